@@ -0,0 +1,155 @@
+/** Accuracy and cost of the fixed-point Arrhenius factor of the firmware
+ *
+ *  Compares arrhenius_factor() with exp(E/R x (1/T_r - 1/T)) in double over -30..90 °C in 0.01 °C
+ *  steps, for activation energies of 20 to 60 kJ/mol. Integrates the equivalent age of a synthetic
+ *  curing profile both ways, like maturity_add(), and times the factor on the host. Exits with 1
+ *  when an error exceeds its tolerance, ctest runs it as a test.
+ *
+ *  usage: tcs_arrhenius_bench [reference °C]
+ */
+extern "C" {
+#include "arrhenius.h"
+}
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+
+constexpr double   GAS_CONSTANT         = 8.314462618;  ///< R [J/(mol·K)]
+constexpr double   ZERO_CELSIUS         = 273.15;       ///< 0 °C [K]
+constexpr double   FACTOR_ONE           = 65536.0;      ///< 1.0 in Q16
+constexpr int16_t  TEMPERATURE_MIN      = -3000;        ///< Range of the comparison [0.01 °C]
+constexpr int16_t  TEMPERATURE_MAX      = 9000;
+constexpr uint32_t PROFILE_INTERVAL     = 600;          ///< Sample interval of the synthetic profile [s]
+constexpr uint32_t PROFILE_SAMPLES      = 28 * 144;     ///< 28 days
+constexpr int      TIMING_REPEAT        = 20;           ///< Sweeps of the range timed for ns/call
+constexpr double   FACTOR_TOLERANCE     = 2e-3;         ///< Largest relative error of a factor
+constexpr double   FACTOR_TOLERANCE_LSB = 16.0;         ///< Allowed on top, small factors are mostly rounding
+constexpr double   AGE_TOLERANCE        = 1e-4;         ///< Largest relative error of the equivalent age
+
+volatile uint32_t  g_sink;                              ///< Keeps the timed factors from being optimized away
+
+
+/**
+ * @brief Function for computing the factor in double, in Q16 units
+ */
+double factor_reference(double activation_energy, double reference, double temperature)
+{
+    return std::exp(activation_energy / GAS_CONSTANT *
+                    (1.0 / (reference + ZERO_CELSIUS) - 1.0 / (temperature + ZERO_CELSIUS))) * FACTOR_ONE;
+}
+
+
+/**
+ * @brief Function for the temperature of the synthetic profile: heat of hydration on a daily cycle
+ *
+ * @return      Temperature [°C]
+ */
+double profile_temperature(uint32_t i)
+{
+    double const hours = i * (PROFILE_INTERVAL / 3600.0);
+    double const hydration = 25.0 * (hours / 12.0) * std::exp(1.0 - hours / 12.0);
+
+    return 8.0 + hydration + 6.0 * std::sin(2.0 * M_PI * hours / 24.0);
+}
+
+} // namespace
+
+
+int main(int argc, char** argv)
+{
+    double const reference = (argc > 1) ? std::atof(argv[1]) : 20.0;
+    int16_t const reference_centi = (int16_t) std::lround(reference * 100.0);
+
+    std::printf("reference %.2f °C, %.2f..%.2f °C\n", reference, TEMPERATURE_MIN / 100.0, TEMPERATURE_MAX / 100.0);
+    std::printf("E [kJ/mol]  max |diff| [LSB]  max rel error  equivalent age [h]  age error\n");
+
+    bool passed = true;
+
+    for (uint32_t energy = 20000; energy <= 60000; energy += 5000)
+    {
+        arrhenius_t arrhenius;
+        arrhenius_init(&arrhenius, energy, reference_centi);
+
+        double max_diff = 0.0;
+        double max_relative = 0.0;
+        uint32_t out_of_tolerance = 0;
+
+        for (int32_t t = TEMPERATURE_MIN; t <= TEMPERATURE_MAX; t++)
+        {
+            double const expected = factor_reference(energy, reference, t / 100.0);
+            double const diff = std::fabs(arrhenius_factor(&arrhenius, (int16_t) t) - expected);
+
+            max_diff = std::max(max_diff, diff);
+            max_relative = std::max(max_relative, diff / expected);
+            if (diff > FACTOR_TOLERANCE * expected + FACTOR_TOLERANCE_LSB)
+            {
+                out_of_tolerance++;
+            }
+        }
+
+        // Trapezoid over the samples, as maturity_add() integrates it
+        uint64_t age_fixed = 0;
+        double age_double = 0.0;
+        uint32_t previous_fixed = 0;
+        double previous_double = 0.0;
+
+        for (uint32_t i = 0; i < PROFILE_SAMPLES; i++)
+        {
+            double const temperature = profile_temperature(i);
+            int16_t const sample = (int16_t) std::lround(temperature * 100.0);
+            uint32_t const factor_fixed = arrhenius_factor(&arrhenius, sample);
+            double const factor_double = factor_reference(energy, reference, sample / 100.0);
+
+            if (i > 0)
+            {
+                age_fixed += (((uint64_t) previous_fixed + factor_fixed) * PROFILE_INTERVAL) / 2;
+                age_double += (previous_double + factor_double) * PROFILE_INTERVAL / 2.0;
+            }
+            previous_fixed = factor_fixed;
+            previous_double = factor_double;
+        }
+
+        double const hours_fixed = (double) age_fixed / FACTOR_ONE / 3600.0;
+        double const hours_double = age_double / FACTOR_ONE / 3600.0;
+        double const age_relative = std::fabs(hours_fixed - hours_double) / hours_double;
+
+        std::printf("%10.1f  %18.2f  %13.2e  %18.3f  %9.2e\n", energy / 1000.0, max_diff, max_relative,
+                    hours_fixed, age_relative);
+
+        if (out_of_tolerance > 0)
+        {
+            std::fprintf(stderr, "FAIL: %.1f kJ/mol, %u factors off by more than %.0e + %.0f LSB\n",
+                         energy / 1000.0, out_of_tolerance, FACTOR_TOLERANCE, FACTOR_TOLERANCE_LSB);
+            passed = false;
+        }
+        if (age_relative > AGE_TOLERANCE)
+        {
+            std::fprintf(stderr, "FAIL: %.1f kJ/mol, equivalent age off by %.2e > %.0e\n",
+                         energy / 1000.0, age_relative, AGE_TOLERANCE);
+            passed = false;
+        }
+    }
+
+    arrhenius_t arrhenius;
+    arrhenius_init(&arrhenius, 40000, reference_centi);
+
+    uint32_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int repeat = 0; repeat < TIMING_REPEAT; repeat++)
+    {
+        for (int32_t t = TEMPERATURE_MIN; t <= TEMPERATURE_MAX; t++)
+        {
+            sink += arrhenius_factor(&arrhenius, (int16_t) t);
+        }
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    uint32_t const calls = TIMING_REPEAT * (TEMPERATURE_MAX - TEMPERATURE_MIN + 1);
+
+    g_sink = sink;
+    std::printf("host: %.1f ns/call\n", elapsed.count() / calls);
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,139 @@
+/** Throughput benchmark of the history stream decoder
+ *
+ *  Builds one history stream per sensor, cuts it into notifications and decodes all streams on
+ *  1 and on N threads. Reports the decoded samples/s in total and per core, the cores being the
+ *  threads up to std::thread::hardware_concurrency().
+ *
+ *  usage: tcs_decoder_bench [streams] [days] [chunk] [threads]
+ */
+#include "tcs_decoder.hpp"
+#include "tcs_fleet.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+namespace {
+
+constexpr uint16_t SAMPLE_INTERVAL      = 600;      ///< Default measurement interval [s]
+constexpr int      REPEAT               = 5;        ///< Runs per configuration, the best one is reported
+
+
+/**
+ * @brief Function for building the history stream of one sensor, as tc_stream_read() sends it
+ */
+std::vector<uint8_t> stream_build(unsigned sensor, uint32_t count)
+{
+    std::vector<float> samples(count);
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        samples[i] = tcs::curing_temperature(sensor, i * SAMPLE_INTERVAL);
+    }
+
+    return tcs::history_stream_build(samples.data(), count, SAMPLE_INTERVAL);
+}
+
+
+/**
+ * @brief Function for decoding every stream once and timing it
+ *
+ * @return      Elapsed time [s], or a negative value if a stream did not decode correctly
+ */
+double run(std::vector<std::vector<tcs::byte_span>> const& chunks, uint32_t expected, unsigned thread_count)
+{
+    std::vector<tcs::stream_decoder> decoders(chunks.size());
+    std::vector<tcs::stream_job> jobs(chunks.size());
+
+    for (size_t i = 0; i < chunks.size(); i++)
+    {
+        jobs[i] = {&chunks[i], &decoders[i]};
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    tcs::decode_parallel(jobs, thread_count);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    for (tcs::stream_decoder const& decoder : decoders)
+    {
+        tcs::decode_stats const& stats = decoder.stats();
+        if (!stats.complete || (stats.samples != expected) || (stats.total_samples != expected) ||
+            (stats.crc_errors != 0) || (stats.bytes_skipped != 0))
+        {
+            return -1.0;
+        }
+    }
+
+    return elapsed.count();
+}
+
+} // namespace
+
+
+int main(int argc, char** argv)
+{
+    unsigned streams = (argc > 1) ? (unsigned) std::atoi(argv[1]) : 2000;
+    unsigned days    = (argc > 2) ? (unsigned) std::atoi(argv[2]) : 14;
+    size_t   chunk   = (argc > 3) ? (size_t) std::atoi(argv[3]) : 244;
+    unsigned threads = (argc > 4) ? (unsigned) std::atoi(argv[4]) : std::thread::hardware_concurrency();
+
+    if ((streams == 0) || (chunk == 0))
+    {
+        std::fprintf(stderr, "usage: %s [streams] [days] [chunk] [threads]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    threads = (threads > 0) ? threads : 1;
+
+    std::vector<std::vector<uint8_t>> data(streams);
+    std::vector<std::vector<tcs::byte_span>> chunks(streams);
+    uint32_t const expected = days * tcs::RECORD_SAMPLES + 37;
+    size_t bytes = 0;
+
+    for (unsigned s = 0; s < streams; s++)
+    {
+        data[s] = stream_build(s, expected);
+        bytes += data[s].size();
+
+        // Cut the stream like the notifications of one ATT MTU
+        for (size_t offset = 0; offset < data[s].size(); offset += chunk)
+        {
+            chunks[s].push_back({&data[s][offset], std::min(chunk, data[s].size() - offset)});
+        }
+    }
+
+    double const samples = (double) expected * streams;
+    unsigned const cores = std::thread::hardware_concurrency();
+
+    std::printf("%u streams, %u samples each, %zu bytes, %zu byte chunks\n", streams, expected, bytes, chunk);
+    std::printf("%8s %14s %18s %10s\n", "threads", "samples/s", "samples/s/core", "MB/s");
+
+    for (unsigned thread_count : {1u, threads})
+    {
+        double best = 0.0;
+
+        for (int r = 0; r < REPEAT; r++)
+        {
+            double elapsed = run(chunks, expected, thread_count);
+            if (elapsed < 0.0)
+            {
+                std::fprintf(stderr, "decode mismatch on %u threads\n", thread_count);
+                return EXIT_FAILURE;
+            }
+            best = ((r == 0) || (elapsed < best)) ? elapsed : best;
+        }
+
+        // Threads beyond the cores share them, 0 if the number of cores is unknown
+        unsigned const busy_cores = ((cores > 0) && (cores < thread_count)) ? cores : thread_count;
+
+        std::printf("%8u %14.0f %18.0f %10.1f\n", thread_count, samples / best, samples / best / busy_cores,
+                    bytes / best / 1e6);
+
+        if (threads == 1)
+        {
+            break;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
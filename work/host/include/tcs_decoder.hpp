@@ -0,0 +1,216 @@
+#ifndef _tcs_decoder_HPP__
+#define _tcs_decoder_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+extern "C" {
+#include "tcs_frame.h"
+#include "adv_status.h"
+}
+
+/** Host side decoder for the data sent by the sensor
+ *
+ *  - the history stream of ble_tcs / ble_tcs_l2cap, a sequence of tcs_frame blocks cut into
+ *    notifications or SDUs of any length
+ *  - the batch record of adv_batch and the status record of adv_status, carried in the
+ *    manufacturer specific advertising data
+ *
+ *  The firmware headers tcs_frame.h and adv_status.h are shared, so the layouts cannot drift.
+ */
+namespace tcs {
+
+/** Batch record constants, see adv_batch.h (not included, it depends on the SoftDevice headers) */
+constexpr uint8_t  ADV_BATCH_RECORD_ID      = 0x81;
+constexpr size_t   ADV_BATCH_HEADER_SIZE    = 8;
+constexpr uint8_t  ADV_BATCH_DELTA_ESCAPE   = 0x80;
+
+/** Largest payload accepted for an encoding the decoder does not know, bounds the buffering of
+ *  a corrupted header */
+constexpr size_t   MAX_UNKNOWN_PAYLOAD      = 4096;
+
+
+/**
+ * @brief Struct for referencing input bytes without copying them
+ */
+struct byte_span
+{
+    uint8_t const*  data;           ///< First byte
+    size_t          size;           ///< Number of bytes
+};
+
+
+/**
+ * @brief Struct for holding a decoded time series, one entry per sample
+ *
+ * @details A summary stream (a coarser level of the history) gives one entry per bucket, with the
+ *          mean as temperature and the bucket index as sequence number. Its range is kept in
+ *          minimum and maximum, which stay empty as long as only raw samples were decoded.
+ *
+ *          A raw sample holds the probe temperature, or the cold junction temperature if only that
+ *          channel was stored. A stream of both channels keeps the cold junction in cold_junction,
+ *          which stays empty as long as only single channel samples were decoded.
+ */
+struct time_series
+{
+    std::vector<uint32_t>   seq;            ///< Sequence number of the sample
+    std::vector<uint32_t>   time;           ///< Time since activation [s]
+    std::vector<float>      temperature;    ///< Temperature [°C]
+    std::vector<float>      minimum;        ///< Lowest sample of the bucket [°C], summary streams only
+    std::vector<float>      maximum;        ///< Highest sample of the bucket [°C], summary streams only
+    std::vector<float>      cold_junction;  ///< Cold junction temperature [°C], NaN where not stored
+
+    size_t size() const { return temperature.size(); }
+    void reserve(size_t count);
+    void clear();
+};
+
+
+/**
+ * @brief Struct for holding the decoder counters
+ */
+struct decode_stats
+{
+    uint64_t    blocks          = 0;        ///< Blocks decoded, end block included
+    uint64_t    samples         = 0;        ///< Samples decoded, or buckets holding samples for a summary stream
+    uint64_t    crc_errors      = 0;        ///< Blocks dropped on a checksum mismatch
+    uint64_t    unknown_blocks  = 0;        ///< Valid blocks with an encoding the decoder does not know
+    uint64_t    bytes_skipped   = 0;        ///< Bytes dropped while searching for the next block
+    bool        complete        = false;    ///< Whether the end block was received
+    uint32_t    total_samples   = 0;        ///< Number of samples announced by the end block
+};
+
+
+/**
+ * @brief Struct for holding the fields of the status record
+ */
+struct adv_status_record
+{
+    float       temperature;        ///< Latest temperature [°C]
+    uint16_t    seq;                ///< Sequence number of the latest sample
+    uint8_t     battery_level;      ///< Battery level [%]
+    uint8_t     faults;             ///< ADV_STATUS_FAULT_* bits
+    uint16_t    unsynced;           ///< Number of samples not yet read out by a gateway
+};
+
+
+/**
+ * @brief Function for computing the block checksum, same as crc16_compute of the SDK
+ *
+ * @param[in]  p_data       Data to checksum
+ * @param[in]  size         Number of bytes
+ * @param[in]  seed         Initial value, 0xFFFF for a new checksum
+ *
+ * @return      CRC-16/CCITT-FALSE of the data
+ */
+uint16_t crc16(uint8_t const* p_data, size_t size, uint16_t seed = 0xFFFF);
+
+
+/**
+ * @brief Function for encoding a block, same as tcs_frame_encode of the firmware
+ *
+ * @details Used by the benchmark and the traffic generators to produce reference streams.
+ *
+ * @param[in]  header       Header fields of the block
+ * @param[in]  p_payload    Payload of the block, header.payload_length bytes
+ * @param[out] out          Buffer the block is appended to
+ */
+void encode_block(tcs_frame_header_t const& header, uint8_t const* p_payload, std::vector<uint8_t>& out);
+
+
+/**
+ * @brief Function for decoding all complete blocks of a contiguous buffer
+ *
+ * @details Bad blocks are skipped by searching for the next magic byte. Decoding stops at the
+ *          first incomplete block, so the caller can keep the remaining bytes.
+ *
+ * @param[in]    input      Bytes of the stream
+ * @param[out]   out        Time series the samples are appended to
+ * @param[inout] stats      Decoder counters
+ *
+ * @return      Number of bytes consumed
+ */
+size_t decode_blocks(byte_span input, time_series& out, decode_stats& stats);
+
+
+/**
+ * @brief Class for decoding one history stream that arrives in chunks
+ *
+ * @details Complete blocks are decoded straight from the chunk. Only a block cut by a chunk
+ *          boundary is copied, into a buffer of at most one block.
+ */
+class stream_decoder
+{
+public:
+    /**
+     * @brief Function for starting a new stream, the decoded samples are kept
+     */
+    void reset();
+
+    /**
+     * @brief Function for decoding a chunk of the stream (a notification or an SDU)
+     *
+     * @param[in] chunk     Bytes of the chunk, only referenced during the call
+     */
+    void push(byte_span chunk);
+
+    time_series&        series()        { return m_series; }
+    time_series const&  series() const  { return m_series; }
+    decode_stats const& stats() const   { return m_stats; }
+
+private:
+    void pending_decode();
+
+    std::vector<uint8_t>    m_pending;      ///< Start of a block cut by a chunk boundary
+    time_series             m_series;
+    decode_stats            m_stats;
+};
+
+
+/**
+ * @brief Function for decoding the status record
+ *
+ * @param[in]  record       Manufacturer specific data after the company identifier
+ * @param[out] status       Fields of the record
+ *
+ * @return      true if the record is a status record of a known version
+ */
+bool decode_adv_status(byte_span record, adv_status_record& status);
+
+
+/**
+ * @brief Function for decoding a batch record
+ *
+ * @param[in]  record       Manufacturer specific data after the company identifier
+ * @param[out] out          Time series the samples are appended to
+ *
+ * @return      true if the record is a complete batch record
+ */
+bool decode_adv_batch(byte_span record, time_series& out);
+
+
+/**
+ * @brief Struct for describing the input of one stream in a parallel decode
+ */
+struct stream_job
+{
+    std::vector<byte_span> const*   p_chunks;   ///< Chunks of the stream, in order of arrival
+    stream_decoder*                 p_decoder;  ///< Decoder owning the state of the stream
+};
+
+
+/**
+ * @brief Function for decoding many streams on several threads
+ *
+ * @details Streams are handed out one at a time, every stream is decoded by one thread only, so
+ *          the decoders need no locking.
+ *
+ * @param[in] jobs          Streams to decode
+ * @param[in] thread_count  Number of threads, 0 for one per hardware thread
+ */
+void decode_parallel(std::vector<stream_job> const& jobs, unsigned thread_count);
+
+} // namespace tcs
+
+#endif // _tcs_decoder_HPP__
@@ -0,0 +1,177 @@
+#ifndef _tcs_fleet_HPP__
+#define _tcs_fleet_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include <queue>
+#include <random>
+#include <vector>
+
+#include "tcs_decoder.hpp"
+
+/** Simulation of the traffic a fleet of sensors sends to the gateways
+ *
+ *  Every sensor is visited by a gateway once per sync period. On a visit it sends its whole history
+ *  like the firmware does: tc_stream_prepare() splits it into one block per storage record, one
+ *  block for the local buffer and an end block, push_data_packets() cuts the stream into
+ *  notifications of (ATT MTU - 3) bytes. A broken link restarts the dump from the first byte on the
+ *  next connection, with a fresh snapshot of the history.
+ *
+ *  The traffic is written as capture records (all fields little endian)
+ *
+ *  | sensor | time_us | type | length | data |
+ *  |   4    |    8    |  1   |   2    |  n   |
+ */
+namespace tcs {
+
+/** Storage layout of the firmware, see storage.h (not included, it depends on the SDK headers) */
+constexpr uint16_t RECORD_SAMPLES       = 144;      ///< MAX_RECORD_SIZE, samples per storage record
+constexpr uint16_t MAX_RECORDS          = 30;       ///< MAX_NUMBER_OF_DAYS, storage records kept
+
+constexpr size_t   CAPTURE_HEADER_SIZE  = 15;       ///< Size of the capture record header in bytes
+
+
+/**
+ * @brief Enum for defining the capture record types
+ */
+enum capture_type : uint8_t
+{
+    CAPTURE_CONNECT         = 1,        ///< A gateway connected and requested the history, no data
+    CAPTURE_NOTIFICATION    = 2,        ///< A notification of the history stream
+    CAPTURE_DISCONNECT      = 3         ///< The link closed, after the end block or in the middle of the stream
+};
+
+
+/**
+ * @brief Struct for holding a capture record
+ */
+struct capture_record
+{
+    uint32_t        sensor;             ///< Identifier of the sensor
+    uint64_t        time_us;            ///< Time since the start of the capture [us]
+    capture_type    type;               ///< Type of the record
+    byte_span       data;               ///< Notification payload, empty for the other types
+};
+
+
+/**
+ * @brief Function for appending a capture record to a buffer
+ */
+void capture_encode(capture_record const& record, std::vector<uint8_t>& out);
+
+
+/**
+ * @brief Function for decoding the complete capture records of a buffer
+ *
+ * @param[in]  input        Bytes of the capture
+ * @param[out] out          Records are appended, their data references the input
+ *
+ * @return      Number of bytes consumed
+ */
+size_t capture_decode(byte_span input, std::vector<capture_record>& out);
+
+
+/**
+ * @brief Function for building the history stream of a sensor, block for block as the firmware
+ *
+ * @param[in] p_samples     Samples since activation, oldest first [°C]
+ * @param[in] count         Number of samples
+ * @param[in] interval      Time between two samples [s]
+ *
+ * @return      Stream as read by tc_stream_read()
+ */
+std::vector<uint8_t> history_stream_build(float const* p_samples, uint32_t count, uint16_t interval);
+
+
+/**
+ * @brief Function for generating a sample of a curing concrete pour
+ *
+ * @param[in] sensor        Identifier of the sensor, varies the curve
+ * @param[in] time          Time since activation [s]
+ *
+ * @return      Temperature [°C]
+ */
+float curing_temperature(uint32_t sensor, uint32_t time);
+
+
+/**
+ * @brief Struct for holding the fleet parameters
+ */
+struct fleet_config
+{
+    uint32_t    sensors             = 10000;    ///< Number of sensors
+    uint32_t    history_days        = 30;       ///< Age of the sensors at the start of the capture [days]
+    uint16_t    interval            = 600;      ///< Time between two samples [s]
+    uint32_t    sync_period         = 3600;     ///< Time between two gateway visits of a sensor [s]
+    uint64_t    duration            = 86400;    ///< Simulated time [s]
+    uint16_t    att_mtu             = 247;      ///< Negotiated ATT MTU
+    uint32_t    conn_interval_us    = 7500;     ///< Connection interval of the bulk link profile [us]
+    uint16_t    packets_per_event   = 4;        ///< Notifications sent per connection event
+    uint32_t    setup_us            = 1000000;  ///< Time from connect to the first notification [us]
+    uint32_t    reconnect_us        = 5000000;  ///< Time from a broken link to the next connect [us]
+    double      drop_rate           = 0.0;      ///< Probability that a notification is lost on the gateway side
+    double      disconnect_rate     = 0.0;      ///< Probability per notification that the link breaks
+    uint64_t    seed                = 1;        ///< Seed of the random generators
+};
+
+
+/**
+ * @brief Struct for holding the fleet counters
+ */
+struct fleet_stats
+{
+    uint64_t    sessions        = 0;        ///< Connections
+    uint64_t    completed       = 0;        ///< Connections that sent the end block
+    uint64_t    notifications   = 0;        ///< Notifications written
+    uint64_t    bytes           = 0;        ///< Notification payload bytes written
+    uint64_t    dropped         = 0;        ///< Notifications lost
+    uint64_t    disconnects     = 0;        ///< Links broken in the middle of a stream
+};
+
+
+/**
+ * @brief Class for generating the traffic of a fleet in time order
+ */
+class fleet_sim
+{
+public:
+    explicit fleet_sim(fleet_config const& config);
+
+    /**
+     * @brief Function for getting the next capture record
+     *
+     * @param[out] record   Next record, its data stays valid until the next call
+     *
+     * @return      false once the simulated time is over
+     */
+    bool next(capture_record& record);
+
+    fleet_stats const& stats() const { return m_stats; }
+
+private:
+    struct sensor_state
+    {
+        uint32_t                id;
+        std::mt19937_64         rng;
+        uint64_t                next_us;            ///< Time of the next event
+        uint64_t                session_us;         ///< Time of the next regular visit
+        bool                    connected;
+        std::vector<uint8_t>    stream;             ///< History snapshot of the connection
+        size_t                  position;           ///< Bytes of the snapshot sent
+    };
+
+    bool step(sensor_state& sensor, capture_record& record);
+    void stream_snapshot(sensor_state& sensor);
+
+    typedef std::pair<uint64_t, uint32_t> event_t;
+
+    fleet_config                m_config;
+    std::vector<sensor_state>   m_sensors;
+    std::priority_queue<event_t, std::vector<event_t>, std::greater<event_t>> m_events;
+    std::vector<float>          m_samples;          ///< Scratch buffer for a history
+    fleet_stats                 m_stats;
+};
+
+} // namespace tcs
+
+#endif // _tcs_fleet_HPP__
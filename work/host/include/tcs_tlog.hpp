@@ -0,0 +1,158 @@
+#ifndef _tcs_tlog_HPP__
+#define _tcs_tlog_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "tcs_decoder.hpp"
+
+/** Host side decoder of the tokenized binary log of the firmware (tlog)
+ *
+ *  The sensor only logs the token of the format string and the raw arguments. The format strings
+ *  are read from the .tlog_fmt section of the firmware ELF file, the token of a string is its
+ *  address in the section.
+ *
+ *  Entry (all fields little endian)
+ *
+ *  | level << 4 | args | token | RTC ticks | args  |
+ *  |        1          |   2   |     3     | 4 x n |
+ */
+namespace tcs {
+
+/** Log constants, see tlog.h (not included, it depends on the SDK headers) */
+constexpr size_t   TLOG_HEADER_SIZE     = 6;
+constexpr uint8_t  TLOG_MAX_ARGS        = 6;
+constexpr uint8_t  TLOG_LEVEL_ERROR     = 1;
+constexpr uint8_t  TLOG_LEVEL_WARNING   = 2;
+constexpr uint8_t  TLOG_LEVEL_INFO      = 3;
+constexpr uint8_t  TLOG_LEVEL_DEBUG     = 4;
+constexpr uint8_t  TLOG_LEVEL_LOST      = 7;
+constexpr uint32_t TLOG_TICK_HZ         = 16384;    ///< app_timer clock, APP_TIMER_CONFIG_RTC_FREQUENCY 1
+constexpr uint32_t TLOG_TICK_WRAP       = 1 << 24;  ///< The RTC counter is 24 bit
+
+
+/**
+ * @brief Struct for holding an entry of the binary log
+ */
+struct tlog_entry
+{
+    uint8_t     level;                      ///< TLOG_LEVEL_*
+    uint8_t     nargs;                      ///< Number of arguments
+    uint16_t    token;                      ///< Address of the format string in .tlog_fmt
+    uint32_t    ticks;                      ///< RTC counter when the entry was written
+    uint32_t    args[TLOG_MAX_ARGS];        ///< Raw arguments, floats as their bits
+};
+
+
+/**
+ * @brief Struct for holding a decoded log line
+ */
+struct tlog_line
+{
+    double      time;                       ///< RTC time, the counter wraps since the first entry included [s]
+    uint8_t     level;                      ///< TLOG_LEVEL_*
+    std::string text;                       ///< Formatted message
+};
+
+
+/**
+ * @brief Class for holding the format strings of a firmware build
+ */
+class tlog_dictionary
+{
+public:
+    /**
+     * @brief Function for loading the .tlog_fmt section of an ELF file, 32 or 64 bit
+     *
+     * @param[in]  p_path       Path of the firmware ELF file
+     * @param[out] error        Reason of a failure
+     *
+     * @return      true if the section was found
+     */
+    bool load_elf(char const* p_path, std::string& error);
+
+    /**
+     * @brief Function for adding a format string, for tests and tools without an ELF file
+     */
+    void add(uint16_t token, std::string format) { m_formats[token] = std::move(format); }
+
+    /**
+     * @brief Function for finding the format string of a token
+     *
+     * @return      The format string, nullptr if the token is unknown
+     */
+    std::string const* find(uint16_t token) const;
+
+    size_t size() const { return m_formats.size(); }
+
+private:
+    std::unordered_map<uint16_t, std::string>   m_formats;
+};
+
+
+/**
+ * @brief Function for decoding the complete entries of a buffer
+ *
+ * @details A byte that cannot start an entry is skipped and counted.
+ *
+ * @param[in]    input      Bytes of the log
+ * @param[out]   out        Entries are appended
+ * @param[inout] skipped    Number of bytes skipped
+ *
+ * @return      Number of bytes consumed
+ */
+size_t tlog_decode(byte_span input, std::vector<tlog_entry>& out, uint64_t& skipped);
+
+
+/**
+ * @brief Function for formatting an entry with its format string
+ *
+ * @details Supports the integer conversions, %c and %f, %e, %g on the float bits. Unknown
+ *          tokens and %s are printed with their raw values.
+ *
+ * @param[in]  entry        Entry to format
+ * @param[in]  dictionary   Format strings of the firmware that wrote the entry
+ *
+ * @return      Formatted message
+ */
+std::string tlog_format(tlog_entry const& entry, tlog_dictionary const& dictionary);
+
+
+/**
+ * @brief Class for decoding a log that arrives in chunks, from RTT or from a file
+ */
+class tlog_decoder
+{
+public:
+    explicit tlog_decoder(tlog_dictionary const& dictionary, uint32_t tick_hz = TLOG_TICK_HZ)
+        : m_dictionary(dictionary), m_tick_hz(tick_hz) {}
+
+    /**
+     * @brief Function for decoding a chunk, an entry cut by the chunk boundary is kept for the next
+     *
+     * @param[in]  chunk        Bytes of the chunk, only referenced during the call
+     * @param[out] out          Lines are appended
+     */
+    void push(byte_span chunk, std::vector<tlog_line>& out);
+
+    uint64_t entries() const { return m_entries; }
+    uint64_t skipped() const { return m_skipped; }
+
+private:
+    tlog_dictionary const&  m_dictionary;
+    uint32_t                m_tick_hz;
+    std::vector<uint8_t>    m_pending;              ///< Bytes not yet decoded
+    std::vector<tlog_entry> m_decoded;              ///< Entries of the current chunk, reused
+    bool                    m_started = false;      ///< Whether an entry was decoded
+    uint32_t                m_last_ticks = 0;       ///< Counter of the previous entry
+    uint64_t                m_wrapped = 0;          ///< Ticks of the counter wraps so far
+    uint64_t                m_entries = 0;
+    uint64_t                m_skipped = 0;
+};
+
+} // namespace tcs
+
+#endif // _tcs_tlog_HPP__
@@ -0,0 +1,579 @@
+#include "tcs_decoder.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+
+namespace tcs {
+
+namespace {
+
+enum class block_result
+{
+    ok,             ///< A complete, valid block
+    need_more,      ///< The header is valid (or incomplete) but the block is not complete yet
+    bad             ///< Not a block, or a block with a checksum mismatch
+};
+
+
+/**
+ * @brief Function for building the CRC table of the polynomial 0x1021, MSB first
+ */
+std::array<uint16_t, 256> crc16_table_build()
+{
+    std::array<uint16_t, 256> table{};
+
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        uint16_t crc = (uint16_t) (i << 8);
+        for (int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 0x8000) ? (uint16_t) ((crc << 1) ^ 0x1021) : (uint16_t) (crc << 1);
+        }
+        table[i] = crc;
+    }
+
+    return table;
+}
+
+std::array<uint16_t, 256> const m_crc16_table = crc16_table_build();
+
+
+bool host_is_little_endian()
+{
+    uint16_t const value = 1;
+    uint8_t first;
+
+    std::memcpy(&first, &value, 1);
+    return first == 1;
+}
+
+bool const m_little_endian = host_is_little_endian();
+
+
+inline uint16_t uint16_decode(uint8_t const* p)
+{
+    return (uint16_t) (p[0] | (p[1] << 8));
+}
+
+inline uint32_t uint32_decode(uint8_t const* p)
+{
+    return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+inline void uint16_encode(uint16_t value, std::vector<uint8_t>& out)
+{
+    out.push_back((uint8_t) value);
+    out.push_back((uint8_t) (value >> 8));
+}
+
+inline void uint32_encode(uint32_t value, std::vector<uint8_t>& out)
+{
+    uint16_encode((uint16_t) value, out);
+    uint16_encode((uint16_t) (value >> 16), out);
+}
+
+
+/**
+ * @brief Function for getting the number of bytes the block at the start of a buffer needs
+ *
+ * @return      TCS_FRAME_HEADER_SIZE while the header is incomplete, else the size of the block
+ */
+inline size_t block_size(uint8_t const* p, size_t size)
+{
+    if (size < TCS_FRAME_HEADER_SIZE)
+    {
+        return TCS_FRAME_HEADER_SIZE;
+    }
+    return TCS_FRAME_SIZE(uint16_decode(&p[14]));
+}
+
+
+/**
+ * @brief Function for checking the header and checksum of the block at the start of a buffer
+ */
+block_result block_parse(uint8_t const* p, size_t size, tcs_frame_header_t& header, decode_stats& stats)
+{
+    if (size == 0)
+    {
+        return block_result::need_more;
+    }
+    if (p[0] != TCS_FRAME_MAGIC)
+    {
+        return block_result::bad;
+    }
+    if (size < TCS_FRAME_HEADER_SIZE)
+    {
+        return block_result::need_more;
+    }
+
+    header.encoding         = (tcs_frame_encoding) p[1];
+    header.count            = uint16_decode(&p[2]);
+    header.seq_base         = uint32_decode(&p[4]);
+    header.time_base        = uint32_decode(&p[8]);
+    header.interval         = uint16_decode(&p[12]);
+    header.payload_length   = uint16_decode(&p[14]);
+
+    // Reject inconsistent headers early, so a false magic byte does not hold up the stream
+    switch (header.encoding)
+    {
+        case TCS_FRAME_ENCODING_FLOAT32:
+            if ((header.count == 0) || (header.payload_length != header.count * sizeof(float)))
+            {
+                return block_result::bad;
+            }
+            break;
+
+        case TCS_FRAME_ENCODING_COLD_JUNCTION:
+            if ((header.count == 0) || (header.payload_length != header.count * TCS_FRAME_COLD_JUNCTION_SIZE))
+            {
+                return block_result::bad;
+            }
+            break;
+
+        case TCS_FRAME_ENCODING_DUAL:
+            if ((header.count == 0) || (header.payload_length != header.count * TCS_FRAME_SAMPLE_MAX_SIZE))
+            {
+                return block_result::bad;
+            }
+            break;
+
+        case TCS_FRAME_ENCODING_SUMMARY:
+            if ((header.count == 0) || (header.payload_length != header.count * TCS_FRAME_SUMMARY_SIZE))
+            {
+                return block_result::bad;
+            }
+            break;
+
+        case TCS_FRAME_ENCODING_END:
+            if ((header.count != 0) || (header.payload_length != 0))
+            {
+                return block_result::bad;
+            }
+            break;
+
+        default:
+            if (header.payload_length > MAX_UNKNOWN_PAYLOAD)
+            {
+                return block_result::bad;
+            }
+            break;
+    }
+
+    size_t const crc_offset = TCS_FRAME_HEADER_SIZE + header.payload_length;
+    if (size < crc_offset + TCS_FRAME_CRC_SIZE)
+    {
+        return block_result::need_more;
+    }
+    if (crc16(p, crc_offset) != uint16_decode(&p[crc_offset]))
+    {
+        stats.crc_errors++;
+        return block_result::bad;
+    }
+
+    return block_result::ok;
+}
+
+
+/**
+ * @brief Function for appending the sequence numbers and times of the samples of a block
+ *
+ * @return      Index of the first appended sample
+ */
+size_t samples_append(tcs_frame_header_t const& header, time_series& out)
+{
+    size_t const base  = out.size();
+    size_t const count = header.count;
+
+    out.seq.resize(base + count);
+    out.time.resize(base + count);
+    out.temperature.resize(base + count);
+
+    uint32_t* p_seq  = &out.seq[base];
+    uint32_t* p_time = &out.time[base];
+    for (size_t i = 0; i < count; i++)
+    {
+        p_seq[i]  = header.seq_base + (uint32_t) i;
+        p_time[i] = header.time_base + (uint32_t) i * header.interval;
+    }
+
+    return base;
+}
+
+
+/**
+ * @brief Function for decoding a float32 channel
+ */
+inline float float_decode(uint8_t const* p)
+{
+    uint32_t const bits = uint32_decode(p);
+    float value;
+
+    std::memcpy(&value, &bits, sizeof(float));
+    return value;
+}
+
+
+/**
+ * @brief Function for decoding a cold junction channel
+ */
+inline float cold_junction_decode(uint8_t const* p)
+{
+    return (float) (int16_t) uint16_decode(p) / TCS_FRAME_COLD_JUNCTION_SCALE;
+}
+
+
+/**
+ * @brief Function for appending the samples of a valid block
+ */
+void block_apply(tcs_frame_header_t const& header, uint8_t const* p_payload, time_series& out, decode_stats& stats)
+{
+    stats.blocks++;
+
+    switch (header.encoding)
+    {
+        case TCS_FRAME_ENCODING_FLOAT32:
+        {
+            size_t const base  = samples_append(header, out);
+            size_t const count = header.count;
+
+            if (m_little_endian)
+            {
+                // The payload already is the in-memory layout, one bulk copy
+                std::memcpy(&out.temperature[base], p_payload, count * sizeof(float));
+            }
+            else
+            {
+                for (size_t i = 0; i < count; i++)
+                {
+                    out.temperature[base + i] = float_decode(&p_payload[i * sizeof(float)]);
+                }
+            }
+
+            stats.samples += count;
+            break;
+        }
+
+        case TCS_FRAME_ENCODING_COLD_JUNCTION:
+        {
+            size_t const base = samples_append(header, out);
+
+            for (size_t i = 0; i < header.count; i++)
+            {
+                out.temperature[base + i] = cold_junction_decode(&p_payload[i * TCS_FRAME_COLD_JUNCTION_SIZE]);
+            }
+
+            stats.samples += header.count;
+            break;
+        }
+
+        case TCS_FRAME_ENCODING_DUAL:
+        {
+            // Single channel samples decoded before into the same series have no cold junction
+            out.cold_junction.resize(out.size(), NAN);
+
+            size_t const base = samples_append(header, out);
+            out.cold_junction.resize(out.size());
+
+            for (size_t i = 0; i < header.count; i++)
+            {
+                uint8_t const* p_sample = &p_payload[i * TCS_FRAME_SAMPLE_MAX_SIZE];
+
+                out.temperature[base + i]   = float_decode(p_sample);
+                out.cold_junction[base + i] = cold_junction_decode(&p_sample[TCS_FRAME_PROBE_SIZE]);
+            }
+
+            stats.samples += header.count;
+            break;
+        }
+
+        case TCS_FRAME_ENCODING_SUMMARY:
+        {
+            // Raw samples decoded before into the same series are their own range
+            out.minimum.insert(out.minimum.end(), out.temperature.begin() + out.minimum.size(), out.temperature.end());
+            out.maximum.insert(out.maximum.end(), out.temperature.begin() + out.maximum.size(), out.temperature.end());
+
+            for (size_t i = 0; i < header.count; i++)
+            {
+                uint8_t const* p_bucket = &p_payload[i * TCS_FRAME_SUMMARY_SIZE];
+                int16_t const minimum   = (int16_t) uint16_decode(&p_bucket[0]);
+                int16_t const maximum   = (int16_t) uint16_decode(&p_bucket[2]);
+                int16_t const mean      = (int16_t) uint16_decode(&p_bucket[4]);
+
+                if (minimum > maximum)
+                {
+                    // No sample in the bucket
+                    continue;
+                }
+
+                out.seq.push_back(header.seq_base + (uint32_t) i);
+                out.time.push_back(header.time_base + (uint32_t) i * header.interval);
+                out.temperature.push_back(mean * 0.01f);
+                out.minimum.push_back(minimum * 0.01f);
+                out.maximum.push_back(maximum * 0.01f);
+                stats.samples++;
+            }
+            break;
+        }
+
+        case TCS_FRAME_ENCODING_END:
+            stats.complete      = true;
+            stats.total_samples = header.seq_base;
+            break;
+
+        default:
+            stats.unknown_blocks++;
+            break;
+    }
+}
+
+} // namespace
+
+
+void time_series::reserve(size_t count)
+{
+    seq.reserve(count);
+    time.reserve(count);
+    temperature.reserve(count);
+}
+
+
+void time_series::clear()
+{
+    seq.clear();
+    time.clear();
+    temperature.clear();
+    minimum.clear();
+    maximum.clear();
+    cold_junction.clear();
+}
+
+
+uint16_t crc16(uint8_t const* p_data, size_t size, uint16_t seed)
+{
+    uint16_t crc = seed;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        crc = (uint16_t) ((crc << 8) ^ m_crc16_table[(uint8_t) ((crc >> 8) ^ p_data[i])]);
+    }
+
+    return crc;
+}
+
+
+void encode_block(tcs_frame_header_t const& header, uint8_t const* p_payload, std::vector<uint8_t>& out)
+{
+    size_t const start = out.size();
+
+    out.push_back(TCS_FRAME_MAGIC);
+    out.push_back((uint8_t) header.encoding);
+    uint16_encode(header.count, out);
+    uint32_encode(header.seq_base, out);
+    uint32_encode(header.time_base, out);
+    uint16_encode(header.interval, out);
+    uint16_encode(header.payload_length, out);
+    out.insert(out.end(), p_payload, p_payload + header.payload_length);
+
+    uint16_encode(crc16(&out[start], out.size() - start), out);
+}
+
+
+size_t decode_blocks(byte_span input, time_series& out, decode_stats& stats)
+{
+    size_t position = 0;
+
+    // Every sample takes at least four bytes, reserve once for the whole batch
+    out.reserve(out.size() + input.size / sizeof(float));
+
+    while (position < input.size)
+    {
+        uint8_t const* p = input.data + position;
+        size_t const remaining = input.size - position;
+        tcs_frame_header_t header;
+
+        block_result result = block_parse(p, remaining, header, stats);
+        if (result == block_result::need_more)
+        {
+            break;
+        }
+
+        if (result == block_result::bad)
+        {
+            // Resynchronize on the next magic byte
+            void const* p_next = std::memchr(p + 1, TCS_FRAME_MAGIC, remaining - 1);
+            size_t skip = (p_next != nullptr) ? (size_t) ((uint8_t const*) p_next - p) : remaining;
+
+            stats.bytes_skipped += skip;
+            position += skip;
+            continue;
+        }
+
+        block_apply(header, p + TCS_FRAME_HEADER_SIZE, out, stats);
+        position += TCS_FRAME_SIZE(header.payload_length);
+    }
+
+    return position;
+}
+
+
+void stream_decoder::reset()
+{
+    m_pending.clear();
+    m_stats.complete      = false;
+    m_stats.total_samples = 0;
+}
+
+
+void stream_decoder::pending_decode()
+{
+    size_t used = decode_blocks({m_pending.data(), m_pending.size()}, m_series, m_stats);
+    m_pending.erase(m_pending.begin(), m_pending.begin() + used);
+}
+
+
+void stream_decoder::push(byte_span chunk)
+{
+    size_t position = 0;
+
+    // Complete the block cut by the previous chunk, copying only the bytes it still needs
+    while (!m_pending.empty() && (position < chunk.size))
+    {
+        size_t need = block_size(m_pending.data(), m_pending.size()) - m_pending.size();
+        size_t take = std::min(need, chunk.size - position);
+
+        m_pending.insert(m_pending.end(), chunk.data + position, chunk.data + position + take);
+        position += take;
+        pending_decode();
+    }
+
+    if (m_pending.empty() && (position < chunk.size))
+    {
+        byte_span rest = {chunk.data + position, chunk.size - position};
+        size_t used = decode_blocks(rest, m_series, m_stats);
+
+        m_pending.assign(rest.data + used, rest.data + rest.size);
+    }
+}
+
+
+bool decode_adv_status(byte_span record, adv_status_record& status)
+{
+    if ((record.size < ADV_STATUS_SIZE) || (record.data[0] != ADV_STATUS_VERSION))
+    {
+        return false;
+    }
+
+    status.temperature      = (int16_t) uint16_decode(&record.data[1]) * 0.01f;
+    status.seq              = uint16_decode(&record.data[3]);
+    status.battery_level    = record.data[5];
+    status.faults           = record.data[6];
+    status.unsynced         = uint16_decode(&record.data[7]);
+
+    return true;
+}
+
+
+bool decode_adv_batch(byte_span record, time_series& out)
+{
+    if ((record.size < ADV_BATCH_HEADER_SIZE) || (record.data[0] != ADV_BATCH_RECORD_ID))
+    {
+        return false;
+    }
+
+    uint16_t const seq_base = uint16_decode(&record.data[1]);
+    uint8_t  const count    = record.data[3];
+    uint16_t const interval = uint16_decode(&record.data[4]);
+    int16_t values[UINT8_MAX];
+    size_t position = ADV_BATCH_HEADER_SIZE;
+
+    if (count == 0)
+    {
+        return false;
+    }
+
+    // Undo the delta coding, a serial dependency, so it is kept apart from the conversion
+    values[0] = (int16_t) uint16_decode(&record.data[6]);
+    for (uint8_t i = 1; i < count; i++)
+    {
+        if (position >= record.size)
+        {
+            return false;
+        }
+
+        uint8_t delta = record.data[position++];
+        if (delta == ADV_BATCH_DELTA_ESCAPE)
+        {
+            if (position + 2 > record.size)
+            {
+                return false;
+            }
+            values[i] = (int16_t) uint16_decode(&record.data[position]);
+            position += 2;
+        }
+        else
+        {
+            values[i] = (int16_t) (values[i - 1] + (int8_t) delta);
+        }
+    }
+
+    size_t const base = out.size();
+
+    out.seq.resize(base + count);
+    out.time.resize(base + count);
+    out.temperature.resize(base + count);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        out.seq[base + i]         = seq_base + (uint32_t) i;
+        out.time[base + i]        = (seq_base + (uint32_t) i) * interval;
+        out.temperature[base + i] = values[i] * 0.01f;
+    }
+
+    return true;
+}
+
+
+void decode_parallel(std::vector<stream_job> const& jobs, unsigned thread_count)
+{
+    std::atomic<size_t> next{0};
+
+    auto worker = [&jobs, &next]()
+    {
+        for (size_t i = next++; i < jobs.size(); i = next++)
+        {
+            for (byte_span const& chunk : *jobs[i].p_chunks)
+            {
+                jobs[i].p_decoder->push(chunk);
+            }
+        }
+    };
+
+    if (thread_count == 0)
+    {
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    if (thread_count == 1)
+    {
+        worker();
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    threads.reserve(thread_count);
+    for (unsigned t = 0; t < thread_count; t++)
+    {
+        threads.emplace_back(worker);
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+}
+
+} // namespace tcs
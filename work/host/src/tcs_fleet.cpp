@@ -0,0 +1,281 @@
+#include "tcs_fleet.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+
+namespace tcs {
+
+namespace {
+
+inline void uint16_encode(uint16_t value, std::vector<uint8_t>& out)
+{
+    out.push_back((uint8_t) value);
+    out.push_back((uint8_t) (value >> 8));
+}
+
+inline void uint32_encode(uint32_t value, std::vector<uint8_t>& out)
+{
+    uint16_encode((uint16_t) value, out);
+    uint16_encode((uint16_t) (value >> 16), out);
+}
+
+inline uint16_t uint16_decode(uint8_t const* p)
+{
+    return (uint16_t) (p[0] | (p[1] << 8));
+}
+
+inline uint32_t uint32_decode(uint8_t const* p)
+{
+    return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+
+/**
+ * @brief Function for appending one block of the history, as tc_stream_build_frame() builds it
+ */
+void history_block_add(float const* p_samples, uint32_t seq_base, uint16_t count, uint16_t interval, std::vector<uint8_t>& out)
+{
+    tcs_frame_header_t header = {};
+
+    header.encoding         = (count > 0) ? TCS_FRAME_ENCODING_FLOAT32 : TCS_FRAME_ENCODING_END;
+    header.count            = count;
+    header.seq_base         = seq_base;
+    header.time_base        = seq_base * interval;
+    header.interval         = interval;
+    header.payload_length   = (uint16_t) (count * sizeof(float));
+
+    // The payload is the little endian float array of the firmware
+    std::vector<uint8_t> payload(header.payload_length);
+    for (uint16_t i = 0; i < count; i++)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &p_samples[seq_base + i], sizeof(bits));
+        payload[i * 4 + 0] = (uint8_t) bits;
+        payload[i * 4 + 1] = (uint8_t) (bits >> 8);
+        payload[i * 4 + 2] = (uint8_t) (bits >> 16);
+        payload[i * 4 + 3] = (uint8_t) (bits >> 24);
+    }
+
+    encode_block(header, payload.data(), out);
+}
+
+} // namespace
+
+
+void capture_encode(capture_record const& record, std::vector<uint8_t>& out)
+{
+    uint32_encode(record.sensor, out);
+    uint32_encode((uint32_t) record.time_us, out);
+    uint32_encode((uint32_t) (record.time_us >> 32), out);
+    out.push_back(record.type);
+    uint16_encode((uint16_t) record.data.size, out);
+    out.insert(out.end(), record.data.data, record.data.data + record.data.size);
+}
+
+
+size_t capture_decode(byte_span input, std::vector<capture_record>& out)
+{
+    size_t position = 0;
+
+    while (input.size - position >= CAPTURE_HEADER_SIZE)
+    {
+        uint8_t const* p = input.data + position;
+        size_t length = uint16_decode(&p[13]);
+
+        if (input.size - position < CAPTURE_HEADER_SIZE + length)
+        {
+            break;
+        }
+
+        capture_record record;
+        record.sensor   = uint32_decode(&p[0]);
+        record.time_us  = uint32_decode(&p[4]) | ((uint64_t) uint32_decode(&p[8]) << 32);
+        record.type     = (capture_type) p[12];
+        record.data     = {p + CAPTURE_HEADER_SIZE, length};
+        out.push_back(record);
+
+        position += CAPTURE_HEADER_SIZE + length;
+    }
+
+    return position;
+}
+
+
+std::vector<uint8_t> history_stream_build(float const* p_samples, uint32_t count, uint16_t interval)
+{
+    std::vector<uint8_t> stream;
+    uint32_t const records = count / RECORD_SAMPLES;
+    uint16_t const local   = (uint16_t) (count % RECORD_SAMPLES);
+
+    stream.reserve(records * TCS_FRAME_SIZE(RECORD_SAMPLES * sizeof(float)) +
+                   TCS_FRAME_SIZE(local * sizeof(float)) + TCS_FRAME_SIZE(0));
+
+    for (uint32_t r = 0; r < records; r++)
+    {
+        history_block_add(p_samples, r * RECORD_SAMPLES, RECORD_SAMPLES, interval, stream);
+    }
+    if (local > 0)
+    {
+        history_block_add(p_samples, records * RECORD_SAMPLES, local, interval, stream);
+    }
+    history_block_add(p_samples, count, 0, interval, stream);
+
+    return stream;
+}
+
+
+float curing_temperature(uint32_t sensor, uint32_t time)
+{
+    float const hours   = time / 3600.0f;
+    float const shift   = 0.05f * (float) (sensor % 64);
+    float const ambient = 15.0f + 4.0f * std::sin(6.2832f * (hours - 9.0f) / 24.0f);
+
+    // Heat of hydration peaks about half a day after the pour and decays over the next days
+    float const hydration = 25.0f * (hours / 12.0f) * std::exp(1.0f - hours / 12.0f);
+
+    return ambient + hydration + shift;
+}
+
+
+fleet_sim::fleet_sim(fleet_config const& config) :
+    m_config(config)
+{
+    m_config.att_mtu            = std::max<uint16_t>(m_config.att_mtu, 23);
+    m_config.packets_per_event  = std::max<uint16_t>(m_config.packets_per_event, 1);
+    m_config.interval           = std::max<uint16_t>(m_config.interval, 1);
+    m_config.sync_period        = std::max<uint32_t>(m_config.sync_period, 1);
+
+    // The curve is the same for every sensor apart from a shift, so it is computed once
+    uint32_t const max_samples = MAX_RECORDS * RECORD_SAMPLES;
+    m_samples.resize(max_samples);
+    for (uint32_t i = 0; i < max_samples; i++)
+    {
+        m_samples[i] = curing_temperature(0, i * m_config.interval);
+    }
+
+    m_sensors.resize(m_config.sensors);
+    for (uint32_t i = 0; i < m_config.sensors; i++)
+    {
+        sensor_state& sensor = m_sensors[i];
+
+        sensor.id           = i;
+        sensor.rng.seed(m_config.seed * 0x9E3779B97F4A7C15ull + i);
+        sensor.session_us   = std::uniform_int_distribution<uint64_t>(0, m_config.sync_period * 1000000ull - 1)(sensor.rng);
+        sensor.next_us      = sensor.session_us;
+        sensor.connected    = false;
+        sensor.position     = 0;
+
+        m_events.push({sensor.next_us, i});
+    }
+}
+
+
+void fleet_sim::stream_snapshot(sensor_state& sensor)
+{
+    uint64_t const age   = m_config.history_days * 86400ull + sensor.next_us / 1000000;
+    uint32_t const count = (uint32_t) std::min<uint64_t>(age / m_config.interval + 1, m_samples.size());
+    float const shift    = curing_temperature(sensor.id, 0) - curing_temperature(0, 0);
+
+    std::vector<float> samples(m_samples.begin(), m_samples.begin() + count);
+    for (float& sample : samples)
+    {
+        sample += shift;
+    }
+
+    sensor.stream   = history_stream_build(samples.data(), count, m_config.interval);
+    sensor.position = 0;
+}
+
+
+bool fleet_sim::step(sensor_state& sensor, capture_record& record)
+{
+    std::uniform_real_distribution<double> chance(0.0, 1.0);
+
+    record.sensor   = sensor.id;
+    record.time_us  = sensor.next_us;
+    record.data     = {nullptr, 0};
+
+    if (!sensor.connected)
+    {
+        stream_snapshot(sensor);
+        sensor.connected = true;
+        sensor.next_us  += m_config.setup_us;
+
+        record.type = CAPTURE_CONNECT;
+        m_stats.sessions++;
+        return true;
+    }
+
+    if (sensor.position >= sensor.stream.size())
+    {
+        // The gateway disconnects after the end block, the next visit is a sync period later
+        sensor.connected = false;
+        sensor.stream    = std::vector<uint8_t>();
+        sensor.session_us += (uint64_t) m_config.sync_period * 1000000;
+        sensor.next_us   = std::max(sensor.session_us, sensor.next_us);
+
+        record.type = CAPTURE_DISCONNECT;
+        m_stats.completed++;
+        return true;
+    }
+
+    if ((m_config.disconnect_rate > 0.0) && (chance(sensor.rng) < m_config.disconnect_rate))
+    {
+        // The dump restarts from the first byte on the next connection
+        sensor.connected = false;
+        sensor.next_us  += m_config.reconnect_us;
+
+        record.type = CAPTURE_DISCONNECT;
+        m_stats.disconnects++;
+        return true;
+    }
+
+    size_t const packet_size = std::min<size_t>(sensor.stream.size() - sensor.position, m_config.att_mtu - 3);
+
+    record.type = CAPTURE_NOTIFICATION;
+    record.data = {&sensor.stream[sensor.position], packet_size};
+
+    sensor.position += packet_size;
+    sensor.next_us  += m_config.conn_interval_us / m_config.packets_per_event;
+
+    if ((m_config.drop_rate > 0.0) && (chance(sensor.rng) < m_config.drop_rate))
+    {
+        m_stats.dropped++;
+        return false;
+    }
+
+    m_stats.notifications++;
+    m_stats.bytes += packet_size;
+    return true;
+}
+
+
+bool fleet_sim::next(capture_record& record)
+{
+    uint64_t const end_us = m_config.duration * 1000000;
+
+    while (!m_events.empty())
+    {
+        sensor_state& sensor = m_sensors[m_events.top().second];
+        m_events.pop();
+
+        bool emitted = step(sensor, record);
+
+        // A link that is still open finishes its stream after the end of the capture
+        if ((sensor.next_us < end_us) || sensor.connected)
+        {
+            m_events.push({sensor.next_us, sensor.id});
+        }
+
+        if (emitted)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+} // namespace tcs
@@ -0,0 +1,333 @@
+#include "tcs_tlog.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+
+namespace tcs {
+
+namespace {
+
+constexpr char TLOG_SECTION[] = ".tlog_fmt";
+
+
+template <typename T>
+T field_read(std::vector<uint8_t> const& data, size_t offset)
+{
+    // ELF files of the firmware are little endian, like the hosts this runs on
+    T value = 0;
+    for (size_t i = 0; i < sizeof(T); i++)
+    {
+        value |= (T) data[offset + i] << (8 * i);
+    }
+    return value;
+}
+
+
+/**
+ * @brief Struct for holding the fields of a section header used by the loader
+ */
+struct section_header
+{
+    uint32_t    name;
+    uint64_t    addr;
+    uint64_t    offset;
+    uint64_t    size;
+};
+
+
+section_header section_read(std::vector<uint8_t> const& data, size_t offset, bool is_64)
+{
+    section_header header;
+
+    header.name = field_read<uint32_t>(data, offset);
+    if (is_64)
+    {
+        header.addr   = field_read<uint64_t>(data, offset + 0x10);
+        header.offset = field_read<uint64_t>(data, offset + 0x18);
+        header.size   = field_read<uint64_t>(data, offset + 0x20);
+    }
+    else
+    {
+        header.addr   = field_read<uint32_t>(data, offset + 0x0C);
+        header.offset = field_read<uint32_t>(data, offset + 0x10);
+        header.size   = field_read<uint32_t>(data, offset + 0x14);
+    }
+    return header;
+}
+
+
+inline uint32_t uint32_decode(uint8_t const* p)
+{
+    return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+
+bool level_is_valid(uint8_t level)
+{
+    return ((level >= TLOG_LEVEL_ERROR) && (level <= TLOG_LEVEL_DEBUG)) || (level == TLOG_LEVEL_LOST);
+}
+
+
+/**
+ * @brief Function for formatting one argument with a printf conversion of the firmware
+ */
+void argument_append(std::string& out, std::string spec, char conversion, uint32_t value)
+{
+    char buffer[64];
+
+    switch (conversion)
+    {
+        case 'd':
+        case 'i':
+            spec += conversion;
+            std::snprintf(buffer, sizeof(buffer), spec.c_str(), (int) (int32_t) value);
+            break;
+
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o':
+        case 'c':
+            spec += conversion;
+            std::snprintf(buffer, sizeof(buffer), spec.c_str(), (unsigned int) value);
+            break;
+
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+        {
+            float number;
+            std::memcpy(&number, &value, sizeof(number));
+            spec += conversion;
+            std::snprintf(buffer, sizeof(buffer), spec.c_str(), (double) number);
+            break;
+        }
+
+        default:
+            // %s and %p, the firmware only logged the address
+            std::snprintf(buffer, sizeof(buffer), "<0x%08x>", (unsigned int) value);
+            break;
+    }
+
+    out += buffer;
+}
+
+} // namespace
+
+
+bool tlog_dictionary::load_elf(char const* p_path, std::string& error)
+{
+    std::ifstream file(p_path, std::ios::binary);
+    if (!file)
+    {
+        error = "cannot open the file";
+        return false;
+    }
+    std::vector<uint8_t> const data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    if ((data.size() < 0x34) || (std::memcmp(data.data(), "\x7F" "ELF", 4) != 0) || (data[5] != 1))
+    {
+        error = "not a little endian ELF file";
+        return false;
+    }
+
+    bool const     is_64     = (data[4] == 2);
+    uint64_t const shoff     = is_64 ? field_read<uint64_t>(data, 0x28) : field_read<uint32_t>(data, 0x20);
+    uint16_t const shentsize = field_read<uint16_t>(data, is_64 ? 0x3A : 0x2E);
+    uint16_t const shnum     = field_read<uint16_t>(data, is_64 ? 0x3C : 0x30);
+    uint16_t const shstrndx  = field_read<uint16_t>(data, is_64 ? 0x3E : 0x32);
+
+    if ((shoff == 0) || (shstrndx >= shnum) || (shoff + (uint64_t) shnum * shentsize > data.size()))
+    {
+        error = "no section headers";
+        return false;
+    }
+
+    section_header const names = section_read(data, shoff + (size_t) shstrndx * shentsize, is_64);
+
+    for (uint16_t i = 0; i < shnum; i++)
+    {
+        section_header const section = section_read(data, shoff + (size_t) i * shentsize, is_64);
+
+        if ((names.offset + section.name + sizeof(TLOG_SECTION) > data.size()) ||
+            (std::memcmp(&data[names.offset + section.name], TLOG_SECTION, sizeof(TLOG_SECTION)) != 0))
+        {
+            continue;
+        }
+        if (section.offset + section.size > data.size())
+        {
+            error = "truncated .tlog_fmt section";
+            return false;
+        }
+
+        // Strings may be padded with zeros for alignment, a token is the address of a first character
+        size_t pos = 0;
+        while (pos < section.size)
+        {
+            char const* p_string = (char const*) &data[section.offset + pos];
+            size_t const length = strnlen(p_string, section.size - pos);
+
+            if (length > 0)
+            {
+                m_formats[(uint16_t) (section.addr + pos)] = std::string(p_string, length);
+            }
+            pos += length + 1;
+        }
+        return true;
+    }
+
+    error = "no .tlog_fmt section, the firmware was built without tlog";
+    return false;
+}
+
+
+std::string const* tlog_dictionary::find(uint16_t token) const
+{
+    auto const it = m_formats.find(token);
+    return (it == m_formats.end()) ? nullptr : &it->second;
+}
+
+
+size_t tlog_decode(byte_span input, std::vector<tlog_entry>& out, uint64_t& skipped)
+{
+    size_t pos = 0;
+
+    while (input.size - pos >= TLOG_HEADER_SIZE)
+    {
+        uint8_t const* p = input.data + pos;
+        tlog_entry entry;
+
+        entry.level = p[0] >> 4;
+        entry.nargs = p[0] & 0x0F;
+
+        if (!level_is_valid(entry.level) || (entry.nargs > TLOG_MAX_ARGS))
+        {
+            pos++;
+            skipped++;
+            continue;
+        }
+
+        size_t const length = TLOG_HEADER_SIZE + entry.nargs * sizeof(uint32_t);
+        if (input.size - pos < length)
+        {
+            break;
+        }
+
+        entry.token = (uint16_t) (p[1] | (p[2] << 8));
+        entry.ticks = (uint32_t) p[3] | ((uint32_t) p[4] << 8) | ((uint32_t) p[5] << 16);
+        for (uint8_t i = 0; i < entry.nargs; i++)
+        {
+            entry.args[i] = uint32_decode(p + TLOG_HEADER_SIZE + i * sizeof(uint32_t));
+        }
+
+        out.push_back(entry);
+        pos += length;
+    }
+
+    return pos;
+}
+
+
+std::string tlog_format(tlog_entry const& entry, tlog_dictionary const& dictionary)
+{
+    char buffer[64];
+
+    if (entry.level == TLOG_LEVEL_LOST)
+    {
+        std::snprintf(buffer, sizeof(buffer), "%u entries lost", (unsigned int) entry.args[0]);
+        return buffer;
+    }
+
+    std::string const* p_format = dictionary.find(entry.token);
+    if (p_format == nullptr)
+    {
+        std::string out;
+        std::snprintf(buffer, sizeof(buffer), "unknown token 0x%04x", entry.token);
+        out = buffer;
+        for (uint8_t i = 0; i < entry.nargs; i++)
+        {
+            std::snprintf(buffer, sizeof(buffer), " 0x%08x", (unsigned int) entry.args[i]);
+            out += buffer;
+        }
+        return out;
+    }
+
+    std::string const& format = *p_format;
+    std::string out;
+    uint8_t arg = 0;
+
+    for (size_t i = 0; i < format.size(); i++)
+    {
+        if (format[i] != '%')
+        {
+            out += format[i];
+            continue;
+        }
+        if ((i + 1 < format.size()) && (format[i + 1] == '%'))
+        {
+            out += '%';
+            i++;
+            continue;
+        }
+
+        // Flags, width and precision are kept, length modifiers dropped: all arguments are 32 bit
+        std::string spec = "%";
+        size_t j = i + 1;
+        while ((j < format.size()) && std::strchr("-+ #0123456789.", format[j]))
+        {
+            spec += format[j++];
+        }
+        while ((j < format.size()) && std::strchr("hlzjt", format[j]))
+        {
+            j++;
+        }
+        if (j >= format.size())
+        {
+            out += format.substr(i);
+            break;
+        }
+
+        if (arg < entry.nargs)
+        {
+            argument_append(out, spec, format[j], entry.args[arg++]);
+        }
+        else
+        {
+            out += "<missing>";
+        }
+        i = j;
+    }
+
+    return out;
+}
+
+
+void tlog_decoder::push(byte_span chunk, std::vector<tlog_line>& out)
+{
+    m_pending.insert(m_pending.end(), chunk.data, chunk.data + chunk.size);
+
+    m_decoded.clear();
+    size_t const consumed = tlog_decode({ m_pending.data(), m_pending.size() }, m_decoded, m_skipped);
+    m_pending.erase(m_pending.begin(), m_pending.begin() + consumed);
+
+    for (tlog_entry const& entry : m_decoded)
+    {
+        if (m_started && (entry.ticks < m_last_ticks))
+        {
+            m_wrapped += TLOG_TICK_WRAP;
+        }
+        m_started = true;
+        m_last_ticks = entry.ticks;
+        m_entries++;
+
+        out.push_back({ (double) (m_wrapped + entry.ticks) / m_tick_hz, entry.level, tlog_format(entry, m_dictionary) });
+    }
+}
+
+} // namespace tcs
@@ -0,0 +1,163 @@
+/** Alert rules of the firmware: debounce and hysteresis both ways, rate and differential rules,
+ *  rules kept across a reset. */
+extern "C" {
+#include "alert.h"
+#include "sdk_fakes.h"
+}
+
+#include "check.hpp"
+
+namespace {
+
+constexpr uint32_t SAMPLE_INTERVAL      = 600;          ///< Measurement interval [s]
+constexpr uint8_t  SLOT                 = 5;
+
+
+/**
+ * @brief Struct for stepping the rules with one sample after the other
+ */
+struct feed
+{
+    uint32_t        seq = 0;
+    alert_report_t  report;
+
+    /** @return     Rules that fired or cleared on the sample */
+    uint8_t operator()(float core, float surface = 20.0f)
+    {
+        bool const changed = alert_evaluate(seq, seq * SAMPLE_INTERVAL, core, surface, &report);
+
+        CHECK(changed == (report.changed != 0));
+        CHECK(report.seq == seq);
+        seq++;
+        return report.changed;
+    }
+};
+
+
+/**
+ * @brief Function for starting with a single rule in SLOT
+ */
+void rule_only(alert_rule_t const& rule)
+{
+    alert_rule_t const off = {ALERT_RULE_OFF, 0, 0, 0};
+
+    alert_init();
+    for (uint8_t i = 0; i < ALERT_RULE_COUNT; i++)
+    {
+        CHECK(alert_rule_set(i, (i == SLOT) ? &rule : &off) == NRF_SUCCESS);
+    }
+}
+
+
+void debounce_check()
+{
+    uint8_t const bit = 1 << SLOT;
+    feed sample;
+
+    rule_only({ALERT_RULE_ABOVE, 3, 3000, 100});
+
+    // A spike shorter than the debounce never fires
+    CHECK(sample(29.0f) == 0);
+    CHECK(sample(31.0f) == 0);
+    CHECK(sample(31.0f) == 0);
+    CHECK(sample(29.0f) == 0);
+    CHECK(sample(31.0f) == 0);
+    CHECK(sample(31.0f) == 0);
+    CHECK(sample(31.0f) == bit);
+    CHECK(alert_active_get() == bit);
+
+    // Back below the threshold but within the hysteresis, still firing
+    CHECK(sample(29.5f) == 0);
+    CHECK(sample(29.5f) == 0);
+    CHECK(sample(29.5f) == 0);
+    CHECK(sample.report.active == bit);
+
+    // Clearing needs the debounce as well
+    CHECK(sample(28.0f) == 0);
+    CHECK(sample(28.0f) == 0);
+    CHECK(sample(31.0f) == 0);
+    CHECK(sample(28.0f) == 0);
+    CHECK(sample(28.0f) == 0);
+    CHECK(sample(28.0f) == bit);
+    CHECK(alert_active_get() == 0);
+}
+
+
+void below_check()
+{
+    uint8_t const bit = 1 << SLOT;
+    feed sample;
+
+    // Debounce 0 acts as 1
+    rule_only({ALERT_RULE_BELOW, 0, 0, 100});
+
+    CHECK(sample(0.5f) == 0);
+    CHECK(sample(-0.5f) == bit);
+    CHECK(sample(0.5f) == 0);
+    CHECK(sample(1.5f) == bit);
+}
+
+
+void rate_check()
+{
+    uint8_t const bit = 1 << SLOT;
+    feed sample;
+
+    // 5 °C/h, the first sample has no rate
+    rule_only({ALERT_RULE_RATE, 2, 500, 100});
+
+    CHECK(sample(20.0f) == 0);
+    CHECK(sample(20.5f) == 0);
+    CHECK(sample(21.5f) == 0);      // 6 °C/h
+    CHECK(sample(20.5f) == bit);    // -6 °C/h counts the same
+    CHECK(sample(20.6f) == 0);
+    CHECK(sample(20.7f) == bit);
+}
+
+
+void differential_check()
+{
+    uint8_t const bit = 1 << SLOT;
+    feed sample;
+
+    rule_only({ALERT_RULE_DIFFERENTIAL, 1, 1900, 100});
+
+    CHECK(sample(38.0f, 20.0f) == 0);
+    CHECK(sample(40.0f, 20.0f) == bit);
+    CHECK(sample(38.5f, 20.0f) == 0);
+    CHECK(sample(2.0f, 20.0f) == 0);
+    CHECK(sample(18.0f, 20.0f) == bit);
+}
+
+
+void restore_check()
+{
+    alert_rule_t const rule = {ALERT_RULE_ABOVE, 1, 3000, 100};
+    feed sample;
+
+    fake_flash_erase();
+    rule_only(rule);
+    CHECK(alert_rule_set(ALERT_RULE_COUNT, &rule) == NRF_ERROR_INVALID_PARAM);
+
+    // After a reset the defaults are replaced by the rules in flash
+    alert_init();
+    alert_restore();
+    CHECK(sample(31.0f) == (1 << SLOT));
+
+    uint8_t data[ALERT_REPORT_SIZE];
+    CHECK(alert_report_encode(&sample.report, data) == ALERT_REPORT_SIZE);
+}
+
+} // namespace
+
+
+int main()
+{
+    debounce_check();
+    below_check();
+    rate_check();
+    differential_check();
+    restore_check();
+
+    return tcs_test::check_result();
+}
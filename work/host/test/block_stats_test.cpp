@@ -0,0 +1,115 @@
+/** Block statistics of the firmware: Welford within a block and the Chan merge across blocks
+ *  against a two pass computation in double. */
+extern "C" {
+#include "block_stats.h"
+#include "sdk_fakes.h"
+}
+
+#include "check.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t BLOCK_SAMPLES        = 144;          ///< Samples per block, one day
+constexpr uint32_t FULL_BLOCKS          = 6;
+constexpr uint32_t PARTIAL_SAMPLES      = 50;           ///< Samples of the block that is filling
+
+
+float sample_temperature(uint32_t i)
+{
+    // Warm concrete with a small daily swing, the variance is small compared to the mean
+    return 45.0f + 2.5f * std::sin(i * 2.0f * (float) M_PI / BLOCK_SAMPLES) - i * 0.004f;
+}
+
+
+/**
+ * @brief Function for checking a query against the samples it covers
+ */
+void query_check(std::vector<float> const& samples, uint16_t first, uint16_t blocks)
+{
+    block_stats_report_t report;
+    size_t const begin = std::min<size_t>((size_t) first * BLOCK_SAMPLES, samples.size());
+    size_t const end   = std::min<size_t>(((size_t) first + blocks) * BLOCK_SAMPLES, samples.size());
+
+    CHECK(block_stats_query(first, blocks, &report) == NRF_SUCCESS);
+    CHECK(report.count == end - begin);
+
+    double mean = 0.0;
+    double m2 = 0.0;
+    float low = samples[begin];
+    float high = samples[begin];
+
+    for (size_t i = begin; i < end; i++)
+    {
+        mean += samples[i];
+        low = std::min(low, samples[i]);
+        high = std::max(high, samples[i]);
+    }
+    mean /= (end - begin);
+    for (size_t i = begin; i < end; i++)
+    {
+        m2 += (samples[i] - mean) * (samples[i] - mean);
+    }
+
+    CHECK(report.min == (int16_t) std::lround(low * 100.0));
+    CHECK(report.max == (int16_t) std::lround(high * 100.0));
+    CHECK_NEAR(report.mean, mean * 100.0, 1);
+    CHECK_NEAR(report.std_dev, std::sqrt(m2 / (end - begin - 1)) * 100.0, 1);
+}
+
+} // namespace
+
+
+int main()
+{
+    std::vector<float> samples;
+
+    fake_flash_erase();
+    block_stats_reset();
+
+    for (uint32_t i = 0; i < FULL_BLOCKS * BLOCK_SAMPLES + PARTIAL_SAMPLES; i++)
+    {
+        samples.push_back(sample_temperature(i));
+        block_stats_add(samples.back());
+        if ((i + 1) % BLOCK_SAMPLES == 0)
+        {
+            block_stats_flush();
+        }
+    }
+
+    // Single blocks, merged blocks, the block that is filling and all of them
+    query_check(samples, 0, 1);
+    query_check(samples, 3, 1);
+    query_check(samples, 1, 3);
+    query_check(samples, FULL_BLOCKS, 1);
+    query_check(samples, 4, 5);
+    query_check(samples, 0, UINT16_MAX);
+
+    block_stats_report_t report;
+    CHECK(block_stats_query(0, UINT16_MAX, &report) == NRF_SUCCESS);
+    CHECK(report.blocks == FULL_BLOCKS + 1);
+    CHECK(block_stats_query(FULL_BLOCKS + 1, 1, &report) == NRF_ERROR_INVALID_PARAM);
+
+    uint8_t data[BLOCK_STATS_REPORT_SIZE];
+    CHECK(block_stats_report_encode(&report, data) == BLOCK_STATS_REPORT_SIZE);
+
+    // One header record per closed block, the queries read them back from flash
+    CHECK(fake_flash_updates() == FULL_BLOCKS);
+    fake_flash_erase();
+    CHECK(block_stats_query(0, 1, &report) == NRF_ERROR_NOT_FOUND);
+    CHECK(block_stats_query(FULL_BLOCKS - 1, 2, &report) == NRF_SUCCESS);
+    CHECK(report.count == BLOCK_SAMPLES + PARTIAL_SAMPLES);
+
+    // A reset starts over and deletes the headers
+    block_stats_add(sample_temperature(0));
+    block_stats_flush();
+    CHECK(fake_flash_updates() == 1);
+    block_stats_reset();
+    CHECK(block_stats_query(0, 1, &report) == NRF_SUCCESS);
+    CHECK(report.count == 0);
+    CHECK(block_stats_query(1, 1, &report) == NRF_ERROR_INVALID_PARAM);
+
+    return tcs_test::check_result();
+}
@@ -0,0 +1,54 @@
+#ifndef _check_HPP__
+#define _check_HPP__
+
+#include <cmath>
+#include <cstdio>
+
+/** Checks of the host tests: a failed check prints where and why, the test carries on and
+ *  check_result() makes main() return 1. */
+
+namespace tcs_test {
+
+inline int& failures()
+{
+    static int count = 0;
+    return count;
+}
+
+inline int check_result()
+{
+    if (failures() > 0)
+    {
+        std::fprintf(stderr, "%d checks failed\n", failures());
+        return 1;
+    }
+    return 0;
+}
+
+} // namespace tcs_test
+
+
+#define CHECK(condition)                                                                            \
+    do                                                                                              \
+    {                                                                                               \
+        if (!(condition))                                                                           \
+        {                                                                                           \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition);      \
+            tcs_test::failures()++;                                                                 \
+        }                                                                                           \
+    } while (0)
+
+#define CHECK_NEAR(actual, expected, tolerance)                                                     \
+    do                                                                                              \
+    {                                                                                               \
+        double const check_actual_   = (double) (actual);                                           \
+        double const check_expected_ = (double) (expected);                                         \
+        if (!(std::fabs(check_actual_ - check_expected_) <= (tolerance)))                           \
+        {                                                                                           \
+            std::fprintf(stderr, "%s:%d: %s is %g, expected %g +- %g\n", __FILE__, __LINE__,        \
+                         #actual, check_actual_, check_expected_, (double) (tolerance));            \
+            tcs_test::failures()++;                                                                 \
+        }                                                                                           \
+    } while (0)
+
+#endif // _check_HPP__
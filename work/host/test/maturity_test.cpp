@@ -0,0 +1,129 @@
+/** Maturity engine of the firmware: Nurse-Saul factor above the datum, equivalent age at the
+ *  reference temperature, trend rate, and the running state kept across a reset. */
+extern "C" {
+#include "maturity.h"
+#include "sdk_config.h"
+#include "sdk_fakes.h"
+}
+
+#include "check.hpp"
+
+#include <cmath>
+
+namespace {
+
+constexpr uint32_t SAMPLE_INTERVAL      = 600;          ///< Measurement interval [s]
+constexpr uint32_t SAMPLES_PER_DAY      = 86400 / SAMPLE_INTERVAL;
+
+
+void constant_check()
+{
+    maturity_report_t report;
+    float const temperature = 20.0f;
+
+    fake_flash_erase();
+    maturity_init();
+
+    // One day of intervals at the reference temperature, MATURITY_DATUM_TEMPERATURE below it
+    for (uint32_t i = 0; i <= SAMPLES_PER_DAY; i++)
+    {
+        maturity_add(temperature, SAMPLE_INTERVAL);
+    }
+    maturity_report_get(&report);
+
+    double const expected = (temperature - MATURITY_DATUM_TEMPERATURE) * 24.0 * 10.0;
+
+    CHECK(report.maturity == (uint32_t) expected);
+    CHECK(report.age == 24 * 60);
+    CHECK(report.temperature == 2000);
+    CHECK(report.datum == MATURITY_DATUM_TEMPERATURE * 100);
+    CHECK_NEAR(report.equivalent_age, 24 * 60, 1);
+    CHECK(report.activation_energy == MATURITY_ACTIVATION_ENERGY / 100);
+
+    // The trend covers the whole day, the rate is the factor gained per day
+    CHECK_NEAR(report.rate, expected, 1);
+}
+
+
+void datum_check()
+{
+    maturity_report_t report;
+
+    fake_flash_erase();
+    maturity_init();
+
+    // Nothing counts below the datum, the time still does
+    for (uint32_t i = 0; i <= SAMPLES_PER_DAY / 2; i++)
+    {
+        maturity_add(MATURITY_DATUM_TEMPERATURE - 5.0f, SAMPLE_INTERVAL);
+    }
+    maturity_report_get(&report);
+
+    CHECK(report.maturity == 0);
+    CHECK(report.age == 12 * 60);
+
+    // Colder is slower: the equivalent age lags the curing time
+    CHECK(report.equivalent_age < report.age / 4);
+}
+
+
+void restore_check()
+{
+    maturity_report_t before;
+    maturity_report_t after;
+
+    fake_flash_erase();
+    maturity_init();
+
+    // A ramp, the state goes to flash every MATURITY_LOG_PERIOD samples
+    for (uint32_t i = 0; i < 20 * MATURITY_LOG_PERIOD; i++)
+    {
+        maturity_add(5.0f + i * 0.1f, SAMPLE_INTERVAL);
+    }
+    maturity_report_get(&before);
+    CHECK(fake_flash_updates() == 20);
+    CHECK(before.maturity > 0);
+
+    maturity_init();
+    maturity_restore();
+    maturity_report_get(&after);
+
+    CHECK(after.maturity == before.maturity);
+    CHECK(after.age == before.age);
+    CHECK(after.equivalent_age == before.equivalent_age);
+    CHECK(after.rate == before.rate);
+
+    // Datums that are not a number or out of range are rejected and the datum is kept
+    CHECK(maturity_datum_set(NAN) == NRF_ERROR_INVALID_PARAM);
+    CHECK(maturity_datum_set(INFINITY) == NRF_ERROR_INVALID_PARAM);
+    CHECK(maturity_datum_set(MATURITY_DATUM_MAX + 1.0f) == NRF_ERROR_INVALID_PARAM);
+    CHECK(maturity_datum_set(MATURITY_DATUM_MIN - 1.0f) == NRF_ERROR_INVALID_PARAM);
+    maturity_report_get(&after);
+    CHECK(after.datum == MATURITY_DATUM_TEMPERATURE * 100);
+
+    // A reset keeps the datum and the activation energy
+    CHECK(maturity_datum_set(0.0f) == NRF_SUCCESS);
+    maturity_activation_energy_set(33000);
+    maturity_reset();
+    maturity_report_get(&after);
+
+    CHECK(after.maturity == 0);
+    CHECK(after.age == 0);
+    CHECK(after.datum == 0);
+    CHECK(after.activation_energy == 330);
+
+    uint8_t data[MATURITY_REPORT_SIZE];
+    CHECK(maturity_report_encode(&after, data) == MATURITY_REPORT_SIZE);
+}
+
+} // namespace
+
+
+int main()
+{
+    constant_check();
+    datum_check();
+    restore_check();
+
+    return tcs_test::check_result();
+}
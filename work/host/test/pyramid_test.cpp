@@ -0,0 +1,140 @@
+/** Coarser levels of the history: buckets of min, max and mean filled by pyramid.c of the
+ *  firmware, sent as summary blocks and decoded by tcs::decode_blocks(). */
+extern "C" {
+#include "pyramid.h"
+}
+
+#include "tcs_decoder.hpp"
+#include "check.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t SAMPLE_INTERVAL      = 600;          ///< Measurement interval [s]
+constexpr uint32_t DURATION             = 2 * 86400;    ///< Time covered by the samples [s]
+constexpr uint32_t GAP_START            = 30000;        ///< Samples missing from here [s]
+constexpr uint32_t GAP_END              = 42000;        ///< to here, level 1 buckets stay empty
+
+
+int16_t sample_centi(uint32_t time)
+{
+    return (int16_t) std::lround((8.0 + 20.0 * std::sin(time / 20000.0) + (time % 7) * 0.01) * 100.0);
+}
+
+
+/**
+ * @brief Struct for holding a bucket computed from the samples
+ */
+struct bucket
+{
+    int32_t     min     = INT16_MAX;
+    int32_t     max     = INT16_MIN;
+    int32_t     sum     = 0;
+    int32_t     samples = 0;
+};
+
+
+void level_check(uint8_t level)
+{
+    uint16_t const period = pyramid_period(level);
+    uint32_t const count  = pyramid_count(level);
+    std::vector<bucket> expected((DURATION + period - 1) / period);
+
+    for (uint32_t time = 0; time < DURATION; time += SAMPLE_INTERVAL)
+    {
+        if ((time >= GAP_START) && (time < GAP_END))
+        {
+            continue;
+        }
+
+        bucket& b = expected[time / period];
+        int16_t const sample = sample_centi(time);
+
+        b.min = std::min<int32_t>(b.min, sample);
+        b.max = std::max<int32_t>(b.max, sample);
+        b.sum += sample;
+        b.samples++;
+    }
+
+    CHECK(count == expected.size());
+
+    // One summary block of the level, as the dump of a level sends it
+    std::vector<uint8_t> payload(count * TCS_FRAME_SUMMARY_SIZE);
+    CHECK(pyramid_encode(level, 0, (uint16_t) count + 5, payload.data()) == payload.size());
+
+    tcs_frame_header_t const header = {TCS_FRAME_ENCODING_SUMMARY, (uint16_t) count, 0, 0, period,
+                                       (uint16_t) payload.size()};
+    std::vector<uint8_t> stream(TCS_FRAME_SIZE(header.payload_length));
+    tcs_frame_encode(&header, payload.data(), stream.data());
+
+    tcs::time_series series;
+    tcs::decode_stats stats;
+    CHECK(tcs::decode_blocks({stream.data(), stream.size()}, series, stats) == stream.size());
+
+    size_t decoded = 0;
+    for (uint32_t i = 0; i < expected.size(); i++)
+    {
+        bucket const& b = expected[i];
+
+        if (b.samples == 0)
+        {
+            // Empty buckets are left out of the series
+            continue;
+        }
+        if (decoded >= series.size())
+        {
+            CHECK(decoded < series.size());
+            break;
+        }
+
+        double const mean = (double) b.sum / b.samples;
+
+        CHECK(series.seq[decoded] == i);
+        CHECK(series.time[decoded] == i * period);
+        CHECK_NEAR(series.minimum[decoded] * 100.0, b.min, 1e-3);
+        CHECK_NEAR(series.maximum[decoded] * 100.0, b.max, 1e-3);
+        CHECK_NEAR(series.temperature[decoded] * 100.0, mean, 0.5 + 1e-3);
+        decoded++;
+    }
+    CHECK(decoded == series.size());
+    CHECK(stats.samples == decoded);
+}
+
+} // namespace
+
+
+int main()
+{
+    pyramid_reset();
+    for (uint32_t time = 0; time < DURATION; time += SAMPLE_INTERVAL)
+    {
+        if ((time < GAP_START) || (time >= GAP_END))
+        {
+            pyramid_add(sample_centi(time) / 100.0f, time);
+        }
+    }
+
+    for (uint8_t level = 1; level < PYRAMID_LEVEL_COUNT; level++)
+    {
+        level_check(level);
+    }
+
+    // Unknown levels
+    CHECK(pyramid_count(0) == 0);
+    CHECK(pyramid_period(PYRAMID_LEVEL_COUNT) == 0);
+
+    // Time runs forward, a late sample does not change a closed bucket
+    uint8_t before[TCS_FRAME_SUMMARY_SIZE];
+    uint8_t after[TCS_FRAME_SUMMARY_SIZE];
+    pyramid_encode(1, 0, 1, before);
+    pyramid_add(-20.0f, 10);
+    pyramid_encode(1, 0, 1, after);
+    CHECK(std::equal(before, before + sizeof(before), after));
+
+    pyramid_reset();
+    CHECK(pyramid_count(1) == 0);
+
+    return tcs_test::check_result();
+}
@@ -0,0 +1,152 @@
+#include <string.h>
+#include "sdk_common.h"
+#include "crc16.h"
+#include "storage.h"
+#include "energy.h"
+#include "sdk_fakes.h"
+
+#define FAKE_RECORD_COUNT       48              ///< Records the fake flash holds, the block headers one per block
+#define FAKE_RECORD_SIZE        1024            ///< Largest record [bytes]
+
+
+/**
+ * @brief Typedef Struct for holding a record of the fake flash
+ */
+typedef struct
+{
+    uint32_t    file_id;                        ///< ID of the file, 0 if unused
+    uint32_t    record_key;                     ///< Key of the record
+    uint32_t    length;                         ///< Length of the data [bytes]
+    uint8_t     data[FAKE_RECORD_SIZE];         ///< Data
+} fake_record_t;
+
+
+static fake_record_t m_records[FAKE_RECORD_COUNT];
+static uint32_t m_updates = 0;
+static uint32_t m_cycles = 0;
+static uint32_t m_ticks = 0;
+
+
+/**
+ * @brief Function for finding a record, or a free slot if create is set
+ */
+static fake_record_t* record_find(uint32_t file_id, uint32_t record_key, bool create)
+{
+    for (uint8_t i = 0; i < FAKE_RECORD_COUNT; i++)
+    {
+        if ((m_records[i].file_id == file_id) && (m_records[i].record_key == record_key))
+        {
+            return &m_records[i];
+        }
+    }
+
+    for (uint8_t i = 0; create && (i < FAKE_RECORD_COUNT); i++)
+    {
+        if (m_records[i].file_id == 0)
+        {
+            m_records[i].file_id    = file_id;
+            m_records[i].record_key = record_key;
+            return &m_records[i];
+        }
+    }
+    return NULL;
+}
+
+
+void fake_flash_erase(void)
+{
+    memset(m_records, 0, sizeof(m_records));
+    m_updates = 0;
+}
+
+
+uint32_t fake_flash_updates(void)
+{
+    return m_updates;
+}
+
+
+ret_code_t fds_update(uint32_t write_file_id, uint32_t write_record_key, void const* p_write_data, uint32_t length_words)
+{
+    fake_record_t* p_record = record_find(write_file_id, write_record_key, true);
+
+    if ((p_record == NULL) || (length_words * WORD > FAKE_RECORD_SIZE))
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    // The fake completes the update at once, the data is not held on to
+    memcpy(p_record->data, p_write_data, length_words * WORD);
+    p_record->length = length_words * WORD;
+    m_updates++;
+    return NRF_SUCCESS;
+}
+
+
+ret_code_t fds_update_deferred(uint32_t write_file_id, uint32_t write_record_key, void const* p_source, uint32_t length_words)
+{
+    // Nothing is in flight, so nothing is deferred
+    return fds_update(write_file_id, write_record_key, p_source, length_words);
+}
+
+
+ret_code_t fds_delete_file(uint32_t file_id)
+{
+    for (uint8_t i = 0; i < FAKE_RECORD_COUNT; i++)
+    {
+        if (m_records[i].file_id == file_id)
+        {
+            memset(&m_records[i], 0, sizeof(m_records[i]));
+        }
+    }
+    return NRF_SUCCESS;
+}
+
+
+uint32_t fds_read_chunk(uint32_t read_file_id, uint32_t read_record_key, uint32_t offset, uint8_t* p_read_data, uint32_t length)
+{
+    fake_record_t const* p_record = record_find(read_file_id, read_record_key, false);
+
+    if ((p_record == NULL) || (offset >= p_record->length))
+    {
+        return 0;
+    }
+
+    length = MIN(length, p_record->length - offset);
+    memcpy(p_read_data, &p_record->data[offset], length);
+    return length;
+}
+
+
+uint32_t energy_cycles_get(void)
+{
+    return m_cycles++;
+}
+
+
+void fake_ticks_set(uint32_t ticks)
+{
+    m_ticks = ticks;
+}
+
+
+uint32_t app_timer_cnt_get(void)
+{
+    return m_ticks;
+}
+
+
+uint16_t crc16_compute(uint8_t const* p_data, uint32_t size, uint16_t const* p_crc)
+{
+    uint16_t crc = (p_crc == NULL) ? 0xFFFF : *p_crc;
+
+    for (uint32_t i = 0; i < size; i++)
+    {
+        crc  = (uint8_t) (crc >> 8) | (crc << 8);
+        crc ^= p_data[i];
+        crc ^= (uint8_t) (crc & 0xFF) >> 4;
+        crc ^= (crc << 8) << 4;
+        crc ^= ((crc & 0xFF) << 4) << 1;
+    }
+    return crc;
+}
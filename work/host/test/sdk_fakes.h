@@ -0,0 +1,35 @@
+#ifndef _sdk_fakes_H__
+#define _sdk_fakes_H__
+
+#include <stdint.h>
+
+/** In-memory stand-ins for the flash storage, the cycle and RTC counters and crc16_compute of the
+ *  SDK, so the firmware modules run on the host. A record written with fds_update() or
+ *  fds_update_deferred() is read back by fds_read_chunk() like after a reset. */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Function for erasing every record of the fake flash
+ */
+void fake_flash_erase(void);
+
+
+/**
+ * @brief Function for getting the number of records written since the last erase
+ */
+uint32_t fake_flash_updates(void);
+
+
+/**
+ * @brief Function for setting the RTC counter returned by app_timer_cnt_get()
+ */
+void fake_ticks_set(uint32_t ticks);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _sdk_fakes_H__
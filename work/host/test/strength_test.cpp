@@ -0,0 +1,151 @@
+/** Strength curve of the firmware: the PCHIP interpolation is monotone, passes through the
+ *  calibration points and never overshoots them, the curve is kept across a reset. */
+extern "C" {
+#include "strength.h"
+#include "sdk_fakes.h"
+}
+
+#include "check.hpp"
+
+#include <vector>
+
+namespace {
+
+/**
+ * @brief Struct for holding a calibration point
+ */
+struct point
+{
+    uint32_t    maturity;               ///< [0.1 °C·h]
+    uint16_t    strength;               ///< [0.01 MPa]
+};
+
+
+ret_code_t curve_upload(std::vector<point> const& points)
+{
+    for (uint8_t i = 0; i < points.size(); i++)
+    {
+        CHECK(strength_point_set(i, points[i].maturity, points[i].strength) == NRF_SUCCESS);
+    }
+    return strength_curve_save((uint8_t) points.size());
+}
+
+
+/**
+ * @brief Function for sweeping the curve one step of maturity after the other
+ */
+void monotone_check(std::vector<point> const& points)
+{
+    CHECK(curve_upload(points) == NRF_SUCCESS);
+
+    uint16_t previous = 0;
+    size_t segment = 0;
+
+    for (uint32_t maturity = 0; maturity <= points.back().maturity + 100; maturity++)
+    {
+        uint16_t const strength = strength_at(maturity);
+
+        CHECK(strength >= previous);
+        previous = strength;
+
+        while ((segment + 1 < points.size()) && (points[segment + 1].maturity <= maturity))
+        {
+            segment++;
+        }
+
+        if (maturity == points[segment].maturity)
+        {
+            CHECK(strength == points[segment].strength);
+        }
+        if ((maturity > points[0].maturity) && (segment + 1 < points.size()))
+        {
+            // No overshoot, a flat stretch stays flat
+            CHECK((strength >= points[segment].strength) && (strength <= points[segment + 1].strength));
+        }
+    }
+    CHECK(previous == points.back().strength);
+}
+
+
+void time_to_target_check()
+{
+    strength_report_t report;
+    uint32_t const rate = 2400;     // 240 °C·h per day, 10 °C·h per hour
+
+    CHECK(curve_upload({{200, 500}, {1000, 1500}, {3000, 3000}, {7000, 4000}}) == NRF_SUCCESS);
+    strength_target_set(2000);
+
+    strength_report_get(500, rate, &report);
+    CHECK(report.points == 4);
+    CHECK(report.target == 2000);
+    CHECK(report.time_to_target != STRENGTH_TIME_UNKNOWN);
+
+    // The predicted time lands on the target, a minute earlier it falls short
+    uint32_t const reached = 500 + (uint32_t) (((uint64_t) report.time_to_target * rate) / (24 * 60));
+    uint32_t const short_of = 500 + (uint32_t) (((uint64_t) (report.time_to_target - 1) * rate) / (24 * 60));
+    CHECK(strength_at(reached) >= 2000);
+    CHECK(strength_at(short_of) < 2000);
+
+    strength_report_get(5000, rate, &report);
+    CHECK(report.time_to_target == 0);
+
+    strength_report_get(500, 0, &report);
+    CHECK(report.time_to_target == STRENGTH_TIME_UNKNOWN);
+
+    uint8_t data[STRENGTH_REPORT_SIZE];
+    CHECK(strength_report_encode(&report, data) == STRENGTH_REPORT_SIZE);
+}
+
+
+void restore_check()
+{
+    std::vector<point> const points = {{100, 300}, {900, 2500}, {1500, 2600}, {9000, 4200}};
+
+    fake_flash_erase();
+    strength_init();
+    CHECK(strength_at(1000) == 0);
+    CHECK(curve_upload(points) == NRF_SUCCESS);
+    strength_target_set(3500);
+
+    std::vector<uint16_t> before;
+    for (uint32_t maturity = 0; maturity < 10000; maturity += 7)
+    {
+        before.push_back(strength_at(maturity));
+    }
+
+    strength_init();
+    strength_restore();
+
+    strength_report_t report;
+    strength_report_get(0, 0, &report);
+    CHECK(report.points == points.size());
+    CHECK(report.target == 3500);
+    for (uint32_t maturity = 0, i = 0; maturity < 10000; maturity += 7, i++)
+    {
+        CHECK(strength_at(maturity) == before[i]);
+    }
+}
+
+} // namespace
+
+
+int main()
+{
+    strength_init();
+
+    // Typical curve, a plateau between steep parts, uneven spacing, a start at 0
+    monotone_check({{150, 400}, {400, 1200}, {800, 2200}, {1600, 3100}, {3200, 3700}, {9600, 4300}});
+    monotone_check({{100, 500}, {200, 2500}, {300, 2500}, {350, 2500}, {5000, 2600}, {5100, 4000}});
+    monotone_check({{0, 0}, {10, 3000}, {20000, 3100}});
+
+    // Rejected curves leave the last one in place
+    CHECK(curve_upload({{100, 500}}) == NRF_ERROR_INVALID_PARAM);
+    CHECK(curve_upload({{100, 500}, {100, 900}}) == NRF_ERROR_INVALID_PARAM);
+    CHECK(curve_upload({{100, 500}, {200, 400}}) == NRF_ERROR_INVALID_PARAM);
+    CHECK(strength_at(20000) == 3100);
+
+    time_to_target_check();
+    restore_check();
+
+    return tcs_test::check_result();
+}
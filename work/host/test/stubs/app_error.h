@@ -0,0 +1,18 @@
+#ifndef APP_ERROR_H__
+#define APP_ERROR_H__
+
+/** Host stand-in for the nRF5 SDK header, an error stops the test */
+
+#include <stdlib.h>
+#include "sdk_errors.h"
+
+#define APP_ERROR_CHECK(err_code)               \
+    do                                          \
+    {                                           \
+        if ((err_code) != NRF_SUCCESS)          \
+        {                                       \
+            abort();                            \
+        }                                       \
+    } while (0)
+
+#endif // APP_ERROR_H__
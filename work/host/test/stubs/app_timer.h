@@ -0,0 +1,10 @@
+#ifndef APP_TIMER_H__
+#define APP_TIMER_H__
+
+/** Host stand-in for the nRF5 SDK header, the RTC counter is set by the test (fake_ticks_set()) */
+
+#include <stdint.h>
+
+uint32_t app_timer_cnt_get(void);
+
+#endif // APP_TIMER_H__
@@ -0,0 +1,46 @@
+#ifndef APP_UTIL_H__
+#define APP_UTIL_H__
+
+/** Host stand-in for the nRF5 SDK header, just what the firmware modules under test use */
+
+#include <stdint.h>
+#include "nordic_common.h"
+
+#define CEIL_DIV(a, b)              ((((a) - 1) / (b)) + 1)
+#define ARRAY_SIZE(arr)             (sizeof(arr) / sizeof((arr)[0]))
+#define STATIC_ASSERT(cond)         _Static_assert(cond, #cond)
+
+// Up to TLOG_MAX_ARGS arguments after the first
+#define NUM_VA_ARGS_LESS_1(...)     NUM_VA_ARGS_LESS_1_(__VA_ARGS__, 6, 5, 4, 3, 2, 1, 0, ~)
+#define NUM_VA_ARGS_LESS_1_(_0, _1, _2, _3, _4, _5, _6, N, ...) N
+#define GET_VA_ARG_1(...)           GET_VA_ARG_1_(__VA_ARGS__, )
+#define GET_VA_ARG_1_(a1, ...)      a1
+
+static inline uint8_t uint16_encode(uint16_t value, uint8_t* p_encoded_data)
+{
+    p_encoded_data[0] = (uint8_t) (value >> 0);
+    p_encoded_data[1] = (uint8_t) (value >> 8);
+    return sizeof(uint16_t);
+}
+
+static inline uint8_t uint32_encode(uint32_t value, uint8_t* p_encoded_data)
+{
+    p_encoded_data[0] = (uint8_t) (value >> 0);
+    p_encoded_data[1] = (uint8_t) (value >> 8);
+    p_encoded_data[2] = (uint8_t) (value >> 16);
+    p_encoded_data[3] = (uint8_t) (value >> 24);
+    return sizeof(uint32_t);
+}
+
+static inline uint16_t uint16_decode(uint8_t const* p_encoded_data)
+{
+    return (uint16_t) (p_encoded_data[0] | (p_encoded_data[1] << 8));
+}
+
+static inline uint32_t uint32_decode(uint8_t const* p_encoded_data)
+{
+    return ((uint32_t) p_encoded_data[0] << 0) | ((uint32_t) p_encoded_data[1] << 8) |
+           ((uint32_t) p_encoded_data[2] << 16) | ((uint32_t) p_encoded_data[3] << 24);
+}
+
+#endif // APP_UTIL_H__
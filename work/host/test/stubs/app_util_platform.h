@@ -0,0 +1,12 @@
+#ifndef APP_UTIL_PLATFORM_H__
+#define APP_UTIL_PLATFORM_H__
+
+/** Host stand-in for the nRF5 SDK header, the tests run in a single thread */
+
+#include <stdint.h>
+#include "app_util.h"
+
+#define CRITICAL_REGION_ENTER()
+#define CRITICAL_REGION_EXIT()
+
+#endif // APP_UTIL_PLATFORM_H__
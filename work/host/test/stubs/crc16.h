@@ -0,0 +1,18 @@
+#ifndef CRC16_H__
+#define CRC16_H__
+
+/** Host stand-in for the nRF5 SDK header, implemented in sdk_fakes.c */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint16_t crc16_compute(uint8_t const* p_data, uint32_t size, uint16_t const* p_crc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CRC16_H__
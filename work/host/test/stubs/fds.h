@@ -0,0 +1,15 @@
+#ifndef FDS_H__
+#define FDS_H__
+
+/** Host stand-in for the nRF5 SDK header, the modules under test only see the storage.h API */
+
+#include <stdint.h>
+#include "sdk_errors.h"
+
+typedef struct
+{
+    uint8_t     id;
+    ret_code_t  result;
+} fds_evt_t;
+
+#endif // FDS_H__
@@ -0,0 +1,16 @@
+#ifndef NORDIC_COMMON_H__
+#define NORDIC_COMMON_H__
+
+/** Host stand-in for the nRF5 SDK header, just what the firmware modules under test use */
+
+#define MIN(a, b)                   ((a) < (b) ? (a) : (b))
+#define MAX(a, b)                   ((a) < (b) ? (b) : (a))
+
+#define UNUSED_PARAMETER(x)         (void) (x)
+#define UNUSED_VARIABLE(x)          (void) (x)
+#define UNUSED_RETURN_VALUE(x)      (void) (x)
+
+#define CONCAT_2(p1, p2)            CONCAT_2_(p1, p2)
+#define CONCAT_2_(p1, p2)           p1##p2
+
+#endif // NORDIC_COMMON_H__
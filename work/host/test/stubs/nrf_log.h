@@ -0,0 +1,11 @@
+#ifndef NRF_LOG_H_
+#define NRF_LOG_H_
+
+/** Host stand-in for the nRF5 SDK header, the tests run without logging */
+
+#define NRF_LOG_ERROR(...)
+#define NRF_LOG_WARNING(...)
+#define NRF_LOG_INFO(...)
+#define NRF_LOG_DEBUG(...)
+
+#endif // NRF_LOG_H_
@@ -0,0 +1,32 @@
+#ifndef SDK_COMMON_H__
+#define SDK_COMMON_H__
+
+/** Host stand-in for the nRF5 SDK header, just what the firmware modules under test use */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "sdk_config.h"
+#include "sdk_errors.h"
+#include "nordic_common.h"
+#include "app_util.h"
+
+#define VERIFY_SUCCESS(err_code)                \
+    do                                          \
+    {                                           \
+        if ((err_code) != NRF_SUCCESS)          \
+        {                                       \
+            return (err_code);                  \
+        }                                       \
+    } while (0)
+
+#define VERIFY_PARAM_NOT_NULL(param)            \
+    do                                          \
+    {                                           \
+        if ((param) == NULL)                    \
+        {                                       \
+            return NRF_ERROR_NULL;              \
+        }                                       \
+    } while (0)
+
+#endif // SDK_COMMON_H__
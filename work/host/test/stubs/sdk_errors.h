@@ -0,0 +1,19 @@
+#ifndef SDK_ERRORS_H__
+#define SDK_ERRORS_H__
+
+/** Host stand-in for the nRF5 SDK header, just what the firmware modules under test use */
+
+#include <stdint.h>
+
+typedef uint32_t ret_code_t;
+
+#define NRF_SUCCESS                 0
+#define NRF_ERROR_NO_MEM            4
+#define NRF_ERROR_NOT_FOUND         5
+#define NRF_ERROR_INVALID_PARAM     7
+#define NRF_ERROR_INVALID_STATE     8
+#define NRF_ERROR_INVALID_LENGTH    9
+#define NRF_ERROR_INVALID_DATA      11
+#define NRF_ERROR_NULL              14
+
+#endif // SDK_ERRORS_H__
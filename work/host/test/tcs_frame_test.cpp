@@ -0,0 +1,160 @@
+/** Round trip of the history stream: blocks built by tcs_frame.c of the firmware for every
+ *  channel mask, decoded by tcs::decode_blocks(). */
+#include "tcs_decoder.hpp"
+#include "check.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+constexpr uint16_t SAMPLE_INTERVAL      = 600;          ///< Measurement interval [s]
+constexpr uint16_t BLOCK_SAMPLES        = 144;          ///< Samples per block, one day like a record
+constexpr uint32_t SAMPLE_COUNT         = 2 * BLOCK_SAMPLES + 50;
+constexpr float    COLD_JUNCTION_STEP   = 1.0f / TCS_FRAME_COLD_JUNCTION_SCALE;
+
+
+float probe_temperature(uint32_t i)
+{
+    return 12.0f + 9.5f * std::sin(i / 23.0f) + i * 0.013f;
+}
+
+
+float cold_junction_temperature(uint32_t i)
+{
+    return 18.0f + 4.0f * std::cos(i / 31.0f) - i * 0.007f;
+}
+
+
+/**
+ * @brief Function for building a stream the way tc_stream_read() sends it, end block included
+ */
+std::vector<uint8_t> stream_build(tcs_frame_encoding encoding, uint32_t* p_blocks)
+{
+    uint8_t const sample_size = tcs_frame_sample_size(encoding);
+    std::vector<uint8_t> stream;
+    std::vector<uint8_t> payload;
+    std::vector<uint8_t> reference;
+
+    *p_blocks = 0;
+    for (uint32_t first = 0; first < SAMPLE_COUNT; first += BLOCK_SAMPLES)
+    {
+        uint16_t const count = (uint16_t) std::min<uint32_t>(BLOCK_SAMPLES, SAMPLE_COUNT - first);
+
+        payload.assign(count * sample_size, 0);
+        for (uint16_t i = 0; i < count; i++)
+        {
+            uint8_t const length = tcs_frame_sample_encode(encoding, probe_temperature(first + i),
+                                                           cold_junction_temperature(first + i),
+                                                           &payload[i * sample_size]);
+            CHECK(length == sample_size);
+        }
+
+        tcs_frame_header_t const header = {encoding, count, first, first * SAMPLE_INTERVAL, SAMPLE_INTERVAL,
+                                           (uint16_t) payload.size()};
+        size_t const offset = stream.size();
+
+        stream.resize(offset + TCS_FRAME_SIZE(header.payload_length));
+        CHECK(tcs_frame_encode(&header, payload.data(), &stream[offset]) == TCS_FRAME_SIZE(header.payload_length));
+
+        // The host encoder of the generators has to produce the same bytes
+        reference.clear();
+        tcs::encode_block(header, payload.data(), reference);
+        CHECK((reference.size() == stream.size() - offset) &&
+              (std::memcmp(reference.data(), &stream[offset], reference.size()) == 0));
+
+        (*p_blocks)++;
+    }
+
+    tcs_frame_header_t const end = {TCS_FRAME_ENCODING_END, 0, SAMPLE_COUNT, SAMPLE_COUNT * SAMPLE_INTERVAL,
+                                    SAMPLE_INTERVAL, 0};
+    size_t const offset = stream.size();
+
+    stream.resize(offset + TCS_FRAME_SIZE(0));
+    tcs_frame_encode(&end, nullptr, &stream[offset]);
+    (*p_blocks)++;
+
+    return stream;
+}
+
+
+void round_trip_check(uint8_t channels)
+{
+    tcs_frame_encoding const encoding = tcs_frame_channels_encoding(channels);
+    bool const has_probe = (channels & TCS_CHANNEL_PROBE) != 0;
+    bool const has_cold_junction = (channels & TCS_CHANNEL_COLD_JUNCTION) != 0;
+    uint32_t blocks;
+
+    std::vector<uint8_t> const stream = stream_build(encoding, &blocks);
+
+    tcs::time_series series;
+    tcs::decode_stats stats;
+    size_t const consumed = tcs::decode_blocks({stream.data(), stream.size()}, series, stats);
+
+    CHECK(consumed == stream.size());
+    CHECK(stats.blocks == blocks);
+    CHECK(stats.samples == SAMPLE_COUNT);
+    CHECK(stats.crc_errors == 0);
+    CHECK(stats.bytes_skipped == 0);
+    CHECK(stats.complete);
+    CHECK(stats.total_samples == SAMPLE_COUNT);
+    CHECK(series.size() == SAMPLE_COUNT);
+    CHECK(series.cold_junction.size() == (has_probe && has_cold_junction ? SAMPLE_COUNT : 0));
+
+    for (uint32_t i = 0; (i < SAMPLE_COUNT) && (i < series.size()); i++)
+    {
+        CHECK(series.seq[i] == i);
+        CHECK(series.time[i] == i * SAMPLE_INTERVAL);
+
+        if (has_probe)
+        {
+            // float32 on the wire, bit exact
+            CHECK(series.temperature[i] == probe_temperature(i));
+        }
+        else
+        {
+            CHECK_NEAR(series.temperature[i], cold_junction_temperature(i), COLD_JUNCTION_STEP / 2);
+        }
+
+        if (has_probe && has_cold_junction)
+        {
+            CHECK_NEAR(series.cold_junction[i], cold_junction_temperature(i), COLD_JUNCTION_STEP / 2);
+        }
+    }
+
+    // The firmware reads back the first channel of a stored sample the same way
+    uint8_t sample[TCS_FRAME_SAMPLE_MAX_SIZE];
+    tcs_frame_sample_encode(encoding, probe_temperature(7), cold_junction_temperature(7), sample);
+    CHECK(tcs_frame_sample_temperature(encoding, sample) == series.temperature[7]);
+}
+
+
+void crc_check()
+{
+    uint32_t blocks;
+    std::vector<uint8_t> stream = stream_build(TCS_FRAME_ENCODING_FLOAT32, &blocks);
+
+    // A flipped payload bit in the first block drops that block only
+    stream[TCS_FRAME_HEADER_SIZE + 5] ^= 0x10;
+
+    tcs::time_series series;
+    tcs::decode_stats stats;
+    tcs::decode_blocks({stream.data(), stream.size()}, series, stats);
+
+    CHECK(stats.crc_errors == 1);
+    CHECK(stats.complete);
+    CHECK(series.size() == SAMPLE_COUNT - BLOCK_SAMPLES);
+}
+
+} // namespace
+
+
+int main()
+{
+    round_trip_check(TCS_CHANNEL_PROBE);
+    round_trip_check(TCS_CHANNEL_COLD_JUNCTION);
+    round_trip_check(TCS_CHANNEL_PROBE | TCS_CHANNEL_COLD_JUNCTION);
+    crc_check();
+
+    return tcs_test::check_result();
+}
@@ -0,0 +1,113 @@
+/** Tokenized log of the firmware: the entries the modules write are read out of the ring and
+ *  decoded with the format strings of the .tlog_fmt section of this executable, a full ring keeps
+ *  the latest entries and reports the lost ones. */
+extern "C" {
+#include "maturity.h"
+#include "sdk_config.h"
+#include "sdk_fakes.h"
+
+// tlog.h is not included, its level macros would replace the constants of tcs_tlog.hpp
+uint32_t tlog_read(uint8_t* p_data, uint32_t size);
+}
+
+#include "check.hpp"
+#include "tcs_tlog.hpp"
+
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t TICK_HZ = tcs::TLOG_TICK_HZ;
+
+/**
+ * @brief Function for reading the whole ring and decoding it
+ */
+std::vector<tcs::tlog_line> ring_decode(tcs::tlog_dictionary const& dictionary)
+{
+    std::vector<uint8_t> log(TLOG_BUFSIZE + tcs::TLOG_HEADER_SIZE + sizeof(uint32_t));
+    uint32_t const length = tlog_read(log.data(), (uint32_t) log.size());
+
+    std::vector<tcs::tlog_line> lines;
+    tcs::tlog_decoder decoder(dictionary, TICK_HZ);
+    decoder.push(tcs::byte_span{ log.data(), length }, lines);
+
+    CHECK(decoder.skipped() == 0);
+    return lines;
+}
+
+
+void format_check(tcs::tlog_dictionary const& dictionary)
+{
+    maturity_init();
+    ring_decode(dictionary);
+
+    fake_ticks_set(3 * TICK_HZ);
+    CHECK(maturity_datum_set(-2.5f) == NRF_SUCCESS);
+    fake_ticks_set(4 * TICK_HZ);
+    maturity_activation_energy_set(40000);
+
+    // A rejected datum is not logged
+    CHECK(maturity_datum_set(NAN) == NRF_ERROR_INVALID_PARAM);
+
+    std::vector<tcs::tlog_line> const lines = ring_decode(dictionary);
+
+    CHECK(lines.size() == 2);
+    if (lines.size() == 2)
+    {
+        // Floats go through the log as their bits
+        CHECK(lines[0].text == "Maturity datum -2.50 °C");
+        CHECK(lines[0].level == tcs::TLOG_LEVEL_INFO);
+        CHECK_NEAR(lines[0].time, 3.0, 1e-9);
+
+        CHECK(lines[1].text == "Maturity activation energy 40000 J/mol");
+        CHECK_NEAR(lines[1].time, 4.0, 1e-9);
+    }
+}
+
+
+void overflow_check(tcs::tlog_dictionary const& dictionary)
+{
+    // Entry of one argument, 10 bytes: the ring holds the last TLOG_BUFSIZE / 10 of them
+    uint32_t const entries = TLOG_BUFSIZE / 10;
+    uint32_t const written = 3 * entries;
+
+    ring_decode(dictionary);
+    fake_ticks_set(TICK_HZ);
+
+    for (uint32_t i = 0; i < written; i++)
+    {
+        maturity_activation_energy_set(30000 + i);
+    }
+
+    std::vector<tcs::tlog_line> const lines = ring_decode(dictionary);
+
+    CHECK(lines.size() == entries + 1);
+    if (lines.size() == entries + 1)
+    {
+        CHECK(lines[0].level == tcs::TLOG_LEVEL_LOST);
+        CHECK(lines[0].text == std::to_string(written - entries) + " entries lost");
+        CHECK(lines[1].text == "Maturity activation energy " + std::to_string(30000 + written - entries) + " J/mol");
+        CHECK(lines.back().text == "Maturity activation energy " + std::to_string(30000 + written - 1) + " J/mol");
+    }
+
+    // The ring is empty after the read
+    CHECK(ring_decode(dictionary).empty());
+}
+
+} // namespace
+
+
+int main()
+{
+    tcs::tlog_dictionary dictionary;
+    std::string error;
+
+    CHECK(dictionary.load_elf("/proc/self/exe", error));
+    CHECK(dictionary.size() > 0);
+
+    format_check(dictionary);
+    overflow_check(dictionary);
+
+    return tcs_test::check_result();
+}
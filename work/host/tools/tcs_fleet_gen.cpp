@@ -0,0 +1,267 @@
+/** Fleet traffic generator
+ *
+ *  Simulates a fleet of sensors and writes the notification streams the gateways receive as
+ *  capture records, to one file, to one file per sensor or to a local TCP socket. The simulated
+ *  time runs as fast as possible or at a multiple of real time.
+ *
+ *  usage: tcs_fleet_gen [options] (--out FILE | --split DIR | --tcp PORT)
+ */
+#include "tcs_fleet.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr size_t FLUSH_SIZE = 1 << 16;      ///< Output is written in blocks of this size
+
+
+void usage(char const* p_name)
+{
+    std::fprintf(stderr,
+        "usage: %s [options] (--out FILE | --split DIR | --tcp PORT)\n"
+        "  --sensors N          number of sensors (10000)\n"
+        "  --days N             history at the start of the capture [days] (30)\n"
+        "  --interval S         time between two samples [s] (600)\n"
+        "  --period S           time between two gateway visits [s] (3600)\n"
+        "  --duration S         simulated time [s] (86400)\n"
+        "  --mtu N              ATT MTU (247)\n"
+        "  --conn-interval US   connection interval [us] (7500)\n"
+        "  --per-event N        notifications per connection event (4)\n"
+        "  --drop P             probability of a lost notification (0)\n"
+        "  --disconnect P       probability per notification of a broken link (0)\n"
+        "  --speed X            simulated time per real time, 0 for as fast as possible (0)\n"
+        "  --seed N             random seed (1)\n", p_name);
+}
+
+
+/**
+ * @brief Class for writing the capture to its destination
+ */
+class capture_sink
+{
+public:
+    ~capture_sink()
+    {
+        flush();
+        if (m_file != nullptr)
+        {
+            std::fclose(m_file);
+        }
+        for (auto& entry : m_split)
+        {
+            std::fclose(entry.second);
+        }
+        if (m_socket >= 0)
+        {
+            close(m_socket);
+        }
+    }
+
+    bool file_open(char const* p_path)
+    {
+        m_file = std::fopen(p_path, "wb");
+        return m_file != nullptr;
+    }
+
+    void split_open(char const* p_dir)
+    {
+        m_dir = p_dir;
+    }
+
+    bool tcp_open(uint16_t port)
+    {
+        sockaddr_in address = {};
+
+        address.sin_family      = AF_INET;
+        address.sin_port        = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        m_socket = socket(AF_INET, SOCK_STREAM, 0);
+        return (m_socket >= 0) && (connect(m_socket, (sockaddr const*) &address, sizeof(address)) == 0);
+    }
+
+    bool write(tcs::capture_record const& record)
+    {
+        if (!m_dir.empty())
+        {
+            return split_write(record);
+        }
+
+        tcs::capture_encode(record, m_buffer);
+        return (m_buffer.size() < FLUSH_SIZE) || flush();
+    }
+
+    bool flush()
+    {
+        size_t written = 0;
+
+        while (written < m_buffer.size())
+        {
+            ssize_t result;
+            if (m_file != nullptr)
+            {
+                result = (ssize_t) std::fwrite(&m_buffer[written], 1, m_buffer.size() - written, m_file);
+            }
+            else if (m_socket >= 0)
+            {
+                result = send(m_socket, &m_buffer[written], m_buffer.size() - written, MSG_NOSIGNAL);
+            }
+            else
+            {
+                result = (ssize_t) (m_buffer.size() - written);
+            }
+
+            if (result <= 0)
+            {
+                return false;
+            }
+            written += (size_t) result;
+        }
+
+        m_buffer.clear();
+        return true;
+    }
+
+private:
+    /**
+     * @brief Function for writing a record to the file of its sensor, the file is open while the
+     *        sensor is connected only
+     */
+    bool split_write(tcs::capture_record const& record)
+    {
+        FILE*& p_file = m_split[record.sensor];
+
+        if (p_file == nullptr)
+        {
+            std::string path = m_dir + "/sensor_" + std::to_string(record.sensor) + ".bin";
+            p_file = std::fopen(path.c_str(), "ab");
+            if (p_file == nullptr)
+            {
+                return false;
+            }
+        }
+
+        m_buffer.clear();
+        tcs::capture_encode(record, m_buffer);
+        bool ok = std::fwrite(m_buffer.data(), 1, m_buffer.size(), p_file) == m_buffer.size();
+        m_buffer.clear();
+
+        if (record.type == tcs::CAPTURE_DISCONNECT)
+        {
+            std::fclose(p_file);
+            m_split.erase(record.sensor);
+        }
+
+        return ok;
+    }
+
+    std::vector<uint8_t>                m_buffer;
+    FILE*                               m_file = nullptr;
+    int                                 m_socket = -1;
+    std::string                         m_dir;
+    std::unordered_map<uint32_t, FILE*> m_split;
+};
+
+} // namespace
+
+
+int main(int argc, char** argv)
+{
+    tcs::fleet_config config;
+    capture_sink sink;
+    double speed = 0.0;
+    bool sink_open = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string option = argv[i];
+
+        if (i + 1 >= argc)
+        {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+
+        char const* p_value = argv[++i];
+
+        if      (option == "--sensors")         config.sensors           = (uint32_t) std::strtoul(p_value, nullptr, 0);
+        else if (option == "--days")            config.history_days      = (uint32_t) std::strtoul(p_value, nullptr, 0);
+        else if (option == "--interval")        config.interval          = (uint16_t) std::strtoul(p_value, nullptr, 0);
+        else if (option == "--period")          config.sync_period       = (uint32_t) std::strtoul(p_value, nullptr, 0);
+        else if (option == "--duration")        config.duration          = std::strtoull(p_value, nullptr, 0);
+        else if (option == "--mtu")             config.att_mtu           = (uint16_t) std::strtoul(p_value, nullptr, 0);
+        else if (option == "--conn-interval")   config.conn_interval_us  = (uint32_t) std::strtoul(p_value, nullptr, 0);
+        else if (option == "--per-event")       config.packets_per_event = (uint16_t) std::strtoul(p_value, nullptr, 0);
+        else if (option == "--drop")            config.drop_rate         = std::strtod(p_value, nullptr);
+        else if (option == "--disconnect")      config.disconnect_rate   = std::strtod(p_value, nullptr);
+        else if (option == "--speed")           speed                    = std::strtod(p_value, nullptr);
+        else if (option == "--seed")            config.seed              = std::strtoull(p_value, nullptr, 0);
+        else if (option == "--out")             sink_open = sink.file_open(p_value);
+        else if (option == "--split")           { sink.split_open(p_value); sink_open = true; }
+        else if (option == "--tcp")             sink_open = sink.tcp_open((uint16_t) std::strtoul(p_value, nullptr, 0));
+        else
+        {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (!sink_open)
+    {
+        std::fprintf(stderr, "no output, or the output could not be opened\n");
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    tcs::fleet_sim sim(config);
+    tcs::capture_record record;
+    auto const start = std::chrono::steady_clock::now();
+
+    while (sim.next(record))
+    {
+        if (speed > 0.0)
+        {
+            auto due = start + std::chrono::microseconds((uint64_t) (record.time_us / speed));
+            if (due > std::chrono::steady_clock::now())
+            {
+                sink.flush();
+                std::this_thread::sleep_until(due);
+            }
+        }
+
+        if (!sink.write(record))
+        {
+            std::fprintf(stderr, "write failed\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (!sink.flush())
+    {
+        std::fprintf(stderr, "write failed\n");
+        return EXIT_FAILURE;
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    tcs::fleet_stats const& stats = sim.stats();
+
+    std::fprintf(stderr, "%u sensors, %llu sessions (%llu complete, %llu broken), %llu notifications, "
+                 "%llu bytes, %llu dropped in %.1f s (%.1f MB/s)\n",
+                 config.sensors, (unsigned long long) stats.sessions, (unsigned long long) stats.completed,
+                 (unsigned long long) stats.disconnects, (unsigned long long) stats.notifications,
+                 (unsigned long long) stats.bytes, (unsigned long long) stats.dropped, elapsed.count(),
+                 stats.bytes / elapsed.count() / 1e6);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,106 @@
+/** Tokenized log decoder
+ *
+ *  Prints the binary log of the firmware (RTT up channel 1, e.g. captured with JLinkRTTLogger)
+ *  as text, with the format strings of the ELF file the sensor runs.
+ *
+ *  usage: tcs_tlog_decode [--tick-hz HZ] FIRMWARE.elf [LOG.bin]
+ */
+#include "tcs_tlog.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <unistd.h>
+
+namespace {
+
+char const* const m_level_names[] = { "", "error", "warning", "info", "debug", "", "", "lost" };
+
+
+void usage(char const* p_name)
+{
+    std::fprintf(stderr,
+        "usage: %s [options] FIRMWARE.elf [LOG.bin]\n"
+        "  --tick-hz HZ         RTC frequency of app_timer (16384)\n"
+        "  reads the log from stdin without LOG.bin\n", p_name);
+}
+
+} // namespace
+
+
+int main(int argc, char** argv)
+{
+    uint32_t tick_hz = tcs::TLOG_TICK_HZ;
+    char const* p_elf = nullptr;
+    char const* p_log = nullptr;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if ((std::strcmp(argv[i], "--tick-hz") == 0) && (i + 1 < argc))
+        {
+            tick_hz = (uint32_t) std::strtoul(argv[++i], nullptr, 0);
+        }
+        else if (p_elf == nullptr)
+        {
+            p_elf = argv[i];
+        }
+        else if (p_log == nullptr)
+        {
+            p_log = argv[i];
+        }
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if ((p_elf == nullptr) || (tick_hz == 0))
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    tcs::tlog_dictionary dictionary;
+    std::string error;
+    if (!dictionary.load_elf(p_elf, error))
+    {
+        std::fprintf(stderr, "%s: %s\n", p_elf, error.c_str());
+        return 1;
+    }
+
+    std::FILE* p_file = (p_log == nullptr) ? stdin : std::fopen(p_log, "rb");
+    if (p_file == nullptr)
+    {
+        std::fprintf(stderr, "%s: cannot open the file\n", p_log);
+        return 1;
+    }
+
+    tcs::tlog_decoder decoder(dictionary, tick_hz);
+    std::vector<tcs::tlog_line> lines;
+    uint8_t chunk[4096];
+    ssize_t length;
+
+    // read() returns what arrived, so a live RTT pipe is printed as it comes
+    while ((length = read(fileno(p_file), chunk, sizeof(chunk))) > 0)
+    {
+        lines.clear();
+        decoder.push({ chunk, (size_t) length }, lines);
+
+        for (tcs::tlog_line const& line : lines)
+        {
+            std::printf("[%12.6f] <%s> %s\n", line.time, m_level_names[line.level & 0x07], line.text.c_str());
+        }
+        std::fflush(stdout);
+    }
+
+    if (p_file != stdin)
+    {
+        std::fclose(p_file);
+    }
+
+    std::fprintf(stderr, "%llu entries, %zu format strings, %llu bytes skipped\n",
+                 (unsigned long long) decoder.entries(), dictionary.size(), (unsigned long long) decoder.skipped());
+    return 0;
+}
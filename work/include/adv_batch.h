@@ -0,0 +1,98 @@
+#ifndef _adv_batch_H__
+#define _adv_batch_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble_gap.h"
+#include "sdk_errors.h"
+#include "app_util.h"
+
+/** Batch record carried in the manufacturer specific data of a non-connectable extended
+ *  advertising packet (all fields little endian)
+ *
+ *  | record_id | seq_base | count | interval | first | delta ... |
+ *  |     1     |    2     |   1   |    2     |   2   |  1 or 3   |
+ *
+ *  Temperatures are signed values in 0.01 °C. The first sample is sent in full, every next sample
+ *  as an int8 difference to the previous one. A difference that does not fit is sent as
+ *  ADV_BATCH_DELTA_ESCAPE followed by the full int16 value. seq_base is the sequence number of
+ *  the first sample, so scanners can merge overlapping batches into one stream.
+ */
+#define ADV_BATCH_RECORD_ID         0x81        ///< First byte of a batch record, a status record starts with ADV_STATUS_VERSION
+#define ADV_BATCH_HEADER_SIZE       8           ///< Size of the batch record header in bytes, first sample included
+#define ADV_BATCH_DELTA_ESCAPE      0x80        ///< Marks a sample sent in full instead of as a difference
+#define ADV_BATCH_DATA_SIZE         BLE_GAP_ADV_SET_DATA_SIZE_EXTENDED_MAX_SUPPORTED    ///< Size of the advertising data
+#define ADV_BATCH_AD_OVERHEAD       4           ///< AD length, AD type and company identifier in front of the record
+
+#define ADV_BATCH_INTERVAL          MSEC_TO_UNITS(100, UNIT_0_625_MS)   ///< Advertising interval during a broadcast window (100 ms)
+#define ADV_BATCH_WINDOW            2000        ///< Length of a broadcast window [ms]
+
+
+/**
+ * @brief Typedef Enum for defining the batch broadcast event types
+ */
+typedef enum
+{
+    ADV_BATCH_EVT_STARTED,          ///< The broadcast window opened, connectable advertising is stopped
+    ADV_BATCH_EVT_STOPPED           ///< The broadcast window closed, the advertising set is free again
+} adv_batch_evt_type_t;
+
+/**
+ * @brief Batch broadcast event handler type
+ */
+typedef void (*adv_batch_evt_handler_t)(adv_batch_evt_type_t evt_type);
+
+
+/**
+ * @brief Function for encoding a batch record
+ *
+ * @details The newest samples are kept, older samples are dropped until the record fits.
+ *
+ * @param[in]  p_samples            Samples, oldest first [°C]
+ * @param[in]  count                Number of samples
+ * @param[in]  seq_base             Sequence number of the first sample
+ * @param[in]  interval             Time between two samples [s]
+ * @param[out] p_data               Buffer for the record
+ * @param[in]  max_length           Size of the buffer in bytes
+ *
+ * @return      Length of the encoded record in bytes, 0 if not even one sample fits
+ */
+uint16_t adv_batch_encode(float const* p_samples, uint16_t count, uint16_t seq_base, uint16_t interval, uint8_t* p_data, uint16_t max_length);
+
+
+/**
+ * @brief Function for initializing the batch broadcaster
+ *
+ * @param[in] evt_handler           Handler for window events
+ */
+void adv_batch_init(adv_batch_evt_handler_t evt_handler);
+
+
+/**
+ * @brief Function for broadcasting the most recent samples
+ *
+ * @details Stops the advertising on the set and reconfigures it as non-connectable extended
+ *          advertising for ADV_BATCH_WINDOW ms. The owner of the set restarts its advertising on
+ *          ADV_BATCH_EVT_STOPPED.
+ *
+ * @param[in] adv_handle            Advertising set to use
+ * @param[in] company_id            Company identifier of the manufacturer specific data
+ * @param[in] p_samples             Samples, oldest first [°C]
+ * @param[in] count                 Number of samples
+ * @param[in] seq_base              Sequence number of the first sample
+ * @param[in] interval              Time between two samples [s]
+ *
+ * @return      NRF_SUCCESS if successful, NRF_ERROR_BUSY if a window is open, else error code
+ */
+ret_code_t adv_batch_broadcast(uint8_t adv_handle, uint16_t company_id, float const* p_samples, uint16_t count, uint16_t seq_base, uint16_t interval);
+
+
+/**
+ * @brief Function for checking if a broadcast window is open
+ *
+ * @return      Boolean indicating the window status
+ */
+bool adv_batch_is_active(void);
+
+
+#endif // _adv_batch_H__
@@ -0,0 +1,94 @@
+#ifndef _adv_policy_H__
+#define _adv_policy_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble_advertising.h"
+#include "sdk_errors.h"
+
+/** Estimated charge per advertising event at +8 dBm, measure with a power profiler and adjust */
+#define ADV_POLICY_LEGACY_EVENT_CHARGE      25000       ///< Connectable legacy event on 3 channels, incl. scan request listening [nC]
+#define ADV_POLICY_EXTENDED_EVENT_CHARGE    60000       ///< Non-connectable extended event, 3 primary channels + 255 byte AUX packet [nC]
+
+#define ADV_POLICY_TICK                     60000       ///< Accounting and scheduling period [ms], below the app_timer counter wrap
+#define ADV_POLICY_MINUTES_PER_DAY          1440        ///< Number of accounting periods per reported day
+#define ADV_POLICY_BLE_OBSERVER_PRIO        2           ///< Priority of the BLE observer
+
+
+/**
+ * @brief Typedef Enum for defining the reasons to restore fast advertising
+ */
+typedef enum
+{
+    ADV_POLICY_TRIGGER_ACTIVATION,      ///< Measurements were activated
+    ADV_POLICY_TRIGGER_ALERT,           ///< An alert was raised
+    ADV_POLICY_TRIGGER_BUTTON,          ///< The button was pressed
+    ADV_POLICY_TRIGGER_LOW_BATTERY      ///< The battery is about to die, the history should be offloaded
+} adv_policy_trigger_t;
+
+/**
+ * @brief Typedef Struct for holding the advertising policy configuration
+ */
+typedef struct
+{
+    ble_advertising_t*  p_advertising;      ///< Advertising module instance the policy drives
+    uint32_t            fast_interval;      ///< Fast advertising interval [0.625 ms]
+    uint32_t            slow_interval;      ///< Slow advertising interval [0.625 ms]
+    uint32_t            batch_interval;     ///< Batch broadcast interval [0.625 ms]
+    uint16_t            sync_period;        ///< Time between the starts of two sync windows [min], 0 to advertise slow continuously
+} adv_policy_init_t;
+
+
+/**
+ * @brief Function for initializing the advertising policy
+ *
+ * @details Fast advertising times out into slow advertising through the Advertising module
+ *          configuration. The policy restarts the advertising on connect (slow, while a link is
+ *          free) and on disconnect (fast), so ble_adv_on_disconnect_disabled must be set. With sync windows the slow advertising also times out, the policy
+ *          reopens it at the start of every window.
+ *
+ * @param[in] p_init                Policy configuration
+ */
+void adv_policy_init(adv_policy_init_t const* p_init);
+
+
+/**
+ * @brief Function for restoring fast advertising
+ *
+ * @details Has no effect while every peripheral link is in use. During a batch broadcast the fast advertising starts
+ *          when the broadcast window closes.
+ *
+ * @param[in] trigger               Reason for restoring fast advertising
+ */
+void adv_policy_restore_fast(adv_policy_trigger_t trigger);
+
+
+/**
+ * @brief Function for passing the Advertising module events to the policy
+ *
+ * @param[in] ble_adv_evt           Advertising event
+ */
+void adv_policy_on_adv_evt(ble_adv_evt_t ble_adv_evt);
+
+
+/**
+ * @brief Function for passing the batch broadcast window state to the policy
+ *
+ * @details When the window closes, the advertising that was running before is resumed.
+ *
+ * @param[in] active                Boolean indicating if the broadcast window is open
+ */
+void adv_policy_on_batch(bool active);
+
+
+/**
+ * @brief Function for getting the estimated advertising charge
+ *
+ * @param[in] previous_day          Charge of the last completed day instead of the running day
+ *
+ * @return      Estimated charge spent on advertising [uC]
+ */
+uint32_t adv_policy_charge_get(bool previous_day);
+
+
+#endif // _adv_policy_H__
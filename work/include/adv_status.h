@@ -0,0 +1,59 @@
+#ifndef _adv_status_H__
+#define _adv_status_H__
+
+#include <stdint.h>
+
+/** Status record carried in the manufacturer specific advertising data (all fields little endian)
+ *
+ *  | version | temperature | seq | battery | faults | unsynced |
+ *  |    1    |      2      |  2  |    1    |   1    |    2     |
+ *
+ *  The temperature is a signed value in 0.01 °C, saturated to the int16 range. Together with the
+ *  flags, short name and company identifier the advertising packet stays within 31 bytes.
+ */
+#define ADV_STATUS_COMPANY_ID       0xFFFF      ///< Company identifier, 0xFFFF is reserved for testing
+#define ADV_STATUS_VERSION          0x01        ///< Version of the status record layout
+#define ADV_STATUS_SIZE             9           ///< Size of the status record in bytes
+
+#define ADV_STATUS_FAULT_SENSOR     (1 << 0)    ///< The MAX31856 reported a fault for the latest sample
+#define ADV_STATUS_FAULT_STORAGE    (1 << 1)    ///< The history is full, no more samples are stored
+#define ADV_STATUS_FAULT_BATTERY    (1 << 2)    ///< The battery level is below ADV_STATUS_BATTERY_LOW
+#define ADV_STATUS_FAULT_ALERT      (1 << 3)    ///< An alert rule is firing, see alert.h
+#define ADV_STATUS_BATTERY_LOW      10          ///< Battery level below which the battery fault is set [%]
+
+
+/**
+ * @brief Typedef Struct for holding the fields of the status record
+ */
+typedef struct
+{
+    float       temperature;        ///< Latest temperature [°C]
+    uint16_t    seq;                ///< Sequence number of the latest sample
+    uint8_t     battery_level;      ///< Battery level [%]
+    uint8_t     faults;             ///< ADV_STATUS_FAULT_* bits
+    uint16_t    unsynced;           ///< Number of samples not yet read out by a gateway
+} adv_status_t;
+
+
+/**
+ * @brief Function for converting a temperature to the advertised fixed point format
+ *
+ * @param[in]  temperature          Temperature [°C]
+ *
+ * @return      Temperature in 0.01 °C, rounded and saturated to the int16 range
+ */
+int16_t adv_status_temperature_encode(float temperature);
+
+
+/**
+ * @brief Function for encoding the status record
+ *
+ * @param[in]  p_status             Fields of the status record
+ * @param[out] p_data               Buffer for the record, at least ADV_STATUS_SIZE bytes
+ *
+ * @return      Length of the encoded record in bytes
+ */
+uint8_t adv_status_encode(adv_status_t const* p_status, uint8_t* p_data);
+
+
+#endif // _adv_status_H__
@@ -0,0 +1,116 @@
+#ifndef _alert_H__
+#define _alert_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdk_errors.h"
+
+/** Alert rules, evaluated on every stored sample. The core is the thermocouple in the concrete,
+ *  the surface the cold junction on the board. A rule fires after `debounce` samples beyond the
+ *  threshold and clears after `debounce` samples back within threshold minus hysteresis. */
+#define ALERT_RULE_COUNT                8           ///< Number of rule slots, one bit each in the active mask
+
+#define ALERT_FILE_ID                   0x3189      ///< FDS file holding the rules, kept across resets
+#define ALERT_REC_KEY                   0x0001      ///< FDS record key of the rules
+
+#define ALERT_REPORT_SIZE               10          ///< active u8 | changed u8 | seq u32 | core i16 | surface i16, little endian
+
+
+/**
+ * @brief Typedef Enum for defining the rule types
+ */
+typedef enum
+{
+    ALERT_RULE_OFF,                     ///< Unused slot
+    ALERT_RULE_ABOVE,                   ///< Core above the threshold [0.01 °C]
+    ALERT_RULE_BELOW,                   ///< Core below the threshold [0.01 °C]
+    ALERT_RULE_RATE,                    ///< Core rising or falling faster than the threshold [0.01 °C/h]
+    ALERT_RULE_DIFFERENTIAL,            ///< Core and surface further apart than the threshold [0.01 °C]
+    ALERT_RULE_TYPE_COUNT
+} alert_rule_type_t;
+
+/**
+ * @brief Typedef Struct for holding a rule, as stored in flash
+ */
+typedef struct
+{
+    uint8_t     type;                   ///< alert_rule_type_t
+    uint8_t     debounce;               ///< Consecutive samples needed to fire and to clear
+    int16_t     threshold;              ///< Threshold, unit depends on the type
+    int16_t     hysteresis;             ///< Distance back from the threshold needed to clear, same unit
+} alert_rule_t;
+
+/**
+ * @brief Typedef Struct for holding the alert report
+ */
+typedef struct
+{
+    uint8_t     active;                 ///< Rules that are firing, bit n for slot n
+    uint8_t     changed;                ///< Rules that fired or cleared on this sample
+    uint32_t    seq;                    ///< Sequence number of the sample
+    int16_t     core;                   ///< Core temperature [0.01 °C]
+    int16_t     surface;                ///< Surface temperature [0.01 °C]
+} alert_report_t;
+
+
+/**
+ * @brief Function for initializing the rules with the ALERT_* defaults of sdk_config.h
+ */
+void alert_init(void);
+
+
+/**
+ * @brief Function for restoring the rules from flash
+ *
+ * @details Call once FDS is initialized, the defaults stay if nothing is stored.
+ */
+void alert_restore(void);
+
+
+/**
+ * @brief Function for setting a rule and writing the rules to flash
+ *
+ * @details The rule starts cleared.
+ *
+ * @param[in] index                 Slot of the rule
+ * @param[in] p_rule                Rule, ALERT_RULE_OFF to remove it
+ *
+ * @return      NRF_SUCCESS, NRF_ERROR_INVALID_PARAM if the slot or the type is unknown
+ */
+ret_code_t alert_rule_set(uint8_t index, alert_rule_t const* p_rule);
+
+
+/**
+ * @brief Function for evaluating the rules on a sample
+ *
+ * @param[in]  seq                  Sequence number of the sample
+ * @param[in]  time                 Time of the sample since activation [s]
+ * @param[in]  core                 Core temperature [°C]
+ * @param[in]  surface              Surface temperature [°C]
+ * @param[out] p_report             Report of the sample
+ *
+ * @return      True if a rule fired or cleared
+ */
+bool alert_evaluate(uint32_t seq, uint32_t time, float core, float surface, alert_report_t* p_report);
+
+
+/**
+ * @brief Function for getting the rules that are firing
+ *
+ * @return      Bit n set if the rule in slot n is firing
+ */
+uint8_t alert_active_get(void);
+
+
+/**
+ * @brief Function for encoding the alert report
+ *
+ * @param[in]  p_report             Report to encode
+ * @param[out] p_data               Buffer of ALERT_REPORT_SIZE bytes
+ *
+ * @return      Number of bytes encoded
+ */
+uint8_t alert_report_encode(alert_report_t const* p_report, uint8_t* p_data);
+
+
+#endif // _alert_H__
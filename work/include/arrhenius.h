@@ -0,0 +1,62 @@
+#ifndef _arrhenius_H__
+#define _arrhenius_H__
+
+#include <stdint.h>
+
+/**
+ * Arrhenius age conversion factor in fixed point, exp(E/R x (1/T_r - 1/T))
+ *
+ * The exponential is computed as a power of two: the integer part is a shift, the fraction is
+ * interpolated in a 65 entry table of 2^(i/64). No float and no library call per sample, one
+ * 64 bit division. Depends on nothing but stdint, so the host tools build the same code.
+ */
+
+#define ARRHENIUS_FACTOR_SHIFT          16              ///< Factors are Q16, 1.0 is 65536
+#define ARRHENIUS_FACTOR_MAX            UINT32_MAX      ///< Saturated factor, beyond 2^16
+#define ARRHENIUS_ZERO_CELSIUS          27315           ///< 0 °C [0.01 K]
+#define ARRHENIUS_LOG2E_OVER_R_Q32      745246963       ///< log2(e) / R in Q32 [mol·K/J], R = 8.314462618
+
+
+/**
+ * @brief Typedef Struct for holding the constants of an activation energy
+ */
+typedef struct
+{
+    int64_t     slope;                  ///< E/R x log2(e) in Q16 [K]
+    int32_t     reference;              ///< Reference temperature [0.01 K]
+} arrhenius_t;
+
+
+/**
+ * @brief Function for computing the constants of an activation energy
+ *
+ * @param[out] p_arrhenius              Constants
+ * @param[in]  activation_energy        Activation energy [J/mol]
+ * @param[in]  reference                Reference temperature [0.01 °C]
+ */
+void arrhenius_init(arrhenius_t* p_arrhenius, uint32_t activation_energy, int16_t reference);
+
+
+/**
+ * @brief Function for computing 2^(y / 65536)
+ *
+ * @param[in] y                         Exponent in Q16
+ *
+ * @return      Power in Q16, ARRHENIUS_FACTOR_MAX if it does not fit
+ */
+uint32_t arrhenius_exp2(int32_t y);
+
+
+/**
+ * @brief Function for computing the age conversion factor at a temperature
+ *
+ * @param[in] p_arrhenius               Constants of the activation energy
+ * @param[in] temperature               Temperature [0.01 °C]
+ *
+ * @return      exp(E/R x (1/T_r - 1/T)) in Q16, the curing time at the reference temperature
+ *              equivalent to one second at the temperature
+ */
+uint32_t arrhenius_factor(arrhenius_t const* p_arrhenius, int16_t temperature);
+
+
+#endif // _arrhenius_H__
@@ -1,20 +1,91 @@
-
-#ifndef BATTERY_VOLTAGE_H__
-#define BATTERY_VOLTAGE_H__
-
-#include <stdint.h>
-
-
-/**@brief Function for initializing the battery voltage module.
- */
-void battery_voltage_init(void);
-
-
-/**@brief Function for reading the battery voltage.
- *
- * @param[out]   p_vbatt       Pointer to the battery voltage value.
- */
-void battery_voltage_get(uint16_t * p_vbatt);
-
-
-#endif // BATTERY_VOLTAGE_H__
+#ifndef BATTERY_VOLTAGE_H__
+#define BATTERY_VOLTAGE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define BATTERY_MEASUREMENT_INTERVAL    600000      //!< Time between two scheduled measurements [ms].
+#define BATTERY_CALIBRATION_INTERVAL    144         //!< Measurements between two offset calibrations (1 day).
+#define BATTERY_TREND_PERIOD            36          //!< Measurements averaged into one trend entry (6 hours).
+#define BATTERY_TREND_SIZE              28          //!< Number of trend entries kept (7 days).
+#define BATTERY_TREND_MIN_ENTRIES       4           //!< Number of trend entries needed for a prediction.
+#define BATTERY_SAG_DELAY               1           //!< Delay from the radio notification to the loaded measurement, lands in the radio activity [ms].
+#define BATTERY_SAG_HEADROOM            100         //!< The battery is low once the voltage under radio load comes this close to the cut-off [mV].
+#define BATTERY_HOURS_UNKNOWN           UINT32_MAX  //!< No prediction, too few trend entries or no discharge.
+
+
+/**@brief Type of a battery measurement.
+ */
+typedef enum
+{
+    BATTERY_MEASUREMENT_IDLE,           //!< Scheduled measurement, the radio is idle.
+    BATTERY_MEASUREMENT_SAG             //!< Measurement during a radio event.
+} battery_measurement_t;
+
+/**@brief Trend entry, the average of BATTERY_TREND_PERIOD measurements.
+ */
+typedef struct
+{
+    uint16_t    voltage;                //!< Average idle voltage [mV].
+    uint16_t    sag;                    //!< Lowest voltage under radio load, 0 if none was measured [mV].
+} battery_trend_t;
+
+/**@brief Battery measurement handler type, called in interrupt context when a measurement is ready.
+ *
+ * @details Call battery_voltage_process() from the main loop to process it.
+ */
+typedef void (*battery_voltage_handler_t)(void);
+
+
+/**@brief Function for initializing the battery voltage module.
+ *
+ * @details Configures the SAADC for 14 bit with 16x hardware oversampling and starts the
+ *          measurement schedule with an offset calibration.
+ *
+ * @param[in]   handler     Handler called when a measurement is ready.
+ */
+void battery_voltage_init(battery_voltage_handler_t handler);
+
+
+/**@brief Function for processing the last measurement in the main loop.
+ *
+ * @details Logs the measurement, updates the trend and the prediction.
+ */
+void battery_voltage_process(void);
+
+
+/**@brief Function for passing the radio notification to the battery module.
+ *
+ * @details With BATTERY_SAG_ENABLED every scheduled measurement is followed by one during the
+ *          next radio event.
+ *
+ * @param[in]   radio_active    Boolean indicating if the radio is about to start or has stopped.
+ */
+void battery_voltage_on_radio(bool radio_active);
+
+
+/**@brief Function for reading the battery voltage.
+ *
+ * @param[out]   p_vbatt       Pointer to the last idle battery voltage [mV].
+ */
+void battery_voltage_get(uint16_t * p_vbatt);
+
+
+/**@brief Function for getting the predicted time until the cut-off voltage.
+ *
+ * @return  Hours left at the current discharge rate, BATTERY_HOURS_UNKNOWN if unknown.
+ */
+uint32_t battery_voltage_hours_left(void);
+
+
+/**@brief Function for checking if the battery is about to die.
+ *
+ * @details The battery is low when the prediction is below BATTERY_OFFLOAD_MARGIN or when the
+ *          voltage under radio load comes within BATTERY_SAG_HEADROOM of the cut-off.
+ *
+ * @return  True if the data should be offloaded now.
+ */
+bool battery_voltage_is_low(void);
+
+
+#endif // BATTERY_VOLTAGE_H__
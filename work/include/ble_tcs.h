@@ -6,6 +6,8 @@
 #include <stdbool.h>
 #include "ble.h"
 #include "ble_srv_common.h"
+#include "nrf_sdh_ble.h"
+#include "nrf_ble_gatt.h"
 
 // UUID: 63CCxxxx-8BA2-4D48-aCC4-E5669638E060
 #define BLE_UUID_THERMOCOUPLE_SERVICE_BASE     {0x60, 0xE0, 0x38, 0x96, 0x66, 0xE5, 0xC4, 0xAC, \
@@ -13,6 +15,29 @@
 
 #define BLE_UUID_THERMOCOUPLE_SERVICE           0x1400
 #define BLE_UUID_THERMOCOUPLE_CHAR              0x1401
+#define BLE_UUID_THERMOCOUPLE_LIVE_CHAR         0x1402
+#define BLE_UUID_THERMOCOUPLE_ENERGY_CHAR       0x1403
+#define BLE_UUID_THERMOCOUPLE_MATURITY_CHAR     0x1404
+#define BLE_UUID_THERMOCOUPLE_STATS_CHAR        0x1405
+#define BLE_UUID_THERMOCOUPLE_ALERT_CHAR        0x1406
+#define BLE_UUID_THERMOCOUPLE_STRENGTH_CHAR     0x1407
+#define BLE_UUID_THERMOCOUPLE_PROFILE_CHAR      0x1408
+
+#define BLE_TCS_LINK_COUNT                      NRF_SDH_BLE_PERIPHERAL_LINK_COUNT                   /**< Number of links that can pull data concurrently. */
+#define BLE_TCS_MAX_PACKET_LENGTH               (NRF_SDH_BLE_GATT_MAX_MTU_SIZE - 3)                 /**< Largest notification payload, (ATT MTU - 3). */
+#define BLE_TCS_MIN_PACKET_LENGTH               (BLE_GATT_ATT_MTU_DEFAULT - 3)                      /**< Notification payload until the ATT MTU is exchanged. */
+
+#define BLE_TCS_LIVE_SAMPLE_SIZE                9           /**< seq u32 | temperature float32 | flags u8, little endian. */
+#define BLE_TCS_ENERGY_MAX_SIZE                 64          /**< Largest energy report, see energy_report_encode(). */
+#define BLE_TCS_MATURITY_MAX_SIZE               32          /**< Largest maturity report, see maturity_report_encode(). */
+#define BLE_TCS_STATS_MAX_SIZE                  32          /**< Largest answer to a statistics query, see block_stats_report_encode(). */
+#define BLE_TCS_ALERT_MAX_SIZE                  16          /**< Largest alert report, see alert_report_encode(). */
+#define BLE_TCS_STRENGTH_MAX_SIZE               16          /**< Largest strength report, see strength_report_encode(). */
+#define BLE_TCS_PROFILE_MAX_SIZE                80          /**< Largest profiler report, see profiler_report_encode(). */
+
+#define BLE_TCS_LIVE_FLAG_FAULT                 (1 << 0)    /**< The MAX31856 reported a fault for this sample. */
+#define BLE_TCS_LIVE_FLAG_COLD_JUNCTION         (1 << 1)    /**< The sample is a cold junction temperature. */
+#define BLE_TCS_LIVE_FLAG_DISCARDED             (1 << 2)    /**< The sample was not stored in the history. */
 
 
 /**@brief   Macro for defining a ble_tcs instance 
@@ -34,17 +59,86 @@ typedef enum
     BLE_TCS_EVT_NOTIFICATION_ENABLED,
     BLE_TCS_EVT_NOTIFICATION_DISABLED,
     BLE_TCS_EVT_DISCONNECTED,
-    BLE_TCS_EVT_CONNECTED
+    BLE_TCS_EVT_CONNECTED,
+    BLE_TCS_EVT_L2CAP_DUMP_REQUEST,
+    BLE_TCS_EVT_TRANSFER_COMPLETE,
+    BLE_TCS_EVT_LIVE_NOTIFICATION_ENABLED,
+    BLE_TCS_EVT_LIVE_NOTIFICATION_DISABLED,
+    BLE_TCS_EVT_ACTIVATION_WRITE,           /**< "Activate" or the timer interval was written, see ble_tcs_getActivatedFlag(). */
+    BLE_TCS_EVT_ENERGY_RESET,               /**< "EnergyReset" was written, the battery was changed. */
+    BLE_TCS_EVT_MATURITY_RESET,             /**< "MaturityReset" was written, a new pour starts. */
+    BLE_TCS_EVT_MATURITY_DATUM_WRITE,       /**< "Datum=<°C>" was written, see params.datum. */
+    BLE_TCS_EVT_MATURITY_ACTIVATION_WRITE,  /**< "ActivationEnergy=<kJ/mol>" was written, see params.activation. */
+    BLE_TCS_EVT_STATS_QUERY,                /**< "Stats=<first block>,<blocks>" was written, see params.stats_query. */
+    BLE_TCS_EVT_ALERT_RULE_WRITE,           /**< "Alert=<slot>,<type>,<threshold>,<hysteresis>,<debounce>" was written, see params.alert_rule. */
+    BLE_TCS_EVT_CURVE_POINT_WRITE,          /**< "Curve=<point>,<°C·h>,<MPa>" was written, see params.curve_point. */
+    BLE_TCS_EVT_CURVE_SAVE,                 /**< "CurveSave=<points>" was written, see params.curve_points. */
+    BLE_TCS_EVT_TARGET_STRENGTH_WRITE,      /**< "Target=<MPa>" was written, see params.target. */
+    BLE_TCS_EVT_PROFILE_QUERY,              /**< "Profile=<probe>" was written, see params.probe. */
+    BLE_TCS_EVT_PROFILE_RESET               /**< "ProfileReset" was written. */
 } ble_tcs_evt_type_t;
 
 
+/**@brief Alert rule written by the peer, thresholds in °C or °C/h. */
+typedef struct
+{
+    uint8_t                         slot;                   /**< Slot of the rule */
+    uint8_t                         type;                   /**< Type of the rule, see alert.h */
+    float                           threshold;              /**< Threshold [°C] or [°C/h] */
+    float                           hysteresis;             /**< Hysteresis, same unit as the threshold */
+    uint8_t                         debounce;               /**< Consecutive samples to fire and to clear */
+} ble_tcs_alert_rule_t;
+
+
+/**@brief Statistics query written by the peer. */
+typedef struct
+{
+    uint16_t                        first;                  /**< First block of the query */
+    uint16_t                        blocks;                 /**< Number of blocks of the query */
+} ble_tcs_stats_query_t;
+
+
+/**@brief Calibration point written by the peer. */
+typedef struct
+{
+    uint8_t                         point;                  /**< Index of the point */
+    float                           maturity;               /**< Temperature-time factor of the point [°C·h] */
+    float                           strength;               /**< Strength at that factor [MPa] */
+} ble_tcs_curve_point_t;
+
+
+/**@brief Value written with a command, carried by its event so back to back writes each keep their own. */
+typedef union
+{
+    float                   datum;          /**< BLE_TCS_EVT_MATURITY_DATUM_WRITE, datum temperature [°C]. */
+    float                   activation;     /**< BLE_TCS_EVT_MATURITY_ACTIVATION_WRITE, activation energy [kJ/mol]. */
+    ble_tcs_stats_query_t   stats_query;    /**< BLE_TCS_EVT_STATS_QUERY. */
+    ble_tcs_alert_rule_t    alert_rule;     /**< BLE_TCS_EVT_ALERT_RULE_WRITE. */
+    ble_tcs_curve_point_t   curve_point;    /**< BLE_TCS_EVT_CURVE_POINT_WRITE. */
+    uint8_t                 curve_points;   /**< BLE_TCS_EVT_CURVE_SAVE, number of points of the curve. */
+    float                   target;         /**< BLE_TCS_EVT_TARGET_STRENGTH_WRITE, target strength [MPa]. */
+    uint8_t                 probe;          /**< BLE_TCS_EVT_PROFILE_QUERY, see profiler_probe_t. */
+} ble_tcs_evt_params_t;
+
+
 /**@brief TC Service event. */
 typedef struct
 {
     ble_tcs_evt_type_t   evt_type;
+    uint16_t             conn_handle;   /**< Connection the event belongs to. */
+    ble_tcs_evt_params_t params;        /**< Value written with the command, depends on evt_type. */
 } ble_tcs_evt_t;
 
 
+/**@brief Live sample, notified on the live characteristic as soon as it is measured. */
+typedef struct
+{
+    uint32_t    seq;                /**< Sequence number, the index of the sample in the history unless discarded. */
+    float       temperature;        /**< Measured temperature [°C]. */
+    uint8_t     flags;              /**< BLE_TCS_LIVE_FLAG_* status flags. */
+} ble_tcs_live_sample_t;
+
+
 /**@brief   Forward declaration of the ble_tcs_t type. */
 typedef struct ble_tcs_s ble_tcs_t;
 
@@ -53,27 +147,88 @@ typedef struct ble_tcs_s ble_tcs_t;
 typedef void (*ble_tcs_evt_handler_t) (ble_tcs_t* p_tcs, ble_tcs_evt_t* p_evt);
 
 
+/**@brief TC Service read handler type.
+ *
+ * @details Copies up to @p length bytes of the thermocouple data stream of the link
+ *          @p conn_handle, starting at @p offset, into @p p_data.
+ *
+ * @return  Number of bytes copied.
+ */
+typedef uint32_t (*ble_tcs_read_handler_t) (uint16_t conn_handle, uint32_t offset, uint8_t* p_data, uint32_t length);
+
+
 /**@brief   Custom Service init structure. This contains all options and data needed for
  *          initialization of the service. */
 typedef struct
 {
     ble_tcs_evt_handler_t           evt_handler;                /**< Event handler to be called for handling events in the Custom Service. */
+    ble_tcs_read_handler_t          read_handler;               /**< Handler supplying the thermocouple data stream. */
     uint8_t                         initial_tc_value;           /**< Initial tc value */
     ble_srv_cccd_security_mode_t    tc_value_char_attr_md;      /**< Initial security level for tc characteristics attribute */
 } ble_tcs_init_t;
 
 
+/**@brief Part of the history a link reads, set with "Dump=<level>[,<first>,<count>]". */
+typedef struct
+{
+    uint8_t                         level;                  /**< Level of the history, 0 for the raw samples, see pyramid.h */
+    uint32_t                        first;                  /**< First sample or bucket */
+    uint32_t                        count;                  /**< Number of samples or buckets, 0 up to the last one */
+} ble_tcs_stream_request_t;
+
+
+/**@brief Transfer state of one link. */
+typedef struct
+{
+    uint16_t                        conn_handle;            /**< Handle of the connection, BLE_CONN_HANDLE_INVALID if the slot is free */
+    uint16_t                        max_packet_length;      /**< Largest notification payload on this link, (ATT MTU - 3) */
+    bool                            is_live_notification_enabled;   /**< Whether the peer enabled live sample notifications */
+    bool                            is_alert_notification_enabled;  /**< Whether the peer enabled alert notifications */
+    bool                            nrf_error_resources;    /**< The SoftDevice queue was full, wait for the next TX complete */
+    uint8_t                         hvn_in_flight;          /**< Notifications queued in the SoftDevice */
+    uint32_t                        data_size;              /**< Length of the running transfer, 0 if idle */
+    uint32_t                        data_pos;               /**< Number of bytes of the transfer handed to the SoftDevice */
+    uint32_t                        start_ticks;            /**< Timestamp at which the transfer started */
+    uint32_t                        hvn_tx_events;          /**< Number of HVN_TX_COMPLETE events (connection events carrying data) of the transfer */
+    uint32_t                        hvn_tx_packets;         /**< Number of notifications completed during the transfer */
+    ble_tcs_stream_request_t        request;                /**< Part of the history the next dump reads, all raw samples by default */
+    uint8_t                         hvn_tx_max;             /**< Largest number of notifications completed in one connection event */
+} ble_tcs_link_t;
+
+
 /**@brief Custom Service structure. This contains various status information for the service. */
 struct ble_tcs_s
 {
     ble_tcs_evt_handler_t           evt_handler;            /**< Event handler to be called for handling events in the Custom Service. */
-    uint16_t                        conn_handle;            /**< Handle of the current connection (as provided by the BLE stack, is BLE_CONN_HANDLE_INVALID if not in a connection) */
+    ble_tcs_read_handler_t          read_handler;           /**< Handler supplying the thermocouple data stream. */
     uint16_t                        service_handle;         /**< Handle of Our Service (as provided by the BLE stack) */
     ble_gatts_char_handles_t        char_handles;           /**< Handles related to the value characteristic */
+    ble_gatts_char_handles_t        live_handles;           /**< Handles related to the live sample characteristic */
+    ble_gatts_char_handles_t        energy_handles;         /**< Handles related to the energy report characteristic */
+    ble_gatts_char_handles_t        maturity_handles;       /**< Handles related to the maturity report characteristic */
+    ble_gatts_char_handles_t        stats_handles;          /**< Handles related to the statistics query characteristic */
+    ble_gatts_char_handles_t        alert_handles;          /**< Handles related to the alert report characteristic */
+    ble_gatts_char_handles_t        strength_handles;       /**< Handles related to the strength report characteristic */
+#if PROFILER_ENABLED
+    ble_gatts_char_handles_t        profile_handles;        /**< Handles related to the profiler report characteristic */
+#endif
+    ble_tcs_link_t                  links[BLE_TCS_LINK_COUNT];  /**< Transfer state per connected peer */
     uint8_t                         uuid_type;
 };
 
 
+/**@brief Function for setting the notification queue size in the SoftDevice.
+ *
+ * @details Must be called after @ref nrf_sdh_ble_default_cfg_set and before @ref nrf_sdh_ble_enable.
+ *
+ * @param[in]   conn_cfg_tag    Connection configuration tag used by the application.
+ * @param[in]   ram_start       Application RAM start address.
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+ret_code_t ble_tcs_conn_cfg_set(uint8_t conn_cfg_tag, uint32_t ram_start);
+
+
 /**@brief Function for adding the TC Value characteristic.
  *
  * @param[in]   p_tcs        TC Service structure.
@@ -94,18 +249,124 @@ ret_code_t ble_tcs_init(ble_tcs_t* p_tcs, const ble_tcs_init_t* p_tcs_init);
 void ble_tcs_on_ble_evt(ble_evt_t const* p_ble_evt, void* p_context);
 
 
+/**@brief Function for handling events from the GATT library.
+ *
+ * @details Keeps the notification payload of each link at (ATT MTU - 3).
+ *
+ * @param[in]   p_tcs       Thermocouple Service structure.
+ * @param[in]   p_gatt_evt  Event received from the GATT library.
+ */
+void ble_tcs_on_gatt_evt(ble_tcs_t* p_tcs, nrf_ble_gatt_evt_t const* p_gatt_evt);
+
+
 /**@brief Function for updating the thermocouple value.
  *
  * @details The application calls this function when the thermcouple value should be updated. If
- *          notification has been enabled, the thermocouple value characteristic is sent to the client.
+ *          notification has been enabled, the thermocouple data stream of the link is pulled
+ *          through the read handler and sent to the client. Every link has its own cursor.
  *       
  * @param[in]   p_tcs           Thermocouple Service structure.
- * @param[in]   p_tc_data       Thermocouple data to send.
- * @param[in]   tc_data_length  Thermocouple data length.
+ * @param[in]   conn_handle     Connection to send the stream on.
+ * @param[in]   tc_data_length  Thermocouple data stream length.
  *
  * @return      NRF_SUCCESS on success, otherwise an error code.
  */
-ret_code_t ble_tcs_thermocouple_level_update(ble_tcs_t* p_tcs, uint8_t* p_tc_data, uint16_t tc_data_length);
+ret_code_t ble_tcs_thermocouple_level_update(ble_tcs_t* p_tcs, uint16_t conn_handle, uint32_t tc_data_length);
+
+
+/**@brief Function for publishing a live sample.
+ *
+ * @details The live characteristic value is always updated, so it can be read. The sample is
+ *          notified on every link that enabled notification. Live samples share the notification
+ *          queue with a running dump, a sample that does not fit is only readable.
+ *
+ * @param[in]   p_tcs       Thermocouple Service structure.
+ * @param[in]   p_sample    Sample to publish.
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+ret_code_t ble_tcs_live_sample_send(ble_tcs_t* p_tcs, ble_tcs_live_sample_t const* p_sample);
+
+
+/**@brief Function for publishing an alert report.
+ *
+ * @details The alert characteristic value is always updated, so it can be read. The report is
+ *          notified on every link that enabled notification.
+ *
+ * @param[in]   p_tcs       Thermocouple Service structure.
+ * @param[in]   p_data      Encoded report.
+ * @param[in]   length      Length of the report, at most BLE_TCS_ALERT_MAX_SIZE.
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+ret_code_t ble_tcs_alert_send(ble_tcs_t* p_tcs, uint8_t const* p_data, uint16_t length);
+
+
+/**@brief Function for setting the energy report.
+ *
+ * @details The energy characteristic is read only, the report is not notified.
+ *
+ * @param[in]   p_tcs       Thermocouple Service structure.
+ * @param[in]   p_data      Encoded report.
+ * @param[in]   length      Length of the report, at most BLE_TCS_ENERGY_MAX_SIZE.
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+ret_code_t ble_tcs_energy_set(ble_tcs_t* p_tcs, uint8_t const* p_data, uint16_t length);
+
+
+/**@brief Function for setting the maturity report.
+ *
+ * @details The maturity characteristic is read only, the report is not notified.
+ *
+ * @param[in]   p_tcs       Thermocouple Service structure.
+ * @param[in]   p_data      Encoded report.
+ * @param[in]   length      Length of the report, at most BLE_TCS_MATURITY_MAX_SIZE.
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+ret_code_t ble_tcs_maturity_set(ble_tcs_t* p_tcs, uint8_t const* p_data, uint16_t length);
+
+
+/**@brief Function for setting the strength report.
+ *
+ * @details The strength characteristic is read only, the report is not notified.
+ *
+ * @param[in]   p_tcs       Thermocouple Service structure.
+ * @param[in]   p_data      Encoded report.
+ * @param[in]   length      Length of the report, at most BLE_TCS_STRENGTH_MAX_SIZE.
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+ret_code_t ble_tcs_strength_set(ble_tcs_t* p_tcs, uint8_t const* p_data, uint16_t length);
+
+
+/**@brief Function for setting the answer to the last statistics query.
+ *
+ * @details The statistics characteristic is read only, the answer is read after writing the query.
+ *
+ * @param[in]   p_tcs       Thermocouple Service structure.
+ * @param[in]   p_data      Encoded answer.
+ * @param[in]   length      Length of the answer, at most BLE_TCS_STATS_MAX_SIZE.
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+ret_code_t ble_tcs_stats_set(ble_tcs_t* p_tcs, uint8_t const* p_data, uint16_t length);
+
+
+#if PROFILER_ENABLED
+/**@brief Function for setting the report of the probe of the last profiler query.
+ *
+ * @details The profile characteristic is read only, the report is read after writing the query.
+ *
+ * @param[in]   p_tcs       Thermocouple Service structure.
+ * @param[in]   p_data      Encoded report.
+ * @param[in]   length      Length of the report, at most BLE_TCS_PROFILE_MAX_SIZE.
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+ret_code_t ble_tcs_profile_set(ble_tcs_t* p_tcs, uint8_t const* p_data, uint16_t length);
+#endif
 
 
 /** 
@@ -140,4 +401,28 @@ uint32_t ble_tcs_getTimerInterval(void);
 void ble_tcs_setTimerInterval(uint32_t tcs_timer_interval);
 
 
+/** 
+ * @brief Function for getting the channels to store per sample
+ * 
+ * @details Written as "Channels=<mask>" before "Activate", see tcs_frame.h.
+ * 
+ * @return      Uint8_t representing the TCS_CHANNEL_* bits, TC_CHANNELS until written
+ */
+uint8_t ble_tcs_getChannels(void);
+
+
+/**@brief Function for getting the part of the history a link reads.
+ *
+ * @details The request is kept until the link disconnects, without a request the dump holds all
+ *          raw samples.
+ *
+ * @param[in]   p_tcs       Thermocouple Service structure.
+ * @param[in]   conn_handle Connection handle of the link.
+ * @param[out]  p_request   Part of the history.
+ *
+ * @return      NRF_SUCCESS on success, NRF_ERROR_NOT_FOUND if the link is unknown.
+ */
+ret_code_t ble_tcs_stream_request_get(ble_tcs_t* p_tcs, uint16_t conn_handle, ble_tcs_stream_request_t* p_request);
+
+
 #endif // _BLE_TCS_H__
\ No newline at end of file
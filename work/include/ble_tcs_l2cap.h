@@ -0,0 +1,160 @@
+#ifndef _BLE_TCS_L2CAP_H__
+#define _BLE_TCS_L2CAP_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble.h"
+#include "ble_srv_common.h"
+#include "nrf_sdh_ble.h"
+
+#define BLE_TCS_L2CAP_PSM               0x0081                  /**< Dynamic LE_PSM the gateway connects to for history dumps. */
+#define BLE_TCS_L2CAP_SDU_SIZE          1024                    /**< Maximum SDU size used for a dump chunk. */
+#define BLE_TCS_L2CAP_SDU_COUNT         2                       /**< Number of SDU buffers (and queued SDUs) in flight. */
+#define BLE_TCS_L2CAP_TX_MPS            247                     /**< Transmit MPS, one K-frame per data length extended LL PDU. */
+#define BLE_TCS_L2CAP_RX_MPS            BLE_L2CAP_MPS_MIN       /**< Receive MPS, the peer only ever sends control data. */
+#define BLE_TCS_L2CAP_RX_MTU            BLE_L2CAP_MTU_MIN       /**< Receive MTU, the peer only ever sends control data. */
+#define BLE_TCS_L2CAP_LINK_COUNT        NRF_SDH_BLE_PERIPHERAL_LINK_COUNT   /**< Number of links that can hold a channel concurrently. */
+
+
+/**@brief   Macro for defining a ble_tcs_l2cap instance
+ *
+ * @param[in]   _name   Name of the instance
+ * @hideinitializer
+ */
+#define BLE_TCS_L2CAP_DEF(_name)                    \
+static ble_tcs_l2cap_t _name;                       \
+NRF_SDH_BLE_OBSERVER(_name ## _obs,                 \
+                     BLE_HRS_BLE_OBSERVER_PRIO,     \
+                     ble_tcs_l2cap_on_ble_evt,      \
+                     &_name)
+
+
+/**@brief   TC L2CAP transport event type. */
+typedef enum
+{
+    BLE_TCS_L2CAP_EVT_CH_OPENED,
+    BLE_TCS_L2CAP_EVT_CH_RELEASED,
+    BLE_TCS_L2CAP_EVT_DUMP_COMPLETE
+} ble_tcs_l2cap_evt_type_t;
+
+
+/**@brief TC L2CAP transport event. */
+typedef struct
+{
+    ble_tcs_l2cap_evt_type_t    evt_type;
+    uint16_t                    conn_handle;    /**< Connection the channel is open on. */
+    uint32_t                    bytes;          /**< Number of bytes sent (DUMP_COMPLETE only). */
+    uint32_t                    ticks;          /**< Duration of the dump in app_timer ticks (DUMP_COMPLETE only). */
+} ble_tcs_l2cap_evt_t;
+
+
+/**@brief   Forward declaration of the ble_tcs_l2cap_t type. */
+typedef struct ble_tcs_l2cap_s ble_tcs_l2cap_t;
+
+
+/**@brief TC L2CAP transport event handler type. */
+typedef void (*ble_tcs_l2cap_evt_handler_t) (ble_tcs_l2cap_t* p_tcs_l2cap, ble_tcs_l2cap_evt_t* p_evt);
+
+
+/**@brief TC L2CAP transport read handler type.
+ *
+ * @details Called whenever an SDU buffer is free. Copies up to @p length bytes of the dump stream
+ *          of the link @p conn_handle, starting at @p offset, into @p p_data.
+ *
+ * @return  Number of bytes copied.
+ */
+typedef uint32_t (*ble_tcs_l2cap_read_handler_t) (uint16_t conn_handle, uint32_t offset, uint8_t* p_data, uint32_t length);
+
+
+/**@brief   TC L2CAP transport init structure. */
+typedef struct
+{
+    ble_tcs_l2cap_evt_handler_t     evt_handler;        /**< Event handler to be called for handling events of the transport. */
+    ble_tcs_l2cap_read_handler_t    read_handler;       /**< Handler supplying the dump stream. */
+} ble_tcs_l2cap_init_t;
+
+
+/**@brief TC L2CAP channel state of one link. */
+typedef struct
+{
+    uint16_t                        conn_handle;                                            /**< Handle of the connection owning the channel, BLE_CONN_HANDLE_INVALID if the slot is free. */
+    uint16_t                        local_cid;                                              /**< Local channel ID, BLE_L2CAP_CID_INVALID if no channel is open. */
+    uint16_t                        tx_mtu;                                                 /**< Largest SDU the peer accepts. */
+    uint16_t                        peer_mps;                                               /**< Largest K-frame the peer accepts. */
+    uint32_t                        dump_size;                                              /**< Total number of bytes of the current dump. */
+    uint32_t                        dump_pos;                                               /**< Number of bytes handed to the SoftDevice. */
+    uint32_t                        dump_start_ticks;                                       /**< Timestamp at which the current dump started. */
+    uint8_t                         sdu_in_flight;                                          /**< Number of SDUs queued in the SoftDevice. */
+    uint8_t                         sdu_next;                                               /**< Index of the next SDU buffer to fill. */
+    uint8_t                         sdu_buf[BLE_TCS_L2CAP_SDU_COUNT][BLE_TCS_L2CAP_SDU_SIZE];  /**< SDU buffers, owned by the SoftDevice while queued. */
+    uint8_t                         rx_buf[BLE_TCS_L2CAP_RX_MTU];                           /**< Receive buffer for peer SDUs (ignored). */
+} ble_tcs_l2cap_link_t;
+
+
+/**@brief TC L2CAP transport structure. This contains various status information for the transport. */
+struct ble_tcs_l2cap_s
+{
+    ble_tcs_l2cap_evt_handler_t     evt_handler;                                            /**< Event handler to be called for handling events of the transport. */
+    ble_tcs_l2cap_read_handler_t    read_handler;                                           /**< Handler supplying the dump stream. */
+    ble_tcs_l2cap_link_t            links[BLE_TCS_L2CAP_LINK_COUNT];                        /**< Channel state per connected peer. */
+};
+
+
+/**@brief Function for adding the L2CAP channel configuration to the SoftDevice.
+ *
+ * @details Must be called after @ref nrf_sdh_ble_default_cfg_set and before @ref nrf_sdh_ble_enable.
+ *
+ * @param[in]   conn_cfg_tag    Connection configuration tag used by the application.
+ * @param[in]   ram_start       Application RAM start address.
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+ret_code_t ble_tcs_l2cap_conn_cfg_set(uint8_t conn_cfg_tag, uint32_t ram_start);
+
+
+/**@brief Function for initializing the TC L2CAP transport.
+ *
+ * @param[in]   p_tcs_l2cap         TC L2CAP transport structure.
+ * @param[in]   p_tcs_l2cap_init    Information needed to initialize the transport.
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+ret_code_t ble_tcs_l2cap_init(ble_tcs_l2cap_t* p_tcs_l2cap, const ble_tcs_l2cap_init_t* p_tcs_l2cap_init);
+
+
+/**@brief Function for handling the Application's BLE Stack events.
+ *
+ * @details Handles the L2CAP channel setup and flow control events of the TC L2CAP transport.
+ *
+ * @param[in]   p_ble_evt  Event received from the BLE stack.
+ * @param[in]   p_context  TC L2CAP transport structure.
+ */
+void ble_tcs_l2cap_on_ble_evt(ble_evt_t const* p_ble_evt, void* p_context);
+
+
+/**@brief Function for starting a history dump over the L2CAP channel of a link.
+ *
+ * @details The stream is pulled in SDU sized chunks through the read handler while the peer
+ *          grants credits.
+ *
+ * @param[in]   p_tcs_l2cap     TC L2CAP transport structure.
+ * @param[in]   conn_handle     Connection to send the dump on.
+ * @param[in]   dump_size       Total number of bytes to send.
+ *
+ * @return      NRF_SUCCESS on success, NRF_ERROR_INVALID_STATE if the link has no open channel,
+ *              NRF_ERROR_BUSY if a dump is already running on the link.
+ */
+ret_code_t ble_tcs_l2cap_dump_start(ble_tcs_l2cap_t* p_tcs_l2cap, uint16_t conn_handle, uint32_t dump_size);
+
+
+/**@brief Function for checking if a link has an open L2CAP channel.
+ *
+ * @param[in]   p_tcs_l2cap     TC L2CAP transport structure.
+ * @param[in]   conn_handle     Connection to check.
+ *
+ * @return      Boolean indicating the channel status
+ */
+bool ble_tcs_l2cap_is_open(ble_tcs_l2cap_t const* p_tcs_l2cap, uint16_t conn_handle);
+
+
+#endif // _BLE_TCS_L2CAP_H__
@@ -0,0 +1,90 @@
+#ifndef _block_stats_H__
+#define _block_stats_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdk_errors.h"
+
+/** Statistics of every history block (one FDS record, MAX_RECORD_SIZE samples). They are updated
+ *  with Welford's algorithm while the block fills and stored as the block header when it is
+ *  flushed, so a query over days or weeks reads the headers from flash and never the samples. */
+#define BLOCK_STATS_FILE_ID             0x3188      ///< FDS file holding the block headers of the run
+#define BLOCK_STATS_REC_KEY             0x0001      ///< FDS record key of the header of block 0, block n uses the key plus n
+
+#define BLOCK_STATS_REPORT_SIZE         16          ///< first u16 | blocks u16 | count u32 | min i16 | max i16 | mean i16 | std dev u16, little endian
+
+
+/**
+ * @brief Typedef Struct for holding the header of a block
+ */
+typedef struct
+{
+    uint32_t    count;                  ///< Number of samples
+    float       min;                    ///< Lowest sample [°C]
+    float       max;                    ///< Highest sample [°C]
+    float       mean;                   ///< Mean of the samples [°C]
+    float       m2;                     ///< Sum of the squared differences from the mean [°C²]
+} block_stats_t;
+
+/**
+ * @brief Typedef Struct for holding the answer to a query
+ */
+typedef struct
+{
+    uint16_t    first;                  ///< First block of the query, block 0 holds the first day
+    uint16_t    blocks;                 ///< Number of blocks covered, the block still filling included
+    uint32_t    count;                  ///< Number of samples
+    int16_t     min;                    ///< Lowest sample [0.01 °C]
+    int16_t     max;                    ///< Highest sample [0.01 °C]
+    int16_t     mean;                   ///< Mean of the samples [0.01 °C]
+    uint16_t    std_dev;                ///< Sample standard deviation [0.01 °C]
+} block_stats_report_t;
+
+
+/**
+ * @brief Function for clearing the block headers in RAM and in flash, with the history of the previous run
+ */
+void block_stats_reset(void);
+
+
+/**
+ * @brief Function for adding a stored sample to the block that is filling
+ *
+ * @param[in] temperature           Stored sample [°C]
+ */
+void block_stats_add(float temperature);
+
+
+/**
+ * @brief Function for closing the block that is filling and writing its header to flash
+ *
+ * @details Call when the block is written to the history, an empty block is not stored.
+ */
+void block_stats_flush(void);
+
+
+/**
+ * @brief Function for answering a query from the block headers
+ *
+ * @param[in]  first                First block
+ * @param[in]  blocks               Number of blocks, cut at the block that is filling
+ * @param[out] p_report             Statistics over the blocks
+ *
+ * @return      NRF_SUCCESS, NRF_ERROR_INVALID_PARAM if the first block does not exist yet,
+ *              NRF_ERROR_NOT_FOUND if a header is not in flash
+ */
+ret_code_t block_stats_query(uint16_t first, uint16_t blocks, block_stats_report_t* p_report);
+
+
+/**
+ * @brief Function for encoding the answer to a query
+ *
+ * @param[in]  p_report             Report to encode
+ * @param[out] p_data               Buffer of BLOCK_STATS_REPORT_SIZE bytes
+ *
+ * @return      Number of bytes encoded
+ */
+uint8_t block_stats_report_encode(block_stats_report_t const* p_report, uint8_t* p_data);
+
+
+#endif // _block_stats_H__
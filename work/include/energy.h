@@ -0,0 +1,166 @@
+#ifndef _energy_H__
+#define _energy_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdk_errors.h"
+
+/** Current per subsystem while active, on top of the sleep current. Datasheet values at 3 V with DCDC, measure with a power profiler and adjust */
+#define ENERGY_CURRENT_SLEEP            5           ///< System ON with RTC and full RAM retention, MAX31856 idle [uA]
+#define ENERGY_CURRENT_CPU              3300        ///< CPU running from flash at 64 MHz [uA]
+#define ENERGY_CURRENT_SPI              900         ///< SPIM with EasyDMA, CPU counted separately [uA]
+#define ENERGY_CURRENT_CONVERSION       1500        ///< MAX31856 during a one-shot conversion [uA]
+#define ENERGY_CURRENT_FLASH            3400        ///< NVMC write or erase, including the wait for a radio free slot [uA]
+#define ENERGY_CURRENT_RADIO            8000        ///< Average over a radio event, TX at +8 dBm and RX [uA]
+#define ENERGY_CURRENT_SAADC            1200        ///< SAADC with HFCLK [uA]
+
+#define ENERGY_CPU_CLOCK_MHZ            64          ///< Clock of the DWT cycle counter [MHz]
+#define ENERGY_RADIO_DISTANCE           800         ///< Radio notification ahead of the radio activity [us], NRF_RADIO_NOTIFICATION_DISTANCE_800US
+#define ENERGY_TICK                     60000       ///< Accounting period [ms], below the app_timer counter wrap
+
+#define ENERGY_FILE_ID                  0x3186      ///< FDS file holding the counters, kept across resets
+#define ENERGY_REC_KEY                  0x0001      ///< FDS record key of the counters
+
+#define ENERGY_REPORT_SIZE              38          ///< uptime u32 | active ms u32 x 6 | consumed u32 | average u32 | remaining u16, little endian
+
+
+/**
+ * @brief Typedef Enum for defining the subsystems with an active time counter
+ */
+typedef enum
+{
+    ENERGY_CPU,             ///< CPU awake, from the DWT cycle counter
+    ENERGY_SPI,             ///< SPI transfers
+    ENERGY_CONVERSION,      ///< MAX31856 conversions
+    ENERGY_FLASH,           ///< FDS writes, updates, deletes and garbage collection
+    ENERGY_RADIO,           ///< Radio events, from the radio notification
+    ENERGY_SAADC,           ///< SAADC conversions
+    ENERGY_SUBSYSTEM_COUNT
+} energy_subsystem_t;
+
+/**
+ * @brief Typedef Struct for holding the energy report
+ */
+typedef struct
+{
+    uint32_t    uptime;                                 ///< Time covered by the counters [s]
+    uint32_t    active_ms[ENERGY_SUBSYSTEM_COUNT];      ///< Active time per subsystem [ms]
+    uint32_t    consumed;                               ///< Estimated charge consumed [uAh]
+    uint32_t    average_current;                        ///< Average current over the uptime [nA]
+    uint16_t    remaining_days;                         ///< Projected battery life at the average current [days], 0xFFFF if unknown
+} energy_report_t;
+
+/**
+ * @brief Energy report handler type, called in interrupt context every ENERGY_TICK
+ */
+typedef void (*energy_report_handler_t)(energy_report_t const* p_report);
+
+
+/**
+ * @brief Function for initializing the energy accounting
+ *
+ * @details Starts the DWT cycle counter. The counters are written to flash every
+ *          ENERGY_LOG_PERIOD minutes.
+ *
+ * @param[in] report_handler        Handler for the periodic report, may be NULL
+ */
+void energy_init(energy_report_handler_t report_handler);
+
+
+/**
+ * @brief Function for restoring the counters from flash
+ *
+ * @details Adds the counters of the previous runs, call once FDS is initialized.
+ */
+void energy_restore(void);
+
+
+/**
+ * @brief Function for clearing the counters in RAM and in flash, after a battery change
+ *
+ * @details Call from the main loop.
+ */
+void energy_reset(void);
+
+
+/**
+ * @brief Function for marking the start of an active period of a subsystem
+ *
+ * @details Periods may nest, the subsystem is active until the last one stops. Safe to call
+ *          from interrupt context.
+ *
+ * @param[in] subsystem             Subsystem that became active
+ */
+void energy_start(energy_subsystem_t subsystem);
+
+
+/**
+ * @brief Function for marking the end of an active period of a subsystem
+ *
+ * @param[in] subsystem             Subsystem that became idle
+ */
+void energy_stop(energy_subsystem_t subsystem);
+
+
+/**
+ * @brief Function for adding active time measured by the caller
+ *
+ * @param[in] subsystem             Subsystem that was active
+ * @param[in] time_us               Active time [us]
+ */
+void energy_add(energy_subsystem_t subsystem, uint32_t time_us);
+
+
+/**
+ * @brief Function for adding active time measured with the DWT cycle counter
+ *
+ * @param[in] subsystem             Subsystem that was active
+ * @param[in] cycles                Active time [CPU cycles]
+ */
+void energy_cycles_add(energy_subsystem_t subsystem, uint32_t cycles);
+
+
+/**
+ * @brief Function for passing the radio notification to the energy accounting
+ *
+ * @details The radio time is the time between the two signals, minus ENERGY_RADIO_DISTANCE.
+ *
+ * @param[in] radio_active          Boolean indicating if the radio is about to start or has stopped
+ */
+void energy_on_radio(bool radio_active);
+
+
+/**
+ * @brief Function for reading the DWT cycle counter, it only runs while the CPU is awake
+ *
+ * @return      Cycle counter value
+ */
+uint32_t energy_cycles_get(void);
+
+
+/**
+ * @brief Function for accounting the CPU cycles since the last call, call before going to sleep
+ */
+void energy_cpu_update(void);
+
+
+/**
+ * @brief Function for computing the energy report
+ *
+ * @param[out] p_report             Report of the counters up to now
+ */
+void energy_report_get(energy_report_t* p_report);
+
+
+/**
+ * @brief Function for encoding the energy report
+ *
+ * @param[in]  p_report             Report to encode
+ * @param[out] p_data               Buffer of ENERGY_REPORT_SIZE bytes
+ *
+ * @return      Number of bytes encoded
+ */
+uint8_t energy_report_encode(energy_report_t const* p_report, uint8_t* p_data);
+
+
+#endif // _energy_H__
@@ -0,0 +1,96 @@
+#ifndef _link_profile_H__
+#define _link_profile_H__
+
+#include <stdint.h>
+#include "ble.h"
+#include "sdk_errors.h"
+#include "app_util.h"
+#include "nrf_sdh_ble.h"
+
+/** Bulk transfer profile, used while a history dump is running. The interval leaves room for the
+ *  connection event of every link, so concurrent dumps share the radio round robin */
+#define LINK_PROFILE_BULK_MIN_INTERVAL      MAX(MSEC_TO_UNITS(7.5, UNIT_1_25_MS), NRF_SDH_BLE_GAP_EVENT_LENGTH * NRF_SDH_BLE_PERIPHERAL_LINK_COUNT)   ///< Minimum connection interval (7.5 ms per link)
+#define LINK_PROFILE_BULK_MAX_INTERVAL      (LINK_PROFILE_BULK_MIN_INTERVAL + MSEC_TO_UNITS(7.5, UNIT_1_25_MS))                                          ///< Maximum connection interval (+7.5 ms)
+#define LINK_PROFILE_BULK_SLAVE_LATENCY     0                                   ///< Slave latency
+#define LINK_PROFILE_BULK_SUP_TIMEOUT       MSEC_TO_UNITS(4000, UNIT_10_MS)     ///< Supervision timeout (4 s)
+
+/** Idle profile, used while the link is only kept open */
+#define LINK_PROFILE_IDLE_MIN_INTERVAL      MSEC_TO_UNITS(400, UNIT_1_25_MS)    ///< Minimum connection interval (400 ms)
+#define LINK_PROFILE_IDLE_MAX_INTERVAL      MSEC_TO_UNITS(500, UNIT_1_25_MS)    ///< Maximum connection interval (500 ms)
+#define LINK_PROFILE_IDLE_SLAVE_LATENCY     4                                   ///< Slave latency, the radio wakes every 2.5 s at most
+#define LINK_PROFILE_IDLE_SUP_TIMEOUT       MSEC_TO_UNITS(6000, UNIT_10_MS)     ///< Supervision timeout (6 s), > (1 + latency) * interval * 2
+
+#define LINK_PROFILE_IDLE_DELAY             10000                               ///< Time after the last connect before idle links switch to the idle profile [ms]
+#define LINK_PROFILE_BLE_OBSERVER_PRIO      2                                   ///< Priority of the BLE observer
+
+
+/**
+ * @brief Typedef Enum for defining the link profiles
+ */
+typedef enum
+{
+    LINK_PROFILE_DEFAULT,       ///< Preferred parameters set by gap_params_init(), used for discovery
+    LINK_PROFILE_BULK,          ///< Short interval for history dumps
+    LINK_PROFILE_IDLE           ///< Long interval and high slave latency
+} link_profile_t;
+
+/**
+ * @brief Typedef Enum for defining the link profile event types
+ */
+typedef enum
+{
+    LINK_PROFILE_EVT_REQUESTED,     ///< A profile change has been requested from the central
+    LINK_PROFILE_EVT_UPDATED        ///< The central applied new connection parameters
+} link_profile_evt_type_t;
+
+/**
+ * @brief Typedef Struct for holding a link profile event
+ */
+typedef struct
+{
+    link_profile_evt_type_t evt_type;       ///< Type of the event
+    uint16_t                conn_handle;    ///< Connection the event belongs to
+    link_profile_t          profile;        ///< Profile requested by the application
+    ble_gap_conn_params_t   conn_params;    ///< Requested (REQUESTED) or applied (UPDATED) parameters
+} link_profile_evt_t;
+
+/**
+ * @brief Link profile event handler type
+ */
+typedef void (*link_profile_evt_handler_t)(link_profile_evt_t const* p_evt);
+
+
+/**
+ * @brief Function for initializing the link profile manager
+ *
+ * @param[in] evt_handler           Handler for renegotiation events, may be NULL
+ */
+void link_profile_init(link_profile_evt_handler_t evt_handler);
+
+
+/**
+ * @brief Function for requesting a link profile on a connection
+ *
+ * @details The request goes through the Connection Parameters module, so it keeps negotiating
+ *          towards the new profile instead of the preferred parameters.
+ *
+ * @param[in] conn_handle           Connection to change
+ * @param[in] profile               Profile to switch to
+ *
+ * @return      NRF_SUCCESS if successful, already active or the link dropped while requesting,
+ *              NRF_ERROR_INVALID_STATE if the link is not connected, else error code
+ */
+ret_code_t link_profile_set(uint16_t conn_handle, link_profile_t profile);
+
+
+/**
+ * @brief Function for getting the requested link profile
+ *
+ * @param[in] conn_handle           Connection to look up
+ *
+ * @return      Profile last requested on the connection
+ */
+link_profile_t link_profile_get(uint16_t conn_handle);
+
+
+#endif // _link_profile_H__
@@ -0,0 +1,123 @@
+#ifndef _maturity_H__
+#define _maturity_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdk_errors.h"
+
+/** Nurse-Saul maturity: M = sum((T_avg - T_datum) x dt) over the intervals with T_avg above the datum
+ *  Equivalent age:      t_e = sum(exp(E/R x (1/T_r - 1/T)) x dt), see arrhenius.h */
+#define MATURITY_TREND_PERIOD           3600        ///< Curing time between two trend snapshots [s]
+#define MATURITY_TREND_SIZE             24          ///< Number of trend snapshots kept, the trend covers the last day
+
+#define MATURITY_FILE_ID                0x3187      ///< FDS file holding the running state, kept across resets
+#define MATURITY_REC_KEY                0x0001      ///< FDS record key of the running state
+
+#define MATURITY_DATUM_MIN              -50.0f      ///< Lowest datum temperature accepted [°C]
+#define MATURITY_DATUM_MAX              50.0f       ///< Highest datum temperature accepted [°C]
+
+#define MATURITY_REPORT_SIZE            20          ///< maturity u32 | rate u16 | age u32 | temperature i16 | datum i16 | equivalent age u32 | activation energy u16, little endian
+
+
+/**
+ * @brief Typedef Struct for holding the maturity report
+ */
+typedef struct
+{
+    uint32_t    maturity;               ///< Temperature-time factor [0.1 °C·h]
+    uint16_t    rate;                   ///< Maturity gained over the trend window, scaled to a day [0.1 °C·h/day]
+    uint32_t    age;                    ///< Curing time covered by the factor [min]
+    int16_t     temperature;            ///< Last sample [0.01 °C]
+    int16_t     datum;                  ///< Datum temperature [0.01 °C]
+    uint32_t    equivalent_age;         ///< Equivalent age at MATURITY_REFERENCE_TEMPERATURE [min]
+    uint16_t    activation_energy;      ///< Activation energy of the equivalent age [0.1 kJ/mol]
+} maturity_report_t;
+
+
+/**
+ * @brief Function for initializing the maturity engine with the MATURITY_DATUM_TEMPERATURE datum
+ *        and the MATURITY_ACTIVATION_ENERGY activation energy
+ */
+void maturity_init(void);
+
+
+/**
+ * @brief Function for restoring the running state from flash
+ *
+ * @details Call once FDS is initialized. The time the sensor was off is not counted, the next
+ *          interval starts at the first sample after the reset.
+ */
+void maturity_restore(void);
+
+
+/**
+ * @brief Function for clearing the running state in RAM and in flash, for a new pour
+ *
+ * @details The datum temperature is kept.
+ */
+void maturity_reset(void);
+
+
+/**
+ * @brief Function for setting the datum temperature
+ *
+ * @details Applies from the next interval on, the factor accumulated so far is kept.
+ *
+ * @param[in] datum                 Datum temperature [°C]
+ *
+ * @return NRF_SUCCESS, NRF_ERROR_INVALID_PARAM if the datum is not a finite number from
+ *         MATURITY_DATUM_MIN to MATURITY_DATUM_MAX
+ */
+ret_code_t maturity_datum_set(float datum);
+
+
+/**
+ * @brief Function for setting the activation energy of the equivalent age
+ *
+ * @details Applies from the next interval on, the equivalent age accumulated so far is kept.
+ *
+ * @param[in] activation_energy     Activation energy [J/mol]
+ */
+void maturity_activation_energy_set(uint32_t activation_energy);
+
+
+/**
+ * @brief Function for getting the CPU cost of the equivalent age
+ *
+ * @return      Largest number of cycles an age conversion factor took
+ */
+uint32_t maturity_factor_cycles_get(void);
+
+
+/**
+ * @brief Function for adding a stored sample
+ *
+ * @details The interval since the previous sample is counted at the average of both
+ *          temperatures. The running state is written to flash every MATURITY_LOG_PERIOD samples.
+ *
+ * @param[in] temperature           Temperature of the sample [°C]
+ * @param[in] interval              Time since the previous sample [s]
+ */
+void maturity_add(float temperature, uint32_t interval);
+
+
+/**
+ * @brief Function for computing the maturity report
+ *
+ * @param[out] p_report             Report of the running state
+ */
+void maturity_report_get(maturity_report_t* p_report);
+
+
+/**
+ * @brief Function for encoding the maturity report
+ *
+ * @param[in]  p_report             Report to encode
+ * @param[out] p_data               Buffer of MATURITY_REPORT_SIZE bytes
+ *
+ * @return      Number of bytes encoded
+ */
+uint8_t maturity_report_encode(maturity_report_t const* p_report, uint8_t* p_data);
+
+
+#endif // _maturity_H__
@@ -38,7 +38,7 @@
 #define WREGISTER_CJTL       0x0B   ///< Cold-Junction Temperature Register, LSB
 
 /** MAX31856 Register Values */
-#define CR0         0x15    ///< Enable open-circuit detection - 50Hz
+#define CR0         0x15    ///< Normally-off mode - Enable open-circuit detection - 50Hz
 #define CR1         0x22    ///< 4 samples averaged - TC Type J
 #define MASK        0xFC    ///< FAULT output only asserting on under-overvoltage and open-circuit
 #define CJHF        0x7F    ///< DEFAULT
@@ -58,6 +58,9 @@
 #define DRDY        0x29    ///< DRDY Pin number
 #define FAULT       0x27    ///< FAULT Pin number
 
+/** Conversion timing */
+#define MAX31856_CONVERSION_TIMEOUT     500     ///< Time a one-shot conversion may take before DRDY is considered stuck [ms]
+
 /** Temperature Resolutions */
 #define TC_RESOLUTION   0.0078125f  ///< Termocouple Temperature Resolution
 #define CJ_RESOLUTION   0.015625f   ///< Cold Junction  Temperature Resolution
@@ -97,6 +100,11 @@ typedef enum
     UNKNOWN         ///< An unknown error has beed asserted
 } fault_status;
 
+/** 
+ * @brief Conversion handler type, called from interrupt context at the end of a conversion
+ */
+typedef void (*max31856_conversion_handler_t)(max31856_status status);
+
 
 /** 
  * @brief Function for initializing the MAX31856
@@ -108,6 +116,16 @@ typedef enum
 max31856_status max31856_init(const nrf_drv_spi_t *const spi_instance);
 
 
+/** 
+ * @brief Function to restore the registers after the MAX31856 was powered off
+ * 
+ * @details Writes the cached register image in a single transfer, without reading it back.
+ * 
+ * @return  Error code to determine the status of MAX31856 if any
+ */
+max31856_status max31856_restore();
+
+
 /** 
  * @brief Function to check the FAULT status registers
  * 
@@ -132,24 +150,42 @@ max31856_status max31856_resetFaultStatus();
 void max31856_printFaultStatus(fault_status fault);
 
 
+/** 
+ * @brief Function to start a one-shot conversion
+ * 
+ * @details Returns right away, the handler is called from interrupt context once DRDY asserts,
+ *          or with MAX31856_ERROR_DRDY after MAX31856_CONVERSION_TIMEOUT. Requires GPIOTE and
+ *          app_timer to be initialized before max31856_init().
+ * 
+ * @param[in] handler               Handler for the end of the conversion
+ * 
+ * @return  Error code to determine the status of MAX31856 if any
+ */
+max31856_status max31856_startConversion(max31856_conversion_handler_t handler);
+
+
 /** 
  * @brief Function to read the cold junction temperature registers and convert it to degree celcius
  * 
+ * @details Reads the result of the last conversion.
+ * 
  * @param[in] temperature           Pointer to a temperature instance for reading the cold junction value
  * 
  * @return  Error code to determine the status of MAX31856 if any
  */
-max31856_status max31856_getColdJunctionTemperature(float* temperature);
+max31856_status max31856_readColdJunctionTemperature(float* temperature);
 
 
 /** 
  * @brief Function to read the thermocouple temperature registers and convert it to degree celcius
  * 
+ * @details Reads the result of the last conversion.
+ * 
  * @param[in] temperature           Pointer to a temperature instance for reading the thermocouple value
  * 
  * @return  Error code to determine the status of MAX31856 if any
  */
-max31856_status max31856_getThermoCoupleTemperature(float* temperature);
+max31856_status max31856_readThermoCoupleTemperature(float* temperature);
 
 
 #endif // _MAX31856_H__
\ No newline at end of file
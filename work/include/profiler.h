@@ -0,0 +1,115 @@
+#ifndef _profiler_H__
+#define _profiler_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdk_config.h"
+#include "sdk_errors.h"
+#include "energy.h"
+
+/** Hot path profiler on the DWT cycle counter started by energy_init(). A probe covers a scope and
+ *  records the cycles from its start to the end of the scope: count, min, max, mean and a log2
+ *  histogram, bin n holding the durations of 2^n up to 2^(n+1) - 1 cycles. The counter stops while
+ *  the CPU sleeps and keeps running in interrupts, a probe counts the awake cycles including the
+ *  interrupts that preempt it. With PROFILER_ENABLED 0 the probes expand to nothing. */
+#define PROFILER_HISTOGRAM_BINS         24          ///< Log2 bins, the last one also holds everything above 2^24 cycles (262 ms)
+
+#define PROFILER_REPORT_SIZE            (17 + 2 * PROFILER_HISTOGRAM_BINS)  ///< probe u8 | count u32 | min u32 | max u32 | mean u32 | bins u16 x PROFILER_HISTOGRAM_BINS, little endian
+
+
+/**
+ * @brief Typedef Enum for defining the probes
+ */
+typedef enum
+{
+    PROFILER_PROBE_DRDY,                ///< MAX31856 DRDY interrupt, up to posting the conversion result
+    PROFILER_PROBE_SAMPLE,              ///< Sample cycle in the main loop: read, store, flush a full record
+    PROFILER_PROBE_SPI_TRANSFER,        ///< spi_transfer()
+    PROFILER_PROBE_FDS_WRITE,           ///< fds_write(), queuing a record
+    PROFILER_PROBE_FDS_READ,            ///< fds_read() and fds_read_chunk()
+    PROFILER_PROBE_PUSH_DATA_PACKETS,   ///< Refill of the notification queue of a link
+    PROFILER_PROBE_MAIN_LOOP,           ///< Awake part of a main loop iteration
+    PROFILER_PROBE_COUNT
+} profiler_probe_t;
+
+/**
+ * @brief Typedef Struct for holding the running probe of a scope
+ */
+typedef struct
+{
+    profiler_probe_t    probe;          ///< Probe the cycles are recorded to
+    uint32_t            start;          ///< Cycle counter at the start of the scope
+} profiler_scope_t;
+
+/**
+ * @brief Typedef Struct for holding the report of a probe
+ */
+typedef struct
+{
+    uint8_t     probe;                              ///< profiler_probe_t
+    uint32_t    count;                              ///< Number of recorded scopes
+    uint32_t    min;                                ///< Shortest scope [cycles], 0 if none
+    uint32_t    max;                                ///< Longest scope [cycles]
+    uint32_t    mean;                               ///< Mean of the scopes [cycles]
+    uint16_t    bins[PROFILER_HISTOGRAM_BINS];      ///< Scopes per log2 bin, saturating
+} profiler_report_t;
+
+
+#if PROFILER_ENABLED
+/** Probes the rest of the enclosing scope, every return included. One probe per scope and per id. */
+#define PROFILER_SCOPE(probe)                                                                       \
+    profiler_scope_t profiler_scope_##probe __attribute__((cleanup(profiler_scope_end))) =          \
+        {(probe), energy_cycles_get()}
+#else
+#define PROFILER_SCOPE(probe)
+#endif
+
+
+/**
+ * @brief Function for recording the cycles of a probe
+ *
+ * @details Safe to call from interrupt context.
+ *
+ * @param[in] probe                 Probe
+ * @param[in] cycles                Cycles of the scope
+ */
+void profiler_record(profiler_probe_t probe, uint32_t cycles);
+
+
+/**
+ * @brief Function for ending a scope opened by PROFILER_SCOPE(), called by the compiler
+ *
+ * @param[in] p_scope               Scope that ends
+ */
+void profiler_scope_end(profiler_scope_t const* p_scope);
+
+
+/**
+ * @brief Function for clearing the records of every probe
+ */
+void profiler_reset(void);
+
+
+/**
+ * @brief Function for getting the report of a probe
+ *
+ * @param[in]  probe                Probe
+ * @param[out] p_report             Report of the probe
+ *
+ * @return      NRF_SUCCESS, NRF_ERROR_INVALID_PARAM if the probe is unknown
+ */
+ret_code_t profiler_report_get(uint8_t probe, profiler_report_t* p_report);
+
+
+/**
+ * @brief Function for encoding the report of a probe
+ *
+ * @param[in]  p_report             Report to encode
+ * @param[out] p_data               Buffer of PROFILER_REPORT_SIZE bytes
+ *
+ * @return      Number of bytes encoded
+ */
+uint8_t profiler_report_encode(profiler_report_t const* p_report, uint8_t* p_data);
+
+
+#endif // _profiler_H__
@@ -0,0 +1,65 @@
+#ifndef _pyramid_H__
+#define _pyramid_H__
+
+#include <stdint.h>
+
+/** Coarser levels of the history, kept next to the raw samples for the overview of the app.
+ *
+ *  Level 0 is the raw history in flash. Every other level holds buckets of min, max and mean of
+ *  the samples within a fixed period, updated with every stored sample and read out as summary
+ *  blocks (tcs_frame.h). The levels live in RAM, like the history they are cleared at boot. */
+#define PYRAMID_LEVEL_COUNT             3           ///< Raw, hourly and 6-hourly
+#define PYRAMID_LEVEL1_PERIOD           3600        ///< Length of a bucket of level 1 [s]
+#define PYRAMID_LEVEL2_PERIOD           21600       ///< Length of a bucket of level 2 [s]
+#define PYRAMID_DAYS                    30          ///< Time covered by the levels, the history holds MAX_NUMBER_OF_DAYS at the default interval
+
+
+/**
+ * @brief Function for clearing the levels, with the history of the previous run
+ */
+void pyramid_reset(void);
+
+
+/**
+ * @brief Function for adding a stored sample to every level
+ *
+ * @param[in] temperature           Stored sample [°C]
+ * @param[in] time                  Time of the sample since activation [s]
+ */
+void pyramid_add(float temperature, uint32_t time);
+
+
+/**
+ * @brief Function for getting the number of buckets of a level
+ *
+ * @param[in] level                 Level, 1 to PYRAMID_LEVEL_COUNT - 1
+ *
+ * @return      Number of buckets up to the one holding the last sample, 0 for an unknown level
+ */
+uint32_t pyramid_count(uint8_t level);
+
+
+/**
+ * @brief Function for getting the bucket length of a level
+ *
+ * @param[in] level                 Level, 1 to PYRAMID_LEVEL_COUNT - 1
+ *
+ * @return      Length of a bucket [s], 0 for an unknown level
+ */
+uint16_t pyramid_period(uint8_t level);
+
+
+/**
+ * @brief Function for encoding buckets of a level as the payload of a summary block
+ *
+ * @param[in]  level                Level, 1 to PYRAMID_LEVEL_COUNT - 1
+ * @param[in]  first                First bucket
+ * @param[in]  count                Number of buckets
+ * @param[out] p_data               Buffer of count x TCS_FRAME_SUMMARY_SIZE bytes
+ *
+ * @return      Number of bytes encoded, buckets past pyramid_count() are left out
+ */
+uint16_t pyramid_encode(uint8_t level, uint32_t first, uint16_t count, uint8_t* p_data);
+
+
+#endif // _pyramid_H__
@@ -0,0 +1,60 @@
+#ifndef _sensor_power_H__
+#define _sensor_power_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "spi.h"
+
+
+/** Load switch of the front end, with SENSOR_POWER_SWITCH_ENABLED */
+#define SENSOR_POWER_PIN            0x2A    ///< Load switch enable pin number, P1.10
+#define SENSOR_POWER_PIN_ACTIVE     1       ///< Level of the enable pin switching the front end on
+#define SENSOR_POWER_UP_DELAY       10      ///< Supply settling and MAX31856 power-on reset before the first SPI access [ms], measure and adjust
+
+
+/** 
+ * @brief Power-up handler type, the front end is ready for a conversion
+ * 
+ * @details Called from interrupt context with a load switch, from sensor_power_up() without one.
+ */
+typedef void (*sensor_power_handler_t)(void);
+
+
+/** 
+ * @brief Function for initializing the sensor front end and powering it down
+ * 
+ * @details Runs the full MAX31856 initialization once, later power-ups only restore the
+ *          register image. Requires GPIOTE and app_timer, like max31856_init().
+ * 
+ * @param[in] spi_instance          Instance of the spi interface to use
+ */
+void sensor_power_init(const nrf_drv_spi_t *const spi_instance);
+
+
+/** 
+ * @brief Function for powering up the front end before a conversion
+ * 
+ * @details Without a load switch the MAX31856 stays powered in normally-off mode and only the
+ *          SPIM is initialized. With one, the switch is closed and the registers are restored
+ *          SENSOR_POWER_UP_DELAY later.
+ * 
+ * @param[in] handler               Handler called once the front end is ready
+ */
+void sensor_power_up(sensor_power_handler_t handler);
+
+
+/** 
+ * @brief Function for powering down the front end after a conversion was read
+ */
+void sensor_power_down(void);
+
+
+/** 
+ * @brief Function for getting the time the last power-up took
+ * 
+ * @return  Time from sensor_power_up() to the front end being ready [us]
+ */
+uint32_t sensor_power_latency_get(void);
+
+
+#endif // _sensor_power_H__
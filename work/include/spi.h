@@ -14,7 +14,7 @@
 /** Extra details concerning SPI */
 #define SPI_IRQ_PRIORITY    6                                ///< 0-7 -> 0,1,4,5 reserverd by softdevice
 #define SPI_ORC             0xFF                             ///< Over-run charachter
-#define SPI_FREQUENCY       NRF_DRV_SPI_FREQ_1M              ///< 125K-250K-500K-1M-2M-4M-8M
+#define SPI_FREQUENCY       NRF_DRV_SPI_FREQ_4M              ///< 125K-250K-500K-1M-2M-4M-8M, MAX31856 up to 5M
 #define SPI_MODE            NRF_DRV_SPI_MODE_1               ///< 0-high-leading|1-high-trailing|2-low-leading|3-low-trailing   
 #define SPI_BIT_ORDER       NRF_DRV_SPI_BIT_ORDER_MSB_FIRST  ///< MSB-LSB
 
@@ -27,6 +27,15 @@
 void spi_init(const nrf_drv_spi_t *const spi_instance);
 
 
+/** 
+ * @brief Function for uninitializing the SPI interface between two transfers
+ * 
+ * @param[in] spi_instance          Instance of the spi interface to release
+ * @param[in] slave_powered         Boolean indicating if the slave stays powered
+ */
+void spi_uninit(const nrf_drv_spi_t *const spi_instance, bool slave_powered);
+
+
 /** 
  * @brief Function for transmitting and receiving data over the SPI bus
  * 
@@ -2,18 +2,33 @@
 #ifndef _storage_H__
 #define _storage_H__
 
+#include "fds.h"
+
 #define TC_DATA_SIZE        sizeof(float)   // Size of float (temperature)
+#define TC_SAMPLE_MAX_SIZE  6               // Size of a sample holding both channels, see tcs_frame.h
 #define MAX_RECORD_SIZE     144             // 1 day, every 10 minutes
 #define MAX_NUMBER_OF_DAYS  30              // Maximum number of days the application will run
 
 #define WORD                4               // Number of bytes in a word
+#define UPDATE_FILE_COUNT   8               // Number of files fds_update_deferred() can update
+#define UPDATE_RECORD_WORDS 40              // Largest record fds_update_deferred() takes, in words
+
+
+/**
+ * @brief FDS event handler type, called after the storage module handled the event
+ */
+typedef void (*fds_storage_evt_handler_t)(fds_evt_t const* p_fds_evt);
 
 /** 
  * @brief Function for writing to the FDS
  * 
+ * @details The data is copied, one write may be queued at a time. The record is counted by
+ *          fds_getNumberOfRecords() once FDS_EVT_WRITE reports it in flash.
+ * 
  * @param[in] write_file_id             ID of the file to write
  * @param[in] write_record key          Key of the record to write to
  * @param[in] p_write_data              Pointer to the data container
+ * @param[in] data_length               Length of the data in bytes, padded to whole words
  * 
  * @return      NRF_SUCCESS if successful, else error code
  */
@@ -21,50 +36,110 @@ ret_code_t fds_write(uint32_t write_file_id, uint32_t write_record_key, uint8_t*
 
 
 /** 
- * @brief Function for reading from the FDS
+ * @brief Function for writing a single record, replacing the previous version
+ * 
+ * @details The data must stay valid until the FDS_EVT_UPDATE or FDS_EVT_WRITE event. When the
+ *          flash is full the garbage collector is started and the update has to be retried.
  * 
  * @param[in] write_file_id             ID of the file to write
- * @param[in] write_record key          Key of the record to write to
- * @param[out] p_read_data              Pointer to the data container
+ * @param[in] write_record_key          Key of the record to write to
+ * @param[in] p_write_data              Pointer to the word aligned data
+ * @param[in] length_words              Length of the data in words
  * 
  * @return      NRF_SUCCESS if successful, else error code
  */
-ret_code_t fds_read(uint32_t read_file_id, uint32_t read_record_key, uint8_t (*p_read_data)[MAX_RECORD_SIZE * TC_DATA_SIZE]);
+ret_code_t fds_update(uint32_t write_file_id, uint32_t write_record_key, void const* p_write_data, uint32_t length_words);
 
 
 /** 
- * @brief Function for finding and deleting records within a file
+ * @brief Function for running the garbage collector
+ * 
+ * @details Completion is reported by FDS_EVT_GC.
+ * 
+ * @return      NRF_SUCCESS if successful, else error code
+ */
+ret_code_t fds_garbage_collector(void);
+
+
+/** 
+ * @brief Function for updating a record from data that keeps changing
+ * 
+ * @details The data is copied to a snapshot that FDS writes. While the update of the file is in
+ *          flight, a new call only notes the source, which is copied again and written once the
+ *          FDS_EVT_UPDATE or FDS_EVT_WRITE event arrives, so the last call always ends up in flash.
+ *          One record per file, callable from interrupt context.
  * 
  * @param[in] write_file_id             ID of the file to write
- * @param[in] write_record key          Key of the record to write to
+ * @param[in] write_record_key          Key of the record to write to
+ * @param[in] p_source                  Pointer to the data, valid for the whole run
+ * @param[in] length_words              Length of the data in words, at most UPDATE_RECORD_WORDS
+ * 
+ * @return      NRF_SUCCESS if the update was queued or deferred, else error code
+ */
+ret_code_t fds_update_deferred(uint32_t write_file_id, uint32_t write_record_key, void const* p_source, uint32_t length_words);
+
+
+/** 
+ * @brief Function for deleting every record of a file
+ * 
+ * @details Completion is reported by FDS_EVT_DEL_FILE.
+ * 
+ * @param[in] file_id                   ID of the file to delete
  * 
  * @return      NRF_SUCCESS if successful, else error code
  */
-ret_code_t fds_find_and_delete(uint32_t read_file_id, uint32_t read_record_key);
+ret_code_t fds_delete_file(uint32_t file_id);
 
 
 /** 
- * @brief Function for initializing the FDS
+ * @brief Function for reading from the FDS
+ * 
+ * @param[in] write_file_id             ID of the file to write
+ * @param[in] write_record key          Key of the record to write to
+ * @param[out] p_read_data              Pointer to the data container
  * 
  * @return      NRF_SUCCESS if successful, else error code
  */
-ret_code_t fds_storage_init(void);
+ret_code_t fds_read(uint32_t read_file_id, uint32_t read_record_key, uint8_t (*p_read_data)[MAX_RECORD_SIZE * TC_SAMPLE_MAX_SIZE]);
 
 
 /** 
- * @brief Function for getting the write flag
+ * @brief Function for reading a chunk of the concatenated records of a file
+ * 
+ * @details The records with the given file ID and record key are treated as one continuous
+ *          byte stream, in the order they were written. Nothing is buffered in RAM besides the
+ *          destination.
+ * 
+ * @param[in] read_file_id              ID of the file to read
+ * @param[in] read_record key           Key of the records to read
+ * @param[in] offset                    Byte offset in the stream to start reading at
+ * @param[out] p_read_data              Pointer to the data container
+ * @param[in] length                    Maximum number of bytes to read
  * 
- * @return      Boolean indicating the write status
+ * @return      Number of bytes read
  */
-bool fds_getWriteFlag(void);
+uint32_t fds_read_chunk(uint32_t read_file_id, uint32_t read_record_key, uint32_t offset, uint8_t* p_read_data, uint32_t length);
 
 
 /** 
- * @brief Function for setting the write flag
+ * @brief Function for finding and deleting records within a file
  * 
- * @param[in] fds_write_flag        Boolean indicating the write status
+ * @param[in] write_file_id             ID of the file to write
+ * @param[in] write_record key          Key of the record to write to
+ * 
+ * @return      NRF_SUCCESS if successful, else error code
+ */
+ret_code_t fds_find_and_delete(uint32_t read_file_id, uint32_t read_record_key);
+
+
+/** 
+ * @brief Function for initializing the FDS
+ * 
+ * @param[in] evt_handler               Handler for the FDS events, may be NULL
+ * 
+ * @return      NRF_SUCCESS if successful, else error code
  */
-void fds_setWriteFlag(bool fds_write_flag);
+ret_code_t fds_storage_init(fds_storage_evt_handler_t evt_handler);
 
 
 /** 
@@ -86,7 +161,7 @@ void fds_setAllRecordsDeletedFlag(bool fds_all_records_deleted_flag);
 /** 
  * @brief Function for getting the number of found records
  * 
- * @return      16 bit initeger indicating the number of records found
+ * @return      16 bit initeger indicating the number of records found, and written since
  */
 uint16_t fds_getNumberOfRecords(void);
 
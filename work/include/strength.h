@@ -0,0 +1,112 @@
+#ifndef _strength_H__
+#define _strength_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdk_errors.h"
+
+/** Strength estimate from the maturity (ASTM C1074): a per-mix calibration curve of strength over
+ *  the temperature-time factor, uploaded point by point and kept in flash. Between the points the
+ *  curve is a monotone cubic (Fritsch-Carlson), evaluated in fixed point. Below the first point it
+ *  is a line through the origin, above the last point it holds the last strength. */
+#define STRENGTH_POINT_COUNT            16          ///< Largest number of calibration points
+
+#define STRENGTH_FILE_ID                0x318A      ///< FDS file holding the curve, kept across resets
+#define STRENGTH_REC_KEY                0x0001      ///< FDS record key of the curve
+
+#define STRENGTH_TIME_UNKNOWN           UINT32_MAX  ///< Time to target without a curve, without maturity gain or with the target above the curve
+
+#define STRENGTH_REPORT_SIZE            9           ///< strength u16 | target u16 | time to target u32 | points u8, little endian
+
+
+/**
+ * @brief Typedef Struct for holding the strength report
+ */
+typedef struct
+{
+    uint16_t    strength;               ///< Estimated strength [0.01 MPa]
+    uint16_t    target;                 ///< Target strength, e.g. for stripping the formwork [0.01 MPa]
+    uint32_t    time_to_target;         ///< Predicted curing time until the target at the current rate [min], 0 once reached
+    uint8_t     points;                 ///< Number of calibration points, 0 without a curve
+} strength_report_t;
+
+
+/**
+ * @brief Function for initializing the estimate without a curve and the STRENGTH_TARGET target
+ */
+void strength_init(void);
+
+
+/**
+ * @brief Function for restoring the curve and the target from flash
+ *
+ * @details Call once FDS is initialized.
+ */
+void strength_restore(void);
+
+
+/**
+ * @brief Function for staging a calibration point
+ *
+ * @details The curve in use is kept until strength_curve_save().
+ *
+ * @param[in] index                 Index of the point, in order of maturity
+ * @param[in] maturity              Temperature-time factor of the point [0.1 °C·h]
+ * @param[in] strength              Strength at that factor [0.01 MPa]
+ *
+ * @return      NRF_SUCCESS, NRF_ERROR_INVALID_PARAM if the index is out of range
+ */
+ret_code_t strength_point_set(uint8_t index, uint32_t maturity, uint16_t strength);
+
+
+/**
+ * @brief Function for taking the staged points as the curve and writing it to flash
+ *
+ * @param[in] points                Number of staged points making up the curve, 0 to remove the curve
+ *
+ * @return      NRF_SUCCESS, NRF_ERROR_INVALID_PARAM if there is a single point, the factors are not
+ *              strictly increasing or the strength drops
+ */
+ret_code_t strength_curve_save(uint8_t points);
+
+
+/**
+ * @brief Function for setting the target strength and writing it to flash
+ *
+ * @param[in] target                Target strength [0.01 MPa]
+ */
+void strength_target_set(uint16_t target);
+
+
+/**
+ * @brief Function for evaluating the curve
+ *
+ * @param[in] maturity              Temperature-time factor [0.1 °C·h]
+ *
+ * @return      Strength [0.01 MPa], 0 without a curve
+ */
+uint16_t strength_at(uint32_t maturity);
+
+
+/**
+ * @brief Function for computing the strength report
+ *
+ * @param[in]  maturity             Temperature-time factor [0.1 °C·h]
+ * @param[in]  rate                 Factor gained per day at the current temperature [0.1 °C·h/day]
+ * @param[out] p_report             Report of the estimate
+ */
+void strength_report_get(uint32_t maturity, uint32_t rate, strength_report_t* p_report);
+
+
+/**
+ * @brief Function for encoding the strength report
+ *
+ * @param[in]  p_report             Report to encode
+ * @param[out] p_data               Buffer of STRENGTH_REPORT_SIZE bytes
+ *
+ * @return      Number of bytes encoded
+ */
+uint8_t strength_report_encode(strength_report_t const* p_report, uint8_t* p_data);
+
+
+#endif // _strength_H__
@@ -0,0 +1,121 @@
+#ifndef _tcs_frame_H__
+#define _tcs_frame_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** Wire format of a thermocouple data block (all fields little endian)
+ *
+ *  | magic | encoding | count | seq_base | time_base | interval | payload_length | payload | crc16 |
+ *  |   1   |    1     |   2   |    4     |     4     |    2     |       2        |    n    |   2   |
+ *
+ *  The CRC is CRC-16/CCITT-FALSE (crc16_compute, seed 0xFFFF) over header and payload. The stream
+ *  ends with a block with count 0, its seq_base holds the total number of samples sent.
+ *
+ *  A sample holds the channels selected at activation, in this order: the linearized probe
+ *  (thermocouple) temperature as float32 [°C], the cold junction temperature as int16 in the
+ *  1/64 °C steps of the MAX31856. The encoding of the block tells which channels are present.
+ *
+ *  A summary block carries buckets of a coarser level instead of samples, seq_base is the index
+ *  of the first bucket and interval the bucket length. Every bucket is | min | max | mean |, int16
+ *  in 0.01 °C, a bucket without samples has min > max.
+ */
+#define TCS_FRAME_MAGIC             0xC5        ///< First byte of every block
+#define TCS_FRAME_HEADER_SIZE       16          ///< Size of the block header in bytes
+#define TCS_FRAME_CRC_SIZE          2           ///< Size of the block checksum in bytes
+#define TCS_FRAME_SUMMARY_SIZE      6           ///< Size of a bucket of a summary block in bytes
+#define TCS_FRAME_PROBE_SIZE        4           ///< Size of the probe channel of a sample in bytes
+#define TCS_FRAME_COLD_JUNCTION_SIZE 2          ///< Size of the cold junction channel of a sample in bytes
+#define TCS_FRAME_SAMPLE_MAX_SIZE   (TCS_FRAME_PROBE_SIZE + TCS_FRAME_COLD_JUNCTION_SIZE)  ///< Size of a sample with both channels
+#define TCS_FRAME_COLD_JUNCTION_SCALE 64        ///< Steps per °C of the cold junction channel
+
+#define TCS_CHANNEL_PROBE           (1 << 0)    ///< Channel mask bit of the thermocouple in the concrete
+#define TCS_CHANNEL_COLD_JUNCTION   (1 << 1)    ///< Channel mask bit of the cold junction on the board, the ambient reference
+
+#define TCS_FRAME_SIZE(payload_length)  (TCS_FRAME_HEADER_SIZE + (payload_length) + TCS_FRAME_CRC_SIZE)   ///< Size of a block on the wire
+
+
+/**
+ * @brief Typedef Enum for defining the payload encoding of a block
+ */
+typedef enum
+{
+    TCS_FRAME_ENCODING_FLOAT32  = 0x00,     ///< Probe channel, IEEE 754 single precision [°C]
+    TCS_FRAME_ENCODING_SUMMARY  = 0x01,     ///< Buckets of min, max and mean, int16 [0.01 °C]
+    TCS_FRAME_ENCODING_COLD_JUNCTION = 0x02,    ///< Cold junction channel, int16 [1/64 °C]
+    TCS_FRAME_ENCODING_DUAL     = 0x03,     ///< Probe channel float32 [°C] | cold junction channel int16 [1/64 °C]
+    TCS_FRAME_ENCODING_END      = 0xFF      ///< End of stream, no payload
+} tcs_frame_encoding;
+
+
+/**
+ * @brief Typedef Struct for holding the header fields of a block
+ */
+typedef struct
+{
+    tcs_frame_encoding  encoding;           ///< Encoding of the payload
+    uint16_t            count;              ///< Number of samples in the payload
+    uint32_t            seq_base;           ///< Sequence number of the first sample
+    uint32_t            time_base;          ///< Time of the first sample since activation [s]
+    uint16_t            interval;           ///< Time between two samples [s]
+    uint16_t            payload_length;     ///< Length of the payload in bytes
+} tcs_frame_header_t;
+
+
+/**
+ * @brief Function for encoding a block
+ *
+ * @param[in]  p_header             Header fields of the block
+ * @param[in]  p_payload            Payload of the block, payload_length bytes
+ * @param[out] p_frame              Buffer for the block, at least TCS_FRAME_SIZE(payload_length) bytes
+ *
+ * @return      Length of the encoded block in bytes
+ */
+uint16_t tcs_frame_encode(tcs_frame_header_t const* p_header, uint8_t const* p_payload, uint8_t* p_frame);
+
+
+/**
+ * @brief Function for getting the sample encoding of a channel mask
+ *
+ * @param[in]  channels             TCS_CHANNEL_* bits, at least one
+ *
+ * @return      Encoding of the blocks holding these channels
+ */
+tcs_frame_encoding tcs_frame_channels_encoding(uint8_t channels);
+
+
+/**
+ * @brief Function for getting the size of a sample
+ *
+ * @param[in]  encoding             Encoding of the sample, one of the sample encodings
+ *
+ * @return      Size of a sample in bytes
+ */
+uint8_t tcs_frame_sample_size(tcs_frame_encoding encoding);
+
+
+/**
+ * @brief Function for encoding the channels of a sample
+ *
+ * @param[in]  encoding             Encoding of the sample, one of the sample encodings
+ * @param[in]  probe                Probe temperature [°C]
+ * @param[in]  cold_junction        Cold junction temperature [°C]
+ * @param[out] p_data               Buffer of tcs_frame_sample_size() bytes
+ *
+ * @return      Number of bytes encoded
+ */
+uint8_t tcs_frame_sample_encode(tcs_frame_encoding encoding, float probe, float cold_junction, uint8_t* p_data);
+
+
+/**
+ * @brief Function for decoding the first channel of a sample, the probe if it is present
+ *
+ * @param[in]  encoding             Encoding of the sample, one of the sample encodings
+ * @param[in]  p_data               Encoded sample
+ *
+ * @return      Temperature of the first channel [°C]
+ */
+float tcs_frame_sample_temperature(tcs_frame_encoding encoding, uint8_t const* p_data);
+
+
+#endif // _tcs_frame_H__
@@ -0,0 +1,30 @@
+#ifndef _temperature_H__
+#define _temperature_H__
+
+#include <stdint.h>
+
+
+/**
+ * @brief Function for converting a temperature to hundredths of a degree
+ *
+ * @param[in] temperature           Temperature [°C]
+ *
+ * @return      Temperature [0.01 °C], rounded and saturated to int16_t
+ */
+static inline int16_t centi_degrees(float temperature)
+{
+    float const centi = temperature * 100.0f;
+
+    if (centi >= INT16_MAX)
+    {
+        return INT16_MAX;
+    }
+    if (centi <= INT16_MIN)
+    {
+        return INT16_MIN;
+    }
+    return (int16_t) ((centi >= 0.0f) ? (centi + 0.5f) : (centi - 0.5f));
+}
+
+
+#endif // _temperature_H__
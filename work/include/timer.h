@@ -2,11 +2,15 @@
 #ifndef _timer_H__
 #define _timer_H__
 
+#include "app_timer.h"
+
 
 /** 
  * @brief Function for initializing the timer interrupt
+ * 
+ * @param[in] timeout_handler   Handler called in interrupt context on every timeout
  */
-void timer_init(void);
+void timer_init(app_timer_timeout_handler_t timeout_handler);
 
 
 /** 
@@ -23,20 +27,4 @@ void timer_start(uint32_t timeout);
 void timer_stop(void);
 
 
-/** 
- * @brief Function for getting the interrupt flag
- * 
- * @return      Boolean indicating the interupt flag state
- */
-bool timer_getIntFlag(void);
-
-
-/** 
- * @brief Function for setting the interrupt flag
- * 
- * @param[in] timerIntFlag      Boolean indicating the interupt flag state
- */
-void timer_setIntFlag(bool timerIntFlag);
-
-
 #endif // _timer_H__
\ No newline at end of file
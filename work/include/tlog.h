@@ -0,0 +1,143 @@
+#ifndef _tlog_H__
+#define _tlog_H__
+
+#include <stdint.h>
+#include <string.h>
+#include "nordic_common.h"
+#include "app_util.h"
+#include "sdk_config.h"
+
+/**
+ * Tokenized binary log
+ *
+ * A log call stores the address of its format string and the raw 32 bit arguments in a ring,
+ * nothing is formatted on the sensor. The format strings live in the .tlog_fmt section, which
+ * the linker script keeps out of the flash image at address 0: the address is the token, and
+ * tcs_tlog_decode rebuilds the text from the section of the ELF file.
+ *
+ * Entry, little endian
+ *
+ *  | level << 4 | args | token | RTC ticks | args    |
+ *  |        1          |   2   |     3     | 4 x n   |
+ *
+ * Floats are passed with TLOG_FLOAT() and printed with %f, %e or %g. %s is not supported, the
+ * string would not be in the log.
+ */
+
+/** Log levels, same values as NRF_LOG */
+#define TLOG_LEVEL_ERROR        1           ///< Error
+#define TLOG_LEVEL_WARNING      2           ///< Warning
+#define TLOG_LEVEL_INFO         3           ///< Info
+#define TLOG_LEVEL_DEBUG        4           ///< Debug
+#define TLOG_LEVEL_LOST         7           ///< Entries were overwritten before they were read, the argument is their number
+
+#define TLOG_HEADER_SIZE        6           ///< Size of an entry without arguments
+#define TLOG_MAX_ARGS           6           ///< Largest number of arguments of an entry
+#define TLOG_RTT_CHANNEL        1           ///< RTT up channel of the binary log, 0 is used by NRF_LOG
+#define TLOG_RTT_BUFSIZE        256         ///< Size of the RTT up buffer of the binary log
+
+
+#if TLOG_ENABLED
+#define TLOG_ERROR(...)         TLOG_INTERNAL(TLOG_LEVEL_ERROR,   __VA_ARGS__)
+#define TLOG_WARNING(...)       TLOG_INTERNAL(TLOG_LEVEL_WARNING, __VA_ARGS__)
+#define TLOG_INFO(...)          TLOG_INTERNAL(TLOG_LEVEL_INFO,    __VA_ARGS__)
+#define TLOG_DEBUG(...)         TLOG_INTERNAL(TLOG_LEVEL_DEBUG,   __VA_ARGS__)
+#else
+#define TLOG_ERROR(...)
+#define TLOG_WARNING(...)
+#define TLOG_INFO(...)
+#define TLOG_DEBUG(...)
+#endif
+
+/** Argument for %f, %e and %g */
+#define TLOG_FLOAT(val)         tlog_float(val)
+
+#define TLOG_INTERNAL(level, ...)                                                                   \
+    do                                                                                              \
+    {                                                                                               \
+        if ((level) <= TLOG_LEVEL)                                                                  \
+        {                                                                                           \
+            static const char tlog_fmt[] __attribute__((section(".tlog_fmt"), used)) =              \
+                GET_VA_ARG_1(__VA_ARGS__);                                                          \
+            CONCAT_2(TLOG_INTERNAL_, NUM_VA_ARGS_LESS_1(__VA_ARGS__))(level, tlog_fmt, __VA_ARGS__); \
+        }                                                                                           \
+    } while (0)
+
+#define TLOG_INTERNAL_0(level, p_fmt, fmt)                                  \
+    tlog_write(level, p_fmt, 0, NULL)
+#define TLOG_INTERNAL_1(level, p_fmt, fmt, a1)                              \
+    tlog_write(level, p_fmt, 1, (uint32_t const[]) { (uint32_t) (a1) })
+#define TLOG_INTERNAL_2(level, p_fmt, fmt, a1, a2)                          \
+    tlog_write(level, p_fmt, 2, (uint32_t const[]) { (uint32_t) (a1), (uint32_t) (a2) })
+#define TLOG_INTERNAL_3(level, p_fmt, fmt, a1, a2, a3)                      \
+    tlog_write(level, p_fmt, 3, (uint32_t const[]) { (uint32_t) (a1), (uint32_t) (a2), (uint32_t) (a3) })
+#define TLOG_INTERNAL_4(level, p_fmt, fmt, a1, a2, a3, a4)                  \
+    tlog_write(level, p_fmt, 4, (uint32_t const[]) { (uint32_t) (a1), (uint32_t) (a2), (uint32_t) (a3), \
+                                                     (uint32_t) (a4) })
+#define TLOG_INTERNAL_5(level, p_fmt, fmt, a1, a2, a3, a4, a5)              \
+    tlog_write(level, p_fmt, 5, (uint32_t const[]) { (uint32_t) (a1), (uint32_t) (a2), (uint32_t) (a3), \
+                                                     (uint32_t) (a4), (uint32_t) (a5) })
+#define TLOG_INTERNAL_6(level, p_fmt, fmt, a1, a2, a3, a4, a5, a6)          \
+    tlog_write(level, p_fmt, 6, (uint32_t const[]) { (uint32_t) (a1), (uint32_t) (a2), (uint32_t) (a3), \
+                                                     (uint32_t) (a4), (uint32_t) (a5), (uint32_t) (a6) })
+
+
+/**
+ * @brief Function for passing a float to the log without converting it
+ *
+ * @param[in] value             Value to log
+ *
+ * @return      Bits of the value
+ */
+static inline uint32_t tlog_float(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+
+/**
+ * @brief Function for initializing the binary log and its RTT channel
+ */
+void tlog_init(void);
+
+
+/**
+ * @brief Function for appending an entry to the ring, use the TLOG_ macros
+ *
+ * @details Overwrites the oldest entries when the ring is full. Safe to call from interrupt
+ *          context.
+ *
+ * @param[in] level             Level of the entry
+ * @param[in] p_fmt             Format string in the .tlog_fmt section
+ * @param[in] nargs             Number of arguments, up to TLOG_MAX_ARGS
+ * @param[in] p_args            Arguments
+ */
+void tlog_write(uint8_t level, char const* p_fmt, uint8_t nargs, uint32_t const* p_args);
+
+
+/**
+ * @brief Function for reading the oldest entries out of the ring
+ *
+ * @details Only complete entries are read. A TLOG_LEVEL_LOST entry comes first if entries
+ *          were overwritten since the last read.
+ *
+ * @param[out] p_data           Buffer for the entries
+ * @param[in]  size             Size of the buffer, at least TLOG_HEADER_SIZE + 4 x TLOG_MAX_ARGS
+ *
+ * @return      Number of bytes read
+ */
+uint32_t tlog_read(uint8_t* p_data, uint32_t size);
+
+
+/**
+ * @brief Function for moving the entries to the RTT channel, call from the main loop
+ *
+ * @details Entries that do not fit stay in the ring, so the sensor sleeps even when no
+ *          debugger drains the channel.
+ */
+void tlog_process(void);
+
+
+#endif // _tlog_H__
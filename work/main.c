@@ -68,10 +68,12 @@
 #include "nrf_sdh_soc.h"
 #include "nrf_sdh_ble.h"
 #include "app_timer.h"
+#include "app_scheduler.h"
 #include "fds.h"
 #include "peer_manager.h"
 #include "peer_manager_handler.h"
 #include "ble_conn_state.h"
+#include "ble_radio_notification.h"
 #include "nrf_ble_gatt.h"
 #include "nrf_ble_qwr.h"
 #include "nrf_pwr_mgmt.h"
@@ -81,11 +83,27 @@
 #include "ble_bas.h"
 #include "ble_dis.h"
 #include "ble_tcs.h"
+#include "ble_tcs_l2cap.h"
 
 #include "battery_voltage.h"
 #include "max31856.h"
+#include "sensor_power.h"
 #include "timer.h"
 #include "storage.h"
+#include "tcs_frame.h"
+#include "link_profile.h"
+#include "adv_status.h"
+#include "adv_batch.h"
+#include "adv_policy.h"
+#include "energy.h"
+#include "maturity.h"
+#include "strength.h"
+#include "block_stats.h"
+#include "pyramid.h"
+#include "alert.h"
+#include "profiler.h"
+#include "tlog.h"
+#include "app_button.h"
 
 #include "nrf_delay.h"
 
@@ -104,10 +122,16 @@
 
 #define APP_ADV_INTERVAL                300                                     /**< The advertising interval (in units of 0.625 ms. This value corresponds to 187.5 ms). */
 
-#define APP_ADV_DURATION                0                                       /**< The advertising duration in units of 10 milliseconds (0 -> always on). */
+#define APP_ADV_DURATION                3000                                    /**< The fast advertising duration in units of 10 milliseconds (30 seconds), slow advertising follows. */
+#define APP_ADV_SLOW_INTERVAL           3200                                    /**< The slow advertising interval (in units of 0.625 ms. This value corresponds to 2 seconds). */
+#define APP_ADV_SLOW_DURATION           ((ADV_POLICY_SYNC_PERIOD > 0) ? (ADV_POLICY_SYNC_WINDOW * 6000) : 0)     /**< The slow advertising duration in units of 10 milliseconds, a sync window or always on. */
+#define BUTTON_DETECTION_DELAY          APP_TIMER_TICKS(50)                     /**< Delay from a GPIOTE event until a button is reported as pushed. */
 #define APP_BLE_OBSERVER_PRIO           3                                       /**< Application's BLE observer priority. You shouldn't need to modify this value. */
 #define APP_BLE_CONN_CFG_TAG            1                                       /**< A tag identifying the SoftDevice BLE configuration. */
 
+#define SCHED_MAX_EVENT_SIZE            sizeof(app_evt_t)                       /**< Maximum size of scheduler events. */
+#define SCHED_QUEUE_SIZE                16                                      /**< Maximum number of events in the scheduler queue. */
+
 #define MIN_CONN_INTERVAL               MSEC_TO_UNITS(100, UNIT_1_25_MS)        /**< Minimum acceptable connection interval (0.1 seconds). */
 #define MAX_CONN_INTERVAL               MSEC_TO_UNITS(200, UNIT_1_25_MS)        /**< Maximum acceptable connection interval (0.2 second). */
 #define SLAVE_LATENCY                   0                                       /**< Slave latency. */
@@ -131,25 +155,36 @@
 #define SPI_INSTANCE    0
 
 #define FDS_FILE_ID     0x3185
+#define TC_BUFFER_SAMPLES   (2 * MAX_RECORD_SIZE)                               /**< A record being written and the samples taken meanwhile. */
 #define FDS_REC_KEY     0x0001
 
+#define TC_RECORD_FRAME_SIZE    TCS_FRAME_SIZE(MAX_RECORD_SIZE * TC_SAMPLE_MAX_SIZE)    /**< Size of the block holding one full FDS record. */
+#define TC_SUMMARY_BLOCK_SIZE   ((MAX_RECORD_SIZE * TC_DATA_SIZE) / TCS_FRAME_SUMMARY_SIZE) /**< Buckets of a full summary block, it fits the buffer of a record block. */
+
 #define BLE_TX_POWER    8
 
 NRF_BLE_GATT_DEF(m_gatt);                                                       /**< GATT module instance. */
-NRF_BLE_QWR_DEF(m_qwr);                                                         /**< Context for the Queued Write module.*/
+NRF_BLE_QWRS_DEF(m_qwr, NRF_SDH_BLE_TOTAL_LINK_COUNT);                          /**< Context for the Queued Write module, one per link.*/
 BLE_ADVERTISING_DEF(m_advertising);                                             /**< Advertising module instance. */
 
 BLE_BAS_DEF(m_bas);
 BLE_TCS_DEF(m_tcs);
-
-bool tcs_update_flag = false;
-bool bas_update_flag = false;
+#if TCS_L2CAP_ENABLED
+BLE_TCS_L2CAP_DEF(m_tcs_l2cap);
+#endif
 
 bool m_app_finished_flag = false;
 bool m_app_activated_flag = false;
+bool m_battery_low_flag = false;
+
+static bool m_erase_bonds = true;                                               /**< Erase the bonds before advertising starts. */
+static bool m_storage_ready = false;                                            /**< The records of the previous run are deleted. */
 
 static const nrf_drv_spi_t spi = NRF_DRV_SPI_INSTANCE(SPI_INSTANCE);
-static uint16_t m_conn_handle = BLE_CONN_HANDLE_INVALID;                        /**< Handle of the current connection. */
+static uint16_t m_tcs_update_conn[NRF_SDH_BLE_TOTAL_LINK_COUNT];                /**< Connections with a pending dump request, indexed by link. */
+#if TCS_L2CAP_ENABLED
+static uint16_t m_l2cap_dump_conn[NRF_SDH_BLE_TOTAL_LINK_COUNT];                /**< Connections with a pending L2CAP dump request, indexed by link. */
+#endif
 
 static ble_uuid_t m_adv_uuids[] =                                               /**< Universally unique service identifiers. */
 {
@@ -158,182 +193,647 @@ static ble_uuid_t m_adv_uuids[] =
     {BLE_UUID_DEVICE_INFORMATION_SERVICE, BLE_UUID_TYPE_BLE}
 };
 
+/**@brief Application event types, posted from interrupt context and handled in the main loop. */
 typedef enum
 {
-    e_cold_junction,
-    e_thermocouple
-} temperature_type;
-
-union
+    APP_EVT_ACTIVATION,             /**< "Activate" or the timer interval was written. */
+    APP_EVT_MEASUREMENT,            /**< The measurement timer expired. */
+    APP_EVT_SENSOR_READY,           /**< The sensor front end is powered up. */
+    APP_EVT_CONVERSION_DONE,        /**< The MAX31856 finished a conversion, or timed out. */
+    APP_EVT_RECORD_WRITTEN,         /**< FDS finished writing a record. */
+    APP_EVT_RECORD_FAILED,          /**< FDS failed to write a record. */
+    APP_EVT_GARBAGE_COLLECTED,      /**< FDS finished collecting garbage. */
+    APP_EVT_ENERGY_RESET,           /**< "EnergyReset" was written. */
+    APP_EVT_TCS_DUMP,               /**< A central enabled the history notifications. */
+    APP_EVT_L2CAP_DUMP,             /**< A central requested the history over L2CAP. */
+    APP_EVT_BATTERY_UPDATE,         /**< A central connected. */
+    APP_EVT_BATTERY_MEASURED,       /**< The battery monitor finished a measurement. */
+    APP_EVT_BUTTON,                 /**< The button was pushed. */
+    APP_EVT_STORAGE_INIT,           /**< FDS finished initializing. */
+    APP_EVT_STORAGE_CLEARED,        /**< The records of the previous run are deleted. */
+    APP_EVT_MATURITY_RESET,         /**< "MaturityReset" was written. */
+    APP_EVT_MATURITY_DATUM,         /**< A datum temperature was written. */
+    APP_EVT_MATURITY_ACTIVATION,    /**< An activation energy was written. */
+    APP_EVT_STATS_QUERY,            /**< A statistics query was written. */
+    APP_EVT_ALERT_RULE,             /**< An alert rule was written. */
+    APP_EVT_CURVE_POINT,            /**< A calibration point was written. */
+    APP_EVT_CURVE_SAVE,             /**< The calibration curve was saved. */
+    APP_EVT_TARGET_STRENGTH,        /**< A target strength was written. */
+    APP_EVT_PROFILE_QUERY,          /**< A profiler query was written. */
+    APP_EVT_PROFILE_RESET           /**< "ProfileReset" was written. */
+} app_evt_type_t;
+
+/**@brief Application event. */
+typedef struct
 {
-    float float_val;
-    unsigned char bytes_val[sizeof(float)];
-} floatAsBytes;
-
+    app_evt_type_t          type;
+    uint16_t                conn_handle;    /**< Connection the event belongs to, BLE_CONN_HANDLE_INVALID if none. */
+    ble_tcs_evt_params_t    params;         /**< Value written with a TCS command, only queued by app_evt_params_post(). */
+} app_evt_t;
 
-static uint8_t m_tc_buffer_local[MAX_RECORD_SIZE * TC_DATA_SIZE] = {0};
-static uint8_t m_tc_buffer_fds[MAX_RECORD_SIZE * TC_DATA_SIZE * MAX_NUMBER_OF_DAYS] = {0};
+static uint8_t m_tc_buffer_local[TC_BUFFER_SAMPLES * TC_SAMPLE_MAX_SIZE] = {0};      /**< Record queued to FDS, followed by the next samples. */
 
-static uint8_t m_number_of_measurements = 0;
+static uint16_t m_number_of_measurements = 0;                                   /**< Samples in the local buffer, the queued record included. */
+static uint16_t m_record_pending_samples = 0;                                   /**< Samples of the record queued to FDS, kept until FDS_EVT_WRITE. */
+static bool m_record_gc_pending = false;                                        /**< The flash was full, the record is written again on FDS_EVT_GC. */
+static bool m_record_gc_retry = false;                                          /**< The record already waited for the garbage collector. */
 static uint16_t m_total_number_of_measurements = 0;
+static uint16_t m_tc_interval = 0;                                              /**< Thermocouple timer interval [s]. */
+static uint8_t m_tc_channels;                                                   /**< TCS_CHANNEL_* bits stored per sample, fixed at activation. */
+static tcs_frame_encoding m_tc_encoding;                                        /**< Encoding of the stored samples. */
+static uint8_t m_tc_sample_size;                                                /**< Size of a stored sample in bytes. */
+
+static bool m_conversion_pending = false;                                       /**< A conversion is running. */
+static volatile max31856_status m_conversion_status;                            /**< Result of the last conversion. */
+static uint32_t m_conversion_start_ticks;                                       /**< RTC ticks at the start of the running conversion. */
+static volatile uint32_t m_conversion_done_ticks;                               /**< RTC ticks at the end of the last conversion. */
+static uint32_t m_maturity_periods = 0;                                         /**< Measurement periods since the last stored sample. */
+#if PROFILER_ENABLED
+static uint8_t m_profile_probe = 0;                                             /**< Probe of the last profiler query, answered again after a reset. */
+#endif
+
+typedef struct
+{
+    uint8_t  level;                             /**< Level of the history being dumped, 0 for the raw samples. */
+    uint16_t block_items;                       /**< Samples or buckets of a full block. */
+    uint16_t item_size;                         /**< Size of a sample or bucket in bytes. */
+    uint32_t first;                             /**< First sample or bucket in the stream being dumped. */
+    uint32_t count;                             /**< Number of samples or buckets in the stream being dumped. */
+    uint32_t blocks;                            /**< Number of full blocks in the stream being dumped. */
+    uint32_t length;                            /**< Length of the stream being dumped in bytes. */
+    uint32_t synced;                            /**< Raw samples read out once the dump completes, 0 for a range or a coarser level. */
+    uint8_t  frame[TC_RECORD_FRAME_SIZE];       /**< Block of the stream that is currently being sent. */
+    int32_t  frame_index;                       /**< Index of the block held in frame, -1 if none. */
+    uint16_t frame_length;                      /**< Length of the block held in frame. */
+} tc_stream_t;
+
+static tc_stream_t m_tc_streams[NRF_SDH_BLE_TOTAL_LINK_COUNT];                  /**< Dump cursor of every link, indexed by link. */
+static uint32_t m_tc_synced_samples = 0;                                        /**< Number of samples read out by the last completed dump. */
+
+static adv_status_t m_adv_status = {0};                                         /**< Status record carried in the advertising data. */
+static uint8_t m_adv_status_data[ADV_STATUS_SIZE];                              /**< Encoded status record. */
 
 
 static void advertising_start(bool erase_bonds);
+static void app_evt_post(app_evt_type_t type, uint16_t conn_handle);
+static void app_evt_params_post(app_evt_type_t type, uint16_t conn_handle, ble_tcs_evt_params_t const* p_params);
+static void advertising_status_update(void);
+#if ADV_BATCH_ENABLED
+static void advertising_batch_broadcast(void);
+#endif
 
 
 /**
- * @brief Function for converting a float to bytes
+ * @brief Function for selecting the channels stored per sample
  * 
- * @param[in] m_float    Float to be converted to bytes
+ * @details The sample size is fixed for a run, the offsets into the history depend on it.
  * 
- * @return  Bytes that form a float value
+ * @param[in] channels      TCS_CHANNEL_* bits, at least one
  */
-unsigned char* float2bytes(float m_float)
+static void tc_channels_set(uint8_t channels)
 {
-    floatAsBytes.float_val = m_float;
-    return floatAsBytes.bytes_val;
+    m_tc_channels    = channels;
+    m_tc_encoding    = tcs_frame_channels_encoding(channels);
+    m_tc_sample_size = tcs_frame_sample_size(m_tc_encoding);
 }
 
 
 /**
- * @brief Function for converting bytes to a float
+ * @brief Function for removing the oldest samples from the local buffer
  * 
- * @param[in] m_bytes    Bytes that form a float (4 bytes)
+ * @param[in] samples       Number of samples to remove
+ */
+static void tc_buffer_remove(uint16_t samples)
+{
+    uint32_t const removed = samples * m_tc_sample_size;
+    uint32_t const kept    = (m_number_of_measurements - samples) * m_tc_sample_size;
+
+    memmove(m_tc_buffer_local, &m_tc_buffer_local[removed], kept);
+    memset(&m_tc_buffer_local[kept], 0, sizeof(m_tc_buffer_local) - kept);
+    m_number_of_measurements -= samples;
+}
+
+
+/**
+ * @brief Function for getting the sequence number of the first sample in the local buffer
  * 
- * @return  Float value
+ * @details Every stored sample is in flash or in the local buffer, the record counter of FDS
+ *          runs ahead of the buffer from FDS_EVT_WRITE to APP_EVT_RECORD_WRITTEN.
  */
-float bytes2float(unsigned char m_bytes[sizeof(float)])
+static uint32_t tc_buffer_first(void)
 {
-    memcpy(floatAsBytes.bytes_val, m_bytes, sizeof(float));
-    return floatAsBytes.float_val;
+    return m_total_number_of_measurements - m_number_of_measurements;
 }
 
 
 /**
  * @brief Function for handling the writing the thermocouple buffer to FDS
+ * 
+ * @details The samples stay in the local buffer until FDS_EVT_WRITE, a dump reads them from there
+ *          until the record is in flash. A full flash starts the garbage collector once and the
+ *          record is written again on FDS_EVT_GC, the samples are only dropped if it is still full.
  */
 static void write_tc_buffer_too_fds(void)
 {
     ret_code_t ret_code;
     
-    if (m_number_of_measurements > 0) 
+    if ((m_number_of_measurements > 0) && (m_record_pending_samples == 0) && !m_record_gc_pending)
     {
-        NRF_LOG_INFO("Writing thermocouple buffer to FDS...");
-        ret_code = fds_write(FDS_FILE_ID, FDS_REC_KEY, m_tc_buffer_local, (m_number_of_measurements * TC_DATA_SIZE));
+        uint16_t const samples = MIN(m_number_of_measurements, MAX_RECORD_SIZE);
+
+        TLOG_INFO("Writing thermocouple buffer to FDS, %d samples", samples);
+        ret_code = fds_write(FDS_FILE_ID, FDS_REC_KEY, m_tc_buffer_local, (samples * m_tc_sample_size));
     
         if (ret_code == FDS_ERR_RECORD_TOO_LARGE)
         {
             NRF_LOG_INFO("FDS_ERR_RECORD_TOO_LARGE");
+            tc_buffer_remove(samples);
+        }
+        else if ((ret_code == FDS_ERR_NO_SPACE_IN_FLASH) && !m_record_gc_retry &&
+                 (fds_garbage_collector() == NRF_SUCCESS))
+        {
+            // Old versions of the updated records fill the flash, the samples wait for FDS_EVT_GC
+            TLOG_INFO("FDS_ERR_NO_SPACE_IN_FLASH, collecting garbage");
+            m_record_gc_pending = true;
+            m_record_gc_retry   = true;
         }
         else if (ret_code == FDS_ERR_NO_SPACE_IN_FLASH)
         {
-            NRF_LOG_INFO("FDS_ERR_NO_SPACE_IN_FLASH");
+            // The garbage collector freed too little, the flash is full of valid records
+            TLOG_WARNING("FDS_ERR_NO_SPACE_IN_FLASH, %d samples dropped", samples);
+            m_record_gc_retry = false;
+            tc_buffer_remove(samples);
         }
         else
         {
+            // The record is copied by fds_write(), completion is reported by FDS_EVT_WRITE
             APP_ERROR_CHECK(ret_code);
-
-            while (!fds_getWriteFlag());
-            fds_setWriteFlag(false);
+            m_record_pending_samples = samples;
+            m_record_gc_retry        = false;
         }
+    }
+}
+
+
+/**
+ * @brief Function for converting RTC ticks to microseconds
+ */
+static uint32_t ticks_to_us(uint32_t ticks)
+{
+    return (uint32_t) (((uint64_t) ticks * 1000000) / APP_TIMER_CLOCK_FREQ);
+}
+
+
+/**
+ * @brief Function for handling the end of a MAX31856 conversion
+ * 
+ * @details Called from interrupt context, the result is read in the main loop.
+ * 
+ * @param[in] status    Result of the conversion
+ */
+static void max31856_conversion_handler(max31856_status status)
+{
+    m_conversion_status = status;
+    m_conversion_done_ticks = app_timer_cnt_get();
+    app_evt_post(APP_EVT_CONVERSION_DONE, BLE_CONN_HANDLE_INVALID);
+}
+
+
+/**
+ * @brief Function for publishing the strength estimated from the maturity on the strength characteristic
+ * 
+ * @param[in] p_maturity    Maturity report the estimate is based on
+ */
+static void strength_publish(maturity_report_t const* p_maturity)
+{
+    strength_report_t report;
+    uint8_t data[STRENGTH_REPORT_SIZE];
+
+    strength_report_get(p_maturity->maturity, p_maturity->rate, &report);
+    uint8_t length = strength_report_encode(&report, data);
+
+    ret_code_t err_code = ble_tcs_strength_set(&m_tcs, data, length);
+    APP_ERROR_CHECK(err_code);
+}
+
+
+/**
+ * @brief Function for publishing the maturity report on the maturity characteristic
+ */
+static void maturity_publish(void)
+{
+    maturity_report_t report;
+    uint8_t data[MATURITY_REPORT_SIZE];
+
+    maturity_report_get(&report);
+    uint8_t length = maturity_report_encode(&report, data);
+
+    ret_code_t err_code = ble_tcs_maturity_set(&m_tcs, data, length);
+    APP_ERROR_CHECK(err_code);
+
+    strength_publish(&report);
+}
+
+
+/**
+ * @brief Function for adding a stored sample to the maturity
+ * 
+ * @param[in] temperature   Temperature of the sample
+ */
+static void maturity_update(float temperature)
+{
+    // Skipped or discarded measurements lengthen the interval
+    maturity_add(temperature, m_maturity_periods * m_tc_interval);
+    m_maturity_periods = 0;
+
+    maturity_publish();
+}
+
 
-        m_number_of_measurements = 0;
-        memcpy(m_tc_buffer_local, 0, sizeof(m_tc_buffer_local));
+/**
+ * @brief Function for evaluating the alert rules on a stored sample
+ * 
+ * @details The core is the thermocouple in the concrete, the surface the cold junction on the
+ *          board, both from the same conversion whatever channels are stored.
+ * 
+ * @param[in] seq           Sequence number of the sample
+ * @param[in] core          Thermocouple temperature [°C]
+ * @param[in] surface       Cold junction temperature [°C]
+ */
+static void alert_update(uint32_t seq, float core, float surface)
+{
+    alert_report_t report;
+    uint8_t data[ALERT_REPORT_SIZE];
+
+    if (!alert_evaluate(seq, seq * m_tc_interval, core, surface, &report))
+    {
+        return;
+    }
+
+    uint8_t length = alert_report_encode(&report, data);
+
+    ret_code_t err_code = ble_tcs_alert_send(&m_tcs, data, length);
+    if ((err_code != NRF_SUCCESS) &&
+        (err_code != NRF_ERROR_INVALID_STATE) &&
+        (err_code != BLE_ERROR_GATTS_SYS_ATTR_MISSING))
+    {
+        APP_ERROR_HANDLER(err_code);
+    }
+
+    if (report.active & report.changed)
+    {
+        // A rule fired, let gateways find the sensor quickly
+        adv_policy_restore_fast(ADV_POLICY_TRIGGER_ALERT);
     }
 }
 
 
 /**
- * @brief Function for handling the MAX31856 timer interrupt
+ * @brief Function for processing the result of a MAX31856 conversion
+ * 
+ * @details Every conversion gives the linearized thermocouple and the cold junction temperature,
+ *          the channels selected at activation are stored as one sample.
+ * 
+ * @param[in] status    Result of the conversion
  */
-static void max31856_int_handler(temperature_type type)
+static void measurement_process(max31856_status status)
 {
-    bsp_board_led_on(BSP_BOARD_LED_2);
-    
+    ble_tcs_live_sample_t live_sample = {0};
+    float thermocouple_temperature = 0.0f;
+    float cold_junction_temperature = 0.0f;
+
     // TODO: Handle error
     if (max31856_checkFaultStatus() != APPROVED)
     {
+        live_sample.flags |= BLE_TCS_LIVE_FLAG_FAULT;
         max31856_resetFaultStatus();
+
+        if (!(m_adv_status.faults & ADV_STATUS_FAULT_SENSOR))
+        {
+            // New sensor fault, let gateways find the sensor quickly
+            adv_policy_restore_fast(ADV_POLICY_TRIGGER_ALERT);
+        }
     }
 
-    if (type == e_cold_junction)
+    live_sample.seq = m_total_number_of_measurements;
+    live_sample.flags |= BLE_TCS_LIVE_FLAG_DISCARDED;
+
+    if ((status == MAX31856_SUCCESS) &&
+        (max31856_readThermoCoupleTemperature(&thermocouple_temperature) == MAX31856_SUCCESS) &&
+        (max31856_readColdJunctionTemperature(&cold_junction_temperature) == MAX31856_SUCCESS))
     {
-        float cold_junction_temperature = 0.0f;
-        unsigned char* cold_junction_temperature_bytes;
+        TLOG_INFO("Measurement %d, thermocouple temperature: %.2f°C, cold junction temperature: %.2f°C",
+                  m_number_of_measurements + 1, TLOG_FLOAT(thermocouple_temperature), TLOG_FLOAT(cold_junction_temperature));
 
-        if (max31856_getColdJunctionTemperature(&cold_junction_temperature) == MAX31856_SUCCESS)
+        // The probe leads, the cold junction alone is the ambient reference
+        if (m_tc_channels & TCS_CHANNEL_PROBE)
+        {
+            live_sample.temperature = thermocouple_temperature;
+        }
+        else
         {
-            NRF_LOG_INFO("Measurement: %d", m_number_of_measurements + 1);
-            NRF_LOG_INFO("Cold Junction Temperature: " NRF_LOG_FLOAT_MARKER "°C\r\n", NRF_LOG_FLOAT(cold_junction_temperature));
-            cold_junction_temperature_bytes = float2bytes(cold_junction_temperature);
+            live_sample.temperature = cold_junction_temperature;
+            live_sample.flags |= BLE_TCS_LIVE_FLAG_COLD_JUNCTION;
+        }
 
-            if (cold_junction_temperature != 0.0f)
-            {
-                memcpy(&m_tc_buffer_local[m_number_of_measurements * TC_DATA_SIZE], cold_junction_temperature_bytes, sizeof(cold_junction_temperature_bytes));
-                
-                m_number_of_measurements++;
-                m_total_number_of_measurements++;
-            }
+        if ((live_sample.temperature != 0.0f) && (m_number_of_measurements < TC_BUFFER_SAMPLES))
+        {
+            UNUSED_RETURN_VALUE(tcs_frame_sample_encode(m_tc_encoding, thermocouple_temperature, cold_junction_temperature,
+                                                        &m_tc_buffer_local[m_number_of_measurements * m_tc_sample_size]));
+
+            m_number_of_measurements++;
+            m_total_number_of_measurements++;
+            live_sample.flags &= ~BLE_TCS_LIVE_FLAG_DISCARDED;
         }
     }
-    else if (type == e_thermocouple)
+
+    ret_code_t err_code = ble_tcs_live_sample_send(&m_tcs, &live_sample);
+    if ((err_code != NRF_SUCCESS) &&
+        (err_code != NRF_ERROR_INVALID_STATE) &&
+        (err_code != NRF_ERROR_RESOURCES) &&
+        (err_code != BLE_ERROR_GATTS_SYS_ATTR_MISSING))
     {
-        float thermocouple_temperature = 0.0f;
-        unsigned char* thermocouple_temperature_tytes;
+        APP_ERROR_HANDLER(err_code);
+    }
 
-        if (max31856_getThermoCoupleTemperature(&thermocouple_temperature) == MAX31856_SUCCESS)
-        {
-            NRF_LOG_INFO("Measurement: %d", m_number_of_measurements + 1);
-            NRF_LOG_INFO("Thermocouple Temperature: " NRF_LOG_FLOAT_MARKER "°C\r\n", NRF_LOG_FLOAT(thermocouple_temperature));
-            thermocouple_temperature_tytes = float2bytes(thermocouple_temperature);
+    if (!(live_sample.flags & BLE_TCS_LIVE_FLAG_DISCARDED))
+    {
+        m_adv_status.temperature = live_sample.temperature;
+        m_adv_status.seq = (uint16_t) live_sample.seq;
+        block_stats_add(live_sample.temperature);
+        pyramid_add(live_sample.temperature, live_sample.seq * m_tc_interval);
+        maturity_update(live_sample.temperature);
+        alert_update(live_sample.seq, thermocouple_temperature, cold_junction_temperature);
+    }
+    m_adv_status.faults = (live_sample.flags & BLE_TCS_LIVE_FLAG_FAULT) ? ADV_STATUS_FAULT_SENSOR : 0;
+    advertising_status_update();
 
-            if (thermocouple_temperature != 0.0f) {
-                memcpy(&m_tc_buffer_local[m_number_of_measurements * TC_DATA_SIZE], thermocouple_temperature_tytes, sizeof(thermocouple_temperature_tytes));
+#if ADV_BATCH_ENABLED
+    if (ble_conn_state_peripheral_conn_count() == 0)
+    {
+        advertising_batch_broadcast();
+    }
+#endif
 
-                m_number_of_measurements++;
-                m_total_number_of_measurements++;
-            }
-        }
+    bsp_board_led_off(BSP_BOARD_LED_2);
+} 
+
+
+/**
+ * @brief Function for handling the power-up of the sensor front end
+ * 
+ * @details Called from interrupt context, the conversion is started in the main loop.
+ */
+static void sensor_power_handler(void)
+{
+    app_evt_post(APP_EVT_SENSOR_READY, BLE_CONN_HANDLE_INVALID);
+}
+
+
+/**
+ * @brief Function for starting a measurement, the conversion starts on APP_EVT_SENSOR_READY
+ */
+static void measurement_start(void)
+{
+    // A skipped period still passes, the next sample covers it
+    m_maturity_periods++;
+
+    if (m_conversion_pending)
+    {
+        TLOG_WARNING("Conversion still running, measurement skipped");
+        return;
+    }
+
+    bsp_board_led_on(BSP_BOARD_LED_2);
+
+    m_conversion_pending = true;
+
+    sensor_power_up(sensor_power_handler);
+}
+
+
+/**
+ * @brief Function for starting the conversion once the front end is powered, the result is
+ *        processed on APP_EVT_CONVERSION_DONE
+ */
+static void sensor_ready_handle(void)
+{
+    m_conversion_start_ticks = app_timer_cnt_get();
+
+    max31856_status status = max31856_startConversion(max31856_conversion_handler);
+    if (status != MAX31856_SUCCESS)
+    {
+        m_conversion_pending = false;
+        measurement_process(status);
+        sensor_power_down();
+    }
+}
+
+
+/**
+ * @brief Function for getting the dump cursor of a link.
+ * 
+ * @param[in]   conn_handle Connection handle of the link.
+ * 
+ * @return  Pointer to the stream context of the link.
+ */
+static tc_stream_t* tc_stream_get(uint16_t conn_handle)
+{
+    return &m_tc_streams[ble_conn_state_conn_idx(conn_handle)];
+}
+
+
+/**
+ * @brief Function for preparing the thermocouple data stream for a dump.
+ * 
+ * @details Takes a snapshot of the part of the history the link requested, by default all raw
+ *          samples. The stream is a sequence of full blocks (one FDS record of samples, or
+ *          TC_SUMMARY_BLOCK_SIZE buckets of a coarser level), one block with the rest and an end
+ *          block. Every link has its own snapshot and cursor, so concurrent dumps do not interfere.
+ * 
+ * @param[in]   conn_handle Connection handle of the link.
+ * 
+ * @return  Length of the stream in bytes.
+ */
+static uint32_t tc_stream_prepare(uint16_t conn_handle)
+{
+    tc_stream_t* p_stream = tc_stream_get(conn_handle);
+    ble_tcs_stream_request_t request;
+    uint32_t available;
+
+    memset(&request, 0, sizeof(request));
+    UNUSED_RETURN_VALUE(ble_tcs_stream_request_get(&m_tcs, conn_handle, &request));
+
+    if (request.level == 0)
+    {
+        available               = m_total_number_of_measurements;
+        p_stream->block_items   = MAX_RECORD_SIZE;
+        p_stream->item_size     = m_tc_sample_size;
     }
     else
     {
-        NRF_LOG_ERROR("ERROR: UNKNOWN TEMPERATURE TYPE");
+        // An unknown level has no buckets, the stream is the end block alone
+        available               = pyramid_count(request.level);
+        p_stream->block_items   = TC_SUMMARY_BLOCK_SIZE;
+        p_stream->item_size     = TCS_FRAME_SUMMARY_SIZE;
     }
 
-    bsp_board_led_off(BSP_BOARD_LED_2);
-} 
+    p_stream->level = request.level;
+    p_stream->first = MIN(request.first, available);
+    p_stream->count = available - p_stream->first;
+    if (request.count > 0)
+    {
+        p_stream->count = MIN(request.count, p_stream->count);
+    }
+    p_stream->blocks        = p_stream->count / p_stream->block_items;
+    p_stream->synced        = ((p_stream->level == 0) && (p_stream->first == 0)) ? p_stream->count : 0;
+    p_stream->frame_index   = -1;
+
+    uint32_t const rest = p_stream->count - (p_stream->blocks * p_stream->block_items);
+
+    p_stream->length  = p_stream->blocks * TCS_FRAME_SIZE(p_stream->block_items * p_stream->item_size);
+    p_stream->length += (rest > 0) ? TCS_FRAME_SIZE(rest * p_stream->item_size) : 0;
+    p_stream->length += TCS_FRAME_SIZE(0);
+
+    return p_stream->length;
+}
 
 
 /**
- * @brief Function for reading the FDS records.
+ * @brief Function for building a block of the thermocouple data stream.
+ * 
+ * @param[in]   p_stream    Stream context of the link.
+ * @param[in]   index       Index of the block in the stream.
  * 
- * @param[out]  p_tc_buffer     Buffer to hold the thermocouple data.
+ * @return  Length of the block in bytes, 0 if its samples are no longer stored.
  */
-void read_records() 
+static uint16_t tc_stream_build_frame(tc_stream_t* p_stream, uint32_t index)
 {
-    static uint8_t read_data[MAX_NUMBER_OF_DAYS][MAX_RECORD_SIZE * TC_DATA_SIZE] = {0};
-    APP_ERROR_CHECK(fds_read(FDS_FILE_ID, FDS_REC_KEY, read_data));
+    static uint8_t payload[MAX_RECORD_SIZE * TC_SAMPLE_MAX_SIZE];
+    tcs_frame_header_t header;
+    uint32_t const rest = p_stream->count - (p_stream->blocks * p_stream->block_items);
+
+    memset(&header, 0, sizeof(header));
+
+    if (index < p_stream->blocks)
+    {
+        header.count    = p_stream->block_items;
+        header.seq_base = p_stream->first + (index * p_stream->block_items);
+    }
+    else if ((index == p_stream->blocks) && (rest > 0))
+    {
+        header.count    = rest;
+        header.seq_base = p_stream->first + (index * p_stream->block_items);
+    }
+    else
+    {
+        // The end block carries the number of samples or buckets sent as its sequence base
+        header.count    = 0;
+        header.seq_base = p_stream->count;
+    }
+
+    if (header.count == 0)
+    {
+        header.encoding = TCS_FRAME_ENCODING_END;
+    }
+    else
+    {
+        header.encoding = (p_stream->level == 0) ? m_tc_encoding : TCS_FRAME_ENCODING_SUMMARY;
+    }
+    header.interval         = (p_stream->level == 0) ? m_tc_interval : pyramid_period(p_stream->level);
+    header.time_base        = header.seq_base * header.interval;
+    header.payload_length   = header.count * p_stream->item_size;
+
+    if ((header.count > 0) && (p_stream->level == 0))
+    {
+        uint32_t const buffer_first = tc_buffer_first();
+
+        // The local buffer may have been flushed to FDS since the snapshot, so look in flash first
+        uint32_t bytes_read = fds_read_chunk(FDS_FILE_ID, FDS_REC_KEY, header.seq_base * p_stream->item_size, payload, header.payload_length);
+        uint32_t local_first = header.seq_base + (bytes_read / p_stream->item_size);
+
+        if (bytes_read < header.payload_length)
+        {
+            uint32_t const local_count = (header.payload_length - bytes_read) / p_stream->item_size;
 
-    NRF_LOG_INFO("Total number of measurements: %d", m_total_number_of_measurements);
-    NRF_LOG_INFO("Total number of records: %d", fds_getNumberOfRecords());
+            if ((local_first < buffer_first) || (local_first + local_count > m_total_number_of_measurements))
+            {
+                // Neither in flash nor in the local buffer, a stale payload would pass the CRC
+                TLOG_WARNING("Block %u of the stream is not stored", index);
+                return 0;
+            }
+            memcpy(&payload[bytes_read], &m_tc_buffer_local[(local_first - buffer_first) * p_stream->item_size], header.payload_length - bytes_read);
+        }
+    }
+    else if (header.count > 0)
+    {
+        UNUSED_RETURN_VALUE(pyramid_encode(p_stream->level, header.seq_base, header.count, payload));
+    }
+
+    return tcs_frame_encode(&header, payload, p_stream->frame);
+}
+
+
+/**
+ * @brief Function for reading a chunk of the thermocouple data stream.
+ * 
+ * @details The blocks are built one at a time from flash, so no copy of the history is kept in RAM.
+ * 
+ * @param[in]   conn_handle Connection handle of the link reading the stream.
+ * @param[in]   offset      Byte offset in the stream.
+ * @param[out]  p_data      Buffer to hold the chunk.
+ * @param[in]   length      Maximum number of bytes to read.
+ * 
+ * @return  Number of bytes read.
+ */
+static uint32_t tc_stream_read(uint16_t conn_handle, uint32_t offset, uint8_t* p_data, uint32_t length)
+{
+    tc_stream_t* p_stream = tc_stream_get(conn_handle);
+    uint32_t const block_size = TCS_FRAME_SIZE(p_stream->block_items * p_stream->item_size);
+    uint32_t const rest = p_stream->count - (p_stream->blocks * p_stream->block_items);
+    uint32_t bytes_read = 0;
 
-    int k = 0;
-    for (int i = 0; i < fds_getNumberOfRecords(); i++)
+    while ((bytes_read < length) && (offset + bytes_read < p_stream->length))
     {
-        for (int j = 0; j < MAX_RECORD_SIZE * TC_DATA_SIZE; j++)
+        uint32_t position = offset + bytes_read;
+        uint32_t index;
+        uint32_t frame_start;
+
+        if (position < p_stream->blocks * block_size)
+        {
+            index       = position / block_size;
+            frame_start = index * block_size;
+        }
+        else
+        {
+            index       = p_stream->blocks;
+            frame_start = p_stream->blocks * block_size;
+
+            if ((rest > 0) && (position >= frame_start + TCS_FRAME_SIZE(rest * p_stream->item_size)))
+            {
+                index++;
+                frame_start += TCS_FRAME_SIZE(rest * p_stream->item_size);
+            }
+        }
+
+        if ((int32_t) index != p_stream->frame_index)
         {
-            m_tc_buffer_fds[k] = read_data[i][j];
-            k++;
-
-            // if (k % 4 == 0)
-            // {
-            //     float cold_junction_temperature = bytes2float(read_data[i]);
-            //     NRF_LOG_INFO("Measurement %d, temperature: " NRF_LOG_FLOAT_MARKER "°C", i+1, NRF_LOG_FLOAT(cold_junction_temperature));
-            // }
+            p_stream->frame_length  = tc_stream_build_frame(p_stream, index);
+            p_stream->frame_index   = (p_stream->frame_length > 0) ? (int32_t) index : -1;
+
+            if (p_stream->frame_length == 0)
+            {
+                // The link ends the transfer on a short read
+                break;
+            }
         }
+
+        uint32_t chunk_length = MIN(length - bytes_read, p_stream->frame_length - (position - frame_start));
+        memcpy(&p_data[bytes_read], &p_stream->frame[position - frame_start], chunk_length);
+        bytes_read += chunk_length;
     }
-    //NRF_LOG_HEXDUMP_INFO(m_tc_buffer_fds, m_total_number_of_measurements * TC_DATA_SIZE);
-    NRF_LOG_INFO("\t*** END OF RECORDS ***\r\n");
+
+    return bytes_read;
 }
 
 
@@ -410,11 +910,27 @@ static void gap_params_init(void)
 }
 
 
+/**@brief Function for handling events from the GATT module.
+ *
+ * @param[in]   p_gatt  GATT module instance.
+ * @param[in]   p_evt   Event received from the GATT module.
+ */
+static void gatt_evt_handler(nrf_ble_gatt_t* p_gatt, nrf_ble_gatt_evt_t const* p_evt)
+{
+    if (p_evt->evt_id == NRF_BLE_GATT_EVT_ATT_MTU_UPDATED)
+    {
+        TLOG_INFO("ATT MTU of link 0x%x: %d", p_evt->conn_handle, p_evt->params.att_mtu_effective);
+    }
+
+    ble_tcs_on_gatt_evt(&m_tcs, p_evt);
+}
+
+
 /**@brief Function for initializing the GATT module. 
 */
 static void gatt_init(void)
 {
-    ret_code_t err_code = nrf_ble_gatt_init(&m_gatt, NULL);
+    ret_code_t err_code = nrf_ble_gatt_init(&m_gatt, gatt_evt_handler);
     APP_ERROR_CHECK(err_code);
 }
 
@@ -444,7 +960,7 @@ static void battery_level_update(void)
 
     battery_voltage_get(&vbatt);
     battery_level = battery_level_in_percent(vbatt);
-    NRF_LOG_INFO("ADC result in percent: %d", battery_level);
+    TLOG_INFO("ADC result in percent: %d", battery_level);
 
     err_code = ble_bas_battery_level_update(&m_bas, battery_level, BLE_CONN_HANDLE_ALL);
     if ((err_code != NRF_SUCCESS) &&
@@ -461,30 +977,28 @@ static void battery_level_update(void)
 
 /**@brief Function for performing thermocouple measurement and updating the Thermocouple characteristic
  *        in Thermocouple Service.
+ *
+ * @param[in]   conn_handle Connection to send the history on.
  */
-static void thermocouple_level_update(void)
+static void thermocouple_level_update(uint16_t conn_handle)
 {
     ret_code_t err_code;
 
-    NRF_LOG_INFO("Reading thermocouple data log from FDS...")
-    read_records();
-
-    uint8_t end_bytes[4] = { 0xFF, 0xFF, 0xFF, 0xFF };
+    uint32_t tc_stream_length = tc_stream_prepare(conn_handle);
 
-    uint16_t number_of_records      = fds_getNumberOfRecords();
-    uint32_t tc_buffer_fds_length   = number_of_records * MAX_RECORD_SIZE * TC_DATA_SIZE;
-    uint16_t tc_buffer_local_length = m_number_of_measurements * TC_DATA_SIZE;
-    uint32_t total_number_of_bytes  = tc_buffer_fds_length + tc_buffer_local_length + sizeof(end_bytes);
+    UNUSED_RETURN_VALUE(link_profile_set(conn_handle, LINK_PROFILE_BULK));
 
-    uint8_t* p_tc_buffer = malloc(total_number_of_bytes);
-    memcpy(p_tc_buffer, m_tc_buffer_fds, tc_buffer_fds_length);
-    memcpy(&p_tc_buffer[tc_buffer_fds_length], m_tc_buffer_local, tc_buffer_local_length);
-    memcpy(&p_tc_buffer[tc_buffer_fds_length + tc_buffer_local_length], end_bytes, sizeof(end_bytes));
+    TLOG_INFO("Sending %d measurements to link 0x%x, %u bytes", m_total_number_of_measurements, conn_handle,
+              tc_stream_length);
 
-    NRF_LOG_INFO("Sending Thermocouple data...");
-
-    err_code = ble_tcs_thermocouple_level_update(&m_tcs, p_tc_buffer, total_number_of_bytes);
-    if ((err_code != NRF_SUCCESS) &&
+    err_code = ble_tcs_thermocouple_level_update(&m_tcs, conn_handle, tc_stream_length);
+    if (err_code == NRF_ERROR_INVALID_DATA)
+    {
+        // The stream ended before its announced length, the service already closed the transfer.
+        TLOG_WARNING("Dump to link 0x%x ended early, %u bytes announced", conn_handle, tc_stream_length);
+        UNUSED_RETURN_VALUE(link_profile_set(conn_handle, LINK_PROFILE_IDLE));
+    }
+    else if ((err_code != NRF_SUCCESS) &&
         (err_code != NRF_ERROR_INVALID_STATE) &&
         (err_code != NRF_ERROR_RESOURCES) &&
         (err_code != NRF_ERROR_BUSY) &&
@@ -492,40 +1006,174 @@ static void thermocouple_level_update(void)
     {
         APP_ERROR_HANDLER(err_code);
     }
-
-    free(p_tc_buffer);
 }
 
 
-/**@brief Function for handling the TC Service events.
- * @details This function will be called for all TC Service events which are passed to
- *          the application.
- *
- * @param[in]   p_tcs   TC Service structure.
- * @param[in]   p_evt          Event received from the TC Service.
+#if TCS_L2CAP_ENABLED
+/**@brief Function for dumping the thermocouple data log over the L2CAP channel of a link.
  *
+ * @param[in]   conn_handle     Connection that requested the dump.
  */
-static void on_tcs_evt(ble_tcs_t* p_tcs,
-                       ble_tcs_evt_t* p_evt)
+static void thermocouple_l2cap_dump(uint16_t conn_handle)
 {
-    switch (p_evt->evt_type)
+    ret_code_t err_code;
+
+    if (!ble_tcs_l2cap_is_open(&m_tcs_l2cap, conn_handle))
     {
-        case BLE_TCS_EVT_CONNECTED:
-            NRF_LOG_INFO("BLE_TCS_EVT_CONNECTED");
-            break;
-        
-        case BLE_TCS_EVT_DISCONNECTED:
-            NRF_LOG_INFO("BLE_TCS_EVT_DISCONNECTED");
-            break;
+        TLOG_INFO("L2CAP dump requested on 0x%04x without an open channel", conn_handle);
+        return;
+    }
+
+    uint32_t tc_stream_length = tc_stream_prepare(conn_handle);
+
+    UNUSED_RETURN_VALUE(link_profile_set(conn_handle, LINK_PROFILE_BULK));
+
+    TLOG_INFO("Sending %d measurements over L2CAP, %u bytes", m_total_number_of_measurements, tc_stream_length);
+
+    err_code = ble_tcs_l2cap_dump_start(&m_tcs_l2cap, conn_handle, tc_stream_length);
+    if ((err_code != NRF_SUCCESS) &&
+        (err_code != NRF_ERROR_INVALID_STATE) &&
+        (err_code != NRF_ERROR_BUSY))
+    {
+        APP_ERROR_HANDLER(err_code);
+    }
+}
+
+
+/**@brief Function for handling the TC L2CAP transport events.
+ *
+ * @param[in]   p_tcs_l2cap     TC L2CAP transport structure.
+ * @param[in]   p_evt           Event received from the TC L2CAP transport.
+ */
+static void on_tcs_l2cap_evt(ble_tcs_l2cap_t* p_tcs_l2cap,
+                             ble_tcs_l2cap_evt_t* p_evt)
+{
+    switch (p_evt->evt_type)
+    {
+        case BLE_TCS_L2CAP_EVT_CH_OPENED:
+            TLOG_INFO("BLE_TCS_L2CAP_EVT_CH_OPENED");
+            break;
+
+        case BLE_TCS_L2CAP_EVT_CH_RELEASED:
+            TLOG_INFO("BLE_TCS_L2CAP_EVT_CH_RELEASED");
+            break;
+
+        case BLE_TCS_L2CAP_EVT_DUMP_COMPLETE:
+            {
+                uint32_t elapsed_ms = ((uint64_t) p_evt->ticks * 1000) / APP_TIMER_CLOCK_FREQ;
+                TLOG_INFO("L2CAP data send successful, %d bytes in %d ms (%d B/s)", p_evt->bytes, elapsed_ms,
+                          (elapsed_ms > 0) ? (p_evt->bytes * 1000) / elapsed_ms : 0);
+
+                m_tc_synced_samples = MAX(m_tc_synced_samples, tc_stream_get(p_evt->conn_handle)->synced);
+                UNUSED_RETURN_VALUE(link_profile_set(p_evt->conn_handle, LINK_PROFILE_IDLE));
+            }
+            break;
+
+        default:
+            // No implementation needed.
+            break;
+    }
+}
+#endif
+
+
+/**@brief Function for handling the TC Service events.
+ * @details This function will be called for all TC Service events which are passed to
+ *          the application.
+ *
+ * @param[in]   p_tcs   TC Service structure.
+ * @param[in]   p_evt          Event received from the TC Service.
+ *
+ */
+static void on_tcs_evt(ble_tcs_t* p_tcs,
+                       ble_tcs_evt_t* p_evt)
+{
+    switch (p_evt->evt_type)
+    {
+        case BLE_TCS_EVT_CONNECTED:
+            TLOG_INFO("BLE_TCS_EVT_CONNECTED");
+            break;
+        
+        case BLE_TCS_EVT_DISCONNECTED:
+            TLOG_INFO("BLE_TCS_EVT_DISCONNECTED");
+            break;
 
         case BLE_TCS_EVT_NOTIFICATION_ENABLED:
-            NRF_LOG_INFO("BLE_TCS_EVT_NOTIFICATION_ENABLED\r\n");
-            tcs_update_flag = true;
+            TLOG_INFO("BLE_TCS_EVT_NOTIFICATION_ENABLED");
+            m_tcs_update_conn[ble_conn_state_conn_idx(p_evt->conn_handle)] = p_evt->conn_handle;
+            app_evt_post(APP_EVT_TCS_DUMP, p_evt->conn_handle);
             break;
         
         case BLE_TCS_EVT_NOTIFICATION_DISABLED:
-            NRF_LOG_INFO("BLE_TCS_EVT_NOTIFICATION_DISABLED\r\n");
-            tcs_update_flag = false;
+            TLOG_INFO("BLE_TCS_EVT_NOTIFICATION_DISABLED");
+            m_tcs_update_conn[ble_conn_state_conn_idx(p_evt->conn_handle)] = BLE_CONN_HANDLE_INVALID;
+            break;
+
+        case BLE_TCS_EVT_L2CAP_DUMP_REQUEST:
+            TLOG_INFO("BLE_TCS_EVT_L2CAP_DUMP_REQUEST");
+            app_evt_post(APP_EVT_L2CAP_DUMP, p_evt->conn_handle);
+            break;
+
+        case BLE_TCS_EVT_TRANSFER_COMPLETE:
+            TLOG_INFO("BLE_TCS_EVT_TRANSFER_COMPLETE");
+            m_tc_synced_samples = MAX(m_tc_synced_samples, tc_stream_get(p_evt->conn_handle)->synced);
+            UNUSED_RETURN_VALUE(link_profile_set(p_evt->conn_handle, LINK_PROFILE_IDLE));
+            break;
+
+        case BLE_TCS_EVT_LIVE_NOTIFICATION_ENABLED:
+            TLOG_INFO("BLE_TCS_EVT_LIVE_NOTIFICATION_ENABLED");
+            break;
+
+        case BLE_TCS_EVT_LIVE_NOTIFICATION_DISABLED:
+            TLOG_INFO("BLE_TCS_EVT_LIVE_NOTIFICATION_DISABLED");
+            break;
+
+        case BLE_TCS_EVT_ACTIVATION_WRITE:
+            app_evt_post(APP_EVT_ACTIVATION, p_evt->conn_handle);
+            break;
+
+        case BLE_TCS_EVT_ENERGY_RESET:
+            app_evt_post(APP_EVT_ENERGY_RESET, p_evt->conn_handle);
+            break;
+
+        case BLE_TCS_EVT_MATURITY_RESET:
+            app_evt_post(APP_EVT_MATURITY_RESET, p_evt->conn_handle);
+            break;
+
+        case BLE_TCS_EVT_MATURITY_DATUM_WRITE:
+            app_evt_params_post(APP_EVT_MATURITY_DATUM, p_evt->conn_handle, &p_evt->params);
+            break;
+
+        case BLE_TCS_EVT_MATURITY_ACTIVATION_WRITE:
+            app_evt_params_post(APP_EVT_MATURITY_ACTIVATION, p_evt->conn_handle, &p_evt->params);
+            break;
+
+        case BLE_TCS_EVT_STATS_QUERY:
+            app_evt_params_post(APP_EVT_STATS_QUERY, p_evt->conn_handle, &p_evt->params);
+            break;
+
+        case BLE_TCS_EVT_ALERT_RULE_WRITE:
+            app_evt_params_post(APP_EVT_ALERT_RULE, p_evt->conn_handle, &p_evt->params);
+            break;
+
+        case BLE_TCS_EVT_CURVE_POINT_WRITE:
+            app_evt_params_post(APP_EVT_CURVE_POINT, p_evt->conn_handle, &p_evt->params);
+            break;
+
+        case BLE_TCS_EVT_CURVE_SAVE:
+            app_evt_params_post(APP_EVT_CURVE_SAVE, p_evt->conn_handle, &p_evt->params);
+            break;
+
+        case BLE_TCS_EVT_TARGET_STRENGTH_WRITE:
+            app_evt_params_post(APP_EVT_TARGET_STRENGTH, p_evt->conn_handle, &p_evt->params);
+            break;
+
+        case BLE_TCS_EVT_PROFILE_QUERY:
+            app_evt_params_post(APP_EVT_PROFILE_QUERY, p_evt->conn_handle, &p_evt->params);
+            break;
+
+        case BLE_TCS_EVT_PROFILE_RESET:
+            app_evt_post(APP_EVT_PROFILE_RESET, p_evt->conn_handle);
             break;
 
         default:
@@ -535,6 +1183,20 @@ static void on_tcs_evt(ble_tcs_t* p_tcs,
 }
 
 
+/**@brief Function for publishing the energy report on the energy characteristic.
+ *
+ * @param[in]   p_report    Report of the energy accounting.
+ */
+static void energy_report_handler(energy_report_t const* p_report)
+{
+    uint8_t data[ENERGY_REPORT_SIZE];
+    uint8_t length = energy_report_encode(p_report, data);
+
+    ret_code_t err_code = ble_tcs_energy_set(&m_tcs, data, length);
+    APP_ERROR_CHECK(err_code);
+}
+
+
 /**@brief Function for initializing services that will be used by the application.
  */
 static void services_init(void)
@@ -548,8 +1210,16 @@ static void services_init(void)
     // Initialize Queued Write Module
     qwr_init.error_handler = nrf_qwr_error_handler;
 
-    err_code = nrf_ble_qwr_init(&m_qwr, &qwr_init);
-    APP_ERROR_CHECK(err_code);
+    for (uint32_t i = 0; i < NRF_SDH_BLE_TOTAL_LINK_COUNT; i++)
+    {
+        err_code = nrf_ble_qwr_init(&m_qwr[i], &qwr_init);
+        APP_ERROR_CHECK(err_code);
+
+        m_tcs_update_conn[i] = BLE_CONN_HANDLE_INVALID;
+#if TCS_L2CAP_ENABLED
+        m_l2cap_dump_conn[i] = BLE_CONN_HANDLE_INVALID;
+#endif
+    }
 
 
     // Initialize Thermocouple Service.
@@ -561,10 +1231,22 @@ static void services_init(void)
 
     // Set the TC event handler
     tcs_init.evt_handler = on_tcs_evt;
+    tcs_init.read_handler = tc_stream_read;
 
     err_code = ble_tcs_init(&m_tcs, &tcs_init);
     APP_ERROR_CHECK(err_code);
 
+#if TCS_L2CAP_ENABLED
+    // Initialize the L2CAP transport for history dumps.
+    ble_tcs_l2cap_init_t tcs_l2cap_init = {0};
+
+    tcs_l2cap_init.evt_handler  = on_tcs_l2cap_evt;
+    tcs_l2cap_init.read_handler = tc_stream_read;
+
+    err_code = ble_tcs_l2cap_init(&m_tcs_l2cap, &tcs_l2cap_init);
+    APP_ERROR_CHECK(err_code);
+#endif
+
 
     // Initialize Battery Service.
     memset(&bas_init, 0, sizeof(bas_init));
@@ -614,7 +1296,20 @@ static void on_conn_params_evt(ble_conn_params_evt_t * p_evt)
 
     if (p_evt->evt_type == BLE_CONN_PARAMS_EVT_FAILED)
     {
-        err_code = sd_ble_gap_disconnect(m_conn_handle, BLE_HCI_CONN_INTERVAL_UNACCEPTABLE);
+        if (link_profile_get(p_evt->conn_handle) != LINK_PROFILE_DEFAULT)
+        {
+            // The central refused the link profile, fall back to the preferred parameters
+            TLOG_INFO("Link profile %d refused by central", link_profile_get(p_evt->conn_handle));
+            err_code = link_profile_set(p_evt->conn_handle, LINK_PROFILE_DEFAULT);
+            if (err_code != NRF_ERROR_INVALID_STATE)
+            {
+                // A link that dropped in the meantime needs no fallback
+                APP_ERROR_CHECK(err_code);
+            }
+            return;
+        }
+
+        err_code = sd_ble_gap_disconnect(p_evt->conn_handle, BLE_HCI_CONN_INTERVAL_UNACCEPTABLE);
         APP_ERROR_CHECK(err_code);
     }
 }
@@ -630,6 +1325,32 @@ static void conn_params_error_handler(uint32_t nrf_error)
 }
 
 
+/**@brief Function for handling the link profile events.
+ *
+ * @param[in] p_evt  Event received from the link profile manager.
+ */
+static void on_link_profile_evt(link_profile_evt_t const* p_evt)
+{
+    switch (p_evt->evt_type)
+    {
+        case LINK_PROFILE_EVT_REQUESTED:
+            TLOG_INFO("Link profile %d requested, interval %d-%d, latency %d", p_evt->profile,
+                      p_evt->conn_params.min_conn_interval, p_evt->conn_params.max_conn_interval,
+                      p_evt->conn_params.slave_latency);
+            break;
+
+        case LINK_PROFILE_EVT_UPDATED:
+            TLOG_INFO("Connection parameters updated, interval %d, latency %d, timeout %d",
+                      p_evt->conn_params.max_conn_interval, p_evt->conn_params.slave_latency,
+                      p_evt->conn_params.conn_sup_timeout);
+            break;
+
+        default:
+            break;
+    }
+}
+
+
 /**@brief Function for initializing the Connection Parameters module.
  */
 static void conn_params_init(void)
@@ -650,6 +1371,8 @@ static void conn_params_init(void)
 
     err_code = ble_conn_params_init(&cp_init);
     APP_ERROR_CHECK(err_code);
+
+    link_profile_init(on_link_profile_evt);
 }
 
 
@@ -661,14 +1384,20 @@ static void conn_params_init(void)
  */
 static void on_adv_evt(ble_adv_evt_t ble_adv_evt)
 {
+    adv_policy_on_adv_evt(ble_adv_evt);
+
     switch (ble_adv_evt)
     {
         case BLE_ADV_EVT_FAST:
-            NRF_LOG_INFO("Fast advertising\r\n");
+            TLOG_INFO("Fast advertising");
+            break;
+
+        case BLE_ADV_EVT_SLOW:
+            TLOG_INFO("Slow advertising");
             break;
 
         case BLE_ADV_EVT_IDLE:
-            NRF_LOG_INFO("Advertising idle state\r\n");
+            TLOG_INFO("Advertising idle state");
             break;
 
         default:
@@ -689,27 +1418,34 @@ static void ble_evt_handler(ble_evt_t const * p_ble_evt, void * p_context)
     switch (p_ble_evt->header.evt_id)
     {
         case BLE_GAP_EVT_DISCONNECTED:
-            NRF_LOG_INFO("Disconnected\r\n");
-            bsp_board_led_on(BSP_BOARD_LED_0);
+            TLOG_INFO("Disconnected");
+            m_tcs_update_conn[ble_conn_state_conn_idx(p_ble_evt->evt.gap_evt.conn_handle)] = BLE_CONN_HANDLE_INVALID;
+#if TCS_L2CAP_ENABLED
+            m_l2cap_dump_conn[ble_conn_state_conn_idx(p_ble_evt->evt.gap_evt.conn_handle)] = BLE_CONN_HANDLE_INVALID;
+#endif
+            if (ble_conn_state_peripheral_conn_count() == 0)
+            {
+                bsp_board_led_on(BSP_BOARD_LED_0);
+            }
             break;
 
         case BLE_GAP_EVT_CONNECTED:
-            NRF_LOG_INFO("Connected\r\n");
+            TLOG_INFO("Connected");
             bsp_board_led_off(BSP_BOARD_LED_0);
 
-            m_conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
-            err_code = nrf_ble_qwr_conn_handle_assign(&m_qwr, m_conn_handle);
+            err_code = nrf_ble_qwr_conn_handle_assign(&m_qwr[ble_conn_state_conn_idx(p_ble_evt->evt.gap_evt.conn_handle)],
+                                                      p_ble_evt->evt.gap_evt.conn_handle);
             APP_ERROR_CHECK(err_code);
 
-            err_code = sd_ble_gap_tx_power_set(BLE_GAP_TX_POWER_ROLE_CONN, m_conn_handle, BLE_TX_POWER);
+            err_code = sd_ble_gap_tx_power_set(BLE_GAP_TX_POWER_ROLE_CONN, p_ble_evt->evt.gap_evt.conn_handle, BLE_TX_POWER);
             APP_ERROR_CHECK(err_code);
             
-            bas_update_flag = true;
+            app_evt_post(APP_EVT_BATTERY_UPDATE, p_ble_evt->evt.gap_evt.conn_handle);
             break;
 
         case BLE_GAP_EVT_PHY_UPDATE_REQUEST:
         {
-            NRF_LOG_DEBUG("PHY update request");
+            TLOG_DEBUG("PHY update request");
             ble_gap_phys_t const phys =
             {
                 .rx_phys = BLE_GAP_PHY_AUTO,
@@ -721,7 +1457,7 @@ static void ble_evt_handler(ble_evt_t const * p_ble_evt, void * p_context)
 
         case BLE_GATTC_EVT_TIMEOUT:
             // Disconnect on GATT Client timeout event.
-            NRF_LOG_DEBUG("GATT Client Timeout");
+            TLOG_DEBUG("GATT Client Timeout");
             err_code = sd_ble_gap_disconnect(p_ble_evt->evt.gattc_evt.conn_handle,
                                              BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION);
             APP_ERROR_CHECK(err_code);
@@ -729,7 +1465,7 @@ static void ble_evt_handler(ble_evt_t const * p_ble_evt, void * p_context)
 
         case BLE_GATTS_EVT_TIMEOUT:
             // Disconnect on GATT Server timeout event.
-            NRF_LOG_DEBUG("GATT Server Timeout.");
+            TLOG_DEBUG("GATT Server Timeout.");
             err_code = sd_ble_gap_disconnect(p_ble_evt->evt.gatts_evt.conn_handle,
                                              BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION);
             APP_ERROR_CHECK(err_code);
@@ -759,6 +1495,14 @@ static void ble_stack_init(void)
     err_code = nrf_sdh_ble_default_cfg_set(APP_BLE_CONN_CFG_TAG, &ram_start);
     APP_ERROR_CHECK(err_code);
 
+    err_code = ble_tcs_conn_cfg_set(APP_BLE_CONN_CFG_TAG, ram_start);
+    APP_ERROR_CHECK(err_code);
+
+#if TCS_L2CAP_ENABLED
+    err_code = ble_tcs_l2cap_conn_cfg_set(APP_BLE_CONN_CFG_TAG, ram_start);
+    APP_ERROR_CHECK(err_code);
+#endif
+
     // Enable BLE stack.
     err_code = nrf_sdh_ble_enable(&ram_start);
     APP_ERROR_CHECK(err_code);
@@ -815,33 +1559,183 @@ static void delete_bonds(void)
 }
 
 
+/**@brief Function for building the advertising and scan response data.
+ *
+ * @param[out]  p_advdata       Advertising data, zero initialized by the caller.
+ * @param[out]  p_srdata        Scan response data, zero initialized by the caller.
+ * @param[out]  p_manuf_data    Manufacturer specific data referenced by p_advdata.
+ */
+static void advertising_data_build(ble_advdata_t* p_advdata, ble_advdata_t* p_srdata, ble_advdata_manuf_data_t* p_manuf_data)
+{
+    p_manuf_data->company_identifier    = ADV_STATUS_COMPANY_ID;    /**< COMPANY ID -> ACHIEVED BY BECOMING A BLUETOOTH SIG MEMBER */
+    p_manuf_data->data.p_data           = m_adv_status_data;
+    p_manuf_data->data.size             = adv_status_encode(&m_adv_status, m_adv_status_data);
+    p_advdata->p_manuf_specific_data    = p_manuf_data;             /**< Advertising data -> MAX. 31 bytes */
+
+    p_advdata->name_type                = BLE_ADVDATA_SHORT_NAME;
+    p_advdata->short_name_len           = DEVICE_NAME_LEN;
+    p_advdata->include_appearance       = false;
+    p_advdata->flags                    = BLE_GAP_ADV_FLAGS_LE_ONLY_GENERAL_DISC_MODE;
+
+    p_srdata->uuids_complete.uuid_cnt   = sizeof(m_adv_uuids) / sizeof(m_adv_uuids[0]);
+    p_srdata->uuids_complete.p_uuids    = m_adv_uuids;
+}
+
+
+/**@brief Function for refreshing the status record in the advertising data.
+ *
+ * @details Called after each measurement, so gateways can monitor the sensor without connecting.
+ */
+static void advertising_status_update(void)
+{
+    ret_code_t                  err_code;
+    ble_advdata_t               advdata;
+    ble_advdata_t               srdata;
+    ble_advdata_manuf_data_t    manuf_data;
+    uint16_t                    vbatt;
+    uint32_t                    stored_samples;
+
+#if ADV_BATCH_ENABLED
+    if (adv_batch_is_active())
+    {
+        // The advertising set is broadcasting a batch, refreshed when the window closes
+        return;
+    }
+#endif
+
+    battery_voltage_get(&vbatt);
+    m_adv_status.battery_level = battery_level_in_percent(vbatt);
+
+    stored_samples = m_total_number_of_measurements;
+    m_adv_status.unsynced = (uint16_t) MIN(stored_samples - MIN(m_tc_synced_samples, stored_samples), UINT16_MAX);
+
+    m_adv_status.faults &= ADV_STATUS_FAULT_SENSOR;
+    if (fds_getNumberOfRecords() >= MAX_NUMBER_OF_DAYS)
+    {
+        m_adv_status.faults |= ADV_STATUS_FAULT_STORAGE;
+    }
+    if ((m_adv_status.battery_level < ADV_STATUS_BATTERY_LOW) || battery_voltage_is_low())
+    {
+        m_adv_status.faults |= ADV_STATUS_FAULT_BATTERY;
+    }
+    if (alert_active_get() != 0)
+    {
+        m_adv_status.faults |= ADV_STATUS_FAULT_ALERT;
+    }
+
+    memset(&advdata, 0, sizeof(advdata));
+    memset(&srdata, 0, sizeof(srdata));
+    advertising_data_build(&advdata, &srdata, &manuf_data);
+
+    err_code = ble_advertising_advdata_update(&m_advertising, &advdata, &srdata);
+    if ((err_code != NRF_SUCCESS) &&
+        (err_code != NRF_ERROR_INVALID_STATE))
+    {
+        APP_ERROR_HANDLER(err_code);
+    }
+}
+
+
+#if ADV_BATCH_ENABLED
+/**@brief Function for broadcasting the most recent samples in extended advertising.
+ *
+ * @details Gateways collect the samples without connecting. The batch overlaps the previous one,
+ *          so a scanner that misses a window can fill the gap from the sequence numbers.
+ */
+static void advertising_batch_broadcast(void)
+{
+    static uint8_t stored[ADV_BATCH_SAMPLE_COUNT * TC_SAMPLE_MAX_SIZE];
+    static float samples[ADV_BATCH_SAMPLE_COUNT];
+    ret_code_t err_code;
+    uint32_t buffer_first   = tc_buffer_first();
+    uint32_t stored_samples = m_total_number_of_measurements;
+    uint32_t count          = MIN(stored_samples, ADV_BATCH_SAMPLE_COUNT);
+    uint32_t first          = stored_samples - count;
+    uint32_t bytes_read;
+
+    if (count == 0)
+    {
+        return;
+    }
+
+    // Older samples are in flash, the rest still in the local buffer
+    bytes_read = fds_read_chunk(FDS_FILE_ID, FDS_REC_KEY, first * m_tc_sample_size, stored, count * m_tc_sample_size);
+    if (bytes_read < (count * m_tc_sample_size))
+    {
+        uint32_t local_first = first + (bytes_read / m_tc_sample_size);
+        if (local_first < buffer_first)
+        {
+            // Not stored, no batch rather than a stale one
+            return;
+        }
+        local_first -= buffer_first;
+        memcpy(&stored[bytes_read], &m_tc_buffer_local[local_first * m_tc_sample_size], (count * m_tc_sample_size) - bytes_read);
+    }
+
+    // The batch carries the first channel only
+    for (uint32_t i = 0; i < count; i++)
+    {
+        samples[i] = tcs_frame_sample_temperature(m_tc_encoding, &stored[i * m_tc_sample_size]);
+    }
+
+    err_code = adv_batch_broadcast(m_advertising.adv_handle, ADV_STATUS_COMPANY_ID, samples, count, (uint16_t) first, m_tc_interval);
+    if ((err_code != NRF_SUCCESS) &&
+        (err_code != NRF_ERROR_BUSY) &&
+        (err_code != NRF_ERROR_INVALID_STATE))
+    {
+        APP_ERROR_HANDLER(err_code);
+    }
+}
+
+
+/**@brief Function for handling the batch broadcast events.
+ *
+ * @param[in] evt_type  Type of the event.
+ */
+static void on_adv_batch_evt(adv_batch_evt_type_t evt_type)
+{
+    switch (evt_type)
+    {
+        case ADV_BATCH_EVT_STARTED:
+            TLOG_INFO("Batch broadcast started");
+            adv_policy_on_batch(true);
+            break;
+
+        case ADV_BATCH_EVT_STOPPED:
+            TLOG_INFO("Batch broadcast stopped");
+            adv_policy_on_batch(false);
+            advertising_status_update();
+            break;
+
+        default:
+            break;
+    }
+}
+#endif
+
+
 /**@brief Function for initializing the Advertising functionality.
  */
 static void advertising_init(void)
 {
-    ret_code_t             err_code;
-    ble_advertising_init_t init;
+    ret_code_t                  err_code;
+    ble_advertising_init_t      init;
+    ble_advdata_manuf_data_t    manuf_data;
+    adv_policy_init_t           policy_init;
 
     memset(&init, 0, sizeof(init));
 
-    ble_advdata_manuf_data_t            manuf_data;         /**< Advertising data -> MAX. 31 bytes */
-    uint8_t data[]                      = "Proware";        /**< Extra data to advertise */
-    manuf_data.company_identifier       = 0xFFFF;           /**< COMPANY ID -> ACHIEVED BY BECOMING A BLUETOOTH SIG MEMBER */
-    manuf_data.data.p_data              = data;
-    manuf_data.data.size                = sizeof(data);
-    init.advdata.p_manuf_specific_data  = &manuf_data;
-
-    init.advdata.name_type               = BLE_ADVDATA_SHORT_NAME;
-    init.advdata.short_name_len          = DEVICE_NAME_LEN;
-    init.advdata.include_appearance      = false;
-    init.advdata.flags                   = BLE_GAP_ADV_FLAGS_LE_ONLY_GENERAL_DISC_MODE;
-
-    init.srdata.uuids_complete.uuid_cnt = sizeof(m_adv_uuids) / sizeof(m_adv_uuids[0]);
-    init.srdata.uuids_complete.p_uuids  = m_adv_uuids;
+    advertising_data_build(&init.advdata, &init.srdata, &manuf_data);
 
     init.config.ble_adv_fast_enabled  = true;
     init.config.ble_adv_fast_interval = APP_ADV_INTERVAL;
     init.config.ble_adv_fast_timeout  = APP_ADV_DURATION;
+    init.config.ble_adv_slow_enabled  = true;
+    init.config.ble_adv_slow_interval = APP_ADV_SLOW_INTERVAL;
+    init.config.ble_adv_slow_timeout  = APP_ADV_SLOW_DURATION;
+
+    // The advertising policy restarts the advertising on disconnect, it knows about every link
+    init.config.ble_adv_on_disconnect_disabled = true;
 
     init.evt_handler = on_adv_evt;
 
@@ -849,6 +1743,17 @@ static void advertising_init(void)
     APP_ERROR_CHECK(err_code);
 
     ble_advertising_conn_cfg_tag_set(&m_advertising, APP_BLE_CONN_CFG_TAG);
+
+    policy_init.p_advertising   = &m_advertising;
+    policy_init.fast_interval   = APP_ADV_INTERVAL;
+    policy_init.slow_interval   = APP_ADV_SLOW_INTERVAL;
+    policy_init.batch_interval  = ADV_BATCH_INTERVAL;
+    policy_init.sync_period     = ADV_POLICY_SYNC_PERIOD;
+    adv_policy_init(&policy_init);
+
+#if ADV_BATCH_ENABLED
+    adv_batch_init(on_adv_batch_evt);
+#endif
 }
 
 
@@ -861,7 +1766,40 @@ static void leds_init()
 }
 
 
-/**@brief Function for initializing the nrf log module.
+/**@brief Function for handling the button events.
+ *
+ * @param[in] pin_no        Pin of the button.
+ * @param[in] button_action APP_BUTTON_PUSH or APP_BUTTON_RELEASE.
+ */
+static void button_event_handler(uint8_t pin_no, uint8_t button_action)
+{
+    if ((pin_no == BSP_BUTTON_0) && (button_action == APP_BUTTON_PUSH))
+    {
+        app_evt_post(APP_EVT_BUTTON, BLE_CONN_HANDLE_INVALID);
+    }
+}
+
+
+/**@brief Function for initializing the button used to restore fast advertising.
+ */
+static void buttons_init(void)
+{
+    ret_code_t err_code;
+
+    static app_button_cfg_t const buttons[] =
+    {
+        {BSP_BUTTON_0, APP_BUTTON_ACTIVE_LOW, BUTTON_PULL, button_event_handler}
+    };
+
+    err_code = app_button_init(buttons, ARRAY_SIZE(buttons), BUTTON_DETECTION_DELAY);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = app_button_enable();
+    APP_ERROR_CHECK(err_code);
+}
+
+
+/**@brief Function for initializing the nrf log module and the binary log of the hot paths.
  */
 static void log_init(void)
 {
@@ -869,6 +1807,7 @@ static void log_init(void)
     APP_ERROR_CHECK(err_code);
 
     NRF_LOG_DEFAULT_BACKENDS_INIT();
+    tlog_init();
 }
 
 
@@ -913,6 +1852,8 @@ static void idle_state_handle(void)
 {
     if (NRF_LOG_PROCESS() == false)
     {
+        tlog_process();
+        energy_cpu_update();
         nrf_pwr_mgmt_run();
     }
 }
@@ -947,103 +1888,634 @@ static void advertising_start(bool erase_bonds)
 // }
 
 
-/**@brief Function for application main entry.
+/**@brief Function for starting the application once it is activated and has an interval.
  */
-int main(void)
+static void application_activate(void)
 {
-    bool erase_bonds = true;
+    const uint32_t timer_interval = ble_tcs_getTimerInterval();
 
-    // Initialize.
-    log_init();
-    NRF_LOG_INFO("*****************************************************\r\n\n");
-    NRF_LOG_INFO("\r\n\n\n\t*** CONCRETE SENSOR ***\r\n");
-    NRF_LOG_FLUSH();
+    if (!ble_tcs_getActivatedFlag() || (timer_interval == 0))
+    {
+        // Wait for the other half of the configuration
+        return;
+    }
 
-    timer_init();
-    leds_init();
-    battery_voltage_init();
-    power_management_init();
-    ble_stack_init();
-    gap_params_init();
-    gatt_init();
-    services_init();
-    advertising_init();
-    tx_power_init();
-    dcdc_init();
-    conn_params_init();
-    peer_manager_init();
+    ble_tcs_setActivatedFlag(false);
+    m_app_activated_flag = true;
+    m_tc_interval = timer_interval;
+    tc_channels_set(ble_tcs_getChannels());
 
-    spi_init(&spi);
-    max31856_init(&spi);
-    
-    APP_ERROR_CHECK(fds_storage_init());
-    
-    fds_find_and_delete(FDS_FILE_ID, FDS_REC_KEY);
-    while(!fds_getAllRecordsDeletedFlag());
+    NRF_LOG_INFO("\r\n\n\n\t*** STARTING APPLICATION ***\r\n");
+    NRF_LOG_INFO("Running application with Thermocouple timer interval of %dms\r\n", timer_interval);
+    NRF_LOG_INFO("Storing channels 0x%x, %d bytes per sample\r\n", m_tc_channels, m_tc_sample_size);
 
-    //sd_ble_gap_tx_power_set(BLE_GAP_TX_POWER_ROLE_ADV, );
-    advertising_start(erase_bonds);
-    //sleep_mode_enter();
+    timer_start(timer_interval * 1000);
+    measurement_start();
+    adv_policy_restore_fast(ADV_POLICY_TRIGGER_ACTIVATION);
+}
 
-    NRF_LOG_FLUSH();
 
-    while (true)
+/**@brief Function for running the requests of the connected centrals.
+ *
+ * @details Requests made before the application is activated wait for the activation.
+ */
+static void link_requests_run(void)
+{
+    if (!m_app_activated_flag || (ble_conn_state_peripheral_conn_count() == 0))
     {
-        idle_state_handle();
+        return;
+    }
 
-        if (ble_tcs_getActivatedFlag())
+    for (uint32_t i = 0; i < NRF_SDH_BLE_TOTAL_LINK_COUNT; i++)
+    {
+        if (m_tcs_update_conn[i] != BLE_CONN_HANDLE_INVALID)
+        {
+            thermocouple_level_update(m_tcs_update_conn[i]);
+            m_tcs_update_conn[i] = BLE_CONN_HANDLE_INVALID;
+        }
+    }
+
+#if TCS_L2CAP_ENABLED
+    for (uint32_t i = 0; i < NRF_SDH_BLE_TOTAL_LINK_COUNT; i++)
+    {
+        if (m_l2cap_dump_conn[i] != BLE_CONN_HANDLE_INVALID)
         {
-            const uint32_t timer_interval = ble_tcs_getTimerInterval(); 
-            if (timer_interval != 0)
+            uint16_t conn_handle = m_l2cap_dump_conn[i];
+
+            m_l2cap_dump_conn[i] = BLE_CONN_HANDLE_INVALID;
+            thermocouple_l2cap_dump(conn_handle);
+        }
+    }
+#endif
+}
+
+
+/**@brief Function for starting a measurement on the measurement timer.
+ */
+static void measurement_handle(void)
+{
+    if (!m_app_activated_flag || (fds_getNumberOfRecords() >= MAX_NUMBER_OF_DAYS))
+    {
+        return;
+    }
+
+    measurement_start();
+}
+
+
+/**@brief Function for processing a finished conversion and storing the buffer once it holds a full record.
+ */
+static void conversion_done_handle(void)
+{
+    PROFILER_SCOPE(PROFILER_PROBE_SAMPLE);
+
+    uint32_t const done_ticks = m_conversion_done_ticks;
+
+    m_conversion_pending = false;
+    measurement_process(m_conversion_status);
+    sensor_power_down();
+
+    if ((m_total_number_of_measurements % MAX_RECORD_SIZE) == 0)
+    {
+        // A full record closes its block, whether or not it is in flash yet
+        block_stats_flush();
+    }
+
+    if (m_number_of_measurements >= MAX_RECORD_SIZE)
+    {
+        write_tc_buffer_too_fds();
+    }
+
+    // Active time of the cycle, the CPU sleeps during the power-up and between the start of the conversion and DRDY
+    TLOG_INFO("Power-up %u us, conversion %u us, processing %u us",
+              sensor_power_latency_get(),
+              ticks_to_us(app_timer_cnt_diff_compute(done_ticks, m_conversion_start_ticks)),
+              ticks_to_us(app_timer_cnt_diff_compute(app_timer_cnt_get(), done_ticks)));
+}
+
+
+/**@brief Function for processing a battery measurement and offloading early when the battery is low.
+ */
+static void battery_measured_handle(void)
+{
+    battery_voltage_process();
+
+    if (ble_conn_state_peripheral_conn_count() > 0)
+    {
+        battery_level_update();
+    }
+
+    if (battery_voltage_is_low() && !m_battery_low_flag)
+    {
+        TLOG_WARNING("Battery low, %d hours left, offloading the history", battery_voltage_hours_left());
+        m_battery_low_flag = true;
+
+        // Let the gateways see the fault and collect the history while the radio still works
+        advertising_status_update();
+        adv_policy_restore_fast(ADV_POLICY_TRIGGER_LOW_BATTERY);
+    }
+}
+
+
+/**@brief Function for deleting the records of the previous run once FDS is initialized.
+ *
+ * @details Advertising starts on APP_EVT_STORAGE_CLEARED once the last record is deleted.
+ */
+static void storage_init_handle(void)
+{
+    energy_restore();
+    maturity_restore();
+    strength_restore();
+    maturity_publish();
+    alert_restore();
+
+    // The headers and the coarser levels go with the history of the previous run
+    block_stats_reset();
+    pyramid_reset();
+
+    ret_code_t err_code = fds_find_and_delete(FDS_FILE_ID, FDS_REC_KEY);
+    if (err_code != NRF_SUCCESS)
+    {
+        NRF_LOG_ERROR("ERROR %d: fds_find_and_delete", err_code);
+    }
+
+    if (fds_getAllRecordsDeletedFlag())
+    {
+        // Nothing was stored, no FDS_EVT_DEL_RECORD will follow
+        app_evt_post(APP_EVT_STORAGE_CLEARED, BLE_CONN_HANDLE_INVALID);
+    }
+}
+
+
+/**@brief Function for starting advertising once the records of the previous run are deleted.
+ */
+static void storage_cleared_handle(void)
+{
+    if (m_storage_ready)
+    {
+        return;
+    }
+
+    m_storage_ready = true;
+    advertising_start(m_erase_bonds);
+}
+
+
+/**@brief Function for answering a statistics query from the block headers.
+ *
+ * @param[in]   p_query     Query as written by the peer.
+ */
+static void stats_query_handle(ble_tcs_stats_query_t const* p_query)
+{
+    block_stats_report_t report;
+    uint8_t data[BLOCK_STATS_REPORT_SIZE];
+
+    if (block_stats_query(p_query->first, p_query->blocks, &report) != NRF_SUCCESS)
+    {
+        // Not stored yet, or its header is missing in flash, an empty answer for the block
+        memset(&report, 0, sizeof(report));
+        report.first = p_query->first;
+    }
+
+    uint8_t length = block_stats_report_encode(&report, data);
+
+    ret_code_t err_code = ble_tcs_stats_set(&m_tcs, data, length);
+    APP_ERROR_CHECK(err_code);
+}
+
+
+/**@brief Function for setting the alert rule written by the peer.
+ *
+ * @param[in]   p_written   Rule as written by the peer.
+ */
+static void alert_rule_handle(ble_tcs_alert_rule_t const* p_written)
+{
+    alert_rule_t rule;
+
+    rule.type       = p_written->type;
+    rule.debounce   = p_written->debounce;
+    rule.threshold  = (int16_t) MAX(MIN(p_written->threshold * 100.0f, INT16_MAX), INT16_MIN);
+    rule.hysteresis = (int16_t) MAX(MIN(p_written->hysteresis * 100.0f, INT16_MAX), INT16_MIN);
+
+    ret_code_t err_code = alert_rule_set(p_written->slot, &rule);
+    if (err_code != NRF_SUCCESS)
+    {
+        TLOG_WARNING("Alert rule %d rejected: %d", p_written->slot, err_code);
+    }
+}
+
+
+#if PROFILER_ENABLED
+/**@brief Function for answering a profiler query with the report of the probe.
+ *
+ * @param[in]   probe       Probe of the query, see profiler_probe_t.
+ */
+static void profile_query_handle(uint8_t probe)
+{
+    profiler_report_t report;
+    uint8_t data[PROFILER_REPORT_SIZE];
+
+    if (profiler_report_get(probe, &report) != NRF_SUCCESS)
+    {
+        // Unknown probe, an empty answer
+        memset(&report, 0, sizeof(report));
+        report.probe = probe;
+    }
+
+    uint8_t length = profiler_report_encode(&report, data);
+
+    ret_code_t err_code = ble_tcs_profile_set(&m_tcs, data, length);
+    APP_ERROR_CHECK(err_code);
+}
+#endif
+
+
+/**@brief Function for staging the calibration point written by the peer.
+ *
+ * @param[in]   p_written   Point as written by the peer.
+ */
+static void curve_point_handle(ble_tcs_curve_point_t const* p_written)
+{
+    // °C·h to 0.1 °C·h, MPa to 0.01 MPa
+    ret_code_t err_code = strength_point_set(p_written->point, (uint32_t) (p_written->maturity * 10.0f + 0.5f),
+                                             (uint16_t) (p_written->strength * 100.0f + 0.5f));
+    if (err_code != NRF_SUCCESS)
+    {
+        TLOG_WARNING("Calibration point %d rejected: %d", p_written->point, err_code);
+    }
+}
+
+
+/**@brief Function for dropping the written record from the local buffer and finishing the
+ *        application once the history is full.
+ */
+static void record_written_handle(void)
+{
+    tc_buffer_remove(m_record_pending_samples);
+    m_record_pending_samples = 0;
+
+    if (m_number_of_measurements >= MAX_RECORD_SIZE)
+    {
+        write_tc_buffer_too_fds();
+    }
+
+    if ((fds_getNumberOfRecords() >= MAX_NUMBER_OF_DAYS) && !m_app_finished_flag)
+    {
+        NRF_LOG_INFO("\r\n\n\n\t*** APPLICATION FINISHED ***\r\n");
+        m_app_finished_flag = true;
+        timer_stop();
+    }
+}
+
+
+/**@brief Function for handling the application events in the main loop.
+ *
+ * @param[in]   p_event_data    Application event.
+ * @param[in]   event_size      Size of the event.
+ */
+static void app_evt_handler(void* p_event_data, uint16_t event_size)
+{
+    app_evt_t const* p_evt = (app_evt_t const*) p_event_data;
+
+    UNUSED_PARAMETER(event_size);
+
+    switch (p_evt->type)
+    {
+        case APP_EVT_ACTIVATION:
+            application_activate();
+            link_requests_run();
+            break;
+
+        case APP_EVT_MEASUREMENT:
+            measurement_handle();
+            break;
+
+        case APP_EVT_SENSOR_READY:
+            sensor_ready_handle();
+            break;
+
+        case APP_EVT_CONVERSION_DONE:
+            conversion_done_handle();
+            break;
+
+        case APP_EVT_RECORD_WRITTEN:
+            record_written_handle();
+            break;
+
+        case APP_EVT_GARBAGE_COLLECTED:
+            if (m_record_gc_pending)
             {
-                ble_tcs_setActivatedFlag(false);
-                m_app_activated_flag = true;
+                m_record_gc_pending = false;
+                write_tc_buffer_too_fds();
+            }
+            break;
+
+        case APP_EVT_ENERGY_RESET:
+            energy_reset();
+            break;
 
-                NRF_LOG_INFO("\r\n\n\n\t*** STARTING APPLICATION ***\r\n");
-                NRF_LOG_INFO("Running application with Thermocouple timer interval of %dms\r\n", timer_interval);
+        case APP_EVT_RECORD_FAILED:
+            // The samples are still in the local buffer, written again with the next sample
+            TLOG_WARNING("Record write failed, retried");
+            m_record_pending_samples = 0;
+            break;
 
-                timer_start(timer_interval * 1000);
-                max31856_int_handler(e_cold_junction);
+        case APP_EVT_TCS_DUMP:
+            link_requests_run();
+            break;
+
+        case APP_EVT_L2CAP_DUMP:
+#if TCS_L2CAP_ENABLED
+            if (ble_conn_state_valid(p_evt->conn_handle))
+            {
+                m_l2cap_dump_conn[ble_conn_state_conn_idx(p_evt->conn_handle)] = p_evt->conn_handle;
+                link_requests_run();
             }
-        }
+#endif
+            break;
 
+        case APP_EVT_BATTERY_UPDATE:
+            battery_level_update();
+            break;
 
-        if (m_app_activated_flag)
-        {
-            if (m_conn_handle != BLE_CONN_HANDLE_INVALID)
+        case APP_EVT_BUTTON:
+            adv_policy_restore_fast(ADV_POLICY_TRIGGER_BUTTON);
+            break;
+
+        case APP_EVT_BATTERY_MEASURED:
+            battery_measured_handle();
+            break;
+
+        case APP_EVT_MATURITY_RESET:
+            maturity_reset();
+            maturity_publish();
+            break;
+
+        case APP_EVT_MATURITY_DATUM:
+            if (maturity_datum_set(p_evt->params.datum) != NRF_SUCCESS)
+            {
+                TLOG_WARNING("Maturity datum rejected");
+            }
+            maturity_publish();
+            break;
+
+        case APP_EVT_MATURITY_ACTIVATION:
+            maturity_activation_energy_set((uint32_t) (p_evt->params.activation * 1000.0f + 0.5f));
+            maturity_publish();
+            break;
+
+        case APP_EVT_STATS_QUERY:
+            stats_query_handle(&p_evt->params.stats_query);
+            break;
+
+        case APP_EVT_ALERT_RULE:
+            alert_rule_handle(&p_evt->params.alert_rule);
+            break;
+
+        case APP_EVT_CURVE_POINT:
+            curve_point_handle(&p_evt->params.curve_point);
+            break;
+
+        case APP_EVT_CURVE_SAVE:
+            if (strength_curve_save(p_evt->params.curve_points) != NRF_SUCCESS)
+            {
+                TLOG_WARNING("Calibration curve rejected, the curve in use is kept");
+            }
+            maturity_publish();
+            break;
+
+        case APP_EVT_TARGET_STRENGTH:
+            strength_target_set((uint16_t) (p_evt->params.target * 100.0f + 0.5f));
+            maturity_publish();
+            break;
+
+#if PROFILER_ENABLED
+        case APP_EVT_PROFILE_QUERY:
+            m_profile_probe = p_evt->params.probe;
+            profile_query_handle(m_profile_probe);
+            break;
+
+        case APP_EVT_PROFILE_RESET:
+            profiler_reset();
+            profile_query_handle(m_profile_probe);
+            break;
+#endif
+
+        case APP_EVT_STORAGE_INIT:
+            storage_init_handle();
+            break;
+
+        case APP_EVT_STORAGE_CLEARED:
+            storage_cleared_handle();
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+/**@brief Function for queueing an application event for the main loop.
+ *
+ * @details The event is dropped and logged if the queue is full.
+ *
+ * @param[in]   p_evt           Event to queue.
+ * @param[in]   size            Number of bytes of the event to queue.
+ */
+static void app_evt_put(app_evt_t const* p_evt, uint16_t size)
+{
+    ret_code_t err_code = app_sched_event_put(p_evt, size, app_evt_handler);
+    if (err_code == NRF_ERROR_NO_MEM)
+    {
+        // A burst of writes from several links filled the queue, losing the event beats a reset
+        TLOG_WARNING("Event %d dropped, scheduler queue full", p_evt->type);
+        return;
+    }
+    APP_ERROR_CHECK(err_code);
+}
+
+
+/**@brief Function for posting an application event to the main loop.
+ *
+ * @details Safe to call from interrupt context. The event is dropped and logged if the queue is full.
+ *
+ * @param[in]   type            Type of the event.
+ * @param[in]   conn_handle     Connection the event belongs to, BLE_CONN_HANDLE_INVALID if none.
+ */
+static void app_evt_post(app_evt_type_t type, uint16_t conn_handle)
+{
+    app_evt_t evt;
+
+    evt.type        = type;
+    evt.conn_handle = conn_handle;
+
+    // Without a value only the head of the event is queued
+    app_evt_put(&evt, offsetof(app_evt_t, params));
+}
+
+
+/**@brief Function for posting an application event carrying the value written with a TCS command.
+ *
+ * @details Safe to call from interrupt context. The value is copied into the scheduler queue, so
+ *          commands written back to back each keep their own.
+ *
+ * @param[in]   type            Type of the event.
+ * @param[in]   conn_handle     Connection the event belongs to.
+ * @param[in]   p_params        Value written with the command.
+ */
+static void app_evt_params_post(app_evt_type_t type, uint16_t conn_handle, ble_tcs_evt_params_t const* p_params)
+{
+    app_evt_t evt;
+
+    evt.type        = type;
+    evt.conn_handle = conn_handle;
+    evt.params      = *p_params;
+
+    app_evt_put(&evt, sizeof(evt));
+}
+
+
+/**@brief Timeout handler for the measurement timer.
+ *
+ * @param[in]   p_context   Unused.
+ */
+static void measurement_timer_handler(void* p_context)
+{
+    UNUSED_PARAMETER(p_context);
+
+    app_evt_post(APP_EVT_MEASUREMENT, BLE_CONN_HANDLE_INVALID);
+}
+
+
+/**@brief Function for handling the battery monitor measurements.
+ */
+static void battery_measurement_handler(void)
+{
+    app_evt_post(APP_EVT_BATTERY_MEASURED, BLE_CONN_HANDLE_INVALID);
+}
+
+
+/**@brief Function for handling the radio notification.
+ *
+ * @param[in]   radio_active    Boolean indicating if the radio is about to start or has stopped.
+ */
+static void radio_notification_handler(bool radio_active)
+{
+    energy_on_radio(radio_active);
+    battery_voltage_on_radio(radio_active);
+}
+
+
+/**@brief Function for initializing the radio notification, requires the SoftDevice.
+ */
+static void radio_notification_init(void)
+{
+    ret_code_t err_code = ble_radio_notification_init(APP_IRQ_PRIORITY_LOW,
+                                                      NRF_RADIO_NOTIFICATION_DISTANCE_800US,
+                                                      radio_notification_handler);
+    APP_ERROR_CHECK(err_code);
+}
+
+
+/**@brief Function for handling the FDS events.
+ *
+ * @param[in]   p_fds_evt   Event received from the FDS.
+ */
+static void storage_evt_handler(fds_evt_t const* p_fds_evt)
+{
+    // The peer manager shares FDS, only the records of the application are of interest
+    switch (p_fds_evt->id)
+    {
+        case FDS_EVT_INIT:
+            if (p_fds_evt->result == FDS_SUCCESS)
             {
-                if (bas_update_flag)
-                {
-                    battery_level_update();
-                    bas_update_flag = false;
-                }
-
-                if (tcs_update_flag)
-                {
-                    thermocouple_level_update();
-                    tcs_update_flag = false;
-                }
+                app_evt_post(APP_EVT_STORAGE_INIT, BLE_CONN_HANDLE_INVALID);
             }
+            break;
 
-            if (fds_getNumberOfRecords() < MAX_NUMBER_OF_DAYS)
+        case FDS_EVT_WRITE:
+            if (p_fds_evt->write.file_id == FDS_FILE_ID)
             {
-                if (timer_getIntFlag())
-                {
-                    max31856_int_handler(e_cold_junction);
-                    timer_setIntFlag(false);
-                }
-
-                if (m_number_of_measurements >= MAX_RECORD_SIZE)
-                {
-                    write_tc_buffer_too_fds();
-                }
+                app_evt_post((p_fds_evt->result == FDS_SUCCESS) ? APP_EVT_RECORD_WRITTEN : APP_EVT_RECORD_FAILED,
+                             BLE_CONN_HANDLE_INVALID);
             }
-            else if (!m_app_finished_flag)
+            break;
+
+        case FDS_EVT_GC:
+            app_evt_post(APP_EVT_GARBAGE_COLLECTED, BLE_CONN_HANDLE_INVALID);
+            break;
+
+        case FDS_EVT_DEL_RECORD:
+            // The storage module deleted the next record before forwarding the event
+            if ((p_fds_evt->del.file_id == FDS_FILE_ID) && !m_storage_ready && fds_getAllRecordsDeletedFlag())
             {
-                NRF_LOG_INFO("\r\n\n\n\t*** APPLICATION FINISHED ***\r\n");
-                m_app_finished_flag = true;
+                app_evt_post(APP_EVT_STORAGE_CLEARED, BLE_CONN_HANDLE_INVALID);
             }
-        }
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+/**@brief Function for initializing the event scheduler.
+ */
+static void scheduler_init(void)
+{
+    APP_SCHED_INIT(SCHED_MAX_EVENT_SIZE, SCHED_QUEUE_SIZE);
+}
+
+
+/**@brief Function for application main entry.
+ */
+int main(void)
+{
+    // Initialize.
+    log_init();
+    NRF_LOG_INFO("*****************************************************\r\n\n");
+    NRF_LOG_INFO("\r\n\n\n\t*** CONCRETE SENSOR ***\r\n");
+    NRF_LOG_FLUSH();
+
+    scheduler_init();
+    timer_init(measurement_timer_handler);
+    leds_init();
+    buttons_init();
+    battery_voltage_init(battery_measurement_handler);
+    power_management_init();
+    ble_stack_init();
+    gap_params_init();
+    gatt_init();
+    services_init();
+    advertising_init();
+    tx_power_init();
+    dcdc_init();
+    conn_params_init();
+    peer_manager_init();
+    energy_init(energy_report_handler);
+    tc_channels_set(TC_CHANNELS);
+    maturity_init();
+    strength_init();
+    alert_init();
+    radio_notification_init();
+
+    sensor_power_init(&spi);
+    
+    // Advertising starts once the records of the previous run are deleted, see storage_evt_handler()
+    APP_ERROR_CHECK(fds_storage_init(storage_evt_handler));
+
+    //sd_ble_gap_tx_power_set(BLE_GAP_TX_POWER_ROLE_ADV, );
+    //sleep_mode_enter();
+
+    NRF_LOG_FLUSH();
+
+    while (true)
+    {
+        PROFILER_SCOPE(PROFILER_PROBE_MAIN_LOOP);
+
+        // Run the handlers of the events queued since the last wake-up
+        app_sched_execute();
+        idle_state_handle();
     }
 }
 
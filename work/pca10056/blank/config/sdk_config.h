@@ -300,6 +300,214 @@
 // </h> 
 //==========================================================
 
+// <h> Application 
+
+//==========================================================
+// <q> TCS_L2CAP_ENABLED  - ble_tcs_l2cap - L2CAP connection-oriented channel for history dumps
+ 
+
+#ifndef TCS_L2CAP_ENABLED
+#define TCS_L2CAP_ENABLED 1
+#endif
+
+// <o> BLE_TCS_HVN_TX_QUEUE_SIZE - Number of notifications the TC Service keeps queued in the SoftDevice. 
+// <i> Set to 1 to reproduce the single packet refill behaviour when measuring packets per connection event.
+
+#ifndef BLE_TCS_HVN_TX_QUEUE_SIZE
+#define BLE_TCS_HVN_TX_QUEUE_SIZE 16
+#endif
+
+// <q> ADV_BATCH_ENABLED  - adv_batch - Broadcast recent samples in extended advertising while not connected
+ 
+
+#ifndef ADV_BATCH_ENABLED
+#define ADV_BATCH_ENABLED 1
+#endif
+
+// <o> ADV_BATCH_SAMPLE_COUNT - Maximum number of recent samples in a broadcast. 
+// <i> Fewer samples are sent when the deltas do not fit in the extended advertising data.
+
+#ifndef ADV_BATCH_SAMPLE_COUNT
+#define ADV_BATCH_SAMPLE_COUNT 64
+#endif
+
+// <o> ADV_POLICY_SYNC_PERIOD - Time between the starts of two advertising sync windows [min]. 
+// <i> 0 keeps slow advertising on continuously after fast advertising times out.
+
+#ifndef ADV_POLICY_SYNC_PERIOD
+#define ADV_POLICY_SYNC_PERIOD 0
+#endif
+
+// <o> ADV_POLICY_SYNC_WINDOW - Length of an advertising sync window [min]. 
+
+#ifndef ADV_POLICY_SYNC_WINDOW
+#define ADV_POLICY_SYNC_WINDOW 5
+#endif
+
+// <o> ENERGY_BATTERY_CAPACITY - Usable capacity of the battery [mAh]. 
+// <i> Used for the projected battery life of the energy report.
+
+#ifndef ENERGY_BATTERY_CAPACITY
+#define ENERGY_BATTERY_CAPACITY 1000
+#endif
+
+// <o> ENERGY_LOG_PERIOD - Time between two writes of the energy counters to flash [min]. 
+
+#ifndef ENERGY_LOG_PERIOD
+#define ENERGY_LOG_PERIOD 60
+#endif
+
+// <q> BATTERY_SAG_ENABLED  - Measure the battery during a radio event after every scheduled measurement
+ 
+
+#ifndef BATTERY_SAG_ENABLED
+#define BATTERY_SAG_ENABLED 1
+#endif
+
+// <o> BATTERY_CUTOFF_VOLTAGE - Battery voltage at which the sensor stops working [mV]. 
+
+#ifndef BATTERY_CUTOFF_VOLTAGE
+#define BATTERY_CUTOFF_VOLTAGE 2100
+#endif
+
+// <o> BATTERY_OFFLOAD_MARGIN - Predicted battery life below which the history is offloaded [h]. 
+
+#ifndef BATTERY_OFFLOAD_MARGIN
+#define BATTERY_OFFLOAD_MARGIN 72
+#endif
+
+// <q> SENSOR_POWER_SWITCH_ENABLED  - Switch the sensor front end off between conversions with a load switch on SENSOR_POWER_PIN
+ 
+
+#ifndef SENSOR_POWER_SWITCH_ENABLED
+#define SENSOR_POWER_SWITCH_ENABLED 0
+#endif
+
+// <o> MATURITY_DATUM_TEMPERATURE - Datum temperature of the Nurse-Saul maturity, below it the concrete does not gain strength [°C]. 
+// <i> ASTM C1074 suggests -10 °C without data for the mix, the app may set it with "Datum=<°C>".
+
+#ifndef MATURITY_DATUM_TEMPERATURE
+#define MATURITY_DATUM_TEMPERATURE -10
+#endif
+
+// <o> MATURITY_LOG_PERIOD - Stored samples between two writes of the maturity to flash. 
+
+#ifndef MATURITY_LOG_PERIOD
+#define MATURITY_LOG_PERIOD 6
+#endif
+
+// <o> MATURITY_ACTIVATION_ENERGY - Activation energy of the equivalent age [J/mol]. 
+// <i> ASTM C1074 suggests 40000-45000 J/mol for Type I cement without data for the mix, the app may set it with "ActivationEnergy=<kJ/mol>".
+
+#ifndef MATURITY_ACTIVATION_ENERGY
+#define MATURITY_ACTIVATION_ENERGY 40000
+#endif
+
+// <o> MATURITY_REFERENCE_TEMPERATURE - Reference temperature of the equivalent age [°C]. 
+
+#ifndef MATURITY_REFERENCE_TEMPERATURE
+#define MATURITY_REFERENCE_TEMPERATURE 20
+#endif
+
+// <o> TC_CHANNELS - Channels stored per sample, bit 0 thermocouple, bit 1 cold junction. 
+// <i> The thermocouple is stored as float32, the cold junction as int16 in 1/64 °C. "Channels=<mask>" overrides it before activation.
+
+#ifndef TC_CHANNELS
+#define TC_CHANNELS 3
+#endif
+
+// <o> STRENGTH_TARGET - Default target strength for the predicted time, e.g. to strip the formwork [MPa]. 
+// <i> Without an uploaded calibration curve no strength is estimated.
+
+#ifndef STRENGTH_TARGET
+#define STRENGTH_TARGET 10
+#endif
+
+// <o> ALERT_FREEZE_TEMPERATURE - Default rule 0, core below this temperature: the fresh concrete may freeze [°C]. 
+
+#ifndef ALERT_FREEZE_TEMPERATURE
+#define ALERT_FREEZE_TEMPERATURE 0
+#endif
+
+// <o> ALERT_MAX_TEMPERATURE - Default rule 1, core above this temperature [°C]. 
+// <i> ACI 301 limits mass concrete to 70 °C, above it delayed ettringite formation becomes a risk.
+
+#ifndef ALERT_MAX_TEMPERATURE
+#define ALERT_MAX_TEMPERATURE 70
+#endif
+
+// <o> ALERT_MAX_RATE - Default rule 2, core rising or falling faster than this [°C/h]. 
+
+#ifndef ALERT_MAX_RATE
+#define ALERT_MAX_RATE 5
+#endif
+
+// <o> ALERT_MAX_DIFFERENTIAL - Default rule 3, core and surface further apart than this [°C]. 
+// <i> ACI 207 and 301 limit the differential to 19 °C (35 °F) against thermal cracking.
+
+#ifndef ALERT_MAX_DIFFERENTIAL
+#define ALERT_MAX_DIFFERENTIAL 19
+#endif
+
+// <o> ALERT_HYSTERESIS - Hysteresis of the default rules [°C or °C/h]. 
+
+#ifndef ALERT_HYSTERESIS
+#define ALERT_HYSTERESIS 1
+#endif
+
+// <o> ALERT_DEBOUNCE - Consecutive samples the default rules need to fire and to clear. 
+
+#ifndef ALERT_DEBOUNCE
+#define ALERT_DEBOUNCE 2
+#endif
+
+// <e> TLOG_ENABLED - tlog - Tokenized binary log of the hot paths
+//==========================================================
+#ifndef TLOG_ENABLED
+#define TLOG_ENABLED 1
+#endif
+// <o> TLOG_LEVEL  - Severity level
+ 
+// <1=> Error 
+// <2=> Warning 
+// <3=> Info 
+// <4=> Debug 
+
+#ifndef TLOG_LEVEL
+#define TLOG_LEVEL 3
+#endif
+
+// <o> TLOG_BUFSIZE  - Size of the ring holding the entries (in bytes).
+ 
+
+// <i> Must be power of 2.
+// <256=> 256 
+// <512=> 512 
+// <1024=> 1024 
+
+#ifndef TLOG_BUFSIZE
+#define TLOG_BUFSIZE 512
+#endif
+
+// <q> TLOG_BACKEND_RTT_ENABLED  - Move the entries to RTT up channel 1 in idle
+ 
+
+#ifndef TLOG_BACKEND_RTT_ENABLED
+#define TLOG_BACKEND_RTT_ENABLED 1
+#endif
+
+// </e>
+
+// <q> PROFILER_ENABLED  - profiler - Cycle counts and log2 histograms of the hot paths
+// <i> Read per probe on the profile characteristic after writing "Profile=<probe>". Disabled, the probes are compiled out.
+
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 0
+#endif
+
+// </h> 
+//==========================================================
+
 // <h> nRF_Drivers 
 
 //==========================================================
@@ -7663,9 +7871,10 @@
 // <i> One of the virtual pages is reserved by the system for garbage collection.
 // <i> Therefore, the minimum is two virtual pages: one page to store data and one page to be used by the system for garbage collection.
 // <i> The total amount of flash memory that is used by FDS amounts to @ref FDS_VIRTUAL_PAGES * @ref FDS_VIRTUAL_PAGE_SIZE * 4 bytes.
+// <i> A day of two-channel samples is a 219 word record, 4 fit a page: the 30 day history takes 8 pages, the rest holds the state records and the peers.
 
 #ifndef FDS_VIRTUAL_PAGES
-#define FDS_VIRTUAL_PAGES 5
+#define FDS_VIRTUAL_PAGES 12
 #endif
 
 // <o> FDS_VIRTUAL_PAGE_SIZE  - The size of a virtual flash page.
@@ -8772,7 +8981,7 @@
 // <16384=> 16384 
 
 #ifndef NRF_LOG_BUFSIZE
-#define NRF_LOG_BUFSIZE 16384
+#define NRF_LOG_BUFSIZE 1024
 #endif
 
 // <q> NRF_LOG_CLI_CMDS  - Enable CLI commands for the module.
@@ -8791,7 +9000,7 @@
 // <4=> Debug 
 
 #ifndef NRF_LOG_DEFAULT_LEVEL
-#define NRF_LOG_DEFAULT_LEVEL 4
+#define NRF_LOG_DEFAULT_LEVEL 3
 #endif
 
 // <q> NRF_LOG_DEFERRED  - Enable deffered logger.
@@ -12249,12 +12458,12 @@
 // <i> Requested BLE GAP data length to be negotiated.
 
 #ifndef NRF_SDH_BLE_GAP_DATA_LENGTH
-#define NRF_SDH_BLE_GAP_DATA_LENGTH 27
+#define NRF_SDH_BLE_GAP_DATA_LENGTH 251
 #endif
 
 // <o> NRF_SDH_BLE_PERIPHERAL_LINK_COUNT - Maximum number of peripheral links. 
 #ifndef NRF_SDH_BLE_PERIPHERAL_LINK_COUNT
-#define NRF_SDH_BLE_PERIPHERAL_LINK_COUNT 1
+#define NRF_SDH_BLE_PERIPHERAL_LINK_COUNT 2
 #endif
 
 // <o> NRF_SDH_BLE_CENTRAL_LINK_COUNT - Maximum number of central links. 
@@ -12266,7 +12475,7 @@
 // <i> Maximum number of total concurrent connections using the default configuration.
 
 #ifndef NRF_SDH_BLE_TOTAL_LINK_COUNT
-#define NRF_SDH_BLE_TOTAL_LINK_COUNT 1
+#define NRF_SDH_BLE_TOTAL_LINK_COUNT 2
 #endif
 
 // <o> NRF_SDH_BLE_GAP_EVENT_LENGTH - GAP event length. 
@@ -12278,7 +12487,7 @@
 
 // <o> NRF_SDH_BLE_GATT_MAX_MTU_SIZE - Static maximum MTU size. 
 #ifndef NRF_SDH_BLE_GATT_MAX_MTU_SIZE
-#define NRF_SDH_BLE_GATT_MAX_MTU_SIZE 23
+#define NRF_SDH_BLE_GATT_MAX_MTU_SIZE 247
 #endif
 
 // <o> NRF_SDH_BLE_GATTS_ATTR_TAB_SIZE - Attribute Table size in bytes. The size must be a multiple of 4. 
@@ -0,0 +1,228 @@
+#include <string.h>
+#include "sdk_common.h"
+#include "app_error.h"
+#include "app_timer.h"
+#include "adv_status.h"
+#include "adv_batch.h"
+#include "tlog.h"
+
+
+APP_TIMER_DEF(m_window_timer_id);       /**< Timer closing the broadcast window. */
+
+static adv_batch_evt_handler_t m_evt_handler = NULL;
+
+static uint8_t m_adv_handle = BLE_GAP_ADV_SET_HANDLE_NOT_SET;   /**< Advertising set in use during the window. */
+static bool m_active = false;                                   /**< Whether a broadcast window is open. */
+static uint8_t m_adv_data[ADV_BATCH_DATA_SIZE];                 /**< Advertising data, owned by the SoftDevice while configured. */
+
+
+/**
+ * @brief Function for getting the encoded size of a sample
+ *
+ * @param[in] previous              Previous sample [0.01 °C]
+ * @param[in] current               Sample to encode [0.01 °C]
+ *
+ * @return      1 if the difference fits a delta, else 3
+ */
+static uint8_t delta_size(int16_t previous, int16_t current)
+{
+    int32_t delta = (int32_t) current - previous;
+
+    return ((delta > INT8_MIN) && (delta <= INT8_MAX)) ? 1 : 3;
+}
+
+
+/**
+ * @brief Function for encoding a batch record
+ *
+ * @details The newest samples are kept, older samples are dropped until the record fits.
+ *
+ * @param[in]  p_samples            Samples, oldest first [°C]
+ * @param[in]  count                Number of samples
+ * @param[in]  seq_base             Sequence number of the first sample
+ * @param[in]  interval             Time between two samples [s]
+ * @param[out] p_data               Buffer for the record
+ * @param[in]  max_length           Size of the buffer in bytes
+ *
+ * @return      Length of the encoded record in bytes, 0 if not even one sample fits
+ */
+uint16_t adv_batch_encode(float const* p_samples, uint16_t count, uint16_t seq_base, uint16_t interval, uint8_t* p_data, uint16_t max_length)
+{
+    uint16_t length = ADV_BATCH_HEADER_SIZE;
+    uint16_t first;
+
+    if ((count == 0) || (max_length < ADV_BATCH_HEADER_SIZE))
+    {
+        return 0;
+    }
+
+    // Walk back from the newest sample while the record still fits
+    first = count - 1;
+    while ((first > 0) && ((count - first) < UINT8_MAX))
+    {
+        uint8_t size = delta_size(adv_status_temperature_encode(p_samples[first - 1]),
+                                  adv_status_temperature_encode(p_samples[first]));
+        if ((length + size) > max_length)
+        {
+            break;
+        }
+        length += size;
+        first--;
+    }
+
+    int16_t previous = adv_status_temperature_encode(p_samples[first]);
+
+    length = 0;
+    p_data[length++] = ADV_BATCH_RECORD_ID;
+    length += uint16_encode(seq_base + first, &p_data[length]);
+    p_data[length++] = (uint8_t) (count - first);
+    length += uint16_encode(interval, &p_data[length]);
+    length += uint16_encode((uint16_t) previous, &p_data[length]);
+
+    for (uint16_t i = first + 1; i < count; i++)
+    {
+        int16_t current = adv_status_temperature_encode(p_samples[i]);
+
+        if (delta_size(previous, current) == 1)
+        {
+            p_data[length++] = (uint8_t) (int8_t) (current - previous);
+        }
+        else
+        {
+            p_data[length++] = ADV_BATCH_DELTA_ESCAPE;
+            length += uint16_encode((uint16_t) current, &p_data[length]);
+        }
+        previous = current;
+    }
+
+    return length;
+}
+
+
+/**
+ * @brief Timeout handler for the window timer
+ */
+static void window_timer_handler(void* p_context)
+{
+    UNUSED_PARAMETER(p_context);
+
+    ret_code_t err_code = sd_ble_gap_adv_stop(m_adv_handle);
+    if ((err_code != NRF_SUCCESS) && (err_code != NRF_ERROR_INVALID_STATE))
+    {
+        APP_ERROR_HANDLER(err_code);
+    }
+
+    m_active = false;
+
+    if (m_evt_handler != NULL)
+    {
+        m_evt_handler(ADV_BATCH_EVT_STOPPED);
+    }
+}
+
+
+/**
+ * @brief Function for initializing the batch broadcaster
+ *
+ * @param[in] evt_handler           Handler for window events
+ */
+void adv_batch_init(adv_batch_evt_handler_t evt_handler)
+{
+    m_evt_handler = evt_handler;
+
+    APP_ERROR_CHECK(app_timer_create(&m_window_timer_id, APP_TIMER_MODE_SINGLE_SHOT, window_timer_handler));
+}
+
+
+/**
+ * @brief Function for broadcasting the most recent samples
+ *
+ * @param[in] adv_handle            Advertising set to use
+ * @param[in] company_id            Company identifier of the manufacturer specific data
+ * @param[in] p_samples             Samples, oldest first [°C]
+ * @param[in] count                 Number of samples
+ * @param[in] seq_base              Sequence number of the first sample
+ * @param[in] interval              Time between two samples [s]
+ *
+ * @return      NRF_SUCCESS if successful, NRF_ERROR_BUSY if a window is open, else error code
+ */
+ret_code_t adv_batch_broadcast(uint8_t adv_handle, uint16_t company_id, float const* p_samples, uint16_t count, uint16_t seq_base, uint16_t interval)
+{
+    ret_code_t err_code;
+    ble_gap_adv_params_t adv_params;
+    ble_gap_adv_data_t adv_data;
+    uint16_t record_length;
+
+    VERIFY_PARAM_NOT_NULL(p_samples);
+
+    if (m_active)
+    {
+        return NRF_ERROR_BUSY;
+    }
+
+    record_length = adv_batch_encode(p_samples, count, seq_base, interval,
+                                     &m_adv_data[ADV_BATCH_AD_OVERHEAD], sizeof(m_adv_data) - ADV_BATCH_AD_OVERHEAD);
+    if (record_length == 0)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+
+    // Manufacturer specific data AD structure around the record
+    m_adv_data[0] = (uint8_t) (record_length + ADV_BATCH_AD_OVERHEAD - 1);
+    m_adv_data[1] = BLE_GAP_AD_TYPE_MANUFACTURER_SPECIFIC_DATA;
+    UNUSED_RETURN_VALUE(uint16_encode(company_id, &m_adv_data[2]));
+
+    memset(&adv_params, 0, sizeof(adv_params));
+
+    adv_params.properties.type  = BLE_GAP_ADV_TYPE_EXTENDED_NONCONNECTABLE_NONSCANNABLE_UNDIRECTED;
+    adv_params.p_peer_addr      = NULL;
+    adv_params.filter_policy    = BLE_GAP_ADV_FP_ANY;
+    adv_params.interval         = ADV_BATCH_INTERVAL;
+    adv_params.duration         = 0;    // Closed by the window timer, a timeout would restart ble_advertising
+    adv_params.primary_phy      = BLE_GAP_PHY_1MBPS;
+    adv_params.secondary_phy    = BLE_GAP_PHY_1MBPS;
+
+    memset(&adv_data, 0, sizeof(adv_data));
+
+    adv_data.adv_data.p_data    = m_adv_data;
+    adv_data.adv_data.len       = record_length + ADV_BATCH_AD_OVERHEAD;
+
+    // The S140 has a single advertising set, take it over from the connectable advertising
+    err_code = sd_ble_gap_adv_stop(adv_handle);
+    if ((err_code != NRF_SUCCESS) && (err_code != NRF_ERROR_INVALID_STATE))
+    {
+        return err_code;
+    }
+
+    m_adv_handle = adv_handle;
+    err_code = sd_ble_gap_adv_set_configure(&m_adv_handle, &adv_data, &adv_params);
+    VERIFY_SUCCESS(err_code);
+
+    err_code = sd_ble_gap_adv_start(m_adv_handle, BLE_CONN_CFG_TAG_DEFAULT);
+    VERIFY_SUCCESS(err_code);
+
+    err_code = app_timer_start(m_window_timer_id, APP_TIMER_TICKS(ADV_BATCH_WINDOW), NULL);
+    VERIFY_SUCCESS(err_code);
+
+    m_active = true;
+
+    TLOG_INFO("Broadcast window opened, %d bytes of advertising data", adv_data.adv_data.len);
+
+    if (m_evt_handler != NULL)
+    {
+        m_evt_handler(ADV_BATCH_EVT_STARTED);
+    }
+
+    return NRF_SUCCESS;
+}
+
+
+/**
+ * @brief Function for checking if a broadcast window is open
+ *
+ * @return      Boolean indicating the window status
+ */
+bool adv_batch_is_active(void)
+{
+    return m_active;
+}
@@ -0,0 +1,320 @@
+#include "sdk_common.h"
+#include "app_error.h"
+#include "app_timer.h"
+#include "nrf_sdh_ble.h"
+#include "ble_conn_state.h"
+#include "adv_policy.h"
+#include "tlog.h"
+
+
+/**
+ * @brief Typedef Enum for defining what the advertising set is doing
+ */
+typedef enum
+{
+    ADV_POLICY_STATE_OFF,       ///< Not advertising, connected or outside a sync window
+    ADV_POLICY_STATE_FAST,      ///< Fast connectable advertising
+    ADV_POLICY_STATE_SLOW,      ///< Slow connectable advertising
+    ADV_POLICY_STATE_BATCH      ///< Non-connectable batch broadcast
+} adv_policy_state_t;
+
+
+APP_TIMER_DEF(m_tick_timer_id);     /**< Timer for the charge accounting and the sync windows. */
+
+static adv_policy_init_t m_config;
+
+static adv_policy_state_t m_state = ADV_POLICY_STATE_OFF;          /**< Current state of the advertising set. */
+static adv_policy_state_t m_resume_state = ADV_POLICY_STATE_OFF;   /**< State to resume when the broadcast window closes. */
+
+static uint32_t m_state_ticks = 0;          /**< Timestamp up to which the current state is accounted. */
+static uint32_t m_residual_us = 0;          /**< Time in the current state not yet filling a full event. */
+static uint32_t m_minutes = 0;              /**< Number of ticks since init. */
+
+static uint64_t m_charge_today = 0;         /**< Charge spent on advertising during the running day [nC]. */
+static uint64_t m_charge_yesterday = 0;     /**< Charge spent on advertising during the last completed day [nC]. */
+static uint32_t m_events_today = 0;         /**< Advertising events during the running day. */
+
+
+/**
+ * @brief Function for checking if every peripheral link is in use
+ *
+ * @return      Boolean indicating that no central can connect
+ */
+static bool links_full(void)
+{
+    return ble_conn_state_peripheral_conn_count() >= NRF_SDH_BLE_PERIPHERAL_LINK_COUNT;
+}
+
+
+/**
+ * @brief Function for accounting the advertising events of the current state up to now
+ */
+static void charge_account(void)
+{
+    uint32_t now = app_timer_cnt_get();
+    uint32_t elapsed_us = ((uint64_t) app_timer_cnt_diff_compute(now, m_state_ticks) * 1000000) / APP_TIMER_CLOCK_FREQ;
+    uint32_t interval_us;
+    uint32_t event_charge;
+
+    m_state_ticks = now;
+
+    switch (m_state)
+    {
+        case ADV_POLICY_STATE_FAST:
+            interval_us  = m_config.fast_interval * 625;
+            event_charge = ADV_POLICY_LEGACY_EVENT_CHARGE;
+            break;
+
+        case ADV_POLICY_STATE_SLOW:
+            interval_us  = m_config.slow_interval * 625;
+            event_charge = ADV_POLICY_LEGACY_EVENT_CHARGE;
+            break;
+
+        case ADV_POLICY_STATE_BATCH:
+            interval_us  = m_config.batch_interval * 625;
+            event_charge = ADV_POLICY_EXTENDED_EVENT_CHARGE;
+            break;
+
+        default:
+            return;
+    }
+
+    uint32_t events = (elapsed_us + m_residual_us) / interval_us;
+    m_residual_us   = (elapsed_us + m_residual_us) % interval_us;
+
+    m_events_today += events;
+    m_charge_today += (uint64_t) events * event_charge;
+}
+
+
+/**
+ * @brief Function for changing the state of the advertising set
+ *
+ * @param[in] state                 New state
+ */
+static void state_set(adv_policy_state_t state)
+{
+    charge_account();
+
+    if (state != m_state)
+    {
+        m_state = state;
+        m_residual_us = 0;
+    }
+}
+
+
+/**
+ * @brief Function for (re)starting the connectable advertising in the given mode
+ *
+ * @param[in] mode                  Advertising mode
+ */
+static void advertising_restart(ble_adv_mode_t mode)
+{
+    ret_code_t err_code = sd_ble_gap_adv_stop(m_config.p_advertising->adv_handle);
+    if ((err_code != NRF_SUCCESS) && (err_code != NRF_ERROR_INVALID_STATE))
+    {
+        APP_ERROR_HANDLER(err_code);
+    }
+
+    err_code = ble_advertising_start(m_config.p_advertising, mode);
+    APP_ERROR_CHECK(err_code);
+}
+
+
+/**
+ * @brief Timeout handler for the tick timer
+ */
+static void tick_timer_handler(void* p_context)
+{
+    UNUSED_PARAMETER(p_context);
+
+    charge_account();
+    m_minutes++;
+
+    if ((m_config.sync_period > 0) && ((m_minutes % m_config.sync_period) == 0) && !links_full())
+    {
+        if (m_state == ADV_POLICY_STATE_OFF)
+        {
+            TLOG_INFO("Sync window opened");
+            advertising_restart(BLE_ADV_MODE_SLOW);
+        }
+        else if ((m_state == ADV_POLICY_STATE_BATCH) && (m_resume_state == ADV_POLICY_STATE_OFF))
+        {
+            m_resume_state = ADV_POLICY_STATE_SLOW;
+        }
+    }
+
+    if ((m_minutes % ADV_POLICY_MINUTES_PER_DAY) == 0)
+    {
+        m_charge_yesterday = m_charge_today;
+        TLOG_INFO("Advertising: %d events, %d uC in the last day", m_events_today, (uint32_t) (m_charge_yesterday / 1000));
+
+        m_charge_today = 0;
+        m_events_today = 0;
+    }
+}
+
+
+/**
+ * @brief Function for handling the BLE events of the advertising policy
+ *
+ * @param[in] p_ble_evt             Event received from the BLE stack
+ * @param[in] p_context             Unused
+ */
+static void adv_policy_on_ble_evt(ble_evt_t const* p_ble_evt, void* p_context)
+{
+    UNUSED_PARAMETER(p_context);
+
+    switch (p_ble_evt->header.evt_id)
+    {
+        case BLE_GAP_EVT_CONNECTED:
+            state_set(ADV_POLICY_STATE_OFF);
+            if (!links_full())
+            {
+                // Keep a link available for a second central, without the fast rate
+                advertising_restart(BLE_ADV_MODE_SLOW);
+            }
+            break;
+
+        case BLE_GAP_EVT_DISCONNECTED:
+            // Restarting on disconnect is disabled in the Advertising module, it only tracks the last link
+            if (m_state == ADV_POLICY_STATE_BATCH)
+            {
+                m_resume_state = ADV_POLICY_STATE_FAST;
+            }
+            else
+            {
+                advertising_restart(BLE_ADV_MODE_FAST);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+NRF_SDH_BLE_OBSERVER(m_adv_policy_obs, ADV_POLICY_BLE_OBSERVER_PRIO, adv_policy_on_ble_evt, NULL);
+
+
+/**
+ * @brief Function for initializing the advertising policy
+ *
+ * @param[in] p_init                Policy configuration
+ */
+void adv_policy_init(adv_policy_init_t const* p_init)
+{
+    m_config = *p_init;
+    m_state_ticks = app_timer_cnt_get();
+
+    APP_ERROR_CHECK(app_timer_create(&m_tick_timer_id, APP_TIMER_MODE_REPEATED, tick_timer_handler));
+    APP_ERROR_CHECK(app_timer_start(m_tick_timer_id, APP_TIMER_TICKS(ADV_POLICY_TICK), NULL));
+}
+
+
+/**
+ * @brief Function for restoring fast advertising
+ *
+ * @param[in] trigger               Reason for restoring fast advertising
+ */
+void adv_policy_restore_fast(adv_policy_trigger_t trigger)
+{
+    if (links_full())
+    {
+        return;
+    }
+
+    TLOG_INFO("Fast advertising restored, trigger %d", trigger);
+
+    if (m_state == ADV_POLICY_STATE_BATCH)
+    {
+        m_resume_state = ADV_POLICY_STATE_FAST;
+    }
+    else
+    {
+        advertising_restart(BLE_ADV_MODE_FAST);
+    }
+}
+
+
+/**
+ * @brief Function for passing the Advertising module events to the policy
+ *
+ * @param[in] ble_adv_evt           Advertising event
+ */
+void adv_policy_on_adv_evt(ble_adv_evt_t ble_adv_evt)
+{
+    switch (ble_adv_evt)
+    {
+        case BLE_ADV_EVT_FAST:
+            state_set(ADV_POLICY_STATE_FAST);
+            break;
+
+        case BLE_ADV_EVT_SLOW:
+            state_set(ADV_POLICY_STATE_SLOW);
+            break;
+
+        case BLE_ADV_EVT_IDLE:
+            state_set(ADV_POLICY_STATE_OFF);
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+/**
+ * @brief Function for passing the batch broadcast window state to the policy
+ *
+ * @param[in] active                Boolean indicating if the broadcast window is open
+ */
+void adv_policy_on_batch(bool active)
+{
+    if (active)
+    {
+        m_resume_state = m_state;
+        state_set(ADV_POLICY_STATE_BATCH);
+        return;
+    }
+
+    state_set(ADV_POLICY_STATE_OFF);
+
+    if (links_full())
+    {
+        return;
+    }
+
+    switch (m_resume_state)
+    {
+        case ADV_POLICY_STATE_FAST:
+            advertising_restart(BLE_ADV_MODE_FAST);
+            break;
+
+        case ADV_POLICY_STATE_SLOW:
+            advertising_restart(BLE_ADV_MODE_SLOW);
+            break;
+
+        default:
+            // Outside a sync window, stay quiet
+            break;
+    }
+}
+
+
+/**
+ * @brief Function for getting the estimated advertising charge
+ *
+ * @param[in] previous_day          Charge of the last completed day instead of the running day
+ *
+ * @return      Estimated charge spent on advertising [uC]
+ */
+uint32_t adv_policy_charge_get(bool previous_day)
+{
+    if (!previous_day)
+    {
+        charge_account();
+    }
+
+    return (uint32_t) ((previous_day ? m_charge_yesterday : m_charge_today) / 1000);
+}
@@ -0,0 +1,50 @@
+#include "adv_status.h"
+#include "app_util.h"
+
+
+/**
+ * @brief Function for converting a temperature to the advertised fixed point format
+ *
+ * @param[in]  temperature          Temperature [°C]
+ *
+ * @return      Temperature in 0.01 °C, rounded and saturated to the int16 range
+ */
+int16_t adv_status_temperature_encode(float temperature)
+{
+    float centidegrees = temperature * 100.0f;
+
+    if (centidegrees >= (float) INT16_MAX)
+    {
+        return INT16_MAX;
+    }
+    else if (centidegrees <= (float) INT16_MIN)
+    {
+        return INT16_MIN;
+    }
+
+    return (int16_t) ((centidegrees >= 0.0f) ? (centidegrees + 0.5f) : (centidegrees - 0.5f));
+}
+
+
+/**
+ * @brief Function for encoding the status record
+ *
+ * @param[in]  p_status             Fields of the status record
+ * @param[out] p_data               Buffer for the record, at least ADV_STATUS_SIZE bytes
+ *
+ * @return      Length of the encoded record in bytes
+ */
+uint8_t adv_status_encode(adv_status_t const* p_status, uint8_t* p_data)
+{
+    uint8_t length = 0;
+    int16_t temperature = adv_status_temperature_encode(p_status->temperature);
+
+    p_data[length++] = ADV_STATUS_VERSION;
+    length += uint16_encode((uint16_t) temperature, &p_data[length]);
+    length += uint16_encode(p_status->seq, &p_data[length]);
+    p_data[length++] = p_status->battery_level;
+    p_data[length++] = p_status->faults;
+    length += uint16_encode(p_status->unsynced, &p_data[length]);
+
+    return length;
+}
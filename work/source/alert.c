@@ -0,0 +1,261 @@
+#include <string.h>
+#include <stdlib.h>
+#include "sdk_common.h"
+#include "app_util.h"
+#include "storage.h"
+#include "alert.h"
+#include "temperature.h"
+#include "tlog.h"
+
+#include "nrf_log.h"
+
+#define SECONDS_PER_HOUR    3600
+
+
+/**
+ * @brief Typedef Struct for holding the evaluation state of a rule
+ */
+typedef struct
+{
+    bool        active;                 ///< The rule is firing
+    uint8_t     count;                  ///< Consecutive samples on the other side of the threshold
+} alert_state_t;
+
+
+static alert_rule_t m_rules[ALERT_RULE_COUNT];      /**< Rules in use. */
+static alert_state_t m_states[ALERT_RULE_COUNT];    /**< Evaluation state of every rule. */
+
+static bool m_has_sample = false;                   /**< A previous sample exists for the rate. */
+static int16_t m_last_core;                         /**< Core temperature of the previous sample [0.01 °C]. */
+static uint32_t m_last_time;                        /**< Time of the previous sample [s]. */
+
+STATIC_ASSERT((sizeof(m_rules) % WORD) == 0);
+STATIC_ASSERT(sizeof(m_rules) <= (UPDATE_RECORD_WORDS * WORD));
+
+
+/**
+ * @brief Function for writing the rules to flash
+ */
+static void alert_log(void)
+{
+    // Rules written back to back are written once the update of the first completes
+    ret_code_t err_code = fds_update_deferred(ALERT_FILE_ID, ALERT_REC_KEY, m_rules, sizeof(m_rules) / WORD);
+    if (err_code != NRF_SUCCESS)
+    {
+        TLOG_WARNING("Alert rules not logged: %d", err_code);
+    }
+}
+
+
+/**
+ * @brief Function for stepping a rule with the value it watches
+ *
+ * @return      True if the rule fired or cleared
+ */
+static bool rule_step(alert_rule_t const* p_rule, alert_state_t* p_state, int32_t value)
+{
+    bool beyond;
+    bool within;
+
+    if (p_rule->type == ALERT_RULE_BELOW)
+    {
+        beyond = (value < p_rule->threshold);
+        within = (value > (int32_t) p_rule->threshold + p_rule->hysteresis);
+    }
+    else
+    {
+        beyond = (value > p_rule->threshold);
+        within = (value < (int32_t) p_rule->threshold - p_rule->hysteresis);
+    }
+
+    // Debounce: the condition has to hold on consecutive samples, either way
+    p_state->count = (p_state->active ? within : beyond) ? (p_state->count + 1) : 0;
+
+    if (p_state->count >= MAX(p_rule->debounce, 1))
+    {
+        p_state->active = !p_state->active;
+        p_state->count  = 0;
+        return true;
+    }
+    return false;
+}
+
+
+/**
+ * @brief Function for initializing the rules with the ALERT_* defaults of sdk_config.h
+ */
+void alert_init(void)
+{
+    memset(m_rules, 0, sizeof(m_rules));
+    memset(m_states, 0, sizeof(m_states));
+    m_has_sample = false;
+
+    m_rules[0] = (alert_rule_t) {ALERT_RULE_BELOW, ALERT_DEBOUNCE, ALERT_FREEZE_TEMPERATURE * 100, ALERT_HYSTERESIS * 100};
+    m_rules[1] = (alert_rule_t) {ALERT_RULE_ABOVE, ALERT_DEBOUNCE, ALERT_MAX_TEMPERATURE * 100, ALERT_HYSTERESIS * 100};
+    m_rules[2] = (alert_rule_t) {ALERT_RULE_RATE, ALERT_DEBOUNCE, ALERT_MAX_RATE * 100, ALERT_HYSTERESIS * 100};
+    m_rules[3] = (alert_rule_t) {ALERT_RULE_DIFFERENTIAL, ALERT_DEBOUNCE, ALERT_MAX_DIFFERENTIAL * 100, ALERT_HYSTERESIS * 100};
+}
+
+
+/**
+ * @brief Function for restoring the rules from flash
+ */
+void alert_restore(void)
+{
+    alert_rule_t stored[ALERT_RULE_COUNT];
+
+    if (fds_read_chunk(ALERT_FILE_ID, ALERT_REC_KEY, 0, (uint8_t*) stored, sizeof(stored)) != sizeof(stored))
+    {
+        NRF_LOG_INFO("No alert rules in flash\r\n");
+        return;
+    }
+
+    memcpy(m_rules, stored, sizeof(m_rules));
+    memset(m_states, 0, sizeof(m_states));
+    NRF_LOG_INFO("Alert rules restored\r\n");
+}
+
+
+/**
+ * @brief Function for setting a rule and writing the rules to flash
+ *
+ * @param[in] index                 Slot of the rule
+ * @param[in] p_rule                Rule, ALERT_RULE_OFF to remove it
+ *
+ * @return      NRF_SUCCESS, NRF_ERROR_INVALID_PARAM if the slot or the type is unknown
+ */
+ret_code_t alert_rule_set(uint8_t index, alert_rule_t const* p_rule)
+{
+    VERIFY_PARAM_NOT_NULL(p_rule);
+
+    if ((index >= ALERT_RULE_COUNT) || (p_rule->type >= ALERT_RULE_TYPE_COUNT) || (p_rule->hysteresis < 0))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    m_rules[index] = *p_rule;
+    memset(&m_states[index], 0, sizeof(m_states[index]));
+
+    TLOG_INFO("Alert rule %d: type %d, threshold %d, hysteresis %d, debounce %d", index, p_rule->type,
+              p_rule->threshold, p_rule->hysteresis, p_rule->debounce);
+    alert_log();
+    return NRF_SUCCESS;
+}
+
+
+/**
+ * @brief Function for evaluating the rules on a sample
+ *
+ * @param[in]  seq                  Sequence number of the sample
+ * @param[in]  time                 Time of the sample since activation [s]
+ * @param[in]  core                 Core temperature [°C]
+ * @param[in]  surface              Surface temperature [°C]
+ * @param[out] p_report             Report of the sample
+ *
+ * @return      True if a rule fired or cleared
+ */
+bool alert_evaluate(uint32_t seq, uint32_t time, float core, float surface, alert_report_t* p_report)
+{
+    int16_t const core_centi    = centi_degrees(core);
+    int16_t const surface_centi = centi_degrees(surface);
+    bool const has_rate         = m_has_sample && (time > m_last_time);
+    int32_t rate                = 0;
+    uint8_t changed             = 0;
+
+    if (has_rate)
+    {
+        rate = ((int32_t) core_centi - m_last_core) * SECONDS_PER_HOUR / (int32_t) (time - m_last_time);
+    }
+
+    for (uint8_t i = 0; i < ALERT_RULE_COUNT; i++)
+    {
+        alert_rule_t const* p_rule = &m_rules[i];
+        int32_t value;
+
+        switch (p_rule->type)
+        {
+            case ALERT_RULE_ABOVE:
+            case ALERT_RULE_BELOW:
+                value = core_centi;
+                break;
+
+            case ALERT_RULE_RATE:
+                if (!has_rate)
+                {
+                    continue;
+                }
+                value = abs(rate);
+                break;
+
+            case ALERT_RULE_DIFFERENTIAL:
+                value = abs((int32_t) core_centi - surface_centi);
+                break;
+
+            default:
+                continue;
+        }
+
+        if (rule_step(p_rule, &m_states[i], value))
+        {
+            changed |= (1 << i);
+        }
+    }
+
+    m_has_sample = true;
+    m_last_core  = core_centi;
+    m_last_time  = time;
+
+    p_report->active  = alert_active_get();
+    p_report->changed = changed;
+    p_report->seq     = seq;
+    p_report->core    = core_centi;
+    p_report->surface = surface_centi;
+
+    if (changed != 0)
+    {
+        TLOG_WARNING("Alert on sample %u: active 0x%x, changed 0x%x", seq, p_report->active, changed);
+    }
+    return (changed != 0);
+}
+
+
+/**
+ * @brief Function for getting the rules that are firing
+ *
+ * @return      Bit n set if the rule in slot n is firing
+ */
+uint8_t alert_active_get(void)
+{
+    uint8_t active = 0;
+
+    for (uint8_t i = 0; i < ALERT_RULE_COUNT; i++)
+    {
+        if (m_states[i].active && (m_rules[i].type != ALERT_RULE_OFF))
+        {
+            active |= (1 << i);
+        }
+    }
+    return active;
+}
+
+
+/**
+ * @brief Function for encoding the alert report
+ *
+ * @param[in]  p_report             Report to encode
+ * @param[out] p_data               Buffer of ALERT_REPORT_SIZE bytes
+ *
+ * @return      Number of bytes encoded
+ */
+uint8_t alert_report_encode(alert_report_t const* p_report, uint8_t* p_data)
+{
+    uint8_t length = 0;
+
+    p_data[length++] = p_report->active;
+    p_data[length++] = p_report->changed;
+    length += uint32_encode(p_report->seq, &p_data[length]);
+    length += uint16_encode((uint16_t) p_report->core, &p_data[length]);
+    length += uint16_encode((uint16_t) p_report->surface, &p_data[length]);
+
+    return length;
+}
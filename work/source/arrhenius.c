@@ -0,0 +1,98 @@
+#include "arrhenius.h"
+
+#define EXP2_TABLE_BITS     6                                       ///< 64 segments
+#define EXP2_FRAC_BITS      (ARRHENIUS_FACTOR_SHIFT - EXP2_TABLE_BITS)  ///< Fraction bits interpolated in a segment
+#define EXP2_TABLE_SHIFT    30                                      ///< Table entries are Q30
+
+/** 2^(i/64) in Q30, i = 0..64 */
+static const uint32_t m_exp2_table[(1 << EXP2_TABLE_BITS) + 1] =
+{
+    0x40000000, 0x40B268FA, 0x4166C34C, 0x421D1462, 0x42D561B4, 0x438FB0CB,
+    0x444C0740, 0x450A6ABB, 0x45CAE0F2, 0x468D6FAE, 0x47521CC6, 0x4818EE22,
+    0x48E1E9BA, 0x49AD1598, 0x4A7A77D4, 0x4B4A169C, 0x4C1BF829, 0x4CF022CA,
+    0x4DC69CDD, 0x4E9F6CD4, 0x4F7A9930, 0x50582888, 0x51382182, 0x521A8AD7,
+    0x52FF6B55, 0x53E6C9DA, 0x54D0AD5A, 0x55BD1CDB, 0x56AC1F75, 0x579DBC57,
+    0x5891FAC1, 0x5988E209, 0x5A82799A, 0x5B7EC8F2, 0x5C7DD7A4, 0x5D7FAD59,
+    0x5E8451D0, 0x5F8BCCDB, 0x60962665, 0x61A3666D, 0x62B39509, 0x63C6BA64,
+    0x64DCDEC3, 0x65F60A7F, 0x6712460B, 0x683199ED, 0x69540EC9, 0x6A79AD56,
+    0x6BA27E65, 0x6CCE8AE1, 0x6DFDDBCC, 0x6F307A41, 0x70666F76, 0x719FC4B9,
+    0x72DC8374, 0x741CB528, 0x75606374, 0x76A7980F, 0x77F25CCE, 0x7940BB9E,
+    0x7A92BE8B, 0x7BE86FBA, 0x7D41D96E, 0x7E9F0606, 0x80000000
+};
+
+
+/**
+ * @brief Function for computing the constants of an activation energy
+ *
+ * @param[out] p_arrhenius              Constants
+ * @param[in]  activation_energy        Activation energy [J/mol]
+ * @param[in]  reference                Reference temperature [0.01 °C]
+ */
+void arrhenius_init(arrhenius_t* p_arrhenius, uint32_t activation_energy, int16_t reference)
+{
+    // Q32 x J/mol >> 16, rounded: E/R x log2(e) in Q16
+    p_arrhenius->slope     = (int64_t) (((uint64_t) activation_energy * ARRHENIUS_LOG2E_OVER_R_Q32 + (1u << 15)) >> 16);
+    p_arrhenius->reference = (int32_t) reference + ARRHENIUS_ZERO_CELSIUS;
+}
+
+
+/**
+ * @brief Function for computing 2^(y / 65536)
+ *
+ * @param[in] y                         Exponent in Q16
+ *
+ * @return      Power in Q16, ARRHENIUS_FACTOR_MAX if it does not fit
+ */
+uint32_t arrhenius_exp2(int32_t y)
+{
+    int32_t  const integer  = y >> ARRHENIUS_FACTOR_SHIFT;         // Floor, also for negative exponents
+    uint32_t const fraction = (uint32_t) y & ((1u << ARRHENIUS_FACTOR_SHIFT) - 1);
+    uint32_t const index    = fraction >> EXP2_FRAC_BITS;
+    uint32_t const offset   = fraction & ((1u << EXP2_FRAC_BITS) - 1);
+
+    if (integer >= 32 - ARRHENIUS_FACTOR_SHIFT)
+    {
+        return ARRHENIUS_FACTOR_MAX;
+    }
+
+    // Linear interpolation, the mantissa stays below 2^31
+    uint32_t const low      = m_exp2_table[index];
+    uint32_t const mantissa = low + (uint32_t) (((uint64_t) (m_exp2_table[index + 1] - low) * offset) >> EXP2_FRAC_BITS);
+
+    int32_t const shift = EXP2_TABLE_SHIFT - ARRHENIUS_FACTOR_SHIFT - integer;
+    if (shift <= 0)
+    {
+        return mantissa << -shift;
+    }
+    if (shift >= 32)
+    {
+        return 0;
+    }
+    return (mantissa + (1u << (shift - 1))) >> shift;
+}
+
+
+/**
+ * @brief Function for computing the age conversion factor at a temperature
+ *
+ * @param[in] p_arrhenius               Constants of the activation energy
+ * @param[in] temperature               Temperature [0.01 °C]
+ *
+ * @return      exp(E/R x (1/T_r - 1/T)) in Q16
+ */
+uint32_t arrhenius_factor(arrhenius_t const* p_arrhenius, int16_t temperature)
+{
+    int32_t const kelvin = (int32_t) temperature + ARRHENIUS_ZERO_CELSIUS;
+    if (kelvin <= 0)
+    {
+        return 0;
+    }
+
+    int64_t const denominator = (int64_t) kelvin * p_arrhenius->reference;
+
+    // E/R x (1/T_r - 1/T) x log2(e) = slope x (T - T_r) / (T x T_r), temperatures in 0.01 K
+    int64_t numerator = p_arrhenius->slope * 100 * (kelvin - p_arrhenius->reference);
+    numerator += (numerator >= 0) ? (denominator / 2) : -(denominator / 2);
+
+    return arrhenius_exp2((int32_t) (numerator / denominator));
+}
@@ -1,79 +1,367 @@
-
-#include "battery_voltage.h"
-#include "nrf_drv_saadc.h"
-#include "sdk_macros.h"
-#include "app_error.h"
-
-#include "nrf_log.h"
-#include "nrf_log_ctrl.h"
-#include "nrf_log_default_backends.h"
-
-#define ADC_REF_VOLTAGE_IN_MILLIVOLTS  600      //!< Internal reference voltage (in milli volts) used by ADC while doing conversion.
-#define DIODE_FWD_VOLT_DROP_MILLIVOLTS 50       //!< Typical forward voltage drop of the diode that is connected in series with the voltage supply.
-#define ADC_RES_10BIT                  1024     //!< Maximum digital value for 10-bit ADC conversion.
-#define ADC_PRE_SCALING_COMPENSATION   6        //!< The ADC is configured to use VDD with 1/3 prescaling as input. And hence the result of conversion is to be multiplied by 3 to get the actual value of the battery voltage.
-#define ADC_RESULT_IN_MILLI_VOLTS(ADC_VALUE) \
-    ((((ADC_VALUE) *ADC_REF_VOLTAGE_IN_MILLIVOLTS) / ADC_RES_10BIT) * ADC_PRE_SCALING_COMPENSATION)
-
-
-static nrf_saadc_value_t adc_buf;                   //!< Buffer used for storing ADC value.
-static uint16_t          m_batt_lvl_in_milli_volts; //!< Current battery level.
-
-
-/**@brief Function handling events from 'nrf_drv_saadc.c'.
- *
- * @param[in] p_evt SAADC event.
- */
-static void saadc_event_handler(nrf_drv_saadc_evt_t const * p_evt)
-{
-    if (p_evt->type == NRF_DRV_SAADC_EVT_DONE)
-    {
-        nrf_saadc_value_t adc_result;
-
-        adc_result = p_evt->data.done.p_buffer[0];
-
-        m_batt_lvl_in_milli_volts = ADC_RESULT_IN_MILLI_VOLTS(adc_result) + DIODE_FWD_VOLT_DROP_MILLIVOLTS;        
-        NRF_LOG_INFO("ADC reading - ADC:%d,  In Millivolts: %d\r\n", adc_result, m_batt_lvl_in_milli_volts);
-    }
-}
-
-
-/**@brief Function for initializing the battery voltage module.
- */
-void battery_voltage_init(void)
-{
-    ret_code_t err_code = nrf_drv_saadc_init(NULL, saadc_event_handler);
-
-    APP_ERROR_CHECK(err_code);
-
-    nrf_saadc_channel_config_t config =
-        NRF_DRV_SAADC_DEFAULT_CHANNEL_CONFIG_SE(NRF_SAADC_INPUT_VDD);
-    err_code = nrf_drv_saadc_channel_init(0, &config);
-    APP_ERROR_CHECK(err_code);
-
-    err_code = nrf_drv_saadc_buffer_convert(&adc_buf, 1);
-    APP_ERROR_CHECK(err_code);
-
-    err_code = nrf_drv_saadc_sample();
-    APP_ERROR_CHECK(err_code);
-}
-
-
-/**@brief Function for reading the battery voltage.
- *
- * @param[out]   p_vbatt       Pointer to the battery voltage value.
- */
-void battery_voltage_get(uint16_t * p_vbatt)
-{
-    VERIFY_PARAM_NOT_NULL_VOID(p_vbatt);
-
-    *p_vbatt = m_batt_lvl_in_milli_volts;
-    if (!nrf_drv_saadc_is_busy())
-    {
-        ret_code_t err_code = nrf_drv_saadc_buffer_convert(&adc_buf, 1);
-        APP_ERROR_CHECK(err_code);
-
-        err_code = nrf_drv_saadc_sample();
-        APP_ERROR_CHECK(err_code);
-    }
-}
+
+#include "battery_voltage.h"
+#include "nrf_drv_saadc.h"
+#include "sdk_macros.h"
+#include "app_error.h"
+#include "app_timer.h"
+#include "app_util_platform.h"
+#include "energy.h"
+#include "tlog.h"
+
+#include "nrf_log.h"
+#include "nrf_log_ctrl.h"
+#include "nrf_log_default_backends.h"
+
+#define ADC_REF_VOLTAGE_IN_MILLIVOLTS  600      //!< Internal reference voltage (in milli volts) used by ADC while doing conversion.
+#define DIODE_FWD_VOLT_DROP_MILLIVOLTS 50       //!< Typical forward voltage drop of the diode that is connected in series with the voltage supply.
+#define ADC_RES_14BIT                  16384    //!< Maximum digital value for 14-bit ADC conversion.
+#define ADC_PRE_SCALING_COMPENSATION   6        //!< The ADC is configured to use VDD with 1/6 gain as input. And hence the result of conversion is to be multiplied by 6 to get the actual value of the battery voltage.
+#define ADC_RESULT_IN_MILLI_VOLTS(ADC_VALUE) \
+    (((ADC_VALUE) * ADC_REF_VOLTAGE_IN_MILLIVOLTS * ADC_PRE_SCALING_COMPENSATION) / ADC_RES_14BIT)
+
+
+APP_TIMER_DEF(m_measurement_timer_id);              //!< Timer for the scheduled measurements.
+APP_TIMER_DEF(m_sag_timer_id);                      //!< Timer placing the loaded measurement in the radio event.
+
+static battery_voltage_handler_t m_handler = NULL;
+
+static nrf_saadc_value_t          adc_buf;                          //!< Buffer used for storing ADC value.
+static battery_measurement_t      m_measurement;                    //!< Type of the running conversion.
+static volatile nrf_saadc_value_t m_adc_result[2];                  //!< Last result of every measurement type.
+static volatile bool              m_adc_pending[2];                 //!< Result not processed yet, per measurement type.
+static volatile bool              m_sag_armed = false;              //!< Measure during the next radio event.
+static uint32_t                   m_measurements = 0;               //!< Number of scheduled measurements since init.
+
+static uint16_t          m_batt_lvl_in_milli_volts; //!< Current battery level.
+static uint16_t          m_sag_in_milli_volts;      //!< Last battery level under radio load, 0 if none.
+
+static battery_trend_t   m_trend[BATTERY_TREND_SIZE];               //!< Trend of the battery voltage, oldest first from m_trend_head.
+static uint8_t           m_trend_head = 0;                          //!< Index of the oldest trend entry.
+static uint8_t           m_trend_count = 0;                         //!< Number of trend entries.
+static uint32_t          m_period_sum = 0;                          //!< Sum of the idle measurements of the running trend period.
+static uint16_t          m_period_count = 0;                        //!< Number of idle measurements in the running trend period.
+static uint16_t          m_period_sag = 0;                          //!< Lowest loaded measurement of the running trend period.
+static uint32_t          m_hours_left = BATTERY_HOURS_UNKNOWN;      //!< Predicted time until the cut-off voltage.
+
+
+/**@brief Function for starting a conversion.
+ *
+ * @param[in]   measurement     Type of the measurement.
+ *
+ * @return  True if the conversion started, false if the SAADC is busy.
+ */
+static bool measurement_start(battery_measurement_t measurement)
+{
+    if (nrf_drv_saadc_is_busy())
+    {
+        return false;
+    }
+
+    ret_code_t err_code = nrf_drv_saadc_buffer_convert(&adc_buf, 1);
+    APP_ERROR_CHECK(err_code);
+
+    m_measurement = measurement;
+
+    // With burst enabled, one sample task runs all the oversampled conversions
+    energy_start(ENERGY_SAADC);
+    err_code = nrf_drv_saadc_sample();
+    APP_ERROR_CHECK(err_code);
+
+    return true;
+}
+
+
+/**@brief Function handling events from 'nrf_drv_saadc.c'.
+ *
+ * @param[in] p_evt SAADC event.
+ */
+static void saadc_event_handler(nrf_drv_saadc_evt_t const * p_evt)
+{
+    if (p_evt->type == NRF_DRV_SAADC_EVT_DONE)
+    {
+        energy_stop(ENERGY_SAADC);
+
+        m_adc_result[m_measurement]  = p_evt->data.done.p_buffer[0];
+        m_adc_pending[m_measurement] = true;
+
+        if ((m_measurement == BATTERY_MEASUREMENT_IDLE) && BATTERY_SAG_ENABLED)
+        {
+            m_sag_armed = true;
+        }
+
+        if (m_handler != NULL)
+        {
+            m_handler();
+        }
+    }
+    else if (p_evt->type == NRF_DRV_SAADC_EVT_CALIBRATEDONE)
+    {
+        energy_stop(ENERGY_SAADC);
+        UNUSED_RETURN_VALUE(measurement_start(BATTERY_MEASUREMENT_IDLE));
+    }
+}
+
+
+/**@brief Timeout handler for the scheduled measurements.
+ */
+static void measurement_timer_handler(void * p_context)
+{
+    UNUSED_PARAMETER(p_context);
+
+    if (nrf_drv_saadc_is_busy())
+    {
+        return;
+    }
+
+    // The offset drifts with temperature, calibrate regularly before measuring
+    if ((m_measurements++ % BATTERY_CALIBRATION_INTERVAL) == 0)
+    {
+        energy_start(ENERGY_SAADC);
+        ret_code_t err_code = nrf_drv_saadc_calibrate_offset();
+        APP_ERROR_CHECK(err_code);
+    }
+    else
+    {
+        UNUSED_RETURN_VALUE(measurement_start(BATTERY_MEASUREMENT_IDLE));
+    }
+}
+
+
+/**@brief Timeout handler for the measurement under radio load.
+ */
+static void sag_timer_handler(void * p_context)
+{
+    UNUSED_PARAMETER(p_context);
+
+    if (!measurement_start(BATTERY_MEASUREMENT_SAG))
+    {
+        // Try again on the next radio event
+        m_sag_armed = true;
+    }
+}
+
+
+/**@brief Function for converting an ADC result to the battery voltage.
+ */
+static uint16_t adc_to_milli_volts(nrf_saadc_value_t adc_result)
+{
+    // The offset can make a result slightly negative
+    adc_result = (adc_result < 0) ? 0 : adc_result;
+    return ADC_RESULT_IN_MILLI_VOLTS((uint32_t) adc_result) + DIODE_FWD_VOLT_DROP_MILLIVOLTS;
+}
+
+
+/**@brief Function for predicting the time until the cut-off voltage from the trend.
+ *
+ * @details Least squares fit of the trend entries, the latest voltage runs down at the slope
+ *          of the fit.
+ */
+static void prediction_update(void)
+{
+    int64_t n = m_trend_count;
+    int64_t sum_x = 0, sum_y = 0, sum_xy = 0, sum_xx = 0;
+
+    m_hours_left = BATTERY_HOURS_UNKNOWN;
+
+    if (m_trend_count < BATTERY_TREND_MIN_ENTRIES)
+    {
+        return;
+    }
+
+    for (int64_t x = 0; x < n; x++)
+    {
+        int64_t y = m_trend[(m_trend_head + x) % BATTERY_TREND_SIZE].voltage;
+
+        sum_x  += x;
+        sum_y  += y;
+        sum_xy += x * y;
+        sum_xx += x * x;
+    }
+
+    // Slope of the fit [mV per trend entry] is numerator / denominator
+    int64_t numerator   = (n * sum_xy) - (sum_x * sum_y);
+    int64_t denominator = (n * sum_xx) - (sum_x * sum_x);
+    int64_t latest      = m_trend[(m_trend_head + n - 1) % BATTERY_TREND_SIZE].voltage;
+
+    if (latest <= BATTERY_CUTOFF_VOLTAGE)
+    {
+        m_hours_left = 0;
+    }
+    else if (numerator < 0)
+    {
+        int64_t period_ms = (int64_t) BATTERY_TREND_PERIOD * BATTERY_MEASUREMENT_INTERVAL;
+        int64_t hours     = ((latest - BATTERY_CUTOFF_VOLTAGE) * denominator * period_ms) / (-numerator * 3600000);
+
+        m_hours_left = (uint32_t) MIN(hours, (int64_t) BATTERY_HOURS_UNKNOWN - 1);
+    }
+}
+
+
+/**@brief Function for closing the running trend period.
+ */
+static void trend_add(void)
+{
+    battery_trend_t entry;
+
+    entry.voltage = (uint16_t) (m_period_sum / m_period_count);
+    entry.sag     = m_period_sag;
+
+    if (m_trend_count < BATTERY_TREND_SIZE)
+    {
+        m_trend[(m_trend_head + m_trend_count) % BATTERY_TREND_SIZE] = entry;
+        m_trend_count++;
+    }
+    else
+    {
+        m_trend[m_trend_head] = entry;
+        m_trend_head = (m_trend_head + 1) % BATTERY_TREND_SIZE;
+    }
+
+    m_period_sum   = 0;
+    m_period_count = 0;
+    m_period_sag   = 0;
+
+    prediction_update();
+
+    TLOG_INFO("Battery trend: %d mV, %d mV under load, %d hours left", entry.voltage, entry.sag,
+              (m_hours_left == BATTERY_HOURS_UNKNOWN) ? -1 : (int32_t) m_hours_left);
+}
+
+
+/**@brief Function for initializing the battery voltage module.
+ *
+ * @param[in]   handler     Handler called when a measurement is ready.
+ */
+void battery_voltage_init(battery_voltage_handler_t handler)
+{
+    nrf_drv_saadc_config_t saadc_config = NRF_DRV_SAADC_DEFAULT_CONFIG;
+
+    m_handler = handler;
+
+    // 14 bit, averaged in hardware over 16 conversions
+    saadc_config.resolution     = NRF_SAADC_RESOLUTION_14BIT;
+    saadc_config.oversample     = NRF_SAADC_OVERSAMPLE_16X;
+    saadc_config.low_power_mode = true;
+
+    ret_code_t err_code = nrf_drv_saadc_init(&saadc_config, saadc_event_handler);
+    APP_ERROR_CHECK(err_code);
+
+    nrf_saadc_channel_config_t config =
+        NRF_DRV_SAADC_DEFAULT_CHANNEL_CONFIG_SE(NRF_SAADC_INPUT_VDD);
+    config.burst = NRF_SAADC_BURST_ENABLED;
+    err_code = nrf_drv_saadc_channel_init(0, &config);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = app_timer_create(&m_measurement_timer_id, APP_TIMER_MODE_REPEATED, measurement_timer_handler);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = app_timer_create(&m_sag_timer_id, APP_TIMER_MODE_SINGLE_SHOT, sag_timer_handler);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = app_timer_start(m_measurement_timer_id, APP_TIMER_TICKS(BATTERY_MEASUREMENT_INTERVAL), NULL);
+    APP_ERROR_CHECK(err_code);
+
+    // First measurement right away, after a calibration
+    measurement_timer_handler(NULL);
+}
+
+
+/**@brief Function for processing the last measurement in the main loop.
+ */
+void battery_voltage_process(void)
+{
+    nrf_saadc_value_t adc_result;
+    bool sag_pending, idle_pending;
+
+    CRITICAL_REGION_ENTER();
+    sag_pending  = m_adc_pending[BATTERY_MEASUREMENT_SAG];
+    idle_pending = m_adc_pending[BATTERY_MEASUREMENT_IDLE];
+    m_adc_pending[BATTERY_MEASUREMENT_SAG]  = false;
+    m_adc_pending[BATTERY_MEASUREMENT_IDLE] = false;
+    CRITICAL_REGION_EXIT();
+
+    if (sag_pending)
+    {
+        adc_result = m_adc_result[BATTERY_MEASUREMENT_SAG];
+        m_sag_in_milli_volts = adc_to_milli_volts(adc_result);
+
+        if ((m_period_sag == 0) || (m_sag_in_milli_volts < m_period_sag))
+        {
+            m_period_sag = m_sag_in_milli_volts;
+        }
+        TLOG_INFO("ADC reading under radio load - ADC:%d,  In Millivolts: %d", adc_result, m_sag_in_milli_volts);
+    }
+
+    if (idle_pending)
+    {
+        adc_result = m_adc_result[BATTERY_MEASUREMENT_IDLE];
+        m_batt_lvl_in_milli_volts = adc_to_milli_volts(adc_result);
+
+        m_period_sum += m_batt_lvl_in_milli_volts;
+        m_period_count++;
+        TLOG_INFO("ADC reading - ADC:%d,  In Millivolts: %d", adc_result, m_batt_lvl_in_milli_volts);
+
+        if (m_period_count >= BATTERY_TREND_PERIOD)
+        {
+            trend_add();
+        }
+    }
+}
+
+
+/**@brief Function for passing the radio notification to the battery module.
+ *
+ * @param[in]   radio_active    Boolean indicating if the radio is about to start or has stopped.
+ */
+void battery_voltage_on_radio(bool radio_active)
+{
+    if (radio_active && m_sag_armed)
+    {
+        m_sag_armed = false;
+
+        ret_code_t err_code = app_timer_start(m_sag_timer_id, APP_TIMER_TICKS(BATTERY_SAG_DELAY), NULL);
+        APP_ERROR_CHECK(err_code);
+    }
+}
+
+
+/**@brief Function for reading the battery voltage.
+ *
+ * @param[out]   p_vbatt       Pointer to the battery voltage value.
+ */
+void battery_voltage_get(uint16_t * p_vbatt)
+{
+    VERIFY_PARAM_NOT_NULL_VOID(p_vbatt);
+
+    *p_vbatt = m_batt_lvl_in_milli_volts;
+}
+
+
+/**@brief Function for getting the predicted time until the cut-off voltage.
+ *
+ * @return  Hours left at the current discharge rate, BATTERY_HOURS_UNKNOWN if unknown.
+ */
+uint32_t battery_voltage_hours_left(void)
+{
+    return m_hours_left;
+}
+
+
+/**@brief Function for checking if the battery is about to die.
+ *
+ * @return  True if the data should be offloaded now.
+ */
+bool battery_voltage_is_low(void)
+{
+    if (m_hours_left < BATTERY_OFFLOAD_MARGIN)
+    {
+        return true;
+    }
+
+    if ((m_sag_in_milli_volts != 0) && (m_sag_in_milli_volts < BATTERY_CUTOFF_VOLTAGE + BATTERY_SAG_HEADROOM))
+    {
+        return true;
+    }
+
+    return (m_batt_lvl_in_milli_volts != 0) && (m_batt_lvl_in_milli_volts < BATTERY_CUTOFF_VOLTAGE + BATTERY_SAG_HEADROOM);
+}
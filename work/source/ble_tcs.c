@@ -1,69 +1,101 @@
-
 #include <string.h>
+#include <stdlib.h>
 #include "boards.h"
 #include "sdk_common.h"
 #include "app_error.h"
 #include "nrf_gpio.h"
+#include "app_timer.h"
 #include "nrf_log.h"
 #include "ble_srv_common.h"
 #include "ble_tcs.h"
+#include "tcs_frame.h"
+#include "profiler.h"
+#include "tlog.h"
 
 
-#define TC_MAX_PACKET_LENGTH  20
-
-static volatile bool m_nrf_error_resources = false;
-volatile uint32_t m_tc_data_size = 0;
-volatile uint32_t m_tc_data_pos = 0;
-uint8_t* m_tc_data;
-
 static volatile bool m_tcs_activated_flag = false;
 static volatile uint32_t m_tcs_timer_interval = 0;
+static volatile uint8_t m_tcs_channels = TC_CHANNELS;
+
+
+/**@brief Function for getting the transfer state of a link.
+ *
+ * @param[in]   p_tcs           Thermocouple Service structure.
+ * @param[in]   conn_handle     Connection handle to look up, BLE_CONN_HANDLE_INVALID for a free slot.
+ *
+ * @return      Transfer state of the link, NULL if not found.
+ */
+static ble_tcs_link_t* link_get(ble_tcs_t* p_tcs, uint16_t conn_handle)
+{
+    for (uint8_t i = 0; i < BLE_TCS_LINK_COUNT; i++)
+    {
+        if (p_tcs->links[i].conn_handle == conn_handle)
+        {
+            return &p_tcs->links[i];
+        }
+    }
+    return NULL;
+}
+
+
+/**@brief Function for resetting the transfer state of a link.
+ *
+ * @param[in]   p_link          Transfer state of the link.
+ * @param[in]   conn_handle     Connection handle the slot is assigned to.
+ */
+static void link_reset(ble_tcs_link_t* p_link, uint16_t conn_handle)
+{
+    memset(p_link, 0, sizeof(ble_tcs_link_t));
+
+    p_link->conn_handle         = conn_handle;
+    p_link->max_packet_length   = BLE_TCS_MIN_PACKET_LENGTH;
+}
+
 
 /**@brief Function for updating the Thermocouple value per packet.
  *
  * @details The application calls this function when the thermocouple value should be updated.
- *          A packet of max 20 bytes will be send to the client.
+ *          A packet of max (ATT MTU - 3) bytes will be send to the client.
  *       
- * @param[in]   p_tcs               Thermocouple Service structure.
+ * @param[in]   p_link              Transfer state of the link to send on.
+ * @param[in]   value_handle        Handle of the characteristic to notify.
  * @param[in]   p_tc_packet         Packet to be send. 
  * @param[in]   tc_packet_length    Length of the packet.
  *
  * @return      NRF_SUCCESS on success, otherwise an error code.
  */
-static ret_code_t ble_tcs_send_packet(ble_tcs_t* p_tcs, uint8_t* p_tc_packet, uint16_t tc_packet_length)
+static ret_code_t ble_tcs_send_packet(ble_tcs_link_t* p_link, uint16_t value_handle, uint8_t* p_tc_packet, uint16_t tc_packet_length)
 {
     ret_code_t err_code;
     ble_gatts_hvx_params_t hvx_params;
 
-    if (m_nrf_error_resources)
+    if (p_link->nrf_error_resources || (p_link->hvn_in_flight >= BLE_TCS_HVN_TX_QUEUE_SIZE))
     {
         return NRF_ERROR_RESOURCES;
     }
 
-    VERIFY_PARAM_NOT_NULL(p_tcs);
-
-    if (p_tcs->conn_handle == BLE_CONN_HANDLE_INVALID)
-    {
-        return NRF_ERROR_INVALID_STATE;
-    }
-
-    if (tc_packet_length > TC_MAX_PACKET_LENGTH)
+    if (tc_packet_length > p_link->max_packet_length)
     {
         return NRF_ERROR_INVALID_PARAM;
     }
 
     memset(&hvx_params, 0, sizeof(hvx_params));
 
-    hvx_params.handle   = p_tcs->char_handles.value_handle;
+    hvx_params.handle   = value_handle;
     hvx_params.type     = BLE_GATT_HVX_NOTIFICATION;
     hvx_params.offset   = 0;
     hvx_params.p_len    = &tc_packet_length;
     hvx_params.p_data   = p_tc_packet;
 
-    err_code = sd_ble_gatts_hvx(p_tcs->conn_handle, &hvx_params);
-    if (err_code == NRF_ERROR_RESOURCES)
+    err_code = sd_ble_gatts_hvx(p_link->conn_handle, &hvx_params);
+    if (err_code == NRF_SUCCESS)
+    {
+        p_link->hvn_in_flight++;
+    }
+    else if (err_code == NRF_ERROR_RESOURCES)
     {
-        m_nrf_error_resources = true;
+        // The queue is shared with other notifying services, wait for the next TX complete
+        p_link->nrf_error_resources = true;
     }
 
     return err_code;
@@ -73,35 +105,42 @@ static ret_code_t ble_tcs_send_packet(ble_tcs_t* p_tcs, uint8_t* p_tc_packet, ui
 /**@brief Function for pushing the Thermocouple data.
  *
  * @details The application calls this function when the thermcouple value should be updated.
- *          The data will be split in packets of 20 bytes and send to the client.
+ *          The data will be split in packets of (ATT MTU - 3) bytes and send to the client. The
+ *          SoftDevice queue of the link is kept filled up to BLE_TCS_HVN_TX_QUEUE_SIZE packets, so
+ *          every connection event can carry as many packets as the event length allows.
  *       
  * @param[in]   p_tcs           Thermocouple Service structure.
+ * @param[in]   p_link          Transfer state of the link.
  * 
  * @return      NRF_SUCCESS on success, otherwise an error code.
  */
-static ret_code_t push_data_packets(ble_tcs_t* p_tcs)
+static ret_code_t push_data_packets(ble_tcs_t* p_tcs, ble_tcs_link_t* p_link)
 {
+    PROFILER_SCOPE(PROFILER_PROBE_PUSH_DATA_PACKETS);
+
     ret_code_t err_code = NRF_SUCCESS;
-    uint32_t packet_length = TC_MAX_PACKET_LENGTH;
+    uint8_t packet[BLE_TCS_MAX_PACKET_LENGTH];
     uint32_t packet_size = 0;
 
     while(err_code == NRF_SUCCESS)
     {
-        if ((m_tc_data_size - m_tc_data_pos) >= packet_length)
-        {
-            packet_size = packet_length;
-        }
-        else if ((m_tc_data_size - m_tc_data_pos) >= 0)
-        {
-            packet_size = (m_tc_data_size - m_tc_data_pos);
-        }
+        packet_size = MIN(p_link->data_size - p_link->data_pos, p_link->max_packet_length);
 
         if (packet_size > 0)
         {
-            err_code = ble_tcs_send_packet(p_tcs, &m_tc_data[m_tc_data_pos], packet_size);
+            packet_size = p_tcs->read_handler(p_link->conn_handle, p_link->data_pos, packet, packet_size);
+            if (packet_size == 0)
+            {
+                NRF_LOG_ERROR("Data source ended at %d of %d bytes", p_link->data_pos, p_link->data_size);
+                p_link->data_size = 0;
+                p_link->data_pos = 0;
+                return NRF_ERROR_INVALID_DATA;
+            }
+
+            err_code = ble_tcs_send_packet(p_link, p_tcs->char_handles.value_handle, packet, packet_size);
             if (err_code == NRF_SUCCESS)
             {
-                m_tc_data_pos += packet_size;
+                p_link->data_pos += packet_size;
             }
             else
             {
@@ -111,9 +150,23 @@ static ret_code_t push_data_packets(ble_tcs_t* p_tcs)
         }
         else
         {
-            NRF_LOG_INFO("Data send successful\r\n")
-            m_tc_data_size = 0;
-            m_tc_data_pos = 0;
+            uint32_t elapsed_ms = ((uint64_t) app_timer_cnt_diff_compute(app_timer_cnt_get(), p_link->start_ticks) * 1000) / APP_TIMER_CLOCK_FREQ;
+            TLOG_INFO("Data send successful on 0x%04x, %d bytes in %d ms (%d B/s)", p_link->conn_handle, p_link->data_size, elapsed_ms,
+                      (elapsed_ms > 0) ? (p_link->data_size * 1000) / elapsed_ms : 0);
+            TLOG_INFO("Notifications: %d in %d connection events, %d.%01d per event (max %d)", p_link->hvn_tx_packets, p_link->hvn_tx_events,
+                      (p_link->hvn_tx_events > 0) ? p_link->hvn_tx_packets / p_link->hvn_tx_events : 0,
+                      (p_link->hvn_tx_events > 0) ? ((p_link->hvn_tx_packets * 10) / p_link->hvn_tx_events) % 10 : 0,
+                      p_link->hvn_tx_max);
+            p_link->data_size = 0;
+            p_link->data_pos = 0;
+
+            if (p_tcs->evt_handler != NULL)
+            {
+                ble_tcs_evt_t evt;
+                evt.evt_type    = BLE_TCS_EVT_TRANSFER_COMPLETE;
+                evt.conn_handle = p_link->conn_handle;
+                p_tcs->evt_handler(p_tcs, &evt);
+            }
             break;
         }
     }
@@ -124,35 +177,272 @@ static ret_code_t push_data_packets(ble_tcs_t* p_tcs)
 /**@brief Function for updating the thermocouple value.
  *
  * @details The application calls this function when the thermcouple value should be updated. If
- *          notification has been enabled, the thermocouple value characteristic is sent to the client.
+ *          notification has been enabled, the thermocouple data stream of the link is pulled
+ *          through the read handler and sent to the client. Every link has its own cursor.
  *       
  * @param[in]   p_tcs           Thermocouple Service structure.
- * @param[in]   p_tc_data       Thermocouple data to send.
- * @param[in]   tc_data_length  Thermocouple data length.
+ * @param[in]   conn_handle     Connection to send the stream on.
+ * @param[in]   tc_data_length  Thermocouple data stream length.
  *
  * @return      NRF_SUCCESS on success, otherwise an error code.
  */
-ret_code_t ble_tcs_thermocouple_level_update(ble_tcs_t* p_tcs, uint8_t* p_tc_data, uint16_t tc_data_length)
+ret_code_t ble_tcs_thermocouple_level_update(ble_tcs_t* p_tcs, uint16_t conn_handle, uint32_t tc_data_length)
 {   
     ret_code_t err_code;
+    ble_tcs_link_t* p_link;
 
     VERIFY_PARAM_NOT_NULL(p_tcs);
-    VERIFY_PARAM_NOT_NULL(p_tc_data);
+    VERIFY_PARAM_NOT_NULL(p_tcs->read_handler);
+
+    if (conn_handle == BLE_CONN_HANDLE_INVALID)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
 
-    if (p_tcs->conn_handle == BLE_CONN_HANDLE_INVALID)
+    p_link = link_get(p_tcs, conn_handle);
+    if (p_link == NULL)
     {
         return NRF_ERROR_INVALID_STATE;
     }
 
-    m_tc_data_size = tc_data_length;
-    m_tc_data = p_tc_data;
+    p_link->data_size = tc_data_length;
+    p_link->data_pos = 0;
+    p_link->start_ticks = app_timer_cnt_get();
 
-    err_code = push_data_packets(p_tcs);
+    p_link->hvn_tx_events = 0;
+    p_link->hvn_tx_packets = 0;
+    p_link->hvn_tx_max = 0;
+
+    err_code = push_data_packets(p_tcs, p_link);
     if (err_code == NRF_ERROR_RESOURCES) return NRF_SUCCESS;
     return err_code;
 }
 
 
+/**@brief Function for publishing a live sample.
+ *
+ * @details The live characteristic value is always updated, so it can be read. The sample is
+ *          notified on every link that enabled notification. Live samples share the notification
+ *          queue with a running dump, a sample that does not fit is only readable.
+ *
+ * @param[in]   p_tcs       Thermocouple Service structure.
+ * @param[in]   p_sample    Sample to publish.
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+ret_code_t ble_tcs_live_sample_send(ble_tcs_t* p_tcs, ble_tcs_live_sample_t const* p_sample)
+{
+    ret_code_t err_code;
+    uint8_t packet[BLE_TCS_LIVE_SAMPLE_SIZE];
+    ble_gatts_value_t gatts_value;
+
+    VERIFY_PARAM_NOT_NULL(p_tcs);
+    VERIFY_PARAM_NOT_NULL(p_sample);
+
+    UNUSED_RETURN_VALUE(uint32_encode(p_sample->seq, &packet[0]));
+    memcpy(&packet[4], &p_sample->temperature, sizeof(float));
+    packet[8] = p_sample->flags;
+
+    memset(&gatts_value, 0, sizeof(gatts_value));
+
+    gatts_value.len     = sizeof(packet);
+    gatts_value.offset  = 0;
+    gatts_value.p_value = packet;
+
+    err_code = sd_ble_gatts_value_set(BLE_CONN_HANDLE_INVALID, p_tcs->live_handles.value_handle, &gatts_value);
+    VERIFY_SUCCESS(err_code);
+
+    for (uint8_t i = 0; i < BLE_TCS_LINK_COUNT; i++)
+    {
+        ble_tcs_link_t* p_link = &p_tcs->links[i];
+
+        if ((p_link->conn_handle == BLE_CONN_HANDLE_INVALID) || !p_link->is_live_notification_enabled)
+        {
+            continue;
+        }
+
+        // A full queue on one link must not keep the sample from the others
+        err_code = ble_tcs_send_packet(p_link, p_tcs->live_handles.value_handle, packet, sizeof(packet));
+        if ((err_code != NRF_SUCCESS) && (err_code != NRF_ERROR_RESOURCES))
+        {
+            return err_code;
+        }
+    }
+
+    return NRF_SUCCESS;
+}
+
+
+/**@brief Function for setting the value of a report characteristic.
+ *
+ * @param[in]   handle      Value handle of the characteristic.
+ * @param[in]   p_data      Encoded report.
+ * @param[in]   length      Length of the report.
+ * @param[in]   max_length  Maximum length of the characteristic.
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+static ret_code_t report_value_set(uint16_t handle, uint8_t const* p_data, uint16_t length, uint16_t max_length)
+{
+    ble_gatts_value_t gatts_value;
+
+    VERIFY_PARAM_NOT_NULL(p_data);
+
+    if (length > max_length)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+
+    memset(&gatts_value, 0, sizeof(gatts_value));
+
+    gatts_value.len     = length;
+    gatts_value.offset  = 0;
+    gatts_value.p_value = (uint8_t*) p_data;
+
+    return sd_ble_gatts_value_set(BLE_CONN_HANDLE_INVALID, handle, &gatts_value);
+}
+
+
+/**@brief Function for publishing an alert report.
+ *
+ * @param[in]   p_tcs       Thermocouple Service structure.
+ * @param[in]   p_data      Encoded report.
+ * @param[in]   length      Length of the report, at most BLE_TCS_ALERT_MAX_SIZE.
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+ret_code_t ble_tcs_alert_send(ble_tcs_t* p_tcs, uint8_t const* p_data, uint16_t length)
+{
+    ret_code_t err_code;
+
+    VERIFY_PARAM_NOT_NULL(p_tcs);
+
+    err_code = report_value_set(p_tcs->alert_handles.value_handle, p_data, length, BLE_TCS_ALERT_MAX_SIZE);
+    VERIFY_SUCCESS(err_code);
+
+    for (uint8_t i = 0; i < BLE_TCS_LINK_COUNT; i++)
+    {
+        ble_tcs_link_t* p_link = &p_tcs->links[i];
+
+        if ((p_link->conn_handle == BLE_CONN_HANDLE_INVALID) || !p_link->is_alert_notification_enabled)
+        {
+            continue;
+        }
+
+        // The value stays readable when the queue of a link is full
+        err_code = ble_tcs_send_packet(p_link, p_tcs->alert_handles.value_handle, (uint8_t*) p_data, length);
+        if ((err_code != NRF_SUCCESS) && (err_code != NRF_ERROR_RESOURCES))
+        {
+            return err_code;
+        }
+    }
+
+    return NRF_SUCCESS;
+}
+
+
+/**@brief Function for setting the energy report.
+ *
+ * @param[in]   p_tcs       Thermocouple Service structure.
+ * @param[in]   p_data      Encoded report.
+ * @param[in]   length      Length of the report, at most BLE_TCS_ENERGY_MAX_SIZE.
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+ret_code_t ble_tcs_energy_set(ble_tcs_t* p_tcs, uint8_t const* p_data, uint16_t length)
+{
+    VERIFY_PARAM_NOT_NULL(p_tcs);
+
+    return report_value_set(p_tcs->energy_handles.value_handle, p_data, length, BLE_TCS_ENERGY_MAX_SIZE);
+}
+
+
+/**@brief Function for setting the maturity report.
+ *
+ * @param[in]   p_tcs       Thermocouple Service structure.
+ * @param[in]   p_data      Encoded report.
+ * @param[in]   length      Length of the report, at most BLE_TCS_MATURITY_MAX_SIZE.
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+ret_code_t ble_tcs_maturity_set(ble_tcs_t* p_tcs, uint8_t const* p_data, uint16_t length)
+{
+    VERIFY_PARAM_NOT_NULL(p_tcs);
+
+    return report_value_set(p_tcs->maturity_handles.value_handle, p_data, length, BLE_TCS_MATURITY_MAX_SIZE);
+}
+
+
+/**@brief Function for setting the strength report.
+ *
+ * @param[in]   p_tcs       Thermocouple Service structure.
+ * @param[in]   p_data      Encoded report.
+ * @param[in]   length      Length of the report, at most BLE_TCS_STRENGTH_MAX_SIZE.
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+ret_code_t ble_tcs_strength_set(ble_tcs_t* p_tcs, uint8_t const* p_data, uint16_t length)
+{
+    VERIFY_PARAM_NOT_NULL(p_tcs);
+
+    return report_value_set(p_tcs->strength_handles.value_handle, p_data, length, BLE_TCS_STRENGTH_MAX_SIZE);
+}
+
+
+/**@brief Function for setting the answer to the last statistics query.
+ *
+ * @param[in]   p_tcs       Thermocouple Service structure.
+ * @param[in]   p_data      Encoded answer.
+ * @param[in]   length      Length of the answer, at most BLE_TCS_STATS_MAX_SIZE.
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+ret_code_t ble_tcs_stats_set(ble_tcs_t* p_tcs, uint8_t const* p_data, uint16_t length)
+{
+    VERIFY_PARAM_NOT_NULL(p_tcs);
+
+    return report_value_set(p_tcs->stats_handles.value_handle, p_data, length, BLE_TCS_STATS_MAX_SIZE);
+}
+
+
+#if PROFILER_ENABLED
+/**@brief Function for setting the report of the probe of the last profiler query.
+ *
+ * @param[in]   p_tcs       Thermocouple Service structure.
+ * @param[in]   p_data      Encoded report.
+ * @param[in]   length      Length of the report, at most BLE_TCS_PROFILE_MAX_SIZE.
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+ret_code_t ble_tcs_profile_set(ble_tcs_t* p_tcs, uint8_t const* p_data, uint16_t length)
+{
+    VERIFY_PARAM_NOT_NULL(p_tcs);
+
+    return report_value_set(p_tcs->profile_handles.value_handle, p_data, length, BLE_TCS_PROFILE_MAX_SIZE);
+}
+#endif
+
+
+/**@brief Function for handling events from the GATT library.
+ *
+ * @param[in]   p_tcs       Thermocouple Service structure.
+ * @param[in]   p_gatt_evt  Event received from the GATT library.
+ */
+void ble_tcs_on_gatt_evt(ble_tcs_t* p_tcs, nrf_ble_gatt_evt_t const* p_gatt_evt)
+{
+    if ((p_tcs == NULL) || (p_gatt_evt == NULL) || (p_gatt_evt->evt_id != NRF_BLE_GATT_EVT_ATT_MTU_UPDATED))
+    {
+        return;
+    }
+
+    ble_tcs_link_t* p_link = link_get(p_tcs, p_gatt_evt->conn_handle);
+    if (p_link != NULL)
+    {
+        p_link->max_packet_length = MIN(p_gatt_evt->params.att_mtu_effective - 3, BLE_TCS_MAX_PACKET_LENGTH);
+    }
+}
+
+
 /**@brief Function for handling the Connect event.
  *
  * @param[in]   p_tcs       Thermocouple Service structure.
@@ -160,10 +450,19 @@ ret_code_t ble_tcs_thermocouple_level_update(ble_tcs_t* p_tcs, uint8_t* p_tc_dat
  */
 static void on_connect(ble_tcs_t* p_tcs, ble_evt_t const* p_ble_evt)
 {
-    p_tcs->conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
+    uint16_t conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
+
+    ble_tcs_link_t* p_link = link_get(p_tcs, BLE_CONN_HANDLE_INVALID);
+    if (p_link == NULL)
+    {
+        NRF_LOG_ERROR("No TC Service link slot for 0x%04x", conn_handle);
+        return;
+    }
+    link_reset(p_link, conn_handle);
 
     ble_tcs_evt_t evt;
-    evt.evt_type = BLE_TCS_EVT_CONNECTED;
+    evt.evt_type    = BLE_TCS_EVT_CONNECTED;
+    evt.conn_handle = conn_handle;
     p_tcs->evt_handler(p_tcs, &evt);
 }
 
@@ -175,11 +474,20 @@ static void on_connect(ble_tcs_t* p_tcs, ble_evt_t const* p_ble_evt)
  */
 static void on_disconnect(ble_tcs_t* p_tcs, ble_evt_t const* p_ble_evt)
 {
-    UNUSED_PARAMETER(p_ble_evt);
-    p_tcs->conn_handle = BLE_CONN_HANDLE_INVALID;
+    uint16_t conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
+
+    ble_tcs_link_t* p_link = link_get(p_tcs, conn_handle);
+    if (p_link == NULL)
+    {
+        return;
+    }
+
+    // Abandon a running transfer, the queued notifications are dropped by the SoftDevice
+    link_reset(p_link, BLE_CONN_HANDLE_INVALID);
 
     ble_tcs_evt_t evt;
-    evt.evt_type = BLE_TCS_EVT_DISCONNECTED;
+    evt.evt_type    = BLE_TCS_EVT_DISCONNECTED;
+    evt.conn_handle = conn_handle;
     p_tcs->evt_handler(p_tcs, &evt);
 }
 
@@ -187,9 +495,10 @@ static void on_disconnect(ble_tcs_t* p_tcs, ble_evt_t const* p_ble_evt)
 /**@brief Function for handling write events to the TC characteristic.
  *
  * @param[in]   p_tcs           Thermocouple Service structure.
+ * @param[in]   conn_handle     Connection the write was received on.
  * @param[in]   p_evt_write     Write event received from the BLE stack.
  */
-static void on_tc_cccd_write(ble_tcs_t* p_tcs, ble_gatts_evt_write_t const* p_evt_write)
+static void on_tc_cccd_write(ble_tcs_t* p_tcs, uint16_t conn_handle, ble_gatts_evt_write_t const* p_evt_write)
 {
     if (p_evt_write->len == 2)
     {
@@ -205,6 +514,8 @@ static void on_tc_cccd_write(ble_tcs_t* p_tcs, ble_gatts_evt_write_t const* p_ev
             {
                 evt.evt_type = BLE_TCS_EVT_NOTIFICATION_DISABLED;
             }
+            evt.conn_handle = conn_handle;
+
             // Call the application event handler.
             p_tcs->evt_handler(p_tcs, &evt);
         }
@@ -212,6 +523,90 @@ static void on_tc_cccd_write(ble_tcs_t* p_tcs, ble_gatts_evt_write_t const* p_ev
 }
 
 
+/**@brief Function for handling write events to the live sample CCCD.
+ *
+ * @param[in]   p_tcs           Thermocouple Service structure.
+ * @param[in]   conn_handle     Connection the write was received on.
+ * @param[in]   p_evt_write     Write event received from the BLE stack.
+ */
+static void on_live_cccd_write(ble_tcs_t* p_tcs, uint16_t conn_handle, ble_gatts_evt_write_t const* p_evt_write)
+{
+    ble_tcs_link_t* p_link = link_get(p_tcs, conn_handle);
+
+    if ((p_evt_write->len == 2) && (p_link != NULL))
+    {
+        p_link->is_live_notification_enabled = ble_srv_is_notification_enabled(p_evt_write->data);
+
+        if (p_tcs->evt_handler != NULL)
+        {
+            ble_tcs_evt_t evt;
+            evt.evt_type    = p_link->is_live_notification_enabled ? BLE_TCS_EVT_LIVE_NOTIFICATION_ENABLED
+                                                                   : BLE_TCS_EVT_LIVE_NOTIFICATION_DISABLED;
+            evt.conn_handle = conn_handle;
+            p_tcs->evt_handler(p_tcs, &evt);
+        }
+    }
+}
+
+
+/**@brief Function for handling write events to the alert CCCD.
+ *
+ * @param[in]   p_tcs           Thermocouple Service structure.
+ * @param[in]   conn_handle     Connection the write was received on.
+ * @param[in]   p_evt_write     Write event received from the BLE stack.
+ */
+static void on_alert_cccd_write(ble_tcs_t* p_tcs, uint16_t conn_handle, ble_gatts_evt_write_t const* p_evt_write)
+{
+    ble_tcs_link_t* p_link = link_get(p_tcs, conn_handle);
+
+    if ((p_evt_write->len == 2) && (p_link != NULL))
+    {
+        p_link->is_alert_notification_enabled = ble_srv_is_notification_enabled(p_evt_write->data);
+    }
+}
+
+
+/**@brief Function for parsing the numbers of a command, separated by commas.
+ *
+ * @details newlib-nano (nano.specs) has no float conversion in sscanf, %f never matches on the
+ *          sensor. strtof() does not depend on it.
+ *
+ * @param[in]   p_string        Text after the '=' of the command.
+ * @param[out]  p_values        Parsed numbers.
+ * @param[in]   count           Number of numbers the command holds.
+ *
+ * @return      True if the text is exactly count numbers.
+ */
+static bool values_parse(char const* p_string, float* p_values, uint8_t count)
+{
+    for (uint8_t i = 0; i < count; i++)
+    {
+        char* p_end;
+
+        p_values[i] = strtof(p_string, &p_end);
+        if (p_end == p_string)
+        {
+            return false;
+        }
+
+        p_string = p_end;
+        if ((i + 1 < count) && (*p_string++ != ','))
+        {
+            return false;
+        }
+    }
+    return (*p_string == '\0');
+}
+
+
+/**@brief Function for checking that a parsed number is a whole number from 0 to 255.
+ */
+static bool value_is_byte(float value)
+{
+    return (value >= 0.0f) && (value <= UINT8_MAX) && (value == (float) (uint8_t) value);
+}
+
+
 /**@brief Function for handling the Write event.
  *
  * @param[in]   p_tcs           Thermocouple Service structure.
@@ -220,6 +615,7 @@ static void on_tc_cccd_write(ble_tcs_t* p_tcs, ble_gatts_evt_write_t const* p_ev
 static void on_write(ble_tcs_t* p_tcs, ble_evt_t const* p_ble_evt)
 {
     ble_gatts_evt_write_t const* p_evt_write = &p_ble_evt->evt.gatts_evt.params.write;
+    uint16_t conn_handle = p_ble_evt->evt.gatts_evt.conn_handle;
 
     if (p_evt_write->handle == p_tcs->char_handles.value_handle)
     {
@@ -229,24 +625,228 @@ static void on_write(ble_tcs_t* p_tcs, ble_evt_t const* p_ble_evt)
         }
         receivedString[p_evt_write->len] = '\0';
 
+        bool activation_write = false;
+
         if (strcmp(receivedString, "Activate") == 0)
         {
             m_tcs_activated_flag = true;
+            activation_write     = true;
+        }
+
+        if ((strcmp(receivedString, "L2capDump") == 0) && (p_tcs->evt_handler != NULL))
+        {
+            ble_tcs_evt_t evt;
+            evt.evt_type    = BLE_TCS_EVT_L2CAP_DUMP_REQUEST;
+            evt.conn_handle = conn_handle;
+            p_tcs->evt_handler(p_tcs, &evt);
+        }
+
+        if ((strcmp(receivedString, "EnergyReset") == 0) && (p_tcs->evt_handler != NULL))
+        {
+            ble_tcs_evt_t evt;
+            evt.evt_type    = BLE_TCS_EVT_ENERGY_RESET;
+            evt.conn_handle = conn_handle;
+            p_tcs->evt_handler(p_tcs, &evt);
+        }
+
+        if ((strcmp(receivedString, "MaturityReset") == 0) && (p_tcs->evt_handler != NULL))
+        {
+            ble_tcs_evt_t evt;
+            evt.evt_type    = BLE_TCS_EVT_MATURITY_RESET;
+            evt.conn_handle = conn_handle;
+            p_tcs->evt_handler(p_tcs, &evt);
+        }
+
+        if ((strncmp(receivedString, "Datum=", 6) == 0) && (p_tcs->evt_handler != NULL))
+        {
+            float datum;
+            if (values_parse(&receivedString[6], &datum, 1))
+            {
+                ble_tcs_evt_t evt;
+                evt.evt_type    = BLE_TCS_EVT_MATURITY_DATUM_WRITE;
+                evt.conn_handle = conn_handle;
+                evt.params.datum = datum;
+                p_tcs->evt_handler(p_tcs, &evt);
+            }
+        }
+
+        if ((strncmp(receivedString, "ActivationEnergy=", 17) == 0) && (p_tcs->evt_handler != NULL))
+        {
+            float activation_energy;
+            if (values_parse(&receivedString[17], &activation_energy, 1) && (activation_energy > 0.0f) && (activation_energy < 1000.0f))
+            {
+                ble_tcs_evt_t evt;
+                evt.evt_type    = BLE_TCS_EVT_MATURITY_ACTIVATION_WRITE;
+                evt.conn_handle = conn_handle;
+                evt.params.activation = activation_energy;
+                p_tcs->evt_handler(p_tcs, &evt);
+            }
+        }
+
+        if ((strncmp(receivedString, "Curve=", 6) == 0) && (p_tcs->evt_handler != NULL))
+        {
+            // point, maturity, strength
+            float values[3];
+
+            if (values_parse(&receivedString[6], values, 3) && value_is_byte(values[0]) &&
+                (values[1] >= 0.0f) && (values[1] < 1.0e6f) && (values[2] >= 0.0f) && (values[2] < 600.0f))
+            {
+                ble_tcs_evt_t evt;
+                evt.evt_type    = BLE_TCS_EVT_CURVE_POINT_WRITE;
+                evt.conn_handle = conn_handle;
+                evt.params.curve_point.point    = (uint8_t) values[0];
+                evt.params.curve_point.maturity = values[1];
+                evt.params.curve_point.strength = values[2];
+                p_tcs->evt_handler(p_tcs, &evt);
+            }
+        }
+
+        if ((strncmp(receivedString, "CurveSave=", 10) == 0) && (p_tcs->evt_handler != NULL))
+        {
+            unsigned int points;
+
+            if ((sscanf(&receivedString[10], "%u", &points) == 1) && (points <= UINT8_MAX))
+            {
+                ble_tcs_evt_t evt;
+                evt.evt_type    = BLE_TCS_EVT_CURVE_SAVE;
+                evt.conn_handle = conn_handle;
+                evt.params.curve_points = (uint8_t) points;
+                p_tcs->evt_handler(p_tcs, &evt);
+            }
+        }
+
+        if ((strncmp(receivedString, "Target=", 7) == 0) && (p_tcs->evt_handler != NULL))
+        {
+            float target;
+            if (values_parse(&receivedString[7], &target, 1) && (target >= 0.0f) && (target < 600.0f))
+            {
+                ble_tcs_evt_t evt;
+                evt.evt_type    = BLE_TCS_EVT_TARGET_STRENGTH_WRITE;
+                evt.conn_handle = conn_handle;
+                evt.params.target = target;
+                p_tcs->evt_handler(p_tcs, &evt);
+            }
+        }
+
+#if PROFILER_ENABLED
+        if ((strncmp(receivedString, "Profile=", 8) == 0) && (p_tcs->evt_handler != NULL))
+        {
+            unsigned int probe;
+            if ((sscanf(&receivedString[8], "%u", &probe) == 1) && (probe <= UINT8_MAX))
+            {
+                ble_tcs_evt_t evt;
+                evt.evt_type    = BLE_TCS_EVT_PROFILE_QUERY;
+                evt.conn_handle = conn_handle;
+                evt.params.probe = (uint8_t) probe;
+                p_tcs->evt_handler(p_tcs, &evt);
+            }
+        }
+
+        if ((strcmp(receivedString, "ProfileReset") == 0) && (p_tcs->evt_handler != NULL))
+        {
+            ble_tcs_evt_t evt;
+            evt.evt_type    = BLE_TCS_EVT_PROFILE_RESET;
+            evt.conn_handle = conn_handle;
+            p_tcs->evt_handler(p_tcs, &evt);
+        }
+#endif
+
+        if ((strncmp(receivedString, "Alert=", 6) == 0) && (p_tcs->evt_handler != NULL))
+        {
+            // slot, type, threshold, hysteresis, debounce
+            float values[5];
+
+            if (values_parse(&receivedString[6], values, 5) &&
+                value_is_byte(values[0]) && value_is_byte(values[1]) && value_is_byte(values[4]))
+            {
+                ble_tcs_evt_t evt;
+                evt.evt_type    = BLE_TCS_EVT_ALERT_RULE_WRITE;
+                evt.conn_handle = conn_handle;
+                evt.params.alert_rule.slot       = (uint8_t) values[0];
+                evt.params.alert_rule.type       = (uint8_t) values[1];
+                evt.params.alert_rule.threshold  = values[2];
+                evt.params.alert_rule.hysteresis = values[3];
+                evt.params.alert_rule.debounce   = (uint8_t) values[4];
+                p_tcs->evt_handler(p_tcs, &evt);
+            }
+        }
+
+        if (strncmp(receivedString, "Dump=", 5) == 0)
+        {
+            ble_tcs_link_t* p_link = link_get(p_tcs, conn_handle);
+            unsigned int level;
+            unsigned long first = 0;
+            unsigned long count = 0;
+            int fields = sscanf(&receivedString[5], "%u,%lu,%lu", &level, &first, &count);
+
+            // The level is checked when the dump is prepared, an unknown one sends an empty stream
+            if ((p_link != NULL) && ((fields == 1) || (fields == 3)) && (level <= UINT8_MAX))
+            {
+                p_link->request.level = (uint8_t) level;
+                p_link->request.first = first;
+                p_link->request.count = count;
+            }
+        }
+
+        if ((strncmp(receivedString, "Stats=", 6) == 0) && (p_tcs->evt_handler != NULL))
+        {
+            unsigned int first;
+            unsigned int blocks;
+            if ((sscanf(&receivedString[6], "%u,%u", &first, &blocks) == 2) && (first <= UINT16_MAX) && (blocks <= UINT16_MAX))
+            {
+                ble_tcs_evt_t evt;
+                evt.evt_type    = BLE_TCS_EVT_STATS_QUERY;
+                evt.conn_handle = conn_handle;
+                evt.params.stats_query.first  = (uint16_t) first;
+                evt.params.stats_query.blocks = (uint16_t) blocks;
+                p_tcs->evt_handler(p_tcs, &evt);
+            }
         }
         
+        if (strncmp(receivedString, "Channels=", 9) == 0)
+        {
+            unsigned int channels;
+            if ((sscanf(&receivedString[9], "%u", &channels) == 1) && (channels != 0) &&
+                ((channels & ~(TCS_CHANNEL_PROBE | TCS_CHANNEL_COLD_JUNCTION)) == 0))
+            {
+                // Taken at activation, the sample layout is fixed for a run
+                m_tcs_channels = (uint8_t) channels;
+            }
+        }
+
         if (strstr(receivedString, "TimerInterval") != NULL)
         {            
             char delim[] = "=";
             char *timer_interval = strtok(receivedString, delim);
             timer_interval = strtok(NULL, delim);
             sscanf(timer_interval, "%ld", &m_tcs_timer_interval);
+            activation_write = true;
+        }
+
+        // Only the activation commands, the other commands raise their own events
+        if (activation_write && (m_tcs_activated_flag || (m_tcs_timer_interval != 0)) && (p_tcs->evt_handler != NULL))
+        {
+            ble_tcs_evt_t evt;
+            evt.evt_type    = BLE_TCS_EVT_ACTIVATION_WRITE;
+            evt.conn_handle = conn_handle;
+            p_tcs->evt_handler(p_tcs, &evt);
         }
     }
 
     // Check if the tc value CCCD is written to.
     if (p_evt_write->handle == p_tcs->char_handles.cccd_handle)
     {
-        on_tc_cccd_write(p_tcs, p_evt_write);
+        on_tc_cccd_write(p_tcs, conn_handle, p_evt_write);
+    }
+
+    if (p_evt_write->handle == p_tcs->live_handles.cccd_handle)
+    {
+        on_live_cccd_write(p_tcs, conn_handle, p_evt_write);
+    }
+
+    if (p_evt_write->handle == p_tcs->alert_handles.cccd_handle)
+    {
+        on_alert_cccd_write(p_tcs, conn_handle, p_evt_write);
     }
 }
 
@@ -283,11 +883,26 @@ void ble_tcs_on_ble_evt(ble_evt_t const* p_ble_evt, void* p_context)
         
         case BLE_GATTS_EVT_HVN_TX_COMPLETE:
             {
-                if (m_tc_data_size > 0)
+                ble_tcs_link_t* p_link = link_get(p_tcs, p_ble_evt->evt.gatts_evt.conn_handle);
+                uint8_t count = p_ble_evt->evt.gatts_evt.params.hvn_tx_complete.count;
+
+                if (p_link == NULL)
                 {
-                    push_data_packets(p_tcs);
+                    break;
+                }
+
+                // Only the link that freed queue space is refilled, the other links keep their own pace
+                p_link->hvn_in_flight = (p_link->hvn_in_flight > count) ? (p_link->hvn_in_flight - count) : 0;
+                p_link->nrf_error_resources = false;
+
+                if (p_link->data_size > 0)
+                {
+                    p_link->hvn_tx_events++;
+                    p_link->hvn_tx_packets += count;
+                    p_link->hvn_tx_max = MAX(p_link->hvn_tx_max, count);
+
+                    push_data_packets(p_tcs, p_link);
                 }
-                m_nrf_error_resources = false;
             }
             break;
 
@@ -352,7 +967,7 @@ static ret_code_t tc_char_add(ble_tcs_t* p_tcs, const ble_tcs_init_t* p_tcs_init
 
     attr_char_value.p_uuid      = &char_uuid;
     attr_char_value.p_attr_md   = &attr_md;
-    attr_char_value.max_len     = TC_MAX_PACKET_LENGTH;
+    attr_char_value.max_len     = BLE_TCS_MAX_PACKET_LENGTH;
     attr_char_value.init_len    = sizeof(uint8_t);
     attr_char_value.init_offs   = 0;
 
@@ -367,6 +982,148 @@ static ret_code_t tc_char_add(ble_tcs_t* p_tcs, const ble_tcs_init_t* p_tcs_init
 }
 
 
+/**@brief Function for adding the live sample characteristic.
+ *
+ * @param[in]   p_tcs        TC Service structure.
+ * @param[in]   p_tcs_init   Information needed to initialize the service.
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+static ret_code_t live_char_add(ble_tcs_t* p_tcs, const ble_tcs_init_t* p_tcs_init)
+{
+    ble_gatts_char_md_t char_md;
+    ble_gatts_attr_md_t attr_md;
+    ble_gatts_attr_md_t cccd_md;
+    ble_gatts_attr_t    attr_char_value;
+    ble_uuid_t          char_uuid;
+
+    // Populate cccd_md
+    memset(&cccd_md, 0, sizeof(cccd_md));
+
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&cccd_md.read_perm);
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&cccd_md.write_perm);
+
+    cccd_md.vloc    = BLE_GATTS_VLOC_STACK;
+
+    // Populate char_md
+    memset(&char_md, 0, sizeof(char_md));
+
+    char_md.char_props.read     = 1;
+    char_md.char_props.notify   = 1;
+    char_md.p_cccd_md           = &cccd_md;
+
+    // Populate attr_md
+    memset(&attr_md, 0, sizeof(attr_md));
+
+    attr_md.read_perm   = p_tcs_init->tc_value_char_attr_md.read_perm;
+    BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS(&attr_md.write_perm);
+    attr_md.vloc        = BLE_GATTS_VLOC_STACK;
+
+    // Populate char_uuid
+    char_uuid.type = p_tcs->uuid_type;
+    char_uuid.uuid = BLE_UUID_THERMOCOUPLE_LIVE_CHAR;
+
+    // Populate attr_char_value, zeroed until the first sample
+    memset(&attr_char_value, 0, sizeof(attr_char_value));
+
+    attr_char_value.p_uuid      = &char_uuid;
+    attr_char_value.p_attr_md   = &attr_md;
+    attr_char_value.max_len     = BLE_TCS_LIVE_SAMPLE_SIZE;
+    attr_char_value.init_len    = BLE_TCS_LIVE_SAMPLE_SIZE;
+    attr_char_value.init_offs   = 0;
+
+    // Add characteristic
+    return sd_ble_gatts_characteristic_add(p_tcs->service_handle,
+                                           &char_md,
+                                           &attr_char_value,
+                                           &p_tcs->live_handles);
+}
+
+
+/**@brief Function for adding a read only report characteristic, empty until the first report.
+ *
+ * @param[in]   p_tcs        TC Service structure.
+ * @param[in]   p_tcs_init   Information needed to initialize the service.
+ * @param[in]   uuid         UUID of the characteristic.
+ * @param[in]   max_length   Maximum length of the report.
+ * @param[in]   notify       True if the report is also notified.
+ * @param[out]  p_handles    Handles of the characteristic.
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+static ret_code_t report_char_add(ble_tcs_t* p_tcs, const ble_tcs_init_t* p_tcs_init, uint16_t uuid,
+                                  uint16_t max_length, bool notify, ble_gatts_char_handles_t* p_handles)
+{
+    ble_gatts_char_md_t char_md;
+    ble_gatts_attr_md_t attr_md;
+    ble_gatts_attr_md_t cccd_md;
+    ble_gatts_attr_t    attr_char_value;
+    ble_uuid_t          char_uuid;
+
+    // Populate cccd_md
+    memset(&cccd_md, 0, sizeof(cccd_md));
+
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&cccd_md.read_perm);
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&cccd_md.write_perm);
+
+    cccd_md.vloc    = BLE_GATTS_VLOC_STACK;
+
+    // Populate char_md
+    memset(&char_md, 0, sizeof(char_md));
+
+    char_md.char_props.read     = 1;
+    char_md.char_props.notify   = notify ? 1 : 0;
+    char_md.p_cccd_md           = notify ? &cccd_md : NULL;
+
+    // Populate attr_md
+    memset(&attr_md, 0, sizeof(attr_md));
+
+    attr_md.read_perm   = p_tcs_init->tc_value_char_attr_md.read_perm;
+    BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS(&attr_md.write_perm);
+    attr_md.vloc        = BLE_GATTS_VLOC_STACK;
+    attr_md.vlen        = 1;
+
+    // Populate char_uuid
+    char_uuid.type = p_tcs->uuid_type;
+    char_uuid.uuid = uuid;
+
+    // Populate attr_char_value
+    memset(&attr_char_value, 0, sizeof(attr_char_value));
+
+    attr_char_value.p_uuid      = &char_uuid;
+    attr_char_value.p_attr_md   = &attr_md;
+    attr_char_value.max_len     = max_length;
+    attr_char_value.init_len    = 0;
+    attr_char_value.init_offs   = 0;
+
+    // Add characteristic
+    return sd_ble_gatts_characteristic_add(p_tcs->service_handle,
+                                           &char_md,
+                                           &attr_char_value,
+                                           p_handles);
+}
+
+
+/**@brief Function for setting the notification queue size in the SoftDevice.
+ *
+ * @param[in]   conn_cfg_tag    Connection configuration tag used by the application.
+ * @param[in]   ram_start       Application RAM start address.
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+ret_code_t ble_tcs_conn_cfg_set(uint8_t conn_cfg_tag, uint32_t ram_start)
+{
+    ble_cfg_t ble_cfg;
+
+    memset(&ble_cfg, 0, sizeof(ble_cfg));
+
+    ble_cfg.conn_cfg.conn_cfg_tag                           = conn_cfg_tag;
+    ble_cfg.conn_cfg.params.gatts_conn_cfg.hvn_tx_queue_size = BLE_TCS_HVN_TX_QUEUE_SIZE;
+
+    return sd_ble_cfg_set(BLE_CONN_CFG_GATTS, &ble_cfg, ram_start);
+}
+
+
 /**@brief Function for initializing the TC Service.
  *
  * @param[out]  p_tcs        TC Service structure. This structure will have to be supplied by
@@ -386,7 +1143,12 @@ ret_code_t ble_tcs_init(ble_tcs_t* p_tcs, const ble_tcs_init_t* p_tcs_init)
 
     // Initialize service structure
     p_tcs->evt_handler       = p_tcs_init->evt_handler;
-    p_tcs->conn_handle       = BLE_CONN_HANDLE_INVALID;
+    p_tcs->read_handler      = p_tcs_init->read_handler;
+
+    for (uint8_t i = 0; i < BLE_TCS_LINK_COUNT; i++)
+    {
+        link_reset(&p_tcs->links[i], BLE_CONN_HANDLE_INVALID);
+    }
 
     // Add service UUID
     ble_uuid128_t base_uuid = {BLE_UUID_THERMOCOUPLE_SERVICE_BASE};
@@ -403,7 +1165,46 @@ ret_code_t ble_tcs_init(ble_tcs_t* p_tcs, const ble_tcs_init_t* p_tcs_init)
     VERIFY_SUCCESS(err_code);
 
     // Add tc characteristic
-    return tc_char_add(p_tcs, p_tcs_init);
+    err_code = tc_char_add(p_tcs, p_tcs_init);
+    VERIFY_SUCCESS(err_code);
+
+    // Add live sample characteristic
+    err_code = live_char_add(p_tcs, p_tcs_init);
+    VERIFY_SUCCESS(err_code);
+
+    // Add energy report characteristic
+    err_code = report_char_add(p_tcs, p_tcs_init, BLE_UUID_THERMOCOUPLE_ENERGY_CHAR, BLE_TCS_ENERGY_MAX_SIZE, false,
+                               &p_tcs->energy_handles);
+    VERIFY_SUCCESS(err_code);
+
+    // Add maturity report characteristic
+    err_code = report_char_add(p_tcs, p_tcs_init, BLE_UUID_THERMOCOUPLE_MATURITY_CHAR, BLE_TCS_MATURITY_MAX_SIZE, false,
+                               &p_tcs->maturity_handles);
+    VERIFY_SUCCESS(err_code);
+
+    // Add statistics query characteristic
+    err_code = report_char_add(p_tcs, p_tcs_init, BLE_UUID_THERMOCOUPLE_STATS_CHAR, BLE_TCS_STATS_MAX_SIZE, false,
+                               &p_tcs->stats_handles);
+    VERIFY_SUCCESS(err_code);
+
+    // Add alert report characteristic
+    err_code = report_char_add(p_tcs, p_tcs_init, BLE_UUID_THERMOCOUPLE_ALERT_CHAR, BLE_TCS_ALERT_MAX_SIZE, true,
+                               &p_tcs->alert_handles);
+    VERIFY_SUCCESS(err_code);
+
+    // Add strength report characteristic
+    err_code = report_char_add(p_tcs, p_tcs_init, BLE_UUID_THERMOCOUPLE_STRENGTH_CHAR, BLE_TCS_STRENGTH_MAX_SIZE, false,
+                               &p_tcs->strength_handles);
+    VERIFY_SUCCESS(err_code);
+
+#if PROFILER_ENABLED
+    // Add profiler report characteristic
+    err_code = report_char_add(p_tcs, p_tcs_init, BLE_UUID_THERMOCOUPLE_PROFILE_CHAR, BLE_TCS_PROFILE_MAX_SIZE, false,
+                               &p_tcs->profile_handles);
+    VERIFY_SUCCESS(err_code);
+#endif
+
+    return NRF_SUCCESS;
 }
 
 
@@ -448,4 +1249,39 @@ uint32_t ble_tcs_getTimerInterval(void)
 void ble_tcs_setTimerInterval(uint32_t tcs_timer_interval)
 {
     m_tcs_timer_interval = tcs_timer_interval;
+}
+
+
+/** 
+ * @brief Function for getting the channels to store per sample
+ * 
+ * @return      Uint8_t representing the TCS_CHANNEL_* bits, TC_CHANNELS until written
+ */
+uint8_t ble_tcs_getChannels(void)
+{
+    return m_tcs_channels;
+}
+
+
+/**@brief Function for getting the part of the history a link reads.
+ *
+ * @param[in]   p_tcs       Thermocouple Service structure.
+ * @param[in]   conn_handle Connection handle of the link.
+ * @param[out]  p_request   Part of the history.
+ *
+ * @return      NRF_SUCCESS on success, NRF_ERROR_NOT_FOUND if the link is unknown.
+ */
+ret_code_t ble_tcs_stream_request_get(ble_tcs_t* p_tcs, uint16_t conn_handle, ble_tcs_stream_request_t* p_request)
+{
+    VERIFY_PARAM_NOT_NULL(p_tcs);
+    VERIFY_PARAM_NOT_NULL(p_request);
+
+    ble_tcs_link_t const* p_link = link_get(p_tcs, conn_handle);
+    if (p_link == NULL)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    *p_request = p_link->request;
+    return NRF_SUCCESS;
 }
\ No newline at end of file
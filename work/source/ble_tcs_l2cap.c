@@ -0,0 +1,416 @@
+#include <string.h>
+#include "sdk_common.h"
+#include "app_error.h"
+#include "app_timer.h"
+#include "nrf_log.h"
+#include "ble_tcs_l2cap.h"
+#include "tlog.h"
+
+
+/**@brief Function for getting the channel state of a link.
+ *
+ * @param[in]   p_tcs_l2cap     TC L2CAP transport structure.
+ * @param[in]   conn_handle     Connection handle to look up, BLE_CONN_HANDLE_INVALID for a free slot.
+ *
+ * @return      Channel state of the link, NULL if not found.
+ */
+static ble_tcs_l2cap_link_t* link_get(ble_tcs_l2cap_t* p_tcs_l2cap, uint16_t conn_handle)
+{
+    for (uint8_t i = 0; i < BLE_TCS_L2CAP_LINK_COUNT; i++)
+    {
+        if (p_tcs_l2cap->links[i].conn_handle == conn_handle)
+        {
+            return &p_tcs_l2cap->links[i];
+        }
+    }
+    return NULL;
+}
+
+
+/**@brief Function for sending the event to the application.
+ *
+ * @param[in]   p_tcs_l2cap     TC L2CAP transport structure.
+ * @param[in]   p_link          Channel state of the link the event belongs to.
+ * @param[in]   evt_type        Type of the event.
+ */
+static void send_evt(ble_tcs_l2cap_t* p_tcs_l2cap, ble_tcs_l2cap_link_t const* p_link, ble_tcs_l2cap_evt_type_t evt_type)
+{
+    if (p_tcs_l2cap->evt_handler != NULL)
+    {
+        ble_tcs_l2cap_evt_t evt;
+        evt.evt_type    = evt_type;
+        evt.conn_handle = p_link->conn_handle;
+        evt.bytes       = p_link->dump_pos;
+        evt.ticks       = app_timer_cnt_diff_compute(app_timer_cnt_get(), p_link->dump_start_ticks);
+        p_tcs_l2cap->evt_handler(p_tcs_l2cap, &evt);
+    }
+}
+
+
+/**@brief Function for resetting the transfer state of a link.
+ *
+ * @param[in]   p_link          Channel state of the link.
+ */
+static void dump_reset(ble_tcs_l2cap_link_t* p_link)
+{
+    p_link->dump_size       = 0;
+    p_link->dump_pos        = 0;
+    p_link->sdu_in_flight   = 0;
+    p_link->sdu_next        = 0;
+}
+
+
+/**@brief Function for freeing the slot of a link.
+ *
+ * @param[in]   p_link          Channel state of the link.
+ */
+static void link_free(ble_tcs_l2cap_link_t* p_link)
+{
+    p_link->conn_handle = BLE_CONN_HANDLE_INVALID;
+    p_link->local_cid   = BLE_L2CAP_CID_INVALID;
+    dump_reset(p_link);
+}
+
+
+/**@brief Function for pushing the dump stream in SDU sized chunks.
+ *
+ * @details Keeps every SDU buffer of the link queued in the SoftDevice. The SoftDevice itself
+ *          holds back K-frames until the peer has granted credits for them, so the queue only has
+ *          to be refilled when an SDU has been transmitted.
+ *
+ * @param[in]   p_tcs_l2cap     TC L2CAP transport structure.
+ * @param[in]   p_link          Channel state of the link.
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+static ret_code_t push_sdus(ble_tcs_l2cap_t* p_tcs_l2cap, ble_tcs_l2cap_link_t* p_link)
+{
+    ret_code_t err_code = NRF_SUCCESS;
+    uint16_t sdu_size = MIN(p_link->tx_mtu, BLE_TCS_L2CAP_SDU_SIZE);
+
+    while ((p_link->dump_pos < p_link->dump_size) &&
+           (p_link->sdu_in_flight < BLE_TCS_L2CAP_SDU_COUNT))
+    {
+        uint8_t* p_sdu = p_link->sdu_buf[p_link->sdu_next];
+        uint32_t length = MIN(sdu_size, p_link->dump_size - p_link->dump_pos);
+
+        length = p_tcs_l2cap->read_handler(p_link->conn_handle, p_link->dump_pos, p_sdu, length);
+        if (length == 0)
+        {
+            NRF_LOG_ERROR("L2CAP dump source ended at %d of %d bytes", p_link->dump_pos, p_link->dump_size);
+            p_link->dump_size = p_link->dump_pos;
+            break;
+        }
+
+        ble_data_t sdu = { .p_data = p_sdu, .len = (uint16_t) length };
+
+        err_code = sd_ble_l2cap_ch_tx(p_link->conn_handle, p_link->local_cid, &sdu);
+        if (err_code != NRF_SUCCESS)
+        {
+            break;
+        }
+
+        p_link->dump_pos += length;
+        p_link->sdu_in_flight++;
+        p_link->sdu_next = (p_link->sdu_next + 1) % BLE_TCS_L2CAP_SDU_COUNT;
+    }
+
+    // The dump is complete once the last SDU has left the SoftDevice queue.
+    if ((p_link->dump_size > 0) &&
+        (p_link->dump_pos >= p_link->dump_size) &&
+        (p_link->sdu_in_flight == 0))
+    {
+        send_evt(p_tcs_l2cap, p_link, BLE_TCS_L2CAP_EVT_DUMP_COMPLETE);
+        dump_reset(p_link);
+    }
+
+    return (err_code == NRF_ERROR_RESOURCES) ? NRF_SUCCESS : err_code;
+}
+
+
+/**@brief Function for handling an L2CAP channel setup request from the peer.
+ *
+ * @details Every link can hold one channel, the slot is claimed until the channel is released
+ *          or the link disconnects.
+ *
+ * @param[in]   p_tcs_l2cap     TC L2CAP transport structure.
+ * @param[in]   p_ble_evt       Event received from the BLE stack.
+ */
+static void on_ch_setup_request(ble_tcs_l2cap_t* p_tcs_l2cap, ble_evt_t const* p_ble_evt)
+{
+    ble_l2cap_evt_t const* p_l2cap_evt = &p_ble_evt->evt.l2cap_evt;
+    ble_l2cap_ch_setup_params_t params;
+    uint16_t local_cid = p_l2cap_evt->local_cid;
+    ble_tcs_l2cap_link_t* p_link = NULL;
+
+    memset(&params, 0, sizeof(params));
+
+    if (p_l2cap_evt->params.ch_setup_request.le_psm != BLE_TCS_L2CAP_PSM)
+    {
+        params.status = BLE_L2CAP_CH_STATUS_CODE_LE_PSM_NOT_SUPPORTED;
+    }
+    else if ((link_get(p_tcs_l2cap, p_l2cap_evt->conn_handle) != NULL) ||
+             ((p_link = link_get(p_tcs_l2cap, BLE_CONN_HANDLE_INVALID)) == NULL))
+    {
+        params.status = BLE_L2CAP_CH_STATUS_CODE_NO_RESOURCES;
+    }
+    else
+    {
+        link_free(p_link);
+        p_link->conn_handle             = p_l2cap_evt->conn_handle;
+
+        params.status                   = BLE_L2CAP_CH_STATUS_CODE_SUCCESS;
+        params.rx_params.rx_mtu         = BLE_TCS_L2CAP_RX_MTU;
+        params.rx_params.rx_mps         = BLE_TCS_L2CAP_RX_MPS;
+        params.rx_params.sdu_buf.p_data = p_link->rx_buf;
+        params.rx_params.sdu_buf.len    = sizeof(p_link->rx_buf);
+    }
+
+    ret_code_t err_code = sd_ble_l2cap_ch_setup(p_l2cap_evt->conn_handle, &local_cid, &params);
+    if (err_code != NRF_SUCCESS)
+    {
+        NRF_LOG_ERROR("ERROR %d: sd_ble_l2cap_ch_setup", err_code);
+        if (p_link != NULL)
+        {
+            link_free(p_link);
+        }
+    }
+}
+
+
+/**@brief Function for handling an established L2CAP channel.
+ *
+ * @param[in]   p_tcs_l2cap     TC L2CAP transport structure.
+ * @param[in]   p_ble_evt       Event received from the BLE stack.
+ */
+static void on_ch_setup(ble_tcs_l2cap_t* p_tcs_l2cap, ble_evt_t const* p_ble_evt)
+{
+    ble_l2cap_evt_t const* p_l2cap_evt = &p_ble_evt->evt.l2cap_evt;
+    ble_tcs_l2cap_link_t* p_link = link_get(p_tcs_l2cap, p_l2cap_evt->conn_handle);
+
+    if (p_link == NULL)
+    {
+        return;
+    }
+
+    p_link->local_cid   = p_l2cap_evt->local_cid;
+    p_link->tx_mtu      = p_l2cap_evt->params.ch_setup.tx_params.tx_mtu;
+    p_link->peer_mps    = p_l2cap_evt->params.ch_setup.tx_params.peer_mps;
+    dump_reset(p_link);
+
+    TLOG_INFO("L2CAP channel open on 0x%04x, SDU: %d, MPS: %d, credits: %d", p_link->conn_handle, p_link->tx_mtu,
+              p_link->peer_mps, p_l2cap_evt->params.ch_setup.tx_params.credits);
+    send_evt(p_tcs_l2cap, p_link, BLE_TCS_L2CAP_EVT_CH_OPENED);
+}
+
+
+/**@brief Function for handling a released L2CAP channel or a link that went away.
+ *
+ * @param[in]   p_tcs_l2cap     TC L2CAP transport structure.
+ * @param[in]   conn_handle     Connection the channel was open on.
+ */
+static void on_ch_released(ble_tcs_l2cap_t* p_tcs_l2cap, uint16_t conn_handle)
+{
+    ble_tcs_l2cap_link_t* p_link = link_get(p_tcs_l2cap, conn_handle);
+
+    if ((p_link == NULL) || (conn_handle == BLE_CONN_HANDLE_INVALID))
+    {
+        return;
+    }
+
+    if (p_link->local_cid != BLE_L2CAP_CID_INVALID)
+    {
+        if (p_link->dump_size > 0)
+        {
+            TLOG_INFO("L2CAP dump aborted at %d of %d bytes", p_link->dump_pos, p_link->dump_size);
+        }
+
+        dump_reset(p_link);
+        send_evt(p_tcs_l2cap, p_link, BLE_TCS_L2CAP_EVT_CH_RELEASED);
+    }
+
+    link_free(p_link);
+}
+
+
+/**@brief Function for handling the Application's BLE Stack events.
+ *
+ * @details Handles the L2CAP channel setup and flow control events of the TC L2CAP transport.
+ *
+ * @param[in]   p_ble_evt  Event received from the BLE stack.
+ * @param[in]   p_context  TC L2CAP transport structure.
+ */
+void ble_tcs_l2cap_on_ble_evt(ble_evt_t const* p_ble_evt, void* p_context)
+{
+    ble_tcs_l2cap_t* p_tcs_l2cap = (ble_tcs_l2cap_t*) p_context;
+
+    if (p_tcs_l2cap == NULL || p_ble_evt == NULL)
+    {
+        return;
+    }
+
+    switch (p_ble_evt->header.evt_id)
+    {
+        case BLE_GAP_EVT_DISCONNECTED:
+            on_ch_released(p_tcs_l2cap, p_ble_evt->evt.gap_evt.conn_handle);
+            break;
+
+        case BLE_L2CAP_EVT_CH_SETUP_REQUEST:
+            on_ch_setup_request(p_tcs_l2cap, p_ble_evt);
+            break;
+
+        case BLE_L2CAP_EVT_CH_SETUP:
+            on_ch_setup(p_tcs_l2cap, p_ble_evt);
+            break;
+
+        case BLE_L2CAP_EVT_CH_RELEASED:
+            on_ch_released(p_tcs_l2cap, p_ble_evt->evt.l2cap_evt.conn_handle);
+            break;
+
+        case BLE_L2CAP_EVT_CH_TX:
+            {
+                ble_tcs_l2cap_link_t* p_link = link_get(p_tcs_l2cap, p_ble_evt->evt.l2cap_evt.conn_handle);
+                if (p_link == NULL)
+                {
+                    break;
+                }
+
+                if (p_link->sdu_in_flight > 0)
+                {
+                    p_link->sdu_in_flight--;
+                }
+
+                ret_code_t err_code = push_sdus(p_tcs_l2cap, p_link);
+                if (err_code != NRF_SUCCESS)
+                {
+                    NRF_LOG_ERROR("ERROR %d: sd_ble_l2cap_ch_tx", err_code);
+                }
+            }
+            break;
+
+        case BLE_L2CAP_EVT_CH_RX:
+            {
+                ble_tcs_l2cap_link_t* p_link = link_get(p_tcs_l2cap, p_ble_evt->evt.l2cap_evt.conn_handle);
+                if (p_link == NULL)
+                {
+                    break;
+                }
+
+                // Control goes through GATT, hand the receive buffer straight back.
+                ble_data_t rx_buf = { .p_data = p_link->rx_buf, .len = sizeof(p_link->rx_buf) };
+                UNUSED_VARIABLE(sd_ble_l2cap_ch_rx(p_ble_evt->evt.l2cap_evt.conn_handle,
+                                                   p_ble_evt->evt.l2cap_evt.local_cid,
+                                                   &rx_buf));
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+/**@brief Function for adding the L2CAP channel configuration to the SoftDevice.
+ *
+ * @param[in]   conn_cfg_tag    Connection configuration tag used by the application.
+ * @param[in]   ram_start       Application RAM start address.
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+ret_code_t ble_tcs_l2cap_conn_cfg_set(uint8_t conn_cfg_tag, uint32_t ram_start)
+{
+    ble_cfg_t ble_cfg;
+
+    memset(&ble_cfg, 0, sizeof(ble_cfg));
+
+    ble_cfg.conn_cfg.conn_cfg_tag                       = conn_cfg_tag;
+    ble_cfg.conn_cfg.params.l2cap_conn_cfg.rx_mps       = BLE_TCS_L2CAP_RX_MPS;
+    ble_cfg.conn_cfg.params.l2cap_conn_cfg.tx_mps       = BLE_TCS_L2CAP_TX_MPS;
+    ble_cfg.conn_cfg.params.l2cap_conn_cfg.rx_queue_size = 1;
+    ble_cfg.conn_cfg.params.l2cap_conn_cfg.tx_queue_size = BLE_TCS_L2CAP_SDU_COUNT;
+    ble_cfg.conn_cfg.params.l2cap_conn_cfg.ch_count     = 1;
+
+    return sd_ble_cfg_set(BLE_CONN_CFG_L2CAP, &ble_cfg, ram_start);
+}
+
+
+/**@brief Function for initializing the TC L2CAP transport.
+ *
+ * @param[in]   p_tcs_l2cap         TC L2CAP transport structure.
+ * @param[in]   p_tcs_l2cap_init    Information needed to initialize the transport.
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+ret_code_t ble_tcs_l2cap_init(ble_tcs_l2cap_t* p_tcs_l2cap, const ble_tcs_l2cap_init_t* p_tcs_l2cap_init)
+{
+    VERIFY_PARAM_NOT_NULL(p_tcs_l2cap);
+    VERIFY_PARAM_NOT_NULL(p_tcs_l2cap_init);
+    VERIFY_PARAM_NOT_NULL(p_tcs_l2cap_init->read_handler);
+
+    p_tcs_l2cap->evt_handler    = p_tcs_l2cap_init->evt_handler;
+    p_tcs_l2cap->read_handler   = p_tcs_l2cap_init->read_handler;
+
+    for (uint8_t i = 0; i < BLE_TCS_L2CAP_LINK_COUNT; i++)
+    {
+        link_free(&p_tcs_l2cap->links[i]);
+    }
+
+    return NRF_SUCCESS;
+}
+
+
+/**@brief Function for starting a history dump over the L2CAP channel of a link.
+ *
+ * @param[in]   p_tcs_l2cap     TC L2CAP transport structure.
+ * @param[in]   conn_handle     Connection to send the dump on.
+ * @param[in]   dump_size       Total number of bytes to send.
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+ret_code_t ble_tcs_l2cap_dump_start(ble_tcs_l2cap_t* p_tcs_l2cap, uint16_t conn_handle, uint32_t dump_size)
+{
+    VERIFY_PARAM_NOT_NULL(p_tcs_l2cap);
+
+    ble_tcs_l2cap_link_t* p_link = link_get(p_tcs_l2cap, conn_handle);
+
+    if ((p_link == NULL) || (conn_handle == BLE_CONN_HANDLE_INVALID) || (p_link->local_cid == BLE_L2CAP_CID_INVALID))
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    if (p_link->dump_size > 0)
+    {
+        return NRF_ERROR_BUSY;
+    }
+
+    dump_reset(p_link);
+    p_link->dump_size           = dump_size;
+    p_link->dump_start_ticks    = app_timer_cnt_get();
+
+    return push_sdus(p_tcs_l2cap, p_link);
+}
+
+
+/**@brief Function for checking if a link has an open L2CAP channel.
+ *
+ * @param[in]   p_tcs_l2cap     TC L2CAP transport structure.
+ * @param[in]   conn_handle     Connection to check.
+ *
+ * @return      Boolean indicating the channel status
+ */
+bool ble_tcs_l2cap_is_open(ble_tcs_l2cap_t const* p_tcs_l2cap, uint16_t conn_handle)
+{
+    if ((p_tcs_l2cap == NULL) || (conn_handle == BLE_CONN_HANDLE_INVALID))
+    {
+        return false;
+    }
+
+    for (uint8_t i = 0; i < BLE_TCS_L2CAP_LINK_COUNT; i++)
+    {
+        if (p_tcs_l2cap->links[i].conn_handle == conn_handle)
+        {
+            return p_tcs_l2cap->links[i].local_cid != BLE_L2CAP_CID_INVALID;
+        }
+    }
+    return false;
+}
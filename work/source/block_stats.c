@@ -0,0 +1,217 @@
+#include <string.h>
+#include <math.h>
+#include "sdk_common.h"
+#include "app_util.h"
+#include "storage.h"
+#include "block_stats.h"
+#include "temperature.h"
+#include "tlog.h"
+
+#include "nrf_log.h"
+
+
+STATIC_ASSERT(sizeof(block_stats_t) <= (UPDATE_RECORD_WORDS * WORD));
+
+
+static block_stats_t m_closed;                      /**< Header of the last closed block, the source of its write to flash. */
+static block_stats_t m_current;                     /**< Block that is filling. */
+static uint16_t m_blocks = 0;                       /**< Number of closed blocks. */
+
+
+/**
+ * @brief Function for merging the statistics of two sets of samples (Chan et al.)
+ */
+static void stats_merge(block_stats_t* p_stats, block_stats_t const* p_other)
+{
+    if (p_other->count == 0)
+    {
+        return;
+    }
+    if (p_stats->count == 0)
+    {
+        *p_stats = *p_other;
+        return;
+    }
+
+    uint32_t const count = p_stats->count + p_other->count;
+    float const delta = p_other->mean - p_stats->mean;
+
+    p_stats->mean += delta * ((float) p_other->count / count);
+    p_stats->m2   += p_other->m2 + delta * delta * ((float) p_stats->count * p_other->count / count);
+    p_stats->min   = MIN(p_stats->min, p_other->min);
+    p_stats->max   = MAX(p_stats->max, p_other->max);
+    p_stats->count = count;
+}
+
+
+/**
+ * @brief Function for writing the header of the last closed block to flash, one record per block
+ */
+static void block_stats_log(void)
+{
+    // A block closing before the previous header is written follows once that write completes
+    ret_code_t err_code = fds_update_deferred(BLOCK_STATS_FILE_ID, BLOCK_STATS_REC_KEY + m_blocks - 1, &m_closed,
+                                              sizeof(m_closed) / WORD);
+    if (err_code != NRF_SUCCESS)
+    {
+        TLOG_WARNING("Block header %d not logged: %d", m_blocks - 1, err_code);
+    }
+}
+
+
+/**
+ * @brief Function for getting the header of a closed block
+ *
+ * @return      True if the header was found, in flash or as the last closed block
+ */
+static bool block_stats_header_get(uint32_t block, block_stats_t* p_header)
+{
+    if (block == (uint32_t) m_blocks - 1)
+    {
+        // Its write may still be in flight
+        *p_header = m_closed;
+        return true;
+    }
+    return fds_read_chunk(BLOCK_STATS_FILE_ID, BLOCK_STATS_REC_KEY + block, 0, (uint8_t*) p_header, sizeof(*p_header)) ==
+           sizeof(*p_header);
+}
+
+
+/**
+ * @brief Function for clearing the block headers in RAM and in flash, with the history of the previous run
+ */
+void block_stats_reset(void)
+{
+    memset(&m_closed, 0, sizeof(m_closed));
+    memset(&m_current, 0, sizeof(m_current));
+    m_blocks = 0;
+
+    ret_code_t err_code = fds_delete_file(BLOCK_STATS_FILE_ID);
+    if (err_code != NRF_SUCCESS)
+    {
+        TLOG_WARNING("Block headers not deleted: %d", err_code);
+    }
+}
+
+
+/**
+ * @brief Function for adding a stored sample to the block that is filling
+ *
+ * @param[in] temperature           Stored sample [°C]
+ */
+void block_stats_add(float temperature)
+{
+    if (m_current.count == 0)
+    {
+        m_current.min = temperature;
+        m_current.max = temperature;
+    }
+
+    // Welford: no sum of squares, no cancellation when the variance is small compared to the mean
+    m_current.count++;
+    float const delta = temperature - m_current.mean;
+    m_current.mean += delta / m_current.count;
+    m_current.m2   += delta * (temperature - m_current.mean);
+    m_current.min   = MIN(m_current.min, temperature);
+    m_current.max   = MAX(m_current.max, temperature);
+}
+
+
+/**
+ * @brief Function for closing the block that is filling and writing its header to flash
+ */
+void block_stats_flush(void)
+{
+    if ((m_current.count == 0) || (m_blocks >= MAX_NUMBER_OF_DAYS))
+    {
+        return;
+    }
+
+    m_closed = m_current;
+    m_blocks++;
+    memset(&m_current, 0, sizeof(m_current));
+
+    TLOG_INFO("Block %u: min %.2f°C, max %.2f°C, mean %.2f°C", m_blocks - 1, TLOG_FLOAT(m_closed.min),
+              TLOG_FLOAT(m_closed.max), TLOG_FLOAT(m_closed.mean));
+    block_stats_log();
+}
+
+
+/**
+ * @brief Function for answering a query from the block headers
+ *
+ * @param[in]  first                First block
+ * @param[in]  blocks               Number of blocks, cut at the block that is filling
+ * @param[out] p_report             Statistics over the blocks
+ *
+ * @return      NRF_SUCCESS, NRF_ERROR_INVALID_PARAM if the first block does not exist yet,
+ *              NRF_ERROR_NOT_FOUND if a header is not in flash
+ */
+ret_code_t block_stats_query(uint16_t first, uint16_t blocks, block_stats_report_t* p_report)
+{
+    block_stats_t stats = {0};
+    block_stats_t header;
+    uint32_t const last = MIN((uint32_t) first + blocks, (uint32_t) m_blocks + 1);
+
+    VERIFY_PARAM_NOT_NULL(p_report);
+
+    if (first > m_blocks)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    for (uint32_t i = first; i < MIN(last, m_blocks); i++)
+    {
+        if (!block_stats_header_get(i, &header))
+        {
+            return NRF_ERROR_NOT_FOUND;
+        }
+        stats_merge(&stats, &header);
+    }
+    if (last > m_blocks)
+    {
+        stats_merge(&stats, &m_current);
+    }
+
+    memset(p_report, 0, sizeof(*p_report));
+    p_report->first  = first;
+    p_report->blocks = (uint16_t) (last - first);
+    p_report->count  = stats.count;
+
+    if (stats.count > 0)
+    {
+        p_report->min  = centi_degrees(stats.min);
+        p_report->max  = centi_degrees(stats.max);
+        p_report->mean = centi_degrees(stats.mean);
+    }
+    if (stats.count > 1)
+    {
+        float const std_dev = sqrtf(stats.m2 / (stats.count - 1)) * 100.0f;
+        p_report->std_dev = (uint16_t) MIN(std_dev + 0.5f, UINT16_MAX);
+    }
+    return NRF_SUCCESS;
+}
+
+
+/**
+ * @brief Function for encoding the answer to a query
+ *
+ * @param[in]  p_report             Report to encode
+ * @param[out] p_data               Buffer of BLOCK_STATS_REPORT_SIZE bytes
+ *
+ * @return      Number of bytes encoded
+ */
+uint8_t block_stats_report_encode(block_stats_report_t const* p_report, uint8_t* p_data)
+{
+    uint8_t length = 0;
+
+    length += uint16_encode(p_report->first, &p_data[length]);
+    length += uint16_encode(p_report->blocks, &p_data[length]);
+    length += uint32_encode(p_report->count, &p_data[length]);
+    length += uint16_encode((uint16_t) p_report->min, &p_data[length]);
+    length += uint16_encode((uint16_t) p_report->max, &p_data[length]);
+    length += uint16_encode((uint16_t) p_report->mean, &p_data[length]);
+    length += uint16_encode(p_report->std_dev, &p_data[length]);
+
+    return length;
+}
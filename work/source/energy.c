@@ -0,0 +1,359 @@
+#include <string.h>
+#include "sdk_common.h"
+#include "app_error.h"
+#include "app_timer.h"
+#include "app_util_platform.h"
+#include "nrf.h"
+#include "storage.h"
+#include "energy.h"
+#include "tlog.h"
+
+#include "nrf_log.h"
+
+
+/**
+ * @brief Typedef Struct for holding the counters, as stored in flash
+ */
+typedef struct
+{
+    uint32_t    uptime;                                 ///< Time covered by the counters [s]
+    uint32_t    reserved;                               ///< Keeps the counters word aligned
+    uint64_t    active_us[ENERGY_SUBSYSTEM_COUNT];      ///< Active time per subsystem [us]
+} energy_counters_t;
+
+STATIC_ASSERT(sizeof(energy_counters_t) <= (UPDATE_RECORD_WORDS * WORD));
+
+
+APP_TIMER_DEF(m_tick_timer_id);     /**< Timer for the report and the flash log. */
+
+static energy_report_handler_t m_report_handler = NULL;
+
+static energy_counters_t m_counters;                            /**< Counters of the running battery. */
+
+static uint32_t m_start_ticks[ENERGY_SUBSYSTEM_COUNT];          /**< Timestamp of the first running active period. */
+static uint8_t  m_depth[ENERGY_SUBSYSTEM_COUNT];                /**< Number of running active periods. */
+static uint32_t m_residual_cycles[ENERGY_SUBSYSTEM_COUNT];      /**< Cycles not yet filling a full microsecond. */
+
+static uint32_t m_cpu_cycles = 0;                               /**< Cycle counter at the last CPU update. */
+static uint32_t m_minutes = 0;                                  /**< Number of ticks since init. */
+
+/** Current of every subsystem while active [uA] */
+static const uint16_t m_current[ENERGY_SUBSYSTEM_COUNT] =
+{
+    [ENERGY_CPU]        = ENERGY_CURRENT_CPU,
+    [ENERGY_SPI]        = ENERGY_CURRENT_SPI,
+    [ENERGY_CONVERSION] = ENERGY_CURRENT_CONVERSION,
+    [ENERGY_FLASH]      = ENERGY_CURRENT_FLASH,
+    [ENERGY_RADIO]      = ENERGY_CURRENT_RADIO,
+    [ENERGY_SAADC]      = ENERGY_CURRENT_SAADC
+};
+
+
+/**
+ * @brief Function for converting RTC ticks to microseconds
+ */
+static uint32_t ticks_to_us(uint32_t ticks)
+{
+    return (uint32_t) (((uint64_t) ticks * 1000000) / APP_TIMER_CLOCK_FREQ);
+}
+
+
+/**
+ * @brief Function for writing the counters to flash
+ */
+static void energy_log(void)
+{
+    // A reset right after the hourly log is written once the hourly one completes
+    ret_code_t err_code = fds_update_deferred(ENERGY_FILE_ID, ENERGY_REC_KEY, &m_counters, sizeof(m_counters) / WORD);
+    if (err_code != NRF_SUCCESS)
+    {
+        TLOG_WARNING("Energy counters not logged: %d", err_code);
+    }
+}
+
+
+/**
+ * @brief Timeout handler for the tick timer
+ */
+static void tick_timer_handler(void* p_context)
+{
+    UNUSED_PARAMETER(p_context);
+
+    energy_report_t report;
+
+    CRITICAL_REGION_ENTER();
+    m_counters.uptime += ENERGY_TICK / 1000;
+    CRITICAL_REGION_EXIT();
+
+    m_minutes++;
+    energy_report_get(&report);
+
+    if ((m_minutes % ENERGY_LOG_PERIOD) == 0)
+    {
+        TLOG_INFO("Energy: %u uAh in %u s, %u nA average, %u days left", report.consumed, report.uptime,
+                  report.average_current, report.remaining_days);
+        TLOG_INFO("Active ms: CPU %u, SPI %u, MAX31856 %u, flash %u, radio %u, SAADC %u",
+                  report.active_ms[ENERGY_CPU], report.active_ms[ENERGY_SPI], report.active_ms[ENERGY_CONVERSION],
+                  report.active_ms[ENERGY_FLASH], report.active_ms[ENERGY_RADIO], report.active_ms[ENERGY_SAADC]);
+        energy_log();
+    }
+
+    if (m_report_handler != NULL)
+    {
+        m_report_handler(&report);
+    }
+}
+
+
+/**
+ * @brief Function for initializing the energy accounting
+ *
+ * @details Starts the DWT cycle counter. The counters are written to flash every
+ *          ENERGY_LOG_PERIOD minutes.
+ *
+ * @param[in] report_handler        Handler for the periodic report, may be NULL
+ */
+void energy_init(energy_report_handler_t report_handler)
+{
+    ret_code_t err_code;
+
+    m_report_handler = report_handler;
+
+    // The cycle counter stops while the CPU sleeps, so it counts the awake time only
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    m_cpu_cycles = 0;
+
+    err_code = app_timer_create(&m_tick_timer_id, APP_TIMER_MODE_REPEATED, tick_timer_handler);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = app_timer_start(m_tick_timer_id, APP_TIMER_TICKS(ENERGY_TICK), NULL);
+    APP_ERROR_CHECK(err_code);
+}
+
+
+/**
+ * @brief Function for restoring the counters from flash
+ *
+ * @details Adds the counters of the previous runs, call once FDS is initialized.
+ */
+void energy_restore(void)
+{
+    energy_counters_t stored;
+
+    if (fds_read_chunk(ENERGY_FILE_ID, ENERGY_REC_KEY, 0, (uint8_t*) &stored, sizeof(stored)) != sizeof(stored))
+    {
+        NRF_LOG_INFO("No energy counters in flash\r\n");
+        return;
+    }
+
+    CRITICAL_REGION_ENTER();
+    m_counters.uptime += stored.uptime;
+    for (uint32_t i = 0; i < ENERGY_SUBSYSTEM_COUNT; i++)
+    {
+        m_counters.active_us[i] += stored.active_us[i];
+    }
+    CRITICAL_REGION_EXIT();
+
+    NRF_LOG_INFO("Energy counters restored, %d s of uptime\r\n", stored.uptime);
+}
+
+
+/**
+ * @brief Function for clearing the counters in RAM and in flash, after a battery change
+ */
+void energy_reset(void)
+{
+    CRITICAL_REGION_ENTER();
+    memset(&m_counters, 0, sizeof(m_counters));
+    CRITICAL_REGION_EXIT();
+
+    TLOG_INFO("Energy counters cleared");
+    energy_log();
+}
+
+
+/**
+ * @brief Function for marking the start of an active period of a subsystem
+ *
+ * @param[in] subsystem             Subsystem that became active
+ */
+void energy_start(energy_subsystem_t subsystem)
+{
+    CRITICAL_REGION_ENTER();
+    if (m_depth[subsystem]++ == 0)
+    {
+        m_start_ticks[subsystem] = app_timer_cnt_get();
+    }
+    CRITICAL_REGION_EXIT();
+}
+
+
+/**
+ * @brief Function for marking the end of an active period of a subsystem
+ *
+ * @param[in] subsystem             Subsystem that became idle
+ */
+void energy_stop(energy_subsystem_t subsystem)
+{
+    uint32_t elapsed_us = 0;
+
+    CRITICAL_REGION_ENTER();
+    if ((m_depth[subsystem] > 0) && (--m_depth[subsystem] == 0))
+    {
+        elapsed_us = ticks_to_us(app_timer_cnt_diff_compute(app_timer_cnt_get(), m_start_ticks[subsystem]));
+    }
+    CRITICAL_REGION_EXIT();
+
+    if (elapsed_us > 0)
+    {
+        energy_add(subsystem, elapsed_us);
+    }
+}
+
+
+/**
+ * @brief Function for adding active time measured by the caller
+ *
+ * @param[in] subsystem             Subsystem that was active
+ * @param[in] time_us               Active time [us]
+ */
+void energy_add(energy_subsystem_t subsystem, uint32_t time_us)
+{
+    CRITICAL_REGION_ENTER();
+    m_counters.active_us[subsystem] += time_us;
+    CRITICAL_REGION_EXIT();
+}
+
+
+/**
+ * @brief Function for adding active time measured with the DWT cycle counter
+ *
+ * @param[in] subsystem             Subsystem that was active
+ * @param[in] cycles                Active time [CPU cycles]
+ */
+void energy_cycles_add(energy_subsystem_t subsystem, uint32_t cycles)
+{
+    CRITICAL_REGION_ENTER();
+    uint64_t total = (uint64_t) m_residual_cycles[subsystem] + cycles;
+
+    m_counters.active_us[subsystem] += total / ENERGY_CPU_CLOCK_MHZ;
+    m_residual_cycles[subsystem]     = (uint32_t) (total % ENERGY_CPU_CLOCK_MHZ);
+    CRITICAL_REGION_EXIT();
+}
+
+
+/**
+ * @brief Function for passing the radio notification to the energy accounting
+ *
+ * @param[in] radio_active          Boolean indicating if the radio is about to start or has stopped
+ */
+void energy_on_radio(bool radio_active)
+{
+    if (radio_active)
+    {
+        m_start_ticks[ENERGY_RADIO] = app_timer_cnt_get();
+        return;
+    }
+
+    // The active signal comes ENERGY_RADIO_DISTANCE before the radio starts
+    uint32_t elapsed_us = ticks_to_us(app_timer_cnt_diff_compute(app_timer_cnt_get(), m_start_ticks[ENERGY_RADIO]));
+    if (elapsed_us > ENERGY_RADIO_DISTANCE)
+    {
+        energy_add(ENERGY_RADIO, elapsed_us - ENERGY_RADIO_DISTANCE);
+    }
+}
+
+
+/**
+ * @brief Function for reading the DWT cycle counter, it only runs while the CPU is awake
+ *
+ * @return      Cycle counter value
+ */
+uint32_t energy_cycles_get(void)
+{
+    return DWT->CYCCNT;
+}
+
+
+/**
+ * @brief Function for accounting the CPU cycles since the last call, call before going to sleep
+ *
+ * @details The counter wraps after 67 s of awake time, far more than the CPU spends between two
+ *          sleeps.
+ */
+void energy_cpu_update(void)
+{
+    uint32_t now = DWT->CYCCNT;
+
+    energy_cycles_add(ENERGY_CPU, now - m_cpu_cycles);
+    m_cpu_cycles = now;
+}
+
+
+/**
+ * @brief Function for computing the energy report
+ *
+ * @param[out] p_report             Report of the counters up to now
+ */
+void energy_report_get(energy_report_t* p_report)
+{
+    energy_counters_t counters;
+
+    CRITICAL_REGION_ENTER();
+    counters = m_counters;
+    CRITICAL_REGION_EXIT();
+
+    // uA * us = pC, the sleep current flows during the whole uptime
+    uint64_t charge_nc = (uint64_t) counters.uptime * ENERGY_CURRENT_SLEEP * 1000;
+
+    for (uint32_t i = 0; i < ENERGY_SUBSYSTEM_COUNT; i++)
+    {
+        p_report->active_ms[i] = (uint32_t) (counters.active_us[i] / 1000);
+        charge_nc += (counters.active_us[i] * m_current[i]) / 1000;
+    }
+
+    p_report->uptime            = counters.uptime;
+    p_report->consumed          = (uint32_t) (charge_nc / 3600000);
+    p_report->average_current   = (counters.uptime > 0) ? (uint32_t) (charge_nc / counters.uptime) : 0;
+    p_report->remaining_days    = 0xFFFF;
+
+    uint64_t capacity_nah = (uint64_t) ENERGY_BATTERY_CAPACITY * 1000000;
+    uint64_t consumed_nah = charge_nc / 3600;
+
+    if (consumed_nah >= capacity_nah)
+    {
+        p_report->remaining_days = 0;
+    }
+    else if (p_report->average_current > 0)
+    {
+        uint64_t days = (capacity_nah - consumed_nah) / p_report->average_current / 24;
+        p_report->remaining_days = (uint16_t) MIN(days, 0xFFFE);
+    }
+}
+
+
+/**
+ * @brief Function for encoding the energy report
+ *
+ * @param[in]  p_report             Report to encode
+ * @param[out] p_data               Buffer of ENERGY_REPORT_SIZE bytes
+ *
+ * @return      Number of bytes encoded
+ */
+uint8_t energy_report_encode(energy_report_t const* p_report, uint8_t* p_data)
+{
+    uint8_t length = 0;
+
+    length += uint32_encode(p_report->uptime, &p_data[length]);
+    for (uint32_t i = 0; i < ENERGY_SUBSYSTEM_COUNT; i++)
+    {
+        length += uint32_encode(p_report->active_ms[i], &p_data[length]);
+    }
+    length += uint32_encode(p_report->consumed, &p_data[length]);
+    length += uint32_encode(p_report->average_current, &p_data[length]);
+    length += uint16_encode(p_report->remaining_days, &p_data[length]);
+
+    return length;
+}
@@ -0,0 +1,282 @@
+#include <string.h>
+#include "sdk_common.h"
+#include "app_error.h"
+#include "app_timer.h"
+#include "nrf_sdh_ble.h"
+#include "ble_conn_params.h"
+#include "ble_conn_state.h"
+#include "link_profile.h"
+
+#include "nrf_log.h"
+
+
+/**
+ * @brief Typedef Struct for holding the profile state of a link
+ */
+typedef struct
+{
+    link_profile_t  profile;            ///< Profile requested by the application
+    bool            request_pending;    ///< Request postponed, a parameter update was in progress
+    bool            idle_pending;       ///< Link switches to the idle profile when the idle timer expires
+} link_profile_link_t;
+
+
+APP_TIMER_DEF(m_idle_timer_id);     /**< Timer switching fresh connections to the idle profile. */
+
+static link_profile_evt_handler_t m_evt_handler = NULL;
+
+static link_profile_link_t m_links[NRF_SDH_BLE_TOTAL_LINK_COUNT];     /**< Profile state, indexed by ble_conn_state_conn_idx(). */
+
+
+/**
+ * @brief Function for getting the profile state of a link
+ *
+ * @param[in] conn_handle           Connection to look up
+ *
+ * @return      Profile state of the link, NULL if the handle is not connected
+ */
+static link_profile_link_t* link_get(uint16_t conn_handle)
+{
+    uint16_t idx = ble_conn_state_conn_idx(conn_handle);
+
+    return (idx < NRF_SDH_BLE_TOTAL_LINK_COUNT) ? &m_links[idx] : NULL;
+}
+
+
+/**
+ * @brief Function for getting the connection parameters of a profile
+ *
+ * @param[in]  profile              Profile to look up
+ * @param[out] p_conn_params        Connection parameters of the profile
+ */
+static void profile_conn_params_get(link_profile_t profile, ble_gap_conn_params_t* p_conn_params)
+{
+    switch (profile)
+    {
+        case LINK_PROFILE_BULK:
+            p_conn_params->min_conn_interval = LINK_PROFILE_BULK_MIN_INTERVAL;
+            p_conn_params->max_conn_interval = LINK_PROFILE_BULK_MAX_INTERVAL;
+            p_conn_params->slave_latency     = LINK_PROFILE_BULK_SLAVE_LATENCY;
+            p_conn_params->conn_sup_timeout  = LINK_PROFILE_BULK_SUP_TIMEOUT;
+            break;
+
+        case LINK_PROFILE_IDLE:
+            p_conn_params->min_conn_interval = LINK_PROFILE_IDLE_MIN_INTERVAL;
+            p_conn_params->max_conn_interval = LINK_PROFILE_IDLE_MAX_INTERVAL;
+            p_conn_params->slave_latency     = LINK_PROFILE_IDLE_SLAVE_LATENCY;
+            p_conn_params->conn_sup_timeout  = LINK_PROFILE_IDLE_SUP_TIMEOUT;
+            break;
+
+        default:
+            APP_ERROR_CHECK(sd_ble_gap_ppcp_get(p_conn_params));
+            break;
+    }
+}
+
+
+/**
+ * @brief Function for sending an event to the application
+ *
+ * @param[in] evt_type              Type of the event
+ * @param[in] conn_handle           Connection the event belongs to
+ * @param[in] p_conn_params         Connection parameters of the event
+ */
+static void send_evt(link_profile_evt_type_t evt_type, uint16_t conn_handle, ble_gap_conn_params_t const* p_conn_params)
+{
+    link_profile_link_t* p_link = link_get(conn_handle);
+
+    if ((m_evt_handler != NULL) && (p_link != NULL))
+    {
+        link_profile_evt_t evt;
+        evt.evt_type    = evt_type;
+        evt.conn_handle = conn_handle;
+        evt.profile     = p_link->profile;
+        evt.conn_params = *p_conn_params;
+        m_evt_handler(&evt);
+    }
+}
+
+
+/**
+ * @brief Function for requesting the parameters of the current profile from the central
+ *
+ * @param[in] conn_handle           Connection to change
+ * @param[in] p_link                Profile state of the link
+ *
+ * @return      NRF_SUCCESS if successful, else error code
+ */
+static ret_code_t profile_request(uint16_t conn_handle, link_profile_link_t* p_link)
+{
+    ble_gap_conn_params_t conn_params;
+    profile_conn_params_get(p_link->profile, &conn_params);
+
+    ret_code_t err_code = ble_conn_params_change_conn_params(conn_handle, &conn_params);
+    if (err_code == NRF_ERROR_BUSY)
+    {
+        // Retried when the ongoing parameter update completes
+        p_link->request_pending = true;
+        return NRF_SUCCESS;
+    }
+
+    p_link->request_pending = false;
+    if ((err_code == NRF_ERROR_INVALID_STATE) || (err_code == BLE_ERROR_INVALID_CONN_HANDLE))
+    {
+        // The link dropped while requesting, BLE_GAP_EVT_DISCONNECTED clears its state
+        return NRF_SUCCESS;
+    }
+
+    if (err_code == NRF_SUCCESS)
+    {
+        send_evt(LINK_PROFILE_EVT_REQUESTED, conn_handle, &conn_params);
+    }
+
+    return err_code;
+}
+
+
+/**
+ * @brief Function for switching a link to the idle profile if nothing else was requested
+ *
+ * @param[in] conn_handle           Connection to change
+ * @param[in] p_context             Unused
+ */
+static void idle_switch(uint16_t conn_handle, void* p_context)
+{
+    UNUSED_PARAMETER(p_context);
+
+    link_profile_link_t* p_link = link_get(conn_handle);
+
+    if ((p_link != NULL) && p_link->idle_pending)
+    {
+        p_link->idle_pending = false;
+        if (p_link->profile == LINK_PROFILE_DEFAULT)
+        {
+            ret_code_t err_code = link_profile_set(conn_handle, LINK_PROFILE_IDLE);
+            if (err_code != NRF_ERROR_INVALID_STATE)
+            {
+                // Only a link that dropped in the meantime is left out
+                APP_ERROR_CHECK(err_code);
+            }
+        }
+    }
+}
+
+
+/**
+ * @brief Timeout handler for the idle timer
+ */
+static void idle_timer_handler(void* p_context)
+{
+    UNUSED_PARAMETER(p_context);
+
+    UNUSED_RETURN_VALUE(ble_conn_state_for_each_connected(idle_switch, NULL));
+}
+
+
+/**
+ * @brief Function for handling the BLE events of the link profile manager
+ *
+ * @param[in] p_ble_evt             Event received from the BLE stack
+ * @param[in] p_context             Unused
+ */
+static void link_profile_on_ble_evt(ble_evt_t const* p_ble_evt, void* p_context)
+{
+    UNUSED_PARAMETER(p_context);
+
+    uint16_t conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
+    link_profile_link_t* p_link = link_get(conn_handle);
+
+    if (p_link == NULL)
+    {
+        return;
+    }
+
+    switch (p_ble_evt->header.evt_id)
+    {
+        case BLE_GAP_EVT_CONNECTED:
+            p_link->profile         = LINK_PROFILE_DEFAULT;
+            p_link->request_pending = false;
+            p_link->idle_pending    = true;
+            APP_ERROR_CHECK(app_timer_stop(m_idle_timer_id));
+            APP_ERROR_CHECK(app_timer_start(m_idle_timer_id, APP_TIMER_TICKS(LINK_PROFILE_IDLE_DELAY), NULL));
+            break;
+
+        case BLE_GAP_EVT_DISCONNECTED:
+            memset(p_link, 0, sizeof(link_profile_link_t));
+            break;
+
+        case BLE_GAP_EVT_CONN_PARAM_UPDATE:
+            {
+                ble_gap_conn_params_t const* p_conn_params = &p_ble_evt->evt.gap_evt.params.conn_param_update.conn_params;
+                send_evt(LINK_PROFILE_EVT_UPDATED, conn_handle, p_conn_params);
+
+                if (p_link->request_pending)
+                {
+                    APP_ERROR_CHECK(profile_request(conn_handle, p_link));
+                }
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+NRF_SDH_BLE_OBSERVER(m_link_profile_obs, LINK_PROFILE_BLE_OBSERVER_PRIO, link_profile_on_ble_evt, NULL);
+
+
+/**
+ * @brief Function for initializing the link profile manager
+ *
+ * @param[in] evt_handler           Handler for renegotiation events, may be NULL
+ */
+void link_profile_init(link_profile_evt_handler_t evt_handler)
+{
+    m_evt_handler = evt_handler;
+    memset(m_links, 0, sizeof(m_links));
+
+    APP_ERROR_CHECK(app_timer_create(&m_idle_timer_id, APP_TIMER_MODE_SINGLE_SHOT, idle_timer_handler));
+}
+
+
+/**
+ * @brief Function for requesting a link profile on a connection
+ *
+ * @param[in] conn_handle           Connection to change
+ * @param[in] profile               Profile to switch to
+ *
+ * @return      NRF_SUCCESS if successful, already active or the link dropped while requesting,
+ *              NRF_ERROR_INVALID_STATE if the link is not connected, else error code
+ */
+ret_code_t link_profile_set(uint16_t conn_handle, link_profile_t profile)
+{
+    link_profile_link_t* p_link = link_get(conn_handle);
+
+    if ((p_link == NULL) || !ble_conn_state_valid(conn_handle))
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    if (profile == p_link->profile)
+    {
+        return NRF_SUCCESS;
+    }
+
+    p_link->profile = profile;
+    return profile_request(conn_handle, p_link);
+}
+
+
+/**
+ * @brief Function for getting the requested link profile
+ *
+ * @param[in] conn_handle           Connection to look up
+ *
+ * @return      Profile last requested on the connection
+ */
+link_profile_t link_profile_get(uint16_t conn_handle)
+{
+    link_profile_link_t* p_link = link_get(conn_handle);
+
+    return (p_link != NULL) ? p_link->profile : LINK_PROFILE_DEFAULT;
+}
@@ -0,0 +1,302 @@
+#include <math.h>
+#include <string.h>
+#include "sdk_common.h"
+#include "app_error.h"
+#include "app_util.h"
+#include "storage.h"
+#include "maturity.h"
+#include "temperature.h"
+#include "arrhenius.h"
+#include "energy.h"
+#include "tlog.h"
+
+#include "nrf_log.h"
+
+#define CENTI_SECONDS_PER_DECI_HOUR     36000       ///< 0.01 °C·s per 0.1 °C·h
+
+
+/**
+ * @brief Typedef Struct for holding the running state, as stored in flash
+ */
+typedef struct
+{
+    uint64_t    factor;                             ///< Temperature-time factor [0.01 °C·s]
+    uint64_t    equivalent_age;                     ///< Equivalent age at the reference temperature, Q16 [s]
+    uint32_t    activation_energy;                  ///< Activation energy of the equivalent age [J/mol]
+    uint32_t    age;                                ///< Curing time covered by the factor [s]
+    uint32_t    period;                             ///< Curing time since the last trend snapshot [s]
+    int16_t     datum;                              ///< Datum temperature [0.01 °C]
+    int16_t     temperature;                        ///< Last sample [0.01 °C]
+    uint16_t    samples;                            ///< Samples since the last write to flash
+    uint8_t     trend_count;                        ///< Number of trend snapshots
+    uint8_t     trend_next;                         ///< Index of the next trend snapshot
+    uint32_t    trend[MATURITY_TREND_SIZE];         ///< Factor at the last snapshots [0.1 °C·h]
+} maturity_state_t;
+
+STATIC_ASSERT(sizeof(maturity_state_t) <= (UPDATE_RECORD_WORDS * WORD));
+
+
+static maturity_state_t m_state;                    /**< Running state. */
+static bool m_has_sample = false;                   /**< A sample opened the current interval. */
+
+static arrhenius_t m_arrhenius;                     /**< Constants of the activation energy. */
+static uint32_t m_age_factor;                       /**< Age conversion factor of the last sample, Q16. */
+static uint32_t m_factor_cycles = 0;                /**< Largest cost of an age conversion factor. */
+
+
+/**
+ * @brief Function for writing the running state to flash
+ */
+static void maturity_log(void)
+{
+    // A reset or a new datum right after a sample is written once the update of the sample completes
+    ret_code_t err_code = fds_update_deferred(MATURITY_FILE_ID, MATURITY_REC_KEY, &m_state, sizeof(m_state) / WORD);
+    if (err_code != NRF_SUCCESS)
+    {
+        TLOG_WARNING("Maturity not logged: %d", err_code);
+    }
+}
+
+
+/**
+ * @brief Function for taking a trend snapshot every MATURITY_TREND_PERIOD of curing time
+ */
+static void trend_update(uint32_t interval)
+{
+    m_state.period += interval;
+
+    while (m_state.period >= MATURITY_TREND_PERIOD)
+    {
+        m_state.period -= MATURITY_TREND_PERIOD;
+
+        m_state.trend[m_state.trend_next] = (uint32_t) (m_state.factor / CENTI_SECONDS_PER_DECI_HOUR);
+        m_state.trend_next = (m_state.trend_next + 1) % MATURITY_TREND_SIZE;
+        if (m_state.trend_count < MATURITY_TREND_SIZE)
+        {
+            m_state.trend_count++;
+        }
+    }
+}
+
+
+/**
+ * @brief Function for computing the age conversion factor of a sample and its cost
+ */
+static uint32_t age_factor(int16_t temperature)
+{
+    uint32_t const start_cycles = energy_cycles_get();
+    uint32_t const factor = arrhenius_factor(&m_arrhenius, temperature);
+    uint32_t const cycles = energy_cycles_get() - start_cycles;
+
+    if (cycles > m_factor_cycles)
+    {
+        m_factor_cycles = cycles;
+    }
+    return factor;
+}
+
+
+/**
+ * @brief Function for initializing the maturity engine with the MATURITY_DATUM_TEMPERATURE datum
+ *        and the MATURITY_ACTIVATION_ENERGY activation energy
+ */
+void maturity_init(void)
+{
+    memset(&m_state, 0, sizeof(m_state));
+    m_state.datum = centi_degrees(MATURITY_DATUM_TEMPERATURE);
+    m_state.activation_energy = MATURITY_ACTIVATION_ENERGY;
+    m_has_sample = false;
+
+    arrhenius_init(&m_arrhenius, m_state.activation_energy, centi_degrees(MATURITY_REFERENCE_TEMPERATURE));
+}
+
+
+/**
+ * @brief Function for restoring the running state from flash
+ */
+void maturity_restore(void)
+{
+    maturity_state_t stored;
+
+    if (fds_read_chunk(MATURITY_FILE_ID, MATURITY_REC_KEY, 0, (uint8_t*) &stored, sizeof(stored)) != sizeof(stored))
+    {
+        NRF_LOG_INFO("No maturity in flash\r\n");
+        return;
+    }
+
+    m_state = stored;
+    m_has_sample = false;
+    arrhenius_init(&m_arrhenius, m_state.activation_energy, centi_degrees(MATURITY_REFERENCE_TEMPERATURE));
+
+    NRF_LOG_INFO("Maturity restored, %d °C·h over %d min\r\n", (uint32_t) (m_state.factor / (10 * CENTI_SECONDS_PER_DECI_HOUR)),
+                 m_state.age / 60);
+}
+
+
+/**
+ * @brief Function for clearing the running state in RAM and in flash, for a new pour
+ */
+void maturity_reset(void)
+{
+    int16_t const datum = m_state.datum;
+    uint32_t const activation_energy = m_state.activation_energy;
+
+    memset(&m_state, 0, sizeof(m_state));
+    m_state.datum = datum;
+    m_state.activation_energy = activation_energy;
+    m_has_sample = false;
+
+    TLOG_INFO("Maturity cleared");
+    maturity_log();
+}
+
+
+/**
+ * @brief Function for setting the datum temperature
+ *
+ * @param[in] datum                 Datum temperature [°C]
+ */
+ret_code_t maturity_datum_set(float datum)
+{
+    if (!isfinite(datum) || (datum < MATURITY_DATUM_MIN) || (datum > MATURITY_DATUM_MAX))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    m_state.datum = centi_degrees(datum);
+
+    TLOG_INFO("Maturity datum %.2f °C", TLOG_FLOAT(datum));
+    maturity_log();
+
+    return NRF_SUCCESS;
+}
+
+
+/**
+ * @brief Function for setting the activation energy of the equivalent age
+ *
+ * @param[in] activation_energy     Activation energy [J/mol]
+ */
+void maturity_activation_energy_set(uint32_t activation_energy)
+{
+    m_state.activation_energy = activation_energy;
+    arrhenius_init(&m_arrhenius, activation_energy, centi_degrees(MATURITY_REFERENCE_TEMPERATURE));
+
+    if (m_has_sample)
+    {
+        m_age_factor = age_factor(m_state.temperature);
+    }
+
+    TLOG_INFO("Maturity activation energy %d J/mol", activation_energy);
+    maturity_log();
+}
+
+
+/**
+ * @brief Function for getting the CPU cost of the equivalent age
+ *
+ * @return      Largest number of cycles an age conversion factor took
+ */
+uint32_t maturity_factor_cycles_get(void)
+{
+    return m_factor_cycles;
+}
+
+
+/**
+ * @brief Function for adding a stored sample
+ *
+ * @param[in] temperature           Temperature of the sample [°C]
+ * @param[in] interval              Time since the previous sample [s]
+ */
+void maturity_add(float temperature, uint32_t interval)
+{
+    int16_t const sample = centi_degrees(temperature);
+    uint32_t const factor = age_factor(sample);
+
+    if (m_has_sample)
+    {
+        // Trapezoid of the conversion factor, it is far from linear in the temperature
+        m_state.equivalent_age += (((uint64_t) m_age_factor + factor) * interval) / 2;
+
+        // Nurse-Saul with the average temperature of the interval, nothing below the datum
+        int32_t const average = ((int32_t) m_state.temperature + sample) / 2;
+        int32_t const excess  = average - m_state.datum;
+
+        if (excess > 0)
+        {
+            m_state.factor += (uint64_t) excess * interval;
+        }
+        m_state.age += interval;
+        trend_update(interval);
+    }
+
+    m_state.temperature = sample;
+    m_age_factor = factor;
+    m_has_sample = true;
+
+    if (++m_state.samples >= MATURITY_LOG_PERIOD)
+    {
+        TLOG_INFO("Maturity %u x0.1 °C·h over %u min, equivalent age %u min, factor %u cycles",
+                  (uint32_t) (m_state.factor / CENTI_SECONDS_PER_DECI_HOUR), m_state.age / 60,
+                  (uint32_t) ((m_state.equivalent_age >> ARRHENIUS_FACTOR_SHIFT) / 60), m_factor_cycles);
+        m_state.samples = 0;
+        maturity_log();
+    }
+}
+
+
+/**
+ * @brief Function for computing the maturity report
+ *
+ * @param[out] p_report             Report of the running state
+ */
+void maturity_report_get(maturity_report_t* p_report)
+{
+    uint32_t const maturity = (uint32_t) (m_state.factor / CENTI_SECONDS_PER_DECI_HOUR);
+    uint32_t rate = 0;
+
+    if (m_state.trend_count > 0)
+    {
+        // From the oldest snapshot to now, the window grows up to MATURITY_TREND_SIZE periods
+        uint8_t const oldest = (m_state.trend_count < MATURITY_TREND_SIZE) ? 0 : m_state.trend_next;
+        uint32_t const window = (m_state.trend_count - 1) * MATURITY_TREND_PERIOD + m_state.period;
+
+        if (window > 0)
+        {
+            rate = (uint32_t) (((uint64_t) (maturity - m_state.trend[oldest]) * 86400) / window);
+        }
+    }
+
+    p_report->maturity    = maturity;
+    p_report->rate        = (uint16_t) MIN(rate, UINT16_MAX);
+    p_report->age         = m_state.age / 60;
+    p_report->temperature = m_state.temperature;
+    p_report->datum       = m_state.datum;
+    p_report->equivalent_age    = (uint32_t) ((m_state.equivalent_age >> ARRHENIUS_FACTOR_SHIFT) / 60);
+    p_report->activation_energy = (uint16_t) MIN((m_state.activation_energy + 50) / 100, UINT16_MAX);
+}
+
+
+/**
+ * @brief Function for encoding the maturity report
+ *
+ * @param[in]  p_report             Report to encode
+ * @param[out] p_data               Buffer of MATURITY_REPORT_SIZE bytes
+ *
+ * @return      Number of bytes encoded
+ */
+uint8_t maturity_report_encode(maturity_report_t const* p_report, uint8_t* p_data)
+{
+    uint8_t length = 0;
+
+    length += uint32_encode(p_report->maturity, &p_data[length]);
+    length += uint16_encode(p_report->rate, &p_data[length]);
+    length += uint32_encode(p_report->age, &p_data[length]);
+    length += uint16_encode((uint16_t) p_report->temperature, &p_data[length]);
+    length += uint16_encode((uint16_t) p_report->datum, &p_data[length]);
+    length += uint32_encode(p_report->equivalent_age, &p_data[length]);
+    length += uint16_encode(p_report->activation_energy, &p_data[length]);
+
+    return length;
+}
@@ -1,49 +1,113 @@
 
 #include "max31856.h"
 #include "app_util_platform.h"
+#include "app_timer.h"
 #include "nrf_gpio.h"
-#include "nrf_delay.h"
+#include "nrf_drv_gpiote.h"
 #include "boards.h"
+#include "energy.h"
+#include "profiler.h"
+#include "tlog.h"
 
 #include "nrf_log.h"
 #include "nrf_log_ctrl.h"
 #include "nrf_log_default_backends.h"
 
+APP_TIMER_DEF(m_drdy_timer_id);         /**< Timer ending a conversion that never asserts DRDY. */
+
 /** Member to hold the SPI instance */
 static const nrf_drv_spi_t *m_spi;
 
+/** Register image written in one burst from CR0 on, the address auto-increments. In RAM for EasyDMA */
+static uint8_t m_register_image[] =
+{
+    WREGISTER_CR0, CR0, CR1, MASK, CJHF, CJLF, LTHFTH, LTHFTL, LTLFTH, LTLFTL, CJTO
+};
+
+/** Handler of the running conversion, NULL if none */
+static max31856_conversion_handler_t volatile m_conversion_handler = NULL;
+
 
 /** 
- * @brief Function to wait for DRDY pin to assert, indicating conversion is completed
+ * @brief Function to end the running conversion and call its handler
  * 
- * @return  Error code to determine the status of MAX31856 if any
+ * @details Called from the DRDY interrupt or the timeout, whichever comes first.
+ * 
+ * @param[in] status            Result of the conversion
  */
-static max31856_status max31856_waitForDRDY() 
+static void max31856_conversionEnd(max31856_status status)
 {
-    uint8_t counter = 0;
-    while (nrf_gpio_pin_read(DRDY) && counter < 50) 
+    max31856_conversion_handler_t handler;
+
+    CRITICAL_REGION_ENTER();
+    handler = m_conversion_handler;
+    m_conversion_handler = NULL;
+    CRITICAL_REGION_EXIT();
+
+    if (handler == NULL)
     {
-        nrf_delay_ms(10);
-        counter++; 
+        return;
     }
 
-    return (counter >= 50) ? MAX31856_ERROR_DRDY : MAX31856_SUCCESS;
+    nrf_drv_gpiote_in_event_disable(DRDY);
+    UNUSED_RETURN_VALUE(app_timer_stop(m_drdy_timer_id));
+    energy_stop(ENERGY_CONVERSION);
+
+    handler(status);
+}
+
+
+/** 
+ * @brief Function for handling the DRDY pin falling edge, the conversion is completed
+ */
+static void max31856_drdyHandler(nrf_drv_gpiote_pin_t pin, nrf_gpiote_polarity_t action)
+{
+    PROFILER_SCOPE(PROFILER_PROBE_DRDY);
+
+    UNUSED_PARAMETER(pin);
+    UNUSED_PARAMETER(action);
+
+    max31856_conversionEnd(MAX31856_SUCCESS);
+}
+
+
+/** 
+ * @brief Timeout handler for a conversion that did not assert DRDY
+ */
+static void max31856_drdyTimeoutHandler(void* p_context)
+{
+    UNUSED_PARAMETER(p_context);
+
+    max31856_conversionEnd(MAX31856_ERROR_DRDY);
 }
 
 
 /** 
- * @brief Function to start a conversion and determine the themocouple temperature
+ * @brief Function to set up the DRDY interrupt and timeout
  * 
  * @return  Error code to determine the status of MAX31856 if any
  */
-static max31856_status max31856_startConversion()
+static max31856_status max31856_initDRDY()
 {
-    const uint8_t oneShot = CR0 | CR0_ONESHOT;
-    const uint8_t tx_buffer[] = { WREGISTER_CR0, oneShot };
-    static uint8_t rx_buffer[sizeof(tx_buffer)];
-    
-    bool success = spi_transfer(m_spi, tx_buffer, sizeof(tx_buffer), rx_buffer, sizeof(rx_buffer));
-    return success ? max31856_waitForDRDY() : MAX31856_ERROR_SPI;
+    ret_code_t err_code;
+
+    if (!nrf_drv_gpiote_is_init())
+    {
+        err_code = nrf_drv_gpiote_init();
+        APP_ERROR_CHECK(err_code);
+    }
+
+    // Sense the port instead of a GPIOTE channel, so the interrupt costs no current while idle
+    nrf_drv_gpiote_in_config_t drdy_config = GPIOTE_CONFIG_IN_SENSE_HITOLO(false);
+    drdy_config.pull = NRF_GPIO_PIN_NOPULL;
+
+    err_code = nrf_drv_gpiote_in_init(DRDY, &drdy_config, max31856_drdyHandler);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = app_timer_create(&m_drdy_timer_id, APP_TIMER_MODE_SINGLE_SHOT, max31856_drdyTimeoutHandler);
+    APP_ERROR_CHECK(err_code);
+
+    return MAX31856_SUCCESS;
 }
 
 
@@ -54,28 +118,10 @@ static max31856_status max31856_startConversion()
  */
 static max31856_status max31856_setRegisters()
 {
-    // { Write Register, Value }
-    static uint8_t tx_buffer[][2] = 
-    { 
-        { WREGISTER_CR0,    CR0     },
-        { WREGISTER_CR1,    CR1     }, 
-        { WREGISTER_MASK,   MASK    },
-        { WREGISTER_CJHF,   CJHF    },
-        { WREGISTER_CJLF,   CJLF    },
-        { WREGISTER_LTHFTH, LTHFTH  },
-        { WREGISTER_LTHFTL, LTHFTL  },
-        { WREGISTER_LTLFTH, LTLFTH  },
-        { WREGISTER_LTLFTL, LTLFTL  },
-        { WREGISTER_CJTO,   CJTO    }
-    };
+    static uint8_t rx_buffer[sizeof(m_register_image)];
+
+    bool success = spi_transfer(m_spi, m_register_image, sizeof(m_register_image), rx_buffer, sizeof(rx_buffer));
 
-    bool success = true;
-    for (int i = 0; i < (sizeof(tx_buffer) / sizeof(tx_buffer[0])); i++) 
-    {
-        static uint8_t rx_buffer[sizeof(tx_buffer[i])];
-        success &= spi_transfer(m_spi, tx_buffer[i], sizeof(tx_buffer[i]), rx_buffer, sizeof(rx_buffer));
-    }
-    
     return success ? MAX31856_SUCCESS : MAX31856_ERROR_SPI;
 }
 
@@ -126,8 +172,9 @@ max31856_status max31856_init(const nrf_drv_spi_t *const spi_instance)
     m_spi = spi_instance;
     max31856_status status = MAX31856_SUCCESS;
 
-    status |= max31856_setRegisters(m_spi);
-    status |= max31856_checkRegisters(m_spi);
+    status |= max31856_setRegisters();
+    status |= max31856_checkRegisters();
+    status |= max31856_initDRDY();
 
     if (status != MAX31856_SUCCESS)
     {
@@ -140,6 +187,19 @@ max31856_status max31856_init(const nrf_drv_spi_t *const spi_instance)
 }
 
 
+/** 
+ * @brief Function to restore the registers after the MAX31856 was powered off
+ * 
+ * @details Writes the cached register image in a single transfer, without reading it back.
+ * 
+ * @return  Error code to determine the status of MAX31856 if any
+ */
+max31856_status max31856_restore()
+{
+    return max31856_setRegisters();
+}
+
+
 /** 
  * @brief Function to check the FAULT status registers
  * 
@@ -208,76 +268,103 @@ void max31856_printFaultStatus(fault_status fault)
         case TCRANGE: NRF_LOG_ERROR("STATUS:\t Thermocouple Out-of-RANGE"); break;
         case CJRANGE: NRF_LOG_ERROR("STATUS:\t Cold-Junction Out-of-RANGE"); break;
         case UNKNOWN: NRF_LOG_ERROR("STATUS:\t UNKNOWN"); break;
-        case APPROVED: NRF_LOG_INFO("STATUS:\t APPROVED"); break;
+        case APPROVED: TLOG_INFO("STATUS:\t APPROVED"); break;
         default: NRF_LOG_ERROR("STATUS:\t FAULT not recognized"); break;
     }
 }
 
 
+/** 
+ * @brief Function to start a one-shot conversion
+ * 
+ * @details Returns right away, the handler is called from interrupt context once DRDY asserts,
+ *          or with MAX31856_ERROR_DRDY after MAX31856_CONVERSION_TIMEOUT.
+ * 
+ * @param[in] handler       Handler for the end of the conversion
+ * 
+ * @return  Error code to determine the status of MAX31856 if any
+ */
+max31856_status max31856_startConversion(max31856_conversion_handler_t handler)
+{
+    const uint8_t oneShot = CR0 | CR0_ONESHOT;
+    const uint8_t tx_buffer[] = { WREGISTER_CR0, oneShot };
+    static uint8_t rx_buffer[sizeof(tx_buffer)];
+
+    if (m_conversion_handler != NULL)
+    {
+        return MAX31856_ERROR_UNKNOWN;
+    }
+
+    m_conversion_handler = handler;
+    nrf_drv_gpiote_in_event_enable(DRDY, true);
+    APP_ERROR_CHECK(app_timer_start(m_drdy_timer_id, APP_TIMER_TICKS(MAX31856_CONVERSION_TIMEOUT), NULL));
+
+    if (!spi_transfer(m_spi, tx_buffer, sizeof(tx_buffer), rx_buffer, sizeof(rx_buffer)))
+    {
+        m_conversion_handler = NULL;
+        nrf_drv_gpiote_in_event_disable(DRDY);
+        UNUSED_RETURN_VALUE(app_timer_stop(m_drdy_timer_id));
+        return MAX31856_ERROR_SPI;
+    }
+    energy_start(ENERGY_CONVERSION);
+
+    return MAX31856_SUCCESS;
+}
+
+
 /** 
  * @brief Function to read the cold junction temperature registers and convert it to degree celcius
  * 
+ * @details Reads the result of the last conversion.
+ * 
  * @param[in] temperature   Pointer to a temperature instance for reading the cold junction value
  * 
  * @return  Error code to determine the status of MAX31856 if any
  */
-max31856_status max31856_getColdJunctionTemperature(float* temperature)
+max31856_status max31856_readColdJunctionTemperature(float* temperature)
 {
     const uint8_t tx_buffer[] = { RREGISTER_CJTH };
     static uint8_t rx_buffer[sizeof(tx_buffer) + 2];
 
-    max31856_status status = max31856_startConversion();
-    if (status == MAX31856_SUCCESS)
+    if (spi_transfer(m_spi, tx_buffer, sizeof(tx_buffer), rx_buffer, sizeof(rx_buffer)))
     {
-        if (spi_transfer(m_spi, tx_buffer, sizeof(tx_buffer), rx_buffer, sizeof(rx_buffer)))
-        {
-            uint16_t digitalTemperature = rx_buffer[1] << 8 | rx_buffer[2];
-            *temperature = (digitalTemperature >> 2) * CJ_RESOLUTION;
-            return status;
-        }
-        else
-        {
-            status = MAX31856_ERROR_SPI;
-        }
-        
+        // 14 bit two's complement, left aligned in the 16 bit register
+        int16_t digitalTemperature = (int16_t) (rx_buffer[1] << 8 | rx_buffer[2]);
+        *temperature = (digitalTemperature >> 2) * CJ_RESOLUTION;
+        return MAX31856_SUCCESS;
     }
 
     NRF_LOG_ERROR("Failed to read Cold Junction Temperature");
-    return status;
+    return MAX31856_ERROR_SPI;
 }
 
 
 /** 
  * @brief Function to read the thermocouple temperature registers and convert it to degree celcius
  * 
+ * @details Reads the result of the last conversion.
+ * 
  * @param[in] temperature   Pointer to a temperature instance for reading the thermocouple value
  * 
  * @return  Error code to determine the status of MAX31856 if any
  */
-max31856_status max31856_getThermoCoupleTemperature(float* temperature)
+max31856_status max31856_readThermoCoupleTemperature(float* temperature)
 {
     const uint8_t tx_buffer[] = { RREGISTER_LTCBH };
     static uint8_t rx_buffer[sizeof(tx_buffer) + 3];
 
-    max31856_status status = max31856_startConversion();
-    if (status == MAX31856_SUCCESS)
+    if (spi_transfer(m_spi, tx_buffer, sizeof(tx_buffer), rx_buffer, sizeof(rx_buffer)))
     {
-        if (spi_transfer(m_spi, tx_buffer, sizeof(tx_buffer), rx_buffer, sizeof(rx_buffer)))
-        {
-            uint32_t digitalTemperature = rx_buffer[1] << 16 | rx_buffer[2] << 8 | rx_buffer[3];
-            digitalTemperature |= ((digitalTemperature & 0x8000000) ? 0xFF000000 : 0x00000000);
-            *temperature = (digitalTemperature >> 5) * TC_RESOLUTION;
-            return status;
-        }
-        else
-        {
-            status = MAX31856_ERROR_SPI;
-        }
+        // 19 bit two's complement, left aligned in the 24 bit register, sign extended from bit 23
+        int32_t digitalTemperature = rx_buffer[1] << 16 | rx_buffer[2] << 8 | rx_buffer[3];
+        digitalTemperature -= ((digitalTemperature & 0x800000) ? 0x1000000 : 0);
+        *temperature = (digitalTemperature >> 5) * TC_RESOLUTION;
+        return MAX31856_SUCCESS;
     }
 
     NRF_LOG_ERROR("Failed to read Thermocouple Temperature");
-    return status;
+    return MAX31856_ERROR_SPI;
 }
 
 
-// TODO: Add interuptHandler for DRDY and FAULT pins
+// TODO: Add interuptHandler for the FAULT pin
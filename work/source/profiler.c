@@ -0,0 +1,152 @@
+#include <string.h>
+#include "sdk_common.h"
+#include "app_util.h"
+#include "app_util_platform.h"
+#include "profiler.h"
+
+
+/**
+ * @brief Typedef Struct for holding the records of a probe
+ */
+typedef struct
+{
+    uint32_t    count;                              ///< Number of recorded scopes
+    uint32_t    min;                                ///< Shortest scope [cycles], valid once count is not 0
+    uint32_t    max;                                ///< Longest scope [cycles]
+    uint64_t    sum;                                ///< Sum of the scopes [cycles]
+    uint16_t    bins[PROFILER_HISTOGRAM_BINS];      ///< Scopes per log2 bin, saturating
+} profiler_probe_record_t;
+
+
+static profiler_probe_record_t m_records[PROFILER_PROBE_COUNT];
+
+
+/**
+ * @brief Function for getting the log2 bin of a duration
+ */
+static uint8_t bin_get(uint32_t cycles)
+{
+    if (cycles < 2)
+    {
+        return 0;
+    }
+
+    uint8_t const bin = 31 - __builtin_clz(cycles);
+    return MIN(bin, PROFILER_HISTOGRAM_BINS - 1);
+}
+
+
+/**
+ * @brief Function for recording the cycles of a probe
+ *
+ * @param[in] probe                 Probe
+ * @param[in] cycles                Cycles of the scope
+ */
+void profiler_record(profiler_probe_t probe, uint32_t cycles)
+{
+    if (probe >= PROFILER_PROBE_COUNT)
+    {
+        return;
+    }
+
+    profiler_probe_record_t* p_record = &m_records[probe];
+    uint8_t const bin = bin_get(cycles);
+
+    // A probe may run in the main loop and in an interrupt
+    CRITICAL_REGION_ENTER();
+    if ((p_record->count == 0) || (cycles < p_record->min))
+    {
+        p_record->min = cycles;
+    }
+    p_record->max = MAX(p_record->max, cycles);
+    p_record->sum += cycles;
+    p_record->count++;
+    if (p_record->bins[bin] < UINT16_MAX)
+    {
+        p_record->bins[bin]++;
+    }
+    CRITICAL_REGION_EXIT();
+}
+
+
+/**
+ * @brief Function for ending a scope opened by PROFILER_SCOPE(), called by the compiler
+ *
+ * @param[in] p_scope               Scope that ends
+ */
+void profiler_scope_end(profiler_scope_t const* p_scope)
+{
+    profiler_record(p_scope->probe, energy_cycles_get() - p_scope->start);
+}
+
+
+/**
+ * @brief Function for clearing the records of every probe
+ */
+void profiler_reset(void)
+{
+    CRITICAL_REGION_ENTER();
+    memset(m_records, 0, sizeof(m_records));
+    CRITICAL_REGION_EXIT();
+}
+
+
+/**
+ * @brief Function for getting the report of a probe
+ *
+ * @param[in]  probe                Probe
+ * @param[out] p_report             Report of the probe
+ *
+ * @return      NRF_SUCCESS, NRF_ERROR_INVALID_PARAM if the probe is unknown
+ */
+ret_code_t profiler_report_get(uint8_t probe, profiler_report_t* p_report)
+{
+    profiler_probe_record_t record;
+
+    VERIFY_PARAM_NOT_NULL(p_report);
+
+    if (probe >= PROFILER_PROBE_COUNT)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    CRITICAL_REGION_ENTER();
+    record = m_records[probe];
+    CRITICAL_REGION_EXIT();
+
+    p_report->probe = probe;
+    p_report->count = record.count;
+    p_report->min   = record.min;
+    p_report->max   = record.max;
+    p_report->mean  = (record.count == 0) ? 0 : (uint32_t) ((record.sum + record.count / 2) / record.count);
+    memcpy(p_report->bins, record.bins, sizeof(p_report->bins));
+
+    return NRF_SUCCESS;
+}
+
+
+/**
+ * @brief Function for encoding the report of a probe
+ *
+ * @param[in]  p_report             Report to encode
+ * @param[out] p_data               Buffer of PROFILER_REPORT_SIZE bytes
+ *
+ * @return      Number of bytes encoded
+ */
+uint8_t profiler_report_encode(profiler_report_t const* p_report, uint8_t* p_data)
+{
+    uint8_t length = 0;
+
+    p_data[length++] = p_report->probe;
+    length += uint32_encode(p_report->count, &p_data[length]);
+    length += uint32_encode(p_report->min, &p_data[length]);
+    length += uint32_encode(p_report->max, &p_data[length]);
+    length += uint32_encode(p_report->mean, &p_data[length]);
+
+    for (uint8_t i = 0; i < PROFILER_HISTOGRAM_BINS; i++)
+    {
+        length += uint16_encode(p_report->bins[i], &p_data[length]);
+    }
+
+    return length;
+}
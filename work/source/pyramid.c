@@ -0,0 +1,191 @@
+#include <string.h>
+#include "sdk_common.h"
+#include "app_util.h"
+#include "tcs_frame.h"
+#include "pyramid.h"
+#include "temperature.h"
+
+#define LEVEL1_CAPACITY     ((PYRAMID_DAYS * 86400UL) / PYRAMID_LEVEL1_PERIOD)
+#define LEVEL2_CAPACITY     ((PYRAMID_DAYS * 86400UL) / PYRAMID_LEVEL2_PERIOD)
+
+
+/**
+ * @brief Typedef Struct for holding a bucket
+ */
+typedef struct
+{
+    int16_t     min;                    ///< Lowest sample [0.01 °C], above max if the bucket is empty
+    int16_t     max;                    ///< Highest sample [0.01 °C]
+    int16_t     mean;                   ///< Mean of the samples [0.01 °C]
+} pyramid_bucket_t;
+
+/**
+ * @brief Typedef Struct for holding a level
+ */
+typedef struct
+{
+    pyramid_bucket_t*   p_buckets;      ///< Buckets, the last one still fills
+    uint32_t            capacity;       ///< Number of buckets that fit
+    uint32_t            count;          ///< Number of buckets up to the one holding the last sample
+    uint16_t            period;         ///< Length of a bucket [s]
+    int32_t             sum;            ///< Sum of the samples of the last bucket [0.01 °C]
+    uint16_t            samples;        ///< Number of samples of the last bucket
+} pyramid_level_t;
+
+
+static pyramid_bucket_t m_level1_buckets[LEVEL1_CAPACITY];
+static pyramid_bucket_t m_level2_buckets[LEVEL2_CAPACITY];
+
+static pyramid_level_t m_levels[PYRAMID_LEVEL_COUNT - 1] =
+{
+    {m_level1_buckets, LEVEL1_CAPACITY, 0, PYRAMID_LEVEL1_PERIOD, 0, 0},
+    {m_level2_buckets, LEVEL2_CAPACITY, 0, PYRAMID_LEVEL2_PERIOD, 0, 0}
+};
+
+
+/**
+ * @brief Function for getting a level, NULL if unknown
+ */
+static pyramid_level_t* level_get(uint8_t level)
+{
+    if ((level == 0) || (level >= PYRAMID_LEVEL_COUNT))
+    {
+        return NULL;
+    }
+    return &m_levels[level - 1];
+}
+
+
+/**
+ * @brief Function for adding a sample to a level
+ */
+static void level_add(pyramid_level_t* p_level, int16_t sample, uint32_t time)
+{
+    uint32_t const index = time / p_level->period;
+
+    if (index >= p_level->capacity)
+    {
+        return;
+    }
+
+    if (index >= p_level->count)
+    {
+        // Buckets skipped by a long interval stay empty
+        for (uint32_t i = p_level->count; i <= index; i++)
+        {
+            p_level->p_buckets[i].min  = INT16_MAX;
+            p_level->p_buckets[i].max  = INT16_MIN;
+            p_level->p_buckets[i].mean = 0;
+        }
+        p_level->count   = index + 1;
+        p_level->sum     = 0;
+        p_level->samples = 0;
+    }
+    else if (index + 1 < p_level->count)
+    {
+        // Time runs forward, a closed bucket is never changed
+        return;
+    }
+
+    pyramid_bucket_t* p_bucket = &p_level->p_buckets[index];
+
+    p_level->sum += sample;
+    p_level->samples++;
+
+    int32_t const half = (p_level->sum >= 0) ? (p_level->samples / 2) : -(p_level->samples / 2);
+    p_bucket->mean = (int16_t) ((p_level->sum + half) / p_level->samples);
+    p_bucket->min  = MIN(p_bucket->min, sample);
+    p_bucket->max  = MAX(p_bucket->max, sample);
+}
+
+
+/**
+ * @brief Function for clearing the levels, with the history of the previous run
+ */
+void pyramid_reset(void)
+{
+    for (uint8_t i = 0; i < ARRAY_SIZE(m_levels); i++)
+    {
+        m_levels[i].count   = 0;
+        m_levels[i].sum     = 0;
+        m_levels[i].samples = 0;
+    }
+}
+
+
+/**
+ * @brief Function for adding a stored sample to every level
+ *
+ * @param[in] temperature           Stored sample [°C]
+ * @param[in] time                  Time of the sample since activation [s]
+ */
+void pyramid_add(float temperature, uint32_t time)
+{
+    int16_t const sample = centi_degrees(temperature);
+
+    for (uint8_t i = 0; i < ARRAY_SIZE(m_levels); i++)
+    {
+        level_add(&m_levels[i], sample, time);
+    }
+}
+
+
+/**
+ * @brief Function for getting the number of buckets of a level
+ *
+ * @param[in] level                 Level, 1 to PYRAMID_LEVEL_COUNT - 1
+ *
+ * @return      Number of buckets up to the one holding the last sample, 0 for an unknown level
+ */
+uint32_t pyramid_count(uint8_t level)
+{
+    pyramid_level_t const* p_level = level_get(level);
+
+    return (p_level != NULL) ? p_level->count : 0;
+}
+
+
+/**
+ * @brief Function for getting the bucket length of a level
+ *
+ * @param[in] level                 Level, 1 to PYRAMID_LEVEL_COUNT - 1
+ *
+ * @return      Length of a bucket [s], 0 for an unknown level
+ */
+uint16_t pyramid_period(uint8_t level)
+{
+    pyramid_level_t const* p_level = level_get(level);
+
+    return (p_level != NULL) ? p_level->period : 0;
+}
+
+
+/**
+ * @brief Function for encoding buckets of a level as the payload of a summary block
+ *
+ * @param[in]  level                Level, 1 to PYRAMID_LEVEL_COUNT - 1
+ * @param[in]  first                First bucket
+ * @param[in]  count                Number of buckets
+ * @param[out] p_data               Buffer of count x TCS_FRAME_SUMMARY_SIZE bytes
+ *
+ * @return      Number of bytes encoded, buckets past pyramid_count() are left out
+ */
+uint16_t pyramid_encode(uint8_t level, uint32_t first, uint16_t count, uint8_t* p_data)
+{
+    pyramid_level_t const* p_level = level_get(level);
+    uint16_t length = 0;
+
+    if (p_level == NULL)
+    {
+        return 0;
+    }
+
+    for (uint32_t i = first; (i < first + count) && (i < p_level->count); i++)
+    {
+        length += uint16_encode((uint16_t) p_level->p_buckets[i].min, &p_data[length]);
+        length += uint16_encode((uint16_t) p_level->p_buckets[i].max, &p_data[length]);
+        length += uint16_encode((uint16_t) p_level->p_buckets[i].mean, &p_data[length]);
+    }
+
+    return length;
+}
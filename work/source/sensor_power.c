@@ -0,0 +1,164 @@
+#include "sensor_power.h"
+#include "sdk_config.h"
+#include "app_error.h"
+#include "app_timer.h"
+#include "nrf_gpio.h"
+#include "nrf_delay.h"
+#include "max31856.h"
+
+#include "nrf_log.h"
+#include "nrf_log_ctrl.h"
+#include "nrf_log_default_backends.h"
+
+#if SENSOR_POWER_SWITCH_ENABLED
+APP_TIMER_DEF(m_power_up_timer_id);     /**< Timer waiting for the front end supply to settle. */
+#endif
+
+/** Member to hold the SPI instance */
+static const nrf_drv_spi_t *m_spi;
+
+static sensor_power_handler_t m_handler = NULL;     /**< Handler of the running power-up. */
+static uint32_t m_power_up_ticks;                   /**< RTC ticks at the start of the running power-up. */
+static uint32_t m_latency_us;                       /**< Duration of the last power-up. */
+static bool m_powered = false;                      /**< The SPIM is initialized and the front end powered. */
+
+
+/** 
+ * @brief Function for driving the load switch of the front end
+ * 
+ * @param[in] on                Boolean indicating if the front end is switched on
+ */
+static void sensor_power_switch(bool on)
+{
+#if SENSOR_POWER_SWITCH_ENABLED
+    nrf_gpio_pin_write(SENSOR_POWER_PIN, on ? SENSOR_POWER_PIN_ACTIVE : !SENSOR_POWER_PIN_ACTIVE);
+#else
+    UNUSED_PARAMETER(on);
+#endif
+}
+
+
+/** 
+ * @brief Function for ending the power-up and calling its handler
+ */
+static void sensor_power_ready(void)
+{
+    sensor_power_handler_t handler = m_handler;
+    m_handler = NULL;
+
+    m_latency_us = (uint32_t) (((uint64_t) app_timer_cnt_diff_compute(app_timer_cnt_get(), m_power_up_ticks) * 1000000) / APP_TIMER_CLOCK_FREQ);
+
+    if (handler != NULL)
+    {
+        handler();
+    }
+}
+
+
+#if SENSOR_POWER_SWITCH_ENABLED
+/** 
+ * @brief Timeout handler for the supply settling, the MAX31856 lost its registers
+ */
+static void sensor_power_up_timeout_handler(void* p_context)
+{
+    UNUSED_PARAMETER(p_context);
+
+    // DRDY was disconnected while unpowered, an open-drain line would float
+    nrf_gpio_cfg_input(DRDY, NRF_GPIO_PIN_NOPULL);
+    spi_init(m_spi);
+
+    if (max31856_restore() != MAX31856_SUCCESS)
+    {
+        // The conversion fails on its own, with the fault status of the front end
+        NRF_LOG_ERROR("Failed to restore the MAX31856 registers");
+    }
+
+    sensor_power_ready();
+}
+#endif
+
+
+/** 
+ * @brief Function for initializing the sensor front end and powering it down
+ * 
+ * @param[in] spi_instance          Instance of the spi interface to use
+ */
+void sensor_power_init(const nrf_drv_spi_t *const spi_instance)
+{
+    m_spi = spi_instance;
+
+#if SENSOR_POWER_SWITCH_ENABLED
+    ret_code_t err_code = app_timer_create(&m_power_up_timer_id, APP_TIMER_MODE_SINGLE_SHOT, sensor_power_up_timeout_handler);
+    APP_ERROR_CHECK(err_code);
+
+    sensor_power_switch(true);
+    nrf_gpio_cfg_output(SENSOR_POWER_PIN);
+    nrf_delay_ms(SENSOR_POWER_UP_DELAY);
+#endif
+
+    spi_init(m_spi);
+    max31856_init(m_spi);
+    m_powered = true;
+
+    sensor_power_down();
+}
+
+
+/** 
+ * @brief Function for powering up the front end before a conversion
+ * 
+ * @param[in] handler               Handler called once the front end is ready
+ */
+void sensor_power_up(sensor_power_handler_t handler)
+{
+    m_handler = handler;
+    m_power_up_ticks = app_timer_cnt_get();
+
+    if (m_powered)
+    {
+        sensor_power_ready();
+        return;
+    }
+    m_powered = true;
+
+#if SENSOR_POWER_SWITCH_ENABLED
+    sensor_power_switch(true);
+    APP_ERROR_CHECK(app_timer_start(m_power_up_timer_id, APP_TIMER_TICKS(SENSOR_POWER_UP_DELAY), NULL));
+#else
+    // The MAX31856 kept its registers in normally-off mode
+    spi_init(m_spi);
+    sensor_power_ready();
+#endif
+}
+
+
+/** 
+ * @brief Function for powering down the front end after a conversion was read
+ */
+void sensor_power_down(void)
+{
+    if (!m_powered || (m_handler != NULL))
+    {
+        return;
+    }
+    m_powered = false;
+
+#if SENSOR_POWER_SWITCH_ENABLED
+    spi_uninit(m_spi, false);
+    nrf_gpio_cfg_default(DRDY);
+    sensor_power_switch(false);
+#else
+    spi_uninit(m_spi, true);
+#endif
+}
+
+
+/** 
+ * @brief Function for getting the time the last power-up took
+ * 
+ * @return  Time from sensor_power_up() to the front end being ready [us]
+ */
+uint32_t sensor_power_latency_get(void)
+{
+    return m_latency_us;
+}
@@ -2,34 +2,19 @@
 #include "spi.h"
 #include "app_util_platform.h"
 #include "nrf_gpio.h"
-#include "nrf_delay.h"
 #include "boards.h"
+#include "energy.h"
+#include "profiler.h"
 #include "nrf_log.h"
 #include "nrf_log_ctrl.h"
 #include "nrf_log_default_backends.h"
 
-static volatile bool    spi_xfer_done;
-
-
-/** 
- * @brief Function for handling the SPI event
- * 
- * @param[in] p_event          Pointer to the SPI event instance
- * @param[in] p_context        Pointer to the SPI context instance
- */
-static void spi_event_handler(nrf_drv_spi_evt_t const* p_event,
-                                         void*  p_context)
-{
-    UNUSED_PARAMETER(p_event);
-    UNUSED_PARAMETER(p_context);
-
-    spi_xfer_done = true;
-}
-
-
 /** 
  * @brief Function for initializing the SPI interface
  * 
+ * @details The driver runs in blocking mode: a transfer of a few bytes at SPI_FREQUENCY is over
+ *          before an interrupt round trip would be.
+ * 
  * @param[out] spi_instance          Instance of the spi interface to use
  */
 void spi_init(const nrf_drv_spi_t* const spi_instance)
@@ -44,9 +29,42 @@ void spi_init(const nrf_drv_spi_t* const spi_instance)
     spi_config.frequency    = SPI_FREQUENCY;
     spi_config.mode         = SPI_MODE;
     spi_config.bit_order    = SPI_BIT_ORDER;
-    APP_ERROR_CHECK(nrf_drv_spi_init(spi_instance, &spi_config, spi_event_handler, NULL));
+    APP_ERROR_CHECK(nrf_drv_spi_init(spi_instance, &spi_config, NULL, NULL));
+
+    NRF_LOG_DEBUG("SPI initialized\r\n");
+}
+
 
-    NRF_LOG_INFO("SPI initialized\r\n");
+/** 
+ * @brief Function for uninitializing the SPI interface between two transfers
+ * 
+ * @details Releases the SPIM and parks the bus lines. A powered slave gets SS high and SCK, MOSI
+ *          driven to their idle level. An unpowered slave gets all lines disconnected, so the bus
+ *          does not feed it through its protection diodes.
+ * 
+ * @param[in] spi_instance          Instance of the spi interface to release
+ * @param[in] slave_powered         Boolean indicating if the slave stays powered
+ */
+void spi_uninit(const nrf_drv_spi_t* const spi_instance, bool slave_powered)
+{
+    nrf_drv_spi_uninit(spi_instance);
+
+    if (slave_powered)
+    {
+        nrf_gpio_pin_set(SPI_SS_PIN);
+        nrf_gpio_cfg_output(SPI_SS_PIN);
+        nrf_gpio_pin_clear(SPI_SCK_PIN);
+        nrf_gpio_cfg_output(SPI_SCK_PIN);
+        nrf_gpio_pin_clear(SPI_MOSI_PIN);
+        nrf_gpio_cfg_output(SPI_MOSI_PIN);
+    }
+    else
+    {
+        nrf_gpio_cfg_default(SPI_SS_PIN);
+        nrf_gpio_cfg_default(SPI_SCK_PIN);
+        nrf_gpio_cfg_default(SPI_MOSI_PIN);
+    }
+    nrf_gpio_cfg_default(SPI_MISO_PIN);
 }
 
 
@@ -65,17 +83,18 @@ bool spi_transfer(const nrf_drv_spi_t* const spi_instance,
                   const uint8_t* p_tx_buffer, uint8_t tx_buffer_length,
                   uint8_t* p_rx_buffer, uint8_t rx_buffer_length)
 {
+    PROFILER_SCOPE(PROFILER_PROBE_SPI_TRANSFER);
+
     memset(p_rx_buffer, 0, rx_buffer_length);
-    spi_xfer_done = false;
 
-    APP_ERROR_CHECK(nrf_drv_spi_transfer(spi_instance, p_tx_buffer, tx_buffer_length, 
-                                         p_rx_buffer, rx_buffer_length));
+    // Transfers take microseconds, below the resolution of the RTC
+    uint32_t start_cycles = energy_cycles_get();
 
-    while (!spi_xfer_done)
-    {
-        __WFE();
-    }
+    ret_code_t err_code = nrf_drv_spi_transfer(spi_instance, p_tx_buffer, tx_buffer_length, 
+                                               p_rx_buffer, rx_buffer_length);
+
+    energy_cycles_add(ENERGY_SPI, energy_cycles_get() - start_cycles);
 
-    return spi_xfer_done;
+    return err_code == NRF_SUCCESS;
 }
 
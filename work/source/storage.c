@@ -1,15 +1,19 @@
 
 #include "boards.h"
+#include "sdk_common.h"
 #include "sdk_errors.h"
+#include "app_util_platform.h"
 #include "fds.h"
 #include "storage.h"
+#include "energy.h"
+#include "profiler.h"
+#include "tlog.h"
 
 #include "nrf_log.h"
 #include "nrf_log_ctrl.h"
 #include "nrf_log_default_backends.h"
 
 
-static volatile bool m_fds_write_flag = false; 
 static volatile bool m_fds_all_records_deleted_flag = false;
 
 static volatile uint16_t m_number_of_records = 0;
@@ -17,12 +21,98 @@ static volatile uint16_t m_number_of_records = 0;
 static volatile uint32_t m_read_file_id = 0;
 static volatile uint32_t m_read_record_key = 0;
 
+static volatile uint32_t m_write_file_id = 0;       /**< File of the records counted by fds_write(). */
+static volatile uint32_t m_write_record_key = 0;    /**< Key of the records counted by fds_write(). */
+
+static fds_storage_evt_handler_t m_evt_handler = NULL;
+
+static volatile uint8_t m_flash_ops = 0;    /**< Operations queued by this module, for the energy accounting. */
+
+/**
+ * @brief Typedef Struct for holding the update of a file, see fds_update_deferred()
+ */
+typedef struct
+{
+    uint16_t        file_id;                            ///< File of the record, 0 if the slot is unused
+    uint16_t        record_key;                         ///< Key of the record
+    uint16_t        length_words;                       ///< Length of the record in words
+    bool            pending;                            ///< The snapshot is being written by FDS
+    bool            resubmit;                           ///< The source changed while the snapshot was written
+    void const*     p_source;                           ///< Data the snapshot is taken from
+    uint32_t        snapshot[UPDATE_RECORD_WORDS];      ///< Copy of the data held on to by FDS
+} update_slot_t;
+
+static update_slot_t m_update_slots[UPDATE_FILE_COUNT];     /**< Files updated through fds_update_deferred(). */
+
+
+/**
+ * @brief   Function for accounting a flash operation that was queued
+ */
+static void flash_op_start(void)
+{
+    m_flash_ops++;
+    energy_start(ENERGY_FLASH);
+}
+
+
+/**
+ * @brief   Function for taking a snapshot of the source of a slot and queueing its update
+ * 
+ * @details Call from a critical region.
+ */
+static ret_code_t update_slot_submit(update_slot_t* p_slot)
+{
+    memcpy(p_slot->snapshot, p_slot->p_source, p_slot->length_words * WORD);
+    p_slot->resubmit = false;
+
+    ret_code_t err_code = fds_update(p_slot->file_id, p_slot->record_key, p_slot->snapshot, p_slot->length_words);
+    p_slot->pending = (err_code == NRF_SUCCESS);
+    return err_code;
+}
+
+
+/**
+ * @brief   Function for completing the update of a file, and queueing the data that changed meanwhile
+ */
+static void update_slot_complete(uint16_t file_id)
+{
+    ret_code_t err_code = NRF_SUCCESS;
+
+    CRITICAL_REGION_ENTER();
+    for (uint8_t i = 0; i < UPDATE_FILE_COUNT; i++)
+    {
+        update_slot_t* p_slot = &m_update_slots[i];
+
+        if ((p_slot->file_id == file_id) && p_slot->pending)
+        {
+            p_slot->pending = false;
+            if (p_slot->resubmit)
+            {
+                err_code = update_slot_submit(p_slot);
+            }
+        }
+    }
+    CRITICAL_REGION_EXIT();
+
+    if (err_code != NRF_SUCCESS)
+    {
+        TLOG_WARNING("Record of file 0x%04X not updated: %d", file_id, err_code);
+    }
+}
+
 
 /**
  * @brief   Event handler for the FDS.
  */
 static void fds_evt_handler(fds_evt_t const* p_fds_evt)
 {
+    // Operations of the peer manager end here as well, the error is bounded by its few writes
+    if ((p_fds_evt->id != FDS_EVT_INIT) && (m_flash_ops > 0))
+    {
+        m_flash_ops--;
+        energy_stop(ENERGY_FLASH);
+    }
+
     switch (p_fds_evt->id)
     {
         case FDS_EVT_INIT:
@@ -33,32 +123,54 @@ static void fds_evt_handler(fds_evt_t const* p_fds_evt)
             break;
 
         case FDS_EVT_WRITE:
-            if (p_fds_evt->result == FDS_SUCCESS)
+            // The record only counts once it is in flash, a read before would come back short
+            if ((p_fds_evt->result == FDS_SUCCESS) && (p_fds_evt->write.file_id == m_write_file_id) &&
+                (p_fds_evt->write.record_key == m_write_record_key))
             {
-                fds_setWriteFlag(true);
+                m_number_of_records++;
             }
+            update_slot_complete(p_fds_evt->write.file_id);
+            break;
+
+        case FDS_EVT_UPDATE:
+            update_slot_complete(p_fds_evt->write.file_id);
             break;
 
         case FDS_EVT_DEL_RECORD:
             // NRF_LOG_INFO("FDS_EVT_DEL_RECORD");
-            fds_find_and_delete(m_read_file_id, m_read_record_key);
+            // Records of the peer manager are deleted through the same FDS instance
+            if (p_fds_evt->del.file_id == m_read_file_id)
+            {
+                fds_find_and_delete(m_read_file_id, m_read_record_key);
+            }
             break;
 
         default:
             break;
     }
+
+    if (m_evt_handler != NULL)
+    {
+        m_evt_handler(p_fds_evt);
+    }
 }
 
 
 /** 
  * @brief Function for running the garbage collector
  * 
+ * @details Completion is reported by FDS_EVT_GC.
+ * 
  * @return      NRF_SUCCESS if successful, else error code
  */
-static ret_code_t fds_garbage_collector()
+ret_code_t fds_garbage_collector(void)
 {
     // call the garbage collector to empty them, don't need to do this all the time, this is just for demonstration
     ret_code_t err_code = fds_gc();
+    if (err_code == FDS_SUCCESS)
+    {
+        flash_op_start();
+    }
     return (err_code != FDS_SUCCESS) ? err_code : NRF_SUCCESS;
 }
 
@@ -66,6 +178,9 @@ static ret_code_t fds_garbage_collector()
 /** 
  * @brief Function for writing to the FDS
  * 
+ * @details The data is copied, one write may be queued at a time. The record is counted by
+ *          fds_getNumberOfRecords() once FDS_EVT_WRITE reports it in flash.
+ * 
  * @param[in] write_file_id             ID of the file to write
  * @param[in] write_record key          Key of the record to write to
  * @param[in] p_write_data              Pointer to the data container
@@ -74,11 +189,16 @@ static ret_code_t fds_garbage_collector()
  */
 ret_code_t fds_write(uint32_t write_file_id, uint32_t write_record_key, uint8_t* p_write_data, uint32_t data_length)
 {    
-    uint8_t m_write_buffer[MAX_RECORD_SIZE * TC_DATA_SIZE] = {0};
+    PROFILER_SCOPE(PROFILER_PROBE_FDS_WRITE);
+
+    uint8_t m_write_buffer[MAX_RECORD_SIZE * TC_SAMPLE_MAX_SIZE] = {0};
 	memcpy(m_write_buffer, p_write_data, data_length);
 
+    // A record of 6 byte samples may end within a word, the padding stays 0
+    data_length = CEIL_DIV(data_length, WORD) * WORD;
+
     // Convert uint8_t array to uint32_t array (bytes > words)
-    static uint32_t m_write_buffer_words[MAX_RECORD_SIZE] = {0};
+    static uint32_t m_write_buffer_words[(MAX_RECORD_SIZE * TC_SAMPLE_MAX_SIZE) / WORD] = {0};
     for (int i = 0, j = 0; i < data_length; i+=4, j++)
     {
         m_write_buffer_words[j] = (m_write_buffer[i + 0] << 0) | (m_write_buffer[i + 1] << 8) | (m_write_buffer[i + 2] << 16) | (m_write_buffer[i + 3] << 24);
@@ -99,14 +219,152 @@ ret_code_t fds_write(uint32_t write_file_id, uint32_t write_record_key, uint8_t*
         NRF_LOG_ERROR("ERROR %d: fds_record_write", ret);
         return ret;
     }
+    flash_op_start();
 
-    NRF_LOG_INFO("Writing Record ID = %d\r\n", record_desc.record_id);
-    m_number_of_records++;
+    TLOG_INFO("Writing Record ID = %u", record_desc.record_id);
+    m_write_file_id    = write_file_id;
+    m_write_record_key = write_record_key;
 
     return NRF_SUCCESS;
 }
 
 
+/** 
+ * @brief Function for writing a single record, replacing the previous version
+ * 
+ * @details The data must stay valid until the FDS_EVT_UPDATE or FDS_EVT_WRITE event. When the
+ *          flash is full the garbage collector is started and the update has to be retried.
+ * 
+ * @param[in] write_file_id             ID of the file to write
+ * @param[in] write_record_key          Key of the record to write to
+ * @param[in] p_write_data              Pointer to the word aligned data
+ * @param[in] length_words              Length of the data in words
+ * 
+ * @return      NRF_SUCCESS if successful, else error code
+ */
+ret_code_t fds_update(uint32_t write_file_id, uint32_t write_record_key, void const* p_write_data, uint32_t length_words)
+{
+    fds_record_t        record;
+    fds_record_desc_t   record_desc;
+    fds_find_token_t    ftok = {0};
+    ret_code_t          ret;
+
+    record.file_id              = write_file_id;
+    record.key                  = write_record_key;
+    record.data.p_data          = p_write_data;
+    record.data.length_words    = length_words;
+
+    if (fds_record_find(write_file_id, write_record_key, &record_desc, &ftok) == FDS_SUCCESS)
+    {
+        ret = fds_record_update(&record_desc, &record);
+    }
+    else
+    {
+        ret = fds_record_write(&record_desc, &record);
+    }
+
+    if (ret == FDS_ERR_NO_SPACE_IN_FLASH)
+    {
+        // Updated records leave their old version behind until the garbage collector runs
+        UNUSED_RETURN_VALUE(fds_garbage_collector());
+    }
+
+    if (ret != FDS_SUCCESS)
+    {
+        return ret;
+    }
+
+    flash_op_start();
+    return NRF_SUCCESS;
+}
+
+
+/** 
+ * @brief Function for updating a record from data that keeps changing
+ * 
+ * @details The data is copied to a snapshot that FDS writes. While the update of the file is in
+ *          flight, a new call only notes the source, which is copied again and written once the
+ *          FDS_EVT_UPDATE or FDS_EVT_WRITE event arrives, so the last call always ends up in flash.
+ *          One record per file, callable from interrupt context.
+ * 
+ * @param[in] write_file_id             ID of the file to write
+ * @param[in] write_record_key          Key of the record to write to
+ * @param[in] p_source                  Pointer to the data, valid for the whole run
+ * @param[in] length_words              Length of the data in words, at most UPDATE_RECORD_WORDS
+ * 
+ * @return      NRF_SUCCESS if the update was queued or deferred, else error code
+ */
+ret_code_t fds_update_deferred(uint32_t write_file_id, uint32_t write_record_key, void const* p_source, uint32_t length_words)
+{
+    update_slot_t* p_slot = NULL;
+    ret_code_t err_code = NRF_SUCCESS;
+
+    if (length_words > UPDATE_RECORD_WORDS)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+
+    CRITICAL_REGION_ENTER();
+    for (uint8_t i = 0; (i < UPDATE_FILE_COUNT) && (p_slot == NULL); i++)
+    {
+        if (m_update_slots[i].file_id == write_file_id)
+        {
+            p_slot = &m_update_slots[i];
+        }
+    }
+    for (uint8_t i = 0; (i < UPDATE_FILE_COUNT) && (p_slot == NULL); i++)
+    {
+        if (m_update_slots[i].file_id == 0)
+        {
+            p_slot = &m_update_slots[i];
+            p_slot->file_id = (uint16_t) write_file_id;
+        }
+    }
+
+    if (p_slot == NULL)
+    {
+        err_code = NRF_ERROR_NO_MEM;
+    }
+    else
+    {
+        p_slot->record_key      = (uint16_t) write_record_key;
+        p_slot->length_words    = (uint16_t) length_words;
+        p_slot->p_source        = p_source;
+
+        if (p_slot->pending)
+        {
+            // FDS still reads the snapshot, the new data follows on completion
+            p_slot->resubmit = true;
+        }
+        else
+        {
+            err_code = update_slot_submit(p_slot);
+        }
+    }
+    CRITICAL_REGION_EXIT();
+
+    return err_code;
+}
+
+
+/** 
+ * @brief Function for deleting every record of a file
+ * 
+ * @param[in] file_id                   ID of the file to delete
+ * 
+ * @return      NRF_SUCCESS if successful, else error code
+ */
+ret_code_t fds_delete_file(uint32_t file_id)
+{
+    ret_code_t err_code = fds_file_delete((uint16_t) file_id);
+    if (err_code == FDS_SUCCESS)
+    {
+        flash_op_start();
+    }
+    return (err_code != FDS_SUCCESS) ? err_code : NRF_SUCCESS;
+}
+
+
 /** 
  * @brief Function for reading from the FDS
  * 
@@ -116,8 +374,10 @@ ret_code_t fds_write(uint32_t write_file_id, uint32_t write_record_key, uint8_t*
  * 
  * @return      NRF_SUCCESS if successful, else error code
  */
-ret_code_t fds_read(uint32_t read_file_id, uint32_t read_record_key, uint8_t (*p_read_data)[MAX_RECORD_SIZE * TC_DATA_SIZE])
+ret_code_t fds_read(uint32_t read_file_id, uint32_t read_record_key, uint8_t (*p_read_data)[MAX_RECORD_SIZE * TC_SAMPLE_MAX_SIZE])
 {
+    PROFILER_SCOPE(PROFILER_PROBE_FDS_READ);
+
     fds_flash_record_t  flash_record;
     fds_record_desc_t   record_desc;
     fds_find_token_t    ftok = {0};
@@ -141,7 +401,7 @@ ret_code_t fds_read(uint32_t read_file_id, uint32_t read_record_key, uint8_t (*p
         data = (uint32_t*) flash_record.p_data;
         
         // Convert uint32_t array to uint8_t array (words -> bytes)
-        static uint8_t m_read_buffer_bytes[MAX_RECORD_SIZE * WORD] = {0};
+        static uint8_t m_read_buffer_bytes[MAX_RECORD_SIZE * TC_SAMPLE_MAX_SIZE] = {0};
         for (int i = 0, j = 0; i < flash_record.p_header->length_words; i++, j+=4)
         {
             // NRF_LOG_INFO("Read: 0x%8x", data[i]);
@@ -166,6 +426,60 @@ ret_code_t fds_read(uint32_t read_file_id, uint32_t read_record_key, uint8_t (*p
 }
 
 
+/** 
+ * @brief Function for reading a chunk of the concatenated records of a file
+ * 
+ * @param[in] read_file_id              ID of the file to read
+ * @param[in] read_record key           Key of the records to read
+ * @param[in] offset                    Byte offset in the stream to start reading at
+ * @param[out] p_read_data              Pointer to the data container
+ * @param[in] length                    Maximum number of bytes to read
+ * 
+ * @return      Number of bytes read
+ */
+uint32_t fds_read_chunk(uint32_t read_file_id, uint32_t read_record_key, uint32_t offset, uint8_t* p_read_data, uint32_t length)
+{
+    PROFILER_SCOPE(PROFILER_PROBE_FDS_READ);
+
+    fds_flash_record_t  flash_record;
+    fds_record_desc_t   record_desc;
+    fds_find_token_t    ftok = {0};
+
+    uint32_t record_start = 0;
+    uint32_t bytes_read = 0;
+
+    while ((bytes_read < length) && (fds_record_find(read_file_id, read_record_key, &record_desc, &ftok) == FDS_SUCCESS))
+    {
+        if (fds_record_open(&record_desc, &flash_record) != FDS_SUCCESS)
+        {
+            NRF_LOG_ERROR("ERROR: fds_record_open");
+            break;
+        }
+
+        uint32_t record_length = flash_record.p_header->length_words * WORD;
+        uint32_t position = offset + bytes_read;
+
+        // Records are stored as little endian words, the same layout as the bytes that were written
+        if (position < record_start + record_length)
+        {
+            uint32_t record_offset = position - record_start;
+            uint32_t chunk_length = MIN(record_length - record_offset, length - bytes_read);
+
+            memcpy(&p_read_data[bytes_read], (uint8_t const*) flash_record.p_data + record_offset, chunk_length);
+            bytes_read += chunk_length;
+        }
+        record_start += record_length;
+
+        if (fds_record_close(&record_desc) != FDS_SUCCESS)
+        {
+            NRF_LOG_ERROR("ERROR: fds_record_close");
+            break;
+        }
+    }
+    return bytes_read;
+}
+
+
 /** 
  * @brief Function for finding and deleting records within a file
  * 
@@ -193,7 +507,11 @@ ret_code_t fds_find_and_delete(uint32_t read_file_id, uint32_t read_record_key)
     if ((ret_code = fds_record_find(read_file_id, read_record_key, &record_desc, &ftok)) == FDS_SUCCESS)
     {
         err_code = fds_record_delete(&record_desc);
-        if (err_code != FDS_SUCCESS)
+        if (err_code == FDS_SUCCESS)
+        {
+            flash_op_start();
+        }
+        else
         {
             // TODO: handle this error properly
             NRF_LOG_ERROR("ERROR %d: fds_record_delete", err_code);
@@ -219,10 +537,14 @@ ret_code_t fds_find_and_delete(uint32_t read_file_id, uint32_t read_record_key)
 /** 
  * @brief Function for initializing the FDS
  * 
+ * @param[in] evt_handler               Handler for the FDS events, may be NULL
+ * 
  * @return      NRF_SUCCESS if successful, else error code
  */
-ret_code_t fds_storage_init(void)
+ret_code_t fds_storage_init(fds_storage_evt_handler_t evt_handler)
 {
+    m_evt_handler = evt_handler;
+
     ret_code_t ret = fds_register(fds_evt_handler);
     if (ret != FDS_SUCCESS)
     {
@@ -240,28 +562,6 @@ ret_code_t fds_storage_init(void)
 }
 
 
-/** 
- * @brief Function for getting the write flag
- * 
- * @return      Boolean indicating the flag status
- */
-bool fds_getWriteFlag(void)
-{
-    return m_fds_write_flag;
-}
-
-
-/** 
- * @brief Function for setting the write flag
- * 
- * @param[in] fds_write_flag        Boolean indicating the flag status
- */
-void fds_setWriteFlag(bool fds_write_flag)
-{
-    m_fds_write_flag = fds_write_flag;
-}
-
-
 /** 
  * @brief Function for getting all records deleted flag
  * 
@@ -287,7 +587,7 @@ void fds_setAllRecordsDeletedFlag(bool fds_all_records_deleted_flag)
 /** 
  * @brief Function for getting the number of found records
  * 
- * @return      16 bit initeger indicating the number of records found
+ * @return      16 bit initeger indicating the number of records found, and written since
  */
 uint16_t fds_getNumberOfRecords(void)
 {
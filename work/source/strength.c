@@ -0,0 +1,352 @@
+#include <string.h>
+#include "sdk_common.h"
+#include "app_util.h"
+#include "storage.h"
+#include "strength.h"
+#include "tlog.h"
+
+#include "nrf_log.h"
+
+#define Q16_ONE             (1 << 16)
+#define MINUTES_PER_DAY     1440
+
+
+/**
+ * @brief Typedef Struct for holding the calibration curve, as stored in flash
+ */
+typedef struct
+{
+    uint32_t    maturity[STRENGTH_POINT_COUNT];     ///< Temperature-time factor of every point [0.1 °C·h]
+    uint16_t    strength[STRENGTH_POINT_COUNT];     ///< Strength of every point [0.01 MPa]
+    uint16_t    target;                             ///< Target strength [0.01 MPa]
+    uint8_t     points;                             ///< Number of points in use
+    uint8_t     reserved;
+} strength_curve_t;
+
+STATIC_ASSERT(sizeof(strength_curve_t) <= (UPDATE_RECORD_WORDS * WORD));
+
+
+static strength_curve_t m_curve;                    /**< Curve in use. */
+static strength_curve_t m_pending;                  /**< Points staged by strength_point_set(). */
+static int64_t m_tangents[STRENGTH_POINT_COUNT];    /**< Slope of the curve at every point, Q16 [0.01 MPa per 0.1 °C·h]. */
+
+
+/**
+ * @brief Function for writing the curve to flash
+ */
+static void strength_log(void)
+{
+    // A target written right after a curve is written once the update of the curve completes
+    ret_code_t err_code = fds_update_deferred(STRENGTH_FILE_ID, STRENGTH_REC_KEY, &m_curve, sizeof(m_curve) / WORD);
+    if (err_code != NRF_SUCCESS)
+    {
+        TLOG_WARNING("Strength curve not logged: %d", err_code);
+    }
+}
+
+
+/**
+ * @brief Function for computing the slope of the curve at every point (Fritsch-Carlson)
+ *
+ * @details Runs once per upload, the weighted harmonic mean keeps every segment monotone.
+ */
+static void tangents_update(void)
+{
+    uint8_t const points = m_curve.points;
+    float secants[STRENGTH_POINT_COUNT];
+
+    memset(m_tangents, 0, sizeof(m_tangents));
+    if (points < 2)
+    {
+        return;
+    }
+
+    for (uint8_t i = 0; i + 1 < points; i++)
+    {
+        secants[i] = ((float) (m_curve.strength[i + 1] - m_curve.strength[i]) * Q16_ONE) /
+                     (float) (m_curve.maturity[i + 1] - m_curve.maturity[i]);
+    }
+
+    m_tangents[0]          = (int64_t) secants[0];
+    m_tangents[points - 1] = (int64_t) secants[points - 2];
+
+    for (uint8_t i = 1; i + 1 < points; i++)
+    {
+        if ((secants[i - 1] <= 0.0f) || (secants[i] <= 0.0f))
+        {
+            // Flat on either side, a flat tangent keeps the curve from overshooting
+            continue;
+        }
+
+        float const before = (float) (m_curve.maturity[i] - m_curve.maturity[i - 1]);
+        float const after  = (float) (m_curve.maturity[i + 1] - m_curve.maturity[i]);
+        float const w1     = 2.0f * after + before;
+        float const w2     = after + 2.0f * before;
+
+        m_tangents[i] = (int64_t) ((w1 + w2) / ((w1 / secants[i - 1]) + (w2 / secants[i])));
+    }
+}
+
+
+/**
+ * @brief Function for evaluating the cubic of a segment
+ *
+ * @param[in] index                 Segment from point index to point index + 1
+ * @param[in] maturity              Factor within the segment [0.1 °C·h]
+ */
+static uint16_t segment_at(uint8_t index, uint32_t maturity)
+{
+    uint32_t const width = m_curve.maturity[index + 1] - m_curve.maturity[index];
+    int64_t const t      = (int64_t) ((((uint64_t) (maturity - m_curve.maturity[index])) << 16) / width);
+    int64_t const t2     = (t * t) >> 16;
+    int64_t const t3     = (t2 * t) >> 16;
+
+    // Cubic Hermite basis, Q16
+    int64_t const h00 = 2 * t3 - 3 * t2 + Q16_ONE;
+    int64_t const h10 = t3 - 2 * t2 + t;
+    int64_t const h01 = -2 * t3 + 3 * t2;
+    int64_t const h11 = t3 - t2;
+
+    int64_t const strength = h00 * ((int64_t) m_curve.strength[index] << 16) +
+                             h10 * (width * m_tangents[index]) +
+                             h01 * ((int64_t) m_curve.strength[index + 1] << 16) +
+                             h11 * (width * m_tangents[index + 1]);
+
+    int64_t const rounded = (strength + ((int64_t) 1 << 31)) >> 32;
+
+    return (uint16_t) MIN(MAX(rounded, m_curve.strength[index]), m_curve.strength[index + 1]);
+}
+
+
+/**
+ * @brief Function for finding the lowest factor at which the curve reaches a strength
+ *
+ * @param[in] strength              Strength up to the last point [0.01 MPa]
+ */
+static uint32_t maturity_at(uint16_t strength)
+{
+    uint8_t index = 0;
+
+    if (strength <= m_curve.strength[0])
+    {
+        return (m_curve.strength[0] == 0) ? 0 :
+               (uint32_t) CEIL_DIV((uint64_t) m_curve.maturity[0] * strength, m_curve.strength[0]);
+    }
+
+    while ((index + 2 < m_curve.points) && (m_curve.strength[index + 1] < strength))
+    {
+        index++;
+    }
+
+    // The segment is monotone, bisect it
+    uint32_t low  = m_curve.maturity[index];
+    uint32_t high = m_curve.maturity[index + 1];
+
+    while (low < high)
+    {
+        uint32_t const middle = low + (high - low) / 2;
+
+        if (segment_at(index, middle) >= strength)
+        {
+            high = middle;
+        }
+        else
+        {
+            low = middle + 1;
+        }
+    }
+    return low;
+}
+
+
+/**
+ * @brief Function for initializing the estimate without a curve and the STRENGTH_TARGET target
+ */
+void strength_init(void)
+{
+    memset(&m_curve, 0, sizeof(m_curve));
+    memset(&m_pending, 0, sizeof(m_pending));
+    memset(m_tangents, 0, sizeof(m_tangents));
+
+    m_curve.target = (uint16_t) (STRENGTH_TARGET * 100);
+}
+
+
+/**
+ * @brief Function for restoring the curve and the target from flash
+ */
+void strength_restore(void)
+{
+    strength_curve_t stored;
+
+    if ((fds_read_chunk(STRENGTH_FILE_ID, STRENGTH_REC_KEY, 0, (uint8_t*) &stored, sizeof(stored)) != sizeof(stored)) ||
+        (stored.points > STRENGTH_POINT_COUNT))
+    {
+        NRF_LOG_INFO("No strength curve in flash\r\n");
+        return;
+    }
+
+    m_curve = stored;
+    tangents_update();
+
+    NRF_LOG_INFO("Strength curve restored, %d points\r\n", m_curve.points);
+}
+
+
+/**
+ * @brief Function for staging a calibration point
+ *
+ * @param[in] index                 Index of the point, in order of maturity
+ * @param[in] maturity              Temperature-time factor of the point [0.1 °C·h]
+ * @param[in] strength              Strength at that factor [0.01 MPa]
+ *
+ * @return      NRF_SUCCESS, NRF_ERROR_INVALID_PARAM if the index is out of range
+ */
+ret_code_t strength_point_set(uint8_t index, uint32_t maturity, uint16_t strength)
+{
+    if (index >= STRENGTH_POINT_COUNT)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    m_pending.maturity[index] = maturity;
+    m_pending.strength[index] = strength;
+    return NRF_SUCCESS;
+}
+
+
+/**
+ * @brief Function for taking the staged points as the curve and writing it to flash
+ *
+ * @param[in] points                Number of staged points making up the curve, 0 to remove the curve
+ *
+ * @return      NRF_SUCCESS, NRF_ERROR_INVALID_PARAM if there is a single point, the factors are not
+ *              strictly increasing or the strength drops
+ */
+ret_code_t strength_curve_save(uint8_t points)
+{
+    if ((points == 1) || (points > STRENGTH_POINT_COUNT))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    for (uint8_t i = 1; i < points; i++)
+    {
+        if ((m_pending.maturity[i] <= m_pending.maturity[i - 1]) || (m_pending.strength[i] < m_pending.strength[i - 1]))
+        {
+            return NRF_ERROR_INVALID_PARAM;
+        }
+    }
+
+    memcpy(m_curve.maturity, m_pending.maturity, sizeof(m_curve.maturity));
+    memcpy(m_curve.strength, m_pending.strength, sizeof(m_curve.strength));
+    m_curve.points = points;
+    tangents_update();
+
+    TLOG_INFO("Strength curve of %d points", points);
+    strength_log();
+    return NRF_SUCCESS;
+}
+
+
+/**
+ * @brief Function for setting the target strength and writing it to flash
+ *
+ * @param[in] target                Target strength [0.01 MPa]
+ */
+void strength_target_set(uint16_t target)
+{
+    m_curve.target = target;
+
+    TLOG_INFO("Target strength %d x0.01 MPa", target);
+    strength_log();
+}
+
+
+/**
+ * @brief Function for evaluating the curve
+ *
+ * @param[in] maturity              Temperature-time factor [0.1 °C·h]
+ *
+ * @return      Strength [0.01 MPa], 0 without a curve
+ */
+uint16_t strength_at(uint32_t maturity)
+{
+    uint8_t const last = m_curve.points - 1;
+    uint8_t index = 0;
+
+    if (m_curve.points == 0)
+    {
+        return 0;
+    }
+    if (maturity <= m_curve.maturity[0])
+    {
+        return (m_curve.maturity[0] == 0) ? m_curve.strength[0] :
+               (uint16_t) (((uint64_t) m_curve.strength[0] * maturity) / m_curve.maturity[0]);
+    }
+    if (maturity >= m_curve.maturity[last])
+    {
+        return m_curve.strength[last];
+    }
+
+    while (m_curve.maturity[index + 1] <= maturity)
+    {
+        index++;
+    }
+    return segment_at(index, maturity);
+}
+
+
+/**
+ * @brief Function for computing the strength report
+ *
+ * @param[in]  maturity             Temperature-time factor [0.1 °C·h]
+ * @param[in]  rate                 Factor gained per day at the current temperature [0.1 °C·h/day]
+ * @param[out] p_report             Report of the estimate
+ */
+void strength_report_get(uint32_t maturity, uint32_t rate, strength_report_t* p_report)
+{
+    p_report->strength       = strength_at(maturity);
+    p_report->target         = m_curve.target;
+    p_report->points         = m_curve.points;
+    p_report->time_to_target = STRENGTH_TIME_UNKNOWN;
+
+    if (m_curve.points == 0)
+    {
+        return;
+    }
+
+    if (p_report->strength >= m_curve.target)
+    {
+        p_report->time_to_target = 0;
+    }
+    else if ((m_curve.target <= m_curve.strength[m_curve.points - 1]) && (rate > 0))
+    {
+        // The temperature of the last day is assumed to hold
+        uint32_t const reached = maturity_at(m_curve.target);
+        uint64_t const minutes = CEIL_DIV((uint64_t) (reached - MIN(reached, maturity)) * MINUTES_PER_DAY, rate);
+
+        p_report->time_to_target = (uint32_t) MIN(minutes, STRENGTH_TIME_UNKNOWN - 1);
+    }
+}
+
+
+/**
+ * @brief Function for encoding the strength report
+ *
+ * @param[in]  p_report             Report to encode
+ * @param[out] p_data               Buffer of STRENGTH_REPORT_SIZE bytes
+ *
+ * @return      Number of bytes encoded
+ */
+uint8_t strength_report_encode(strength_report_t const* p_report, uint8_t* p_data)
+{
+    uint8_t length = 0;
+
+    length += uint16_encode(p_report->strength, &p_data[length]);
+    length += uint16_encode(p_report->target, &p_data[length]);
+    length += uint32_encode(p_report->time_to_target, &p_data[length]);
+    p_data[length++] = p_report->points;
+
+    return length;
+}
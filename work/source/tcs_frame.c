@@ -0,0 +1,132 @@
+#include "tcs_frame.h"
+#include "app_util.h"
+#include "crc16.h"
+#include <string.h>
+
+
+/**
+ * @brief Function for encoding a block
+ *
+ * @param[in]  p_header             Header fields of the block
+ * @param[in]  p_payload            Payload of the block, payload_length bytes
+ * @param[out] p_frame              Buffer for the block, at least TCS_FRAME_SIZE(payload_length) bytes
+ *
+ * @return      Length of the encoded block in bytes
+ */
+uint16_t tcs_frame_encode(tcs_frame_header_t const* p_header, uint8_t const* p_payload, uint8_t* p_frame)
+{
+    uint16_t length = 0;
+
+    p_frame[length++] = TCS_FRAME_MAGIC;
+    p_frame[length++] = (uint8_t) p_header->encoding;
+    length += uint16_encode(p_header->count, &p_frame[length]);
+    length += uint32_encode(p_header->seq_base, &p_frame[length]);
+    length += uint32_encode(p_header->time_base, &p_frame[length]);
+    length += uint16_encode(p_header->interval, &p_frame[length]);
+    length += uint16_encode(p_header->payload_length, &p_frame[length]);
+
+    if (p_header->payload_length > 0)
+    {
+        memcpy(&p_frame[length], p_payload, p_header->payload_length);
+        length += p_header->payload_length;
+    }
+
+    uint16_t crc = crc16_compute(p_frame, length, NULL);
+    length += uint16_encode(crc, &p_frame[length]);
+
+    return length;
+}
+
+
+/**
+ * @brief Function for getting the sample encoding of a channel mask
+ *
+ * @param[in]  channels             TCS_CHANNEL_* bits, at least one
+ *
+ * @return      Encoding of the blocks holding these channels
+ */
+tcs_frame_encoding tcs_frame_channels_encoding(uint8_t channels)
+{
+    if (!(channels & TCS_CHANNEL_COLD_JUNCTION))
+    {
+        return TCS_FRAME_ENCODING_FLOAT32;
+    }
+    return (channels & TCS_CHANNEL_PROBE) ? TCS_FRAME_ENCODING_DUAL : TCS_FRAME_ENCODING_COLD_JUNCTION;
+}
+
+
+/**
+ * @brief Function for getting the size of a sample
+ *
+ * @param[in]  encoding             Encoding of the sample, one of the sample encodings
+ *
+ * @return      Size of a sample in bytes
+ */
+uint8_t tcs_frame_sample_size(tcs_frame_encoding encoding)
+{
+    switch (encoding)
+    {
+        case TCS_FRAME_ENCODING_COLD_JUNCTION:
+            return TCS_FRAME_COLD_JUNCTION_SIZE;
+
+        case TCS_FRAME_ENCODING_DUAL:
+            return TCS_FRAME_SAMPLE_MAX_SIZE;
+
+        default:
+            return TCS_FRAME_PROBE_SIZE;
+    }
+}
+
+
+/**
+ * @brief Function for encoding the channels of a sample
+ *
+ * @param[in]  encoding             Encoding of the sample, one of the sample encodings
+ * @param[in]  probe                Probe temperature [°C]
+ * @param[in]  cold_junction        Cold junction temperature [°C]
+ * @param[out] p_data               Buffer of tcs_frame_sample_size() bytes
+ *
+ * @return      Number of bytes encoded
+ */
+uint8_t tcs_frame_sample_encode(tcs_frame_encoding encoding, float probe, float cold_junction, uint8_t* p_data)
+{
+    uint8_t length = 0;
+
+    if (encoding != TCS_FRAME_ENCODING_COLD_JUNCTION)
+    {
+        memcpy(&p_data[length], &probe, TCS_FRAME_PROBE_SIZE);
+        length += TCS_FRAME_PROBE_SIZE;
+    }
+    if ((encoding == TCS_FRAME_ENCODING_COLD_JUNCTION) || (encoding == TCS_FRAME_ENCODING_DUAL))
+    {
+        // The MAX31856 resolves the cold junction in 1/64 °C, the steps are kept exactly
+        float const steps = cold_junction * TCS_FRAME_COLD_JUNCTION_SCALE;
+        int16_t const value = (int16_t) MIN(MAX((steps >= 0.0f) ? (steps + 0.5f) : (steps - 0.5f), INT16_MIN), INT16_MAX);
+
+        length += uint16_encode((uint16_t) value, &p_data[length]);
+    }
+
+    return length;
+}
+
+
+/**
+ * @brief Function for decoding the first channel of a sample, the probe if it is present
+ *
+ * @param[in]  encoding             Encoding of the sample, one of the sample encodings
+ * @param[in]  p_data               Encoded sample
+ *
+ * @return      Temperature of the first channel [°C]
+ */
+float tcs_frame_sample_temperature(tcs_frame_encoding encoding, uint8_t const* p_data)
+{
+    float temperature;
+
+    if (encoding == TCS_FRAME_ENCODING_COLD_JUNCTION)
+    {
+        return (float) (int16_t) uint16_decode(p_data) / TCS_FRAME_COLD_JUNCTION_SCALE;
+    }
+
+    memcpy(&temperature, p_data, TCS_FRAME_PROBE_SIZE);
+    return temperature;
+}
@@ -7,39 +7,32 @@
 
 APP_TIMER_DEF(m_repeated_timer_id);     /**< Handler for repeated timer used to blink LED 1. */
 
-static volatile bool m_timer_int_flag = false;
-
-
-/**
- * @brief Timeout handler for the repeated timer.
- */
-static void repeated_timer_handler(void* p_context)
-{
-    timer_setIntFlag(true);
-}
-
 
 /**
  * @brief Create timers.
+ * 
+ * @param[in] timeout_handler   Timeout handler for the repeated timer
  */
-static void create_timers(void)
+static void create_timers(app_timer_timeout_handler_t timeout_handler)
 {
     ret_code_t err_code;
 
     err_code = app_timer_create(&m_repeated_timer_id,
                                 APP_TIMER_MODE_REPEATED,
-                                repeated_timer_handler);
+                                timeout_handler);
     APP_ERROR_CHECK(err_code);
 }
 
 
 /** 
  * @brief Function for initializing the timer interrupt
+ * 
+ * @param[in] timeout_handler   Handler called in interrupt context on every timeout
  */
-void timer_init(void)
+void timer_init(app_timer_timeout_handler_t timeout_handler)
 {
     APP_ERROR_CHECK(app_timer_init());
-    create_timers();
+    create_timers(timeout_handler);
 }
 
 
@@ -60,26 +53,4 @@ void timer_start(uint32_t timeout)
 void timer_stop(void)
 {
     APP_ERROR_CHECK(app_timer_stop(m_repeated_timer_id));
-}
-
-
-/** 
- * @brief Function for getting the interrupt flag
- * 
- * @return      Boolean indicating the interupt flag state
- */
-bool timer_getIntFlag(void)
-{
-    return m_timer_int_flag;
-}
-
-
-/** 
- * @brief Function for setting the interrupt flag
- * 
- * @param[in] timerIntFlag      Boolean indicating the interupt flag state
- */
-void timer_setIntFlag(bool timerIntFlag)
-{
-    m_timer_int_flag = timerIntFlag;
 }
\ No newline at end of file
@@ -0,0 +1,171 @@
+#include "tlog.h"
+#include "app_timer.h"
+#include "app_util_platform.h"
+
+#if TLOG_BACKEND_RTT_ENABLED
+#include "SEGGER_RTT.h"
+#endif
+
+#define TLOG_MASK   (TLOG_BUFSIZE - 1)
+
+STATIC_ASSERT((TLOG_BUFSIZE & TLOG_MASK) == 0);     // TLOG_BUFSIZE must be a power of two
+
+static uint8_t  m_ring[TLOG_BUFSIZE];           /**< Entries not yet read. */
+static uint32_t m_head = 0;                     /**< Free running write position. */
+static uint32_t m_tail = 0;                     /**< Free running read position. */
+static uint32_t m_lost = 0;                     /**< Entries overwritten since the last read. */
+
+#if TLOG_BACKEND_RTT_ENABLED
+static uint8_t  m_rtt_buffer[TLOG_RTT_BUFSIZE]; /**< RTT up buffer, read by the debugger. */
+#endif
+
+
+/**
+ * @brief Function for getting the size of the entry at a ring position
+ */
+static uint32_t tlog_entry_size(uint32_t pos)
+{
+    return TLOG_HEADER_SIZE + (m_ring[pos & TLOG_MASK] & 0x0F) * sizeof(uint32_t);
+}
+
+
+/**
+ * @brief Function for copying bytes into the ring
+ */
+static void tlog_ring_put(uint32_t pos, uint8_t const* p_data, uint32_t length)
+{
+    for (uint32_t i = 0; i < length; i++)
+    {
+        m_ring[(pos + i) & TLOG_MASK] = p_data[i];
+    }
+}
+
+
+/**
+ * @brief Function for initializing the binary log and its RTT channel
+ */
+void tlog_init(void)
+{
+#if TLOG_BACKEND_RTT_ENABLED
+    SEGGER_RTT_ConfigUpBuffer(TLOG_RTT_CHANNEL, "tlog", m_rtt_buffer, sizeof(m_rtt_buffer),
+                              SEGGER_RTT_MODE_NO_BLOCK_SKIP);
+#endif
+}
+
+
+/**
+ * @brief Function for appending an entry to the ring
+ *
+ * @param[in] level             Level of the entry
+ * @param[in] p_fmt             Format string in the .tlog_fmt section
+ * @param[in] nargs             Number of arguments, up to TLOG_MAX_ARGS
+ * @param[in] p_args            Arguments
+ */
+void tlog_write(uint8_t level, char const* p_fmt, uint8_t nargs, uint32_t const* p_args)
+{
+    uint32_t const token = (uint32_t) (uintptr_t) p_fmt;
+    uint32_t const ticks = app_timer_cnt_get();
+    uint32_t const length = TLOG_HEADER_SIZE + nargs * sizeof(uint32_t);
+
+    uint8_t const header[TLOG_HEADER_SIZE] =
+    {
+        (uint8_t) ((level << 4) | nargs),
+        (uint8_t) token,
+        (uint8_t) (token >> 8),
+        (uint8_t) ticks,
+        (uint8_t) (ticks >> 8),
+        (uint8_t) (ticks >> 16)
+    };
+
+    CRITICAL_REGION_ENTER();
+
+    // The most recent entries are the useful ones
+    while ((m_head - m_tail) + length > TLOG_BUFSIZE)
+    {
+        m_tail += tlog_entry_size(m_tail);
+        m_lost++;
+    }
+
+    tlog_ring_put(m_head, header, sizeof(header));
+    tlog_ring_put(m_head + TLOG_HEADER_SIZE, (uint8_t const*) p_args, length - TLOG_HEADER_SIZE);
+    m_head += length;
+
+    CRITICAL_REGION_EXIT();
+}
+
+
+/**
+ * @brief Function for reading the oldest entries out of the ring
+ *
+ * @param[out] p_data           Buffer for the entries
+ * @param[in]  size             Size of the buffer
+ *
+ * @return      Number of bytes read
+ */
+uint32_t tlog_read(uint8_t* p_data, uint32_t size)
+{
+    uint32_t length = 0;
+
+    CRITICAL_REGION_ENTER();
+
+    if ((m_lost > 0) && (size >= TLOG_HEADER_SIZE + sizeof(uint32_t)))
+    {
+        // Stamped like the oldest entry left, so the time stays monotonic for the decoder
+        uint32_t ticks = app_timer_cnt_get();
+        if (m_tail != m_head)
+        {
+            ticks = m_ring[(m_tail + 3) & TLOG_MASK] |
+                    (m_ring[(m_tail + 4) & TLOG_MASK] << 8) |
+                    (m_ring[(m_tail + 5) & TLOG_MASK] << 16);
+        }
+
+        uint8_t const lost[TLOG_HEADER_SIZE + sizeof(uint32_t)] =
+        {
+            (TLOG_LEVEL_LOST << 4) | 1, 0, 0,
+            (uint8_t) ticks, (uint8_t) (ticks >> 8), (uint8_t) (ticks >> 16),
+            (uint8_t) m_lost, (uint8_t) (m_lost >> 8), (uint8_t) (m_lost >> 16), (uint8_t) (m_lost >> 24)
+        };
+
+        memcpy(p_data, lost, sizeof(lost));
+        length = sizeof(lost);
+        m_lost = 0;
+    }
+
+    while ((m_tail != m_head) && (length + tlog_entry_size(m_tail) <= size))
+    {
+        uint32_t const entry_size = tlog_entry_size(m_tail);
+
+        for (uint32_t i = 0; i < entry_size; i++)
+        {
+            p_data[length++] = m_ring[(m_tail + i) & TLOG_MASK];
+        }
+        m_tail += entry_size;
+    }
+
+    CRITICAL_REGION_EXIT();
+
+    return length;
+}
+
+
+/**
+ * @brief Function for moving the entries to the RTT channel
+ */
+void tlog_process(void)
+{
+#if TLOG_BACKEND_RTT_ENABLED
+    uint8_t chunk[TLOG_HEADER_SIZE + TLOG_MAX_ARGS * sizeof(uint32_t)];
+
+    // Only read what fits, the ring keeps the rest while no debugger drains the channel
+    uint32_t space;
+    while ((space = SEGGER_RTT_GetAvailWriteSpace(TLOG_RTT_CHANNEL)) > 0)
+    {
+        uint32_t const length = tlog_read(chunk, MIN(space, sizeof(chunk)));
+        if (length == 0)
+        {
+            break;
+        }
+        UNUSED_RETURN_VALUE(SEGGER_RTT_Write(TLOG_RTT_CHANNEL, chunk, length));
+    }
+#endif
+}